@@ -1,12 +1,17 @@
 #include "session/session.h"
 #include "session/player.h"
+#include "session/audience.h"
 #include "session/manager.h"
+#include "session/checkpoint.h"
 
 #include "game/game_file.h"
 #include "game/manager.h"
+#include "game/watcher.h"
 
 #include "data_node.h"
 #include "errors.h"
+#include "logger.h"
+#include "metrics.h"
 
 #include "configuration.h"
 #include "game_state_object.h"
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+/**
+ * Fixed width, host byte order encoding shared by checkpoints, snapshots and
+ * the messages between shards. Readers advance a view over the input and
+ * return false rather than read past its end.
+ */
+namespace encoding
+{
+  template <typename T>
+  void put(std::string &out, T value)
+  {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+  }
+
+  template <typename T>
+  bool get(std::string_view &in, T &value)
+  {
+    if (in.size() < sizeof(T))
+    {
+      return false;
+    }
+    std::memcpy(&value, in.data(), sizeof(T));
+    in.remove_prefix(sizeof(T));
+    return true;
+  }
+
+  inline void putBytes(std::string &out, std::string_view bytes)
+  {
+    put<uint64_t>(out, bytes.size());
+    out.append(bytes);
+  }
+
+  inline bool getBytes(std::string_view &in, std::string &bytes)
+  {
+    uint64_t length;
+    if (!get(in, length) || in.size() < length)
+    {
+      return false;
+    }
+    bytes = in.substr(0, length);
+    in.remove_prefix(length);
+    return true;
+  }
+}
@@ -1,17 +1,35 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 
 class GameFile
 {
 private:
   std::string contents;
+  uint64_t contentHash;
+
+  // FNV-1a, used to tell whether a file changed when only its timestamp did
+  static uint64_t hashContents(const std::string &contents)
+  {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : contents)
+    {
+      hash = (hash ^ c) * 1099511628211ULL;
+    }
+    return hash;
+  }
 
 public:
-  GameFile(std::string contents) : contents(contents) {}
+  GameFile(std::string contents) : contents(std::move(contents)), contentHash(hashContents(this->contents)) {}
 
-  std::string getContents() const
+  const std::string &getContents() const
   {
     return contents;
   }
-};
\ No newline at end of file
+
+  uint64_t getContentHash() const
+  {
+    return contentHash;
+  }
+};
@@ -7,17 +7,31 @@
 #include <fstream>
 #include <optional>
 #include <ranges>
+#include <mutex>
 
 #include "game_file.h"
+#include "watcher.h"
 
 const std::string GAME_FILE_EXTENSION = ".game";
 
+/**
+ * Identifies the version of a game file on disk without reading it
+ */
+struct GameFileStamp
+{
+  std::string path;
+  std::filesystem::file_time_type lastWriteTime;
+};
+
 class GameManager
 {
 private:
   std::string gameDirectory;
   std::vector<std::string> gameFileNames;
 
+  // Guards gameFileNames, which the directory watcher updates in the background
+  mutable std::mutex gameListMutex;
+
   std::string getGamePath(std::string gameName) const;
 
 public:
@@ -26,10 +40,16 @@ public:
     refreshGameList();
   };
 
-  std::vector<std::string_view> listGameNames() const;
+  std::vector<std::string> listGameNames() const;
   std::optional<GameFile> readGameFile(std::string gameName) const;
+  std::optional<GameFileStamp> getGameFileStamp(std::string gameName) const;
 
   void refreshGameList();
+
+  // Apply a single change reported by a GameDirectoryWatcher without rescanning
+  void applyChange(const GameChange &change);
+
+  const std::string &getGameDirectory() const { return gameDirectory; };
 };
 
 std::string stringFromFile(std::ifstream &file);
\ No newline at end of file
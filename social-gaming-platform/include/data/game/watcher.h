@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+
+/**
+ * A game file that was added, rewritten or removed
+ */
+struct GameChange
+{
+  std::string gameName;
+  bool removed;
+};
+
+/**
+ * Watches the top level of a game directory on a background thread and
+ * reports changed game files one at a time.
+ *
+ * Uses inotify when the platform provides it and otherwise falls back to
+ * periodically comparing the directory listing and file timestamps. When
+ * inotify drops events the directory is rescanned, and when the directory
+ * itself is removed or moved the watcher goes on by polling.
+ */
+class GameDirectoryWatcher
+{
+public:
+  using ChangeCallback = std::function<void(const GameChange &)>;
+
+  GameDirectoryWatcher(std::string gameDirectory, ChangeCallback onChange,
+                       std::chrono::milliseconds pollInterval = std::chrono::milliseconds(2000));
+  ~GameDirectoryWatcher();
+
+  GameDirectoryWatcher(const GameDirectoryWatcher &) = delete;
+  GameDirectoryWatcher &operator=(const GameDirectoryWatcher &) = delete;
+
+  /**
+   * Start watching, forcePolling skips inotify
+   */
+  void start(bool forcePolling = false);
+  void stop();
+
+  bool isUsingInotify() const { return usingInotify.load(); };
+
+private:
+  std::string gameDirectory;
+  ChangeCallback onChange;
+  std::chrono::milliseconds pollInterval;
+  std::jthread worker;
+  std::atomic<bool> usingInotify = false;
+
+  // Game name to last write time of every game file in the directory
+  using GameTimes = std::map<std::string, std::filesystem::file_time_type>;
+
+  void watchWithInotify(std::stop_token stopToken, int inotifyFd, GameTimes known);
+  void watchWithPolling(std::stop_token stopToken, GameTimes known);
+
+  GameTimes scanDirectory() const;
+
+  /**
+   * Report every game that differs between two scans
+   */
+  void reportChanges(const GameTimes &known, const GameTimes &current) const;
+};
@@ -10,6 +10,9 @@ public:
     GameStateObject();
     GameStateObject(const DataNode& variables);
 
+    // Getter for the DataNode
+    const DataNode& getDataNode() const { return variables; }
+
     const DataNode& getObjectByName(std::string_view key) const;
     void setObject(std::string key, const DataNode& value);
 
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <cstdio>
+#include <expected>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+enum class LogLevel
+{
+  DEBUG = 0,
+  INFO = 1,
+  WARNING = 2,
+  ERROR = 3,
+  OFF = 4
+};
+
+// Log statements below this level are removed at compile time
+#ifndef LOG_COMPILED_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILED_LEVEL 1
+#else
+#define LOG_COMPILED_LEVEL 0
+#endif
+#endif
+
+/**
+ * Log through the global logger, e.g.
+ *   LOG_INFO("server", "client connected", {{"client", id}});
+ * Arguments are not evaluated when the level is filtered out.
+ */
+#define LOG_AT(level, ...)                                       \
+  do                                                             \
+  {                                                              \
+    if constexpr (static_cast<int>(level) >= LOG_COMPILED_LEVEL) \
+    {                                                            \
+      Logger &logger_ = Logger::instance();                      \
+      if (logger_.isEnabled(level))                              \
+      {                                                          \
+        logger_.log(level, __VA_ARGS__);                         \
+      }                                                          \
+    }                                                            \
+  } while (false)
+
+#define LOG_DEBUG(...) LOG_AT(LogLevel::DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LogLevel::INFO, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(LogLevel::WARNING, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LogLevel::ERROR, __VA_ARGS__)
+
+std::string_view logLevelName(LogLevel level);
+std::expected<LogLevel, std::string> parseLogLevel(std::string_view name);
+
+/**
+ * A key and value attached to a log record. Text values are only viewed,
+ * they are copied into the record before log() returns.
+ */
+struct LogField
+{
+  enum class Kind
+  {
+    SIGNED,
+    UNSIGNED,
+    FLOATING,
+    BOOLEAN,
+    TEXT
+  };
+
+  const char *key;
+  Kind kind;
+  union
+  {
+    long long signedValue;
+    unsigned long long unsignedValue;
+    double floatingValue;
+    bool booleanValue;
+  };
+  std::string_view text;
+
+  LogField(const char *key, std::string_view value) : key(key), kind(Kind::TEXT), signedValue(0), text(value) {}
+  LogField(const char *key, const std::string &value) : LogField(key, std::string_view(value)) {}
+  LogField(const char *key, const char *value) : LogField(key, std::string_view(value)) {}
+
+  template <std::integral T>
+  LogField(const char *key, T value) : key(key), signedValue(0)
+  {
+    if constexpr (std::same_as<T, bool>)
+    {
+      kind = Kind::BOOLEAN;
+      booleanValue = value;
+    }
+    else if constexpr (std::is_signed_v<T>)
+    {
+      kind = Kind::SIGNED;
+      signedValue = value;
+    }
+    else
+    {
+      kind = Kind::UNSIGNED;
+      unsignedValue = value;
+    }
+  }
+
+  template <std::floating_point T>
+  LogField(const char *key, T value) : key(key), kind(Kind::FLOATING), floatingValue(value) {}
+};
+
+/**
+ * Asynchronous structured logger.
+ *
+ * Callers format their record straight into a slot of a bounded lock-free
+ * ring buffer and return; a background thread writes the records out in
+ * batches, sleeping while there are none. Logging never blocks or
+ * allocates: when the buffer is full the record is dropped and counted
+ * instead.
+ *
+ * Records are written as one logfmt-style line each:
+ *   2024-01-01T12:00:00.000Z INFO    [server] client connected client=12
+ */
+class Logger
+{
+public:
+  static const size_t RECORD_TEXT_CAPACITY = 232;
+
+  /**
+   * @param capacity records the ring buffer holds, rounded up to a power of two
+   * @param output where records are written, not closed by the logger
+   */
+  explicit Logger(size_t capacity = 8192, FILE *output = stderr);
+  ~Logger();
+
+  Logger(const Logger &) = delete;
+  Logger &operator=(const Logger &) = delete;
+
+  // The logger used by the LOG_ macros
+  static Logger &instance();
+
+  bool isEnabled(LogLevel level) const noexcept
+  {
+    return level >= minimumLevel.load(std::memory_order_relaxed);
+  }
+  void setLevel(LogLevel level) noexcept { minimumLevel.store(level, std::memory_order_relaxed); };
+  LogLevel getLevel() const noexcept { return minimumLevel.load(std::memory_order_relaxed); };
+
+  // Write to a file, appending, instead of the current output
+  std::expected<void, std::string> setOutputFile(const std::string &path);
+  void setOutput(FILE *output);
+
+  void log(LogLevel level, std::string_view component, std::string_view message,
+           std::initializer_list<LogField> fields = {}) noexcept;
+
+  // Block until every record logged before the call has been written
+  void flush();
+
+  uint64_t getDroppedCount() const noexcept { return dropped.load(std::memory_order_relaxed); };
+
+private:
+  struct Record
+  {
+    int64_t timeMillis;
+    LogLevel level;
+    uint16_t length;
+    char text[RECORD_TEXT_CAPACITY];
+  };
+
+  struct Slot
+  {
+    std::atomic<size_t> sequence;
+    Record record;
+  };
+
+  std::unique_ptr<Slot[]> slots;
+  size_t mask;
+
+  alignas(64) std::atomic<size_t> enqueuePosition = 0;
+  alignas(64) std::atomic<size_t> writtenPosition = 0;
+
+  // Bumped after each record is published, the idle writer waits on it
+  alignas(64) std::atomic<uint32_t> published = 0;
+  std::atomic<uint64_t> dropped = 0;
+  std::atomic<LogLevel> minimumLevel = LogLevel::INFO;
+
+  std::mutex outputMutex;
+  FILE *output;
+  FILE *ownedOutput = nullptr;
+
+  std::jthread writer;
+
+  void writeRecords(std::stop_token stopToken);
+  void wakeWriter() noexcept;
+  size_t writeAvailable(size_t position, char *buffer, size_t bufferSize);
+};
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+// Recording threads are spread over this many cache lines of each metric
+const size_t METRIC_SHARDS = 16;
+
+/**
+ * The shard of the calling thread, assigned round-robin on first use
+ */
+inline size_t currentMetricShard() noexcept
+{
+  static std::atomic<size_t> nextShard = 0;
+  thread_local const size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS;
+  return shard;
+}
+
+/**
+ * Monotonic count of events. Each thread adds to its own cache line, so
+ * recording never contends; reading sums the shards.
+ */
+class Counter
+{
+public:
+  void add(uint64_t amount = 1) noexcept
+  {
+    cells[currentMetricShard()].value.fetch_add(amount, std::memory_order_relaxed);
+  }
+
+  uint64_t value() const noexcept;
+
+private:
+  struct alignas(64) Cell
+  {
+    std::atomic<uint64_t> value = 0;
+  };
+
+  std::array<Cell, METRIC_SHARDS> cells;
+};
+
+/**
+ * A value that goes up and down, usually set by its single owner
+ */
+class Gauge
+{
+public:
+  void set(int64_t value) noexcept { current.store(value, std::memory_order_relaxed); };
+  void add(int64_t amount) noexcept { current.fetch_add(amount, std::memory_order_relaxed); };
+  int64_t value() const noexcept { return current.load(std::memory_order_relaxed); };
+
+private:
+  alignas(64) std::atomic<int64_t> current = 0;
+};
+
+/**
+ * Distribution of durations over power of two buckets, from 1.024us up to
+ * about 17s, plus one for anything longer.
+ */
+class Histogram
+{
+public:
+  static const size_t FIRST_BOUND_BITS = 10; // the first bucket ends at 2^10 ns
+  static const size_t BUCKETS = 26;
+
+  void record(std::chrono::nanoseconds duration) noexcept
+  {
+    recordNanos(duration.count() > 0 ? static_cast<uint64_t>(duration.count()) : 0);
+  }
+
+  void recordNanos(uint64_t nanos) noexcept
+  {
+    size_t bits = std::bit_width(nanos > 0 ? nanos - 1 : 0);
+    size_t bucket = std::min(bits > FIRST_BOUND_BITS ? bits - FIRST_BOUND_BITS : 0, BUCKETS - 1);
+
+    Shard &shard = shards[currentMetricShard() % HISTOGRAM_SHARDS];
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sumNanos.fetch_add(nanos, std::memory_order_relaxed);
+  }
+
+  struct Snapshot
+  {
+    std::array<uint64_t, BUCKETS> buckets{};
+    uint64_t count = 0;
+    uint64_t sumNanos = 0;
+  };
+
+  Snapshot snapshot() const noexcept;
+
+  // Upper bound of a bucket in seconds, infinite for the last one
+  static double upperBoundSeconds(size_t bucket) noexcept;
+
+private:
+  static const size_t HISTOGRAM_SHARDS = 4;
+
+  struct alignas(64) Shard
+  {
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+    std::atomic<uint64_t> sumNanos = 0;
+  };
+
+  std::array<Shard, HISTOGRAM_SHARDS> shards;
+};
+
+/**
+ * Distribution of durations with a bounded relative error, for percentiles.
+ *
+ * Buckets are laid out the way HDR histograms do it: exact up to 64ns,
+ * then every power of two is split into 32 equal buckets, so a value is
+ * known to within about 3% up to about 69s, where recording saturates.
+ * Recording is one relaxed atomic add; reading while others record gives
+ * a consistent enough view for reporting.
+ */
+class LatencyHistogram
+{
+public:
+  static constexpr size_t SUB_BUCKET_BITS = 5;
+  static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+  static constexpr size_t MAX_VALUE_BITS = 36;
+  static constexpr size_t BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  void record(std::chrono::nanoseconds duration) noexcept
+  {
+    recordNanos(duration.count() > 0 ? static_cast<uint64_t>(duration.count()) : 0);
+  }
+
+  void recordNanos(uint64_t nanos) noexcept
+  {
+    buckets[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint64_t count() const noexcept;
+
+  /**
+   * Highest value of the bucket holding the given quantile, 0 when empty
+   * @param quantile between 0 and 1, e.g. 0.99
+   */
+  uint64_t quantileNanos(double quantile) const noexcept;
+
+  static size_t bucketOf(uint64_t nanos) noexcept
+  {
+    if (nanos < 2 * SUB_BUCKETS)
+    {
+      return static_cast<size_t>(nanos);
+    }
+    size_t shift = std::min<size_t>(std::bit_width(nanos), MAX_VALUE_BITS) - SUB_BUCKET_BITS - 1;
+    uint64_t subBucket = std::min<uint64_t>(nanos >> shift, 2 * SUB_BUCKETS - 1);
+    return shift * SUB_BUCKETS + static_cast<size_t>(subBucket);
+  }
+
+  // Highest value counted in a bucket
+  static uint64_t highestOf(size_t bucket) noexcept;
+
+private:
+  std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+};
+
+/**
+ * Every metric of the process, rendered in the Prometheus text format.
+ *
+ * Registering takes a lock and is meant to happen once per metric; keep the
+ * returned reference, which stays valid for the life of the registry.
+ * Registering the same name and labels again returns the same metric.
+ */
+class MetricsRegistry
+{
+public:
+  // The registry the server records into
+  static MetricsRegistry &instance();
+
+  /**
+   * @param labels Prometheus label pairs without braces, e.g. action="join"
+   */
+  Counter &counter(std::string_view name, std::string_view help, std::string_view labels = "");
+  Gauge &gauge(std::string_view name, std::string_view help, std::string_view labels = "");
+  Histogram &histogram(std::string_view name, std::string_view help, std::string_view labels = "");
+
+  // Text exposition of every metric, grouped by name
+  std::string render() const;
+
+private:
+  struct Entry
+  {
+    std::string name;
+    std::string help;
+    std::string labels;
+    std::variant<Counter *, Gauge *, Histogram *> metric;
+  };
+
+  mutable std::mutex mutex;
+  std::vector<Entry> entries;
+  std::deque<Counter> counters;
+  std::deque<Gauge> gauges;
+  std::deque<Histogram> histograms;
+
+  template <typename Metric>
+  Metric &find(std::deque<Metric> &metrics, std::string_view name, std::string_view help, std::string_view labels);
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "Server.h"
+
+using networking::Connection;
+
+/**
+ * Spectators of a session, kept apart from the players.
+ *
+ * Members are stored contiguously so a broadcast is a single pass over the
+ * connections, and an index by connection id keeps add and remove O(1).
+ */
+class AudienceGroup
+{
+private:
+  std::vector<Connection> members;
+  std::unordered_map<uintptr_t, size_t> memberIndex;
+
+public:
+  /**
+   * Add a spectator, returns false if they are already in the audience
+   */
+  bool add(Connection connection);
+
+  /**
+   * Remove a spectator by swapping the last member into its slot,
+   * returns false if they are not in the audience
+   */
+  bool remove(uintptr_t connectionId);
+
+  bool contains(uintptr_t connectionId) const { return memberIndex.contains(connectionId); };
+  size_t size() const { return members.size(); };
+  const std::vector<Connection> &getMembers() const { return members; };
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <expected>
+#include <cstdint>
+#include <unordered_map>
+
+#include "data/session/session.h"
+
+/**
+ * On-disk layout of a session checkpoint:
+ *
+ *   header  : magic "SGCP", u32 version, u32 session count, i32 max session id, u64 index offset
+ *   records : one encoded session per entry, back to back
+ *   index   : per session i32 id, u32 join code length and join code, u64 record offset, u32 record length
+ *
+ * Integers are in the host's byte order (see data/encoding.h), so a
+ * checkpoint is only read back on a machine of the same architecture.
+ *
+ * The index lets a reader locate any session without decoding the others,
+ * so restoring only needs to read the index and can decode sessions lazily.
+ */
+const std::string_view CHECKPOINT_MAGIC = "SGCP";
+const uint32_t CHECKPOINT_VERSION = 1;
+
+struct CheckpointEntry
+{
+  int sessionId;
+  std::string joinCode;
+  uint64_t offset;
+  uint32_t length;
+};
+
+/**
+ * Encode a session (join code, game name, interpreter position and GameData).
+ * Players are not stored, they rejoin with the join code after a restart.
+ */
+void encodeSession(std::string &out, const Session &session);
+std::expected<Session, std::string> decodeSession(std::string_view record);
+
+/**
+ * Builds a checkpoint in memory so it can be written out with a single write.
+ */
+class CheckpointBuilder
+{
+private:
+  std::string records;
+  std::vector<CheckpointEntry> entries;
+  int maxSessionId = 0;
+
+public:
+  void addSession(const Session &session);
+
+  // Add a session that is already encoded, e.g. copied from a previous checkpoint
+  void addEncodedSession(int sessionId, const std::string &joinCode, std::string_view record);
+
+  // Return the complete checkpoint image (header, records and index)
+  std::string finish() const;
+
+  // Write the checkpoint to a temporary file and atomically rename it over path
+  std::expected<void, std::string> writeTo(const std::string &path) const;
+};
+
+/**
+ * Read-only view of a checkpoint, either memory mapped from disk or held in a buffer.
+ */
+class CheckpointReader
+{
+private:
+  const char *data = nullptr;
+  size_t size = 0;
+  bool mapped = false;
+  std::string buffer;
+
+  int maxSessionId = 0;
+  std::vector<CheckpointEntry> entries;
+
+  std::expected<void, std::string> readIndex();
+
+public:
+  CheckpointReader() = default;
+  CheckpointReader(const CheckpointReader &) = delete;
+  CheckpointReader &operator=(const CheckpointReader &) = delete;
+  CheckpointReader(CheckpointReader &&other) noexcept;
+  CheckpointReader &operator=(CheckpointReader &&other) noexcept;
+  ~CheckpointReader();
+
+  static std::expected<CheckpointReader, std::string> open(const std::string &path);
+  static std::expected<CheckpointReader, std::string> fromBuffer(std::string image);
+
+  const std::vector<CheckpointEntry> &getEntries() const { return entries; };
+  int getMaxSessionId() const { return maxSessionId; };
+
+  std::string_view getRecord(const CheckpointEntry &entry) const;
+};
+
+/**
+ * Sessions a process hands to the process taking over from it. The clients
+ * stay connected through a handoff, so unlike a checkpoint it keeps who
+ * plays in and watches each session (all integers in host byte order):
+ *
+ *   u64 checkpoint length, checkpoint of every session,
+ *   u32 member record count, per session with members: i32 session id,
+ *   u32 player count, u64 player ids, u32 audience count, u64 audience ids
+ */
+class SnapshotBuilder
+{
+private:
+  CheckpointBuilder sessions;
+  std::string members;
+  uint32_t memberCount = 0;
+
+public:
+  void addSession(const Session &session);
+  void addEncodedSession(int sessionId, const std::string &joinCode, std::string_view record);
+
+  std::string finish() const;
+};
+
+struct SessionMembers
+{
+  std::vector<uintptr_t> players;
+  std::vector<uintptr_t> audience;
+};
+
+class SnapshotReader
+{
+private:
+  CheckpointReader sessions;
+  std::unordered_map<int, SessionMembers> members;
+
+public:
+  static std::expected<SnapshotReader, std::string> fromBuffer(std::string_view image);
+
+  const CheckpointReader &getSessions() const { return sessions; };
+
+  // Members of a session, none when nobody was in it
+  const SessionMembers &getMembers(int sessionId) const;
+};
@@ -4,34 +4,125 @@
 #include <optional>
 #include <climits>
 #include <expected>
+#include <functional>
+#include <string_view>
 
 #include "data/session/session.h"
+#include "data/session/checkpoint.h"
 
 class SessionManager
 {
 private:
+  // Which of shardCount managers this is, see shardOfJoinCode
+  unsigned shardIndex;
+  unsigned shardCount;
+
   // Map from a session's id to session
   std::unordered_map<int, Session> sessions;
 
+  // Sessions restored from a checkpoint that have not been decoded yet
+  std::optional<CheckpointReader> checkpoint;
+  std::unordered_map<int, CheckpointEntry> pendingSessions;
+  std::unordered_map<std::string, int> pendingJoinCodes;
+  std::function<bool(Session &)> onSessionRestored;
+
+  // Session of every player and of every spectator, so finding or leaving
+  // a client's session does not scan every session. A client is in one
+  // session at a time.
+  std::unordered_map<uintptr_t, int> playerSessions;
+  std::unordered_map<uintptr_t, int> audienceSessions;
+
+  // Managers sharing the clients, e.g. session workers, keep each client in one session across them
+  std::function<bool(uintptr_t)> onClientJoining;
+  std::function<void(uintptr_t)> onClientLeft;
+
+  // Session each slow client is holding paused
+  std::unordered_map<uintptr_t, int> pausingClients;
+
+  void indexSessionMembers(const Session &session);
+  void forgetSessionMembers(const Session &session);
+
+  // Session a client plays in or watches
+  std::optional<int> sessionOfClient(uintptr_t clientID) const;
+
+  // Whether a client may enter a session here, it may not while in a session elsewhere
+  bool claimClient(uintptr_t clientID);
+  void releaseClient(uintptr_t clientID);
+
   int getNextId() const;
   std::string generateJoinCode() const;
   Session& newSession(const GameData &gameData);
 
+  // Decode a pending checkpointed session into the live session map
+  Session *restorePendingSession(int sessionId);
+
 public:
   static const int JOIN_CODE_LENGTH = 6;
 
+  // Characters naming a shard at the start of a join code
+  static constexpr const char *SHARD_CODE_CHARSET = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  static constexpr unsigned MAX_SHARDS = 36;
+
+  // A manager owning one shard of the sessions, the default owns all of them
+  explicit SessionManager(unsigned shardIndex = 0, unsigned shardCount = 1);
+
+  // Shard owning the session of a join code, if the code is well formed
+  static std::optional<unsigned> shardOfJoinCode(const std::string &joinCode, unsigned shardCount);
+
   //Player creates session
   std::expected<Session*, std::string> createSession(uintptr_t playerID, const GameData &gameData);
   
   std::expected<void, std::string> destroySession(int sessionId);
   std::expected<Session*, std::string> getSession(int sessionId);
   std::expected<Session*, std::string> getSession(const std::string &joinCode);
-  std::expected<Session*, std::string> findSessionByPlayer(uintptr_t playerID);
+  // Runs for every response routed, so not finding one does not allocate
+  std::expected<Session*, std::string_view> findSessionByPlayer(uintptr_t playerID);
   bool isPlayerInAnySession(uintptr_t playerID);
   bool isSessionExists(const std::string &joinCode);
   bool isSessionExists(int sessionId);
   bool isPlayerInSession(const Session &session, uintptr_t playerID);
 
+  // Add a player, e.g. the host, to a session the caller already holds
+  std::expected<void, std::string> addPlayer(Session &session, const Connection &connection);
+
+  // Remove a disconnected client from the session they play in or watch.
+  // Returns the id of the session they played in, if any.
+  std::optional<int> removeClient(uintptr_t clientID);
+
+  // Hold the session a client plays in paused until the client resumes it, or leaves.
+  // Returns whether the client plays in a session.
+  bool pauseSessionFor(uintptr_t clientID);
+  void resumeSessionFor(uintptr_t clientID);
+
   // Add player to session using a join code
   std::expected<Session*, std::string> addPlayerToSession(const std::string& joinCode, const Connection& connection);
+
+  // Add a spectator to the audience of a session using a join code
+  std::expected<Session*, std::string> addAudienceMemberToSession(const std::string& joinCode, const Connection& connection);
+
+  // Called as a client enters a session on this manager and once it left it. A client that
+  // onJoining returns false for is in a session elsewhere and is refused like here.
+  void setMembershipCallbacks(std::function<bool(uintptr_t)> onJoining, std::function<void(uintptr_t)> onLeft);
+
+  // Write every session, restored or not, to a checkpoint file
+  std::expected<void, std::string> writeCheckpoint(const std::string &path) const;
+
+  // Map a checkpoint file and register its sessions; sessions are decoded on first access
+  std::expected<size_t, std::string> restoreFromCheckpoint(const std::string &path);
+
+  // Add every session to a handoff snapshot, with who is in the live ones
+  void addToSnapshot(SnapshotBuilder &snapshot) const;
+
+  // Take the sessions of a handoff snapshot that belong to this manager's shard, with their members.
+  // They are decoded right away, so their players are found like any other.
+  std::expected<size_t, std::string> restoreSnapshot(const SnapshotReader &snapshot);
+
+  // Called once for each session when it is decoded from the checkpoint or a snapshot,
+  // a session it returns false for cannot resume and is dropped
+  void setRestoreCallback(std::function<bool(Session &)> callback);
+
+  size_t pendingRestoreCount() const { return pendingSessions.size(); };
+
+  // Live sessions, including restored ones that have not been decoded yet
+  size_t getSessionCount() const { return sessions.size() + pendingSessions.size(); };
 };
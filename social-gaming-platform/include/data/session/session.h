@@ -1,11 +1,14 @@
 #pragma once
 
 #include "data/session/player.h"
+#include "data/session/audience.h"
 
 #include "data/data_node.h"
 #include "data/configuration.h"
 #include "data/game_state_object.h"
+#include <chrono>
 #include <iostream>
+#include <optional>
 
 #include "Server.h"
 
@@ -25,20 +28,72 @@ struct Session
 private:
   int id;
   std::string joinCode;
+  std::string gameName;
+  int interpreterPosition;
+  int pauseHolds = 0;
+  std::optional<std::chrono::steady_clock::time_point> wakeDeadline;
+  bool deadlinePassed = false;
   GameData gameData;
   std::list<Player> players;
+  AudienceGroup audience;
 
 public:
-  Session() : id(-1), gameData(GameData()), joinCode(""), players(std::list<Player>()) {};
+  Session() : id(-1), gameData(GameData()), joinCode(""), interpreterPosition(-1), players(std::list<Player>()) {};
   Session(int id, GameData gameData, std::string joinCode) : id(id),
                                                              gameData(gameData),
                                                              joinCode(joinCode),
+                                                             interpreterPosition(-1),
                                                              players(std::list<Player>()) {};
 
   int getId() const { return id; };
   std::string getJoinCode() const { return joinCode; };
   GameData& getGameData() { return gameData; };
-  const std::list<Player> getPlayers() const { return players; };
+  const GameData& getGameData() const { return gameData; };
+
+  /**
+   * Name of the game file the session is playing, used to rebuild its game process
+   */
+  const std::string& getGameName() const { return gameName; };
+  void setGameName(const std::string& name) { gameName = name; };
+
+  /**
+   * Number of top-level rule specs the interpreter has left to execute, -1 before the game
+   * starts and -2 while a rule is part way through, when the game cannot be resumed
+   */
+  int getInterpreterPosition() const { return interpreterPosition; };
+  void setInterpreterPosition(int position) { interpreterPosition = position; };
+  const std::list<Player>& getPlayers() const { return players; };
+
+  /**
+   * Clients that fall too far behind hold the session's game back until they catch up
+   */
+  bool isPaused() const { return pauseHolds > 0; };
+  void holdPause() { pauseHolds++; };
+  void releasePause() { pauseHolds = pauseHolds > 0 ? pauseHolds - 1 : 0; };
+
+  /**
+   * Latest time the game must run again while it waits, e.g. for an input's timeout or a timer rule.
+   * The scheduler wakes the game once it passes, and the rules running then see it passed.
+   */
+  const std::optional<std::chrono::steady_clock::time_point>& getWakeDeadline() const { return wakeDeadline; };
+  void setWakeDeadline(std::optional<std::chrono::steady_clock::time_point> deadline)
+  {
+    wakeDeadline = deadline;
+    deadlinePassed = false;
+  };
+  bool hasDeadlinePassed() const { return deadlinePassed; };
+  void passDeadline()
+  {
+    wakeDeadline.reset();
+    deadlinePassed = true;
+  };
+  void clearPassedDeadline() { deadlinePassed = false; };
+
+  /**
+   * Spectators of the session, stored separately from the players
+   */
+  AudienceGroup& getAudience() { return audience; };
+  const AudienceGroup& getAudience() const { return audience; };
 
   /**
    * Add Player (using player ID) into session
@@ -49,4 +104,13 @@ public:
   {
     players.insert(players.end(), {client, client.id, "TempName"});
   };
+
+  /**
+   * Remove a player, returns whether they were in the session
+   */
+  bool removePlayer(uintptr_t playerId)
+  {
+    return players.remove_if([playerId](const Player &player)
+                             { return player.getId() == playerId; }) > 0;
+  };
 };
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "OutboundQueue.h"
+#include "RateLimiter.h"
+#include "WireCodec.h"
+
+/**
+ * @brief What the server keeps about each connected client
+ */
+struct ClientInfo
+{
+    std::chrono::steady_clock::time_point connectedAt;
+    std::chrono::steady_clock::time_point lastActivity;
+
+    // Session the client plays in, when the network thread knows it
+    std::optional<int> sessionId;
+
+    // Serialized messages waiting to be sent to this client
+    OutboundQueue outbound;
+
+    // Whether this client's backlog is holding back its session's game
+    bool pausingSession = false;
+
+    // Request rate limits of this client
+    ConnectionRateLimiter rateLimiter;
+
+    // Format of the client's latest request, its replies use the same
+    WireFormat wireFormat = WireFormat::JSON;
+};
+
+/**
+ * @brief Connected clients keyed by connection id.
+ *
+ * Connections and their info are stored densely, in parallel vectors, so
+ * broadcasting iterates contiguous memory, while an index from connection
+ * id to position makes lookup, connect and disconnect O(1). Removal moves
+ * the last client into the freed position, so order is not preserved.
+ */
+class ClientRegistry
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Register a connection, returns false if it is already registered
+     */
+    bool add(const Connection &connection, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Unregister a connection, returning its info if it was registered
+     */
+    std::optional<ClientInfo> remove(uintptr_t connectionId);
+
+    ClientInfo *find(uintptr_t connectionId);
+    const ClientInfo *find(uintptr_t connectionId) const;
+    bool contains(uintptr_t connectionId) const { return indices.contains(connectionId); };
+
+    /**
+     * @brief Record that a client sent something
+     */
+    void touch(uintptr_t connectionId, Clock::time_point now);
+
+    const std::vector<Connection> &getConnections() const { return connections; };
+    size_t size() const { return connections.size(); };
+
+private:
+    std::vector<Connection> connections;
+    std::vector<ClientInfo> infos;
+    std::unordered_map<uintptr_t, size_t> indices;
+};
@@ -12,32 +12,34 @@
 #include <sstream>
 #include <iostream>
 #include <unistd.h>
+#include <atomic>
+#include <chrono>
 
 #include <nlohmann/json.hpp>
 
 #include "MessageTypes.h"
 #include "RequestHandler.h"
+#include "RequestLanes.h"
+#include "RequestPipeline.h"
+#include "ServerOptions.h"
+#include "LoopPacer.h"
+#include "ClientRegistry.h"
+#include "ResponseRouting.h"
+#include "SessionWorker.h"
+#include "ServerMetrics.h"
+#include "SessionHandoff.h"
+#include "Transport.h"
 #include "data/data.h"
 #include "data/session/manager.h"
 
 #include "logic/scheduler/Scheduler.h"
 #include "logic/GameProcess.h"
+#include "logic/GameLibraryValidator.h"
 
 using networking::Connection;
 using networking::Message;
-using networking::Server;
 using json = nlohmann::json;
 
-/**
- * @brief Struct to hold results after processing the message
- */
-struct MessageResult
-{
-    std::string result;                     // Response to send to client
-    bool shouldShutdown;                    // Flag which indicates whether server to shut down
-    std::vector<uintptr_t> sendToClientIDs; // specific clients to send to
-};
-
 class GameServer
 {
 public:
@@ -46,8 +48,17 @@ public:
      *
      * @param port port number
      * @param htmlResponseFile Path to the HTML file
+     * @param options Startup options
+     */
+    GameServer(unsigned short, char *&, const ServerOptions & = ServerOptions());
+
+    /**
+     * @brief Constructor for a server reached through any transport
+     *
+     * @param transport How clients reach the server
+     * @param options Startup options
      */
-    GameServer(unsigned short, char *&);
+    explicit GameServer(std::unique_ptr<Transport>, const ServerOptions & = ServerOptions());
 
     /**
      * @brief Destructor
@@ -62,7 +73,7 @@ public:
     /**
      * @brief Clients
      */
-    const std::vector<Connection> &getClients() const { return clients; };
+    const std::vector<Connection> &getClients() const { return clients.getConnections(); };
 
     /**
      * @brief Connecting Client
@@ -74,6 +85,16 @@ public:
      */
     void onDisconnect(Connection c);
 
+    /**
+     * @brief Depth of the clients' outbound queues and what backpressure has done so far
+     */
+    OutboundStats getOutboundStats() const;
+
+    /**
+     * @brief Requests turned away by rate limits or for lack of capacity
+     */
+    const AdmissionStats &getAdmissionStats() const { return admissionStats; };
+
     /**
      * @brief Handling shutdown
      *
@@ -98,22 +119,28 @@ public:
     MessageResult processValidMessage(const Message &, std::ostringstream &);
 
     /**
-     * @brief Processes outgoing messages from the outgoing queue.
+     * @brief Extracts client IDs from the response.
      */
-    MessageResult processOutgoingMessages();
+    std::vector<uintptr_t> extractClientIdsFromResponse(const Response &);
 
     /**
-     * @brief Extracts client IDs from the response.
+     * @brief Process a batch of received messages.
+     * Stops at a shutdown message. Requests are handled by priority lane,
+     * game inputs first, up to the limit; the rest stay queued for the next call.
+     *
+     * @param incoming Incoming messages
+     * @param handleLimit Most requests handled in this call
+     * @return One result per message, in order, then the results of requests queued by earlier calls
      */
-    std::vector<uintptr_t> extractClientIdsFromResponse(const Response &);
+    std::vector<MessageResult> processMessages(const std::deque<Message> &, size_t handleLimit = SIZE_MAX);
 
     /**
-     * @brief Process the message
+     * @brief Add the broadcast delivering a result to its recipients
      *
-     * @param s Server
-     * @param incoming Incoming message
+     * @param result Result of processing one message
+     * @param outgoing Broadcasts to send in this update
      */
-    MessageResult processMessages(const std::deque<Message> &);
+    void appendOutgoing(MessageResult, std::deque<Broadcast> &);
 
     /**
      * @brief Message building and sending
@@ -121,7 +148,7 @@ public:
      * @param players The map of session codes to player connections.
      * @param sessionCode The code identifying the session.
      */
-    std::deque<Message> buildOutgoing(const std::string &, const std::expected<Session *, std::string> &, const std::vector<uintptr_t> &);
+    std::deque<Message> buildOutgoing(const std::string &, const std::expected<Session *, std::string_view> &, const std::vector<uintptr_t> &);
 
     /**
      * @brief Get the session Players - for later usage
@@ -133,13 +160,19 @@ public:
      *
      * @param htmlLocation path to the html
      */
-    std::string getHTTPMessage(const char *htmlLocation);
+    static std::string getHTTPMessage(const char *htmlLocation);
 
     /**
      * @brief Running the server
      */
     void run();
 
+    /**
+     * @brief Run one iteration of the server loop without sleeping.
+     * Returns false once the server has stopped.
+     */
+    bool update();
+
     /**
      * @brief Stop the server
      * For later, resource cleaner
@@ -147,17 +180,72 @@ public:
      */
     void stop();
 
+    /**
+     * @brief Ask the running server to stop at the next loop iteration.
+     * Safe to call from a signal handler.
+     */
+    static void requestStop() noexcept;
+
+    /**
+     * @brief Write all sessions to the checkpoint file, if one is configured
+     */
+    void checkpoint();
+
+    /**
+     * @brief Take over the sockets, clients and sessions of the process serving the shard socket.
+     * Call once the server is constructed and before it runs, so the pause is only the handoff.
+     * On an error the old process goes on serving and this server must not run.
+     */
+    std::expected<void, std::string> takeOver();
+
 private:
-    Server server;
-    SessionManager sessionManager;                                  // Manages sessions
+    static std::atomic<bool> stopRequested;
+
+    ServerOptions options;
+    std::chrono::steady_clock::time_point lastCheckpoint = std::chrono::steady_clock::now();
+    LoopPacer pacer = LoopPacer(options.minIdleWait, options.maxIdleWait);
+
+    std::unique_ptr<Transport> transport;
+    SessionManager sessionManager = SessionManager(options.shardIndex, options.shardCount); // Manages sessions
     // RequestHandler requestHandler = RequestHandler(sessionManager); // Handles incoming request
-    GameManager gameManager = GameManager("../../games");                        
+    GameManager gameManager = GameManager(options.gameDirectory);
     logic::Scheduler<logic::GameProcess> scheduler = logic::Scheduler<logic::GameProcess>();
-    RequestHandler requestHandler = RequestHandler(sessionManager, gameManager, scheduler);
+    logic::GameDefinitionCache gameCache = logic::GameDefinitionCache(gameManager);
+    RequestHandler requestHandler = RequestHandler(sessionManager, gameManager, scheduler, gameCache);
+
+    // New games loading in the background, when sessions are handled on this thread
+    std::unique_ptr<PreparationPool> preparationPool;
+    std::unique_ptr<RequestPipeline> pipeline;
+
+    // Session workers, when sessions are spread over several threads
+    std::unique_ptr<WorkerPool> workerPool;
+
+    // Declared after the game manager and cache so it stops before they are destroyed
+    std::unique_ptr<GameDirectoryWatcher> gameWatcher;
     
-    std::vector<Connection> clients;    // Connected clients
-    std::queue<Request> incomingQueue;  // Queue for incoming
-    std::queue<Response> outgoingQueue; // Queue for outgoing
+    ClientRegistry clients;                    // Connected clients
+    std::vector<uintptr_t> backloggedClients;  // Clients with messages in their outbound queue
+    OutboundStats outboundStats;               // Backpressure counters
+    AdmissionStats admissionStats;             // Rejected request counters
+
+    // Published to the metrics registry every so often, served when a metrics port is set
+    ShardMetrics shardMetrics = ShardMetrics(0);
+    NetworkMetrics networkMetrics;
+    std::chrono::steady_clock::time_point lastMetricsPublish;
+    std::unique_ptr<MetricsServer> metricsServer;
+
+    // Where a process taking over from this one asks for the handoff, in backend mode
+    std::unique_ptr<HandoffListener> handoffListener;
+
+    // Requests waiting to be handled on this thread, by priority lane
+    struct QueuedRequest
+    {
+        Request request;
+        uint64_t batch; // processMessages call that queued it
+        size_t slot;    // where its result goes in that call's results
+    };
+    RequestLanes<QueuedRequest> incomingLanes = RequestLanes<QueuedRequest>(options.laneWeights);
+    uint64_t batchCount = 0;
 
     /**
      * @brief Handle incoming and outgoing messages
@@ -165,8 +253,127 @@ private:
     bool handleServerUpdates();
 
 
+    /**
+     * @brief Hand a batch of received messages to the session workers
+     *
+     * @param incoming Incoming messages
+     * @param outgoing Replies the network thread sends itself, e.g. to invalid messages
+     * @return Whether a shutdown message was received
+     */
+    bool dispatchToWorkers(const std::deque<Message> &incoming, std::deque<Broadcast> &outgoing);
+
+    /**
+     * @brief Parse and admit a message.
+     * Returns the request to handle, or the result answering it right away.
+     */
+    std::variant<MessageResult, Request> admitMessage(const Message &, std::ostringstream &);
+
+    /**
+     * @brief Handle a request on this thread and serialize its response
+     */
+    MessageResult handleRequest(Request &request);
+
+    /**
+     * @brief Handle the requests whose game finished loading
+     */
+    void handlePreparedRequests(std::deque<Broadcast> &outgoing);
+
+    /**
+     * @brief Charge a request to its client's rate limits, returns false when it must be turned away
+     */
+    bool admitRequest(const Request &request);
+
+    /**
+     * @brief Note the wire format of a client's message, its replies follow it.
+     * Returns false for compact messages when the compact protocol is off.
+     */
+    bool acceptWireFormat(const Message &msg);
+
+    /**
+     * @brief Queue each broadcast for its recipients, applying backpressure to those over the limit
+     *
+     * @param outgoing Broadcasts produced in this update
+     * @param messages Messages for recipients that are not registered clients, sent right away
+     * @param sent Traces of the responses among messages
+     */
+    void enqueueOutgoing(const std::deque<Broadcast> &outgoing, std::deque<Message> &messages,
+                         std::vector<LatencyTrace> &sent);
+
+    /**
+     * @brief Take up to the send budget from every backlogged client's queue,
+     * adding the traces of the responses taken to sent
+     */
+    void flushOutbound(std::deque<Message> &messages, std::vector<LatencyTrace> &sent);
+
+    /**
+     * @brief Record the latency of responses just handed to the transport
+     */
+    void recordSent(const std::vector<LatencyTrace> &sent);
+
+    /**
+     * @brief Apply the backpressure policy to a client whose queue is over the limit
+     */
+    void applyBackpressure(const Connection &connection, ClientInfo &client);
+
+    /**
+     * @brief Hold back or resume the game of the session a client plays in
+     */
+    bool setSessionPaused(uintptr_t clientID, bool paused);
+
+    /**
+     * @brief Unregister a client and take them out of their sessions, once
+     */
+    void forgetClient(Connection c);
+
     /**
      * @brief Run game processes
      */
     bool handleGameUpdates();
+
+    /**
+     * @brief The next time the loop has to run even if no messages arrive
+     */
+    std::chrono::steady_clock::time_point nextDeadline() const;
+
+    /**
+     * @brief Checkpoint sessions when the checkpoint interval has elapsed
+     */
+    void handleCheckpoint();
+
+    /**
+     * @brief Publish gauges and counters the loop keeps, at most every publish interval
+     */
+    void publishMetrics();
+
+    /**
+     * @brief Restore sessions from the checkpoint file, if one exists
+     */
+    void restoreCheckpoint();
+
+    /**
+     * @brief Wait for a process to take over from this one, in backend mode
+     */
+    void listenForSuccessor();
+
+    /**
+     * @brief Finish the accepted requests, send every reply and hand everything to the successor.
+     * Returns whether it took over and confirmed it; when it did not, this server goes on.
+     */
+    bool handOff(int successor);
+
+    /**
+     * @brief Validate every game in the game directory and report broken ones
+     */
+    void validateGameLibrary();
+
+    /**
+     * @brief Start watching the game directory for changed games
+     */
+    void watchGameDirectory();
+
+    /**
+     * @brief Update the game list and recompile a changed game.
+     * Runs on the watcher thread, so recompiling never blocks the server loop.
+     */
+    void onGameChanged(const GameChange &change);
 };
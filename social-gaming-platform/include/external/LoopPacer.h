@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+
+/**
+ * @brief Decides how long the server loop may sleep between iterations.
+ *
+ * The networking library only offers a non-blocking update(), so the loop
+ * cannot block on socket readiness directly. Instead, every iteration that
+ * did work (received a message, ticked a game) keeps the loop spinning, and
+ * every idle iteration sleeps for an exponentially growing interval, capped
+ * by maxWait and by the next deadline the server has to meet. A burst of
+ * requests is answered without any added delay, while an idle server wakes
+ * only a few hundred times per second.
+ */
+class LoopPacer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    LoopPacer(std::chrono::microseconds minWait, std::chrono::microseconds maxWait);
+
+    /**
+     * @brief Record that the current iteration did work
+     */
+    void markActive() noexcept { active = true; };
+
+    /**
+     * @brief Finish an iteration, sleeping if it was idle.
+     *
+     * @param deadline the next time the loop must run, e.g. a checkpoint
+     */
+    void pace(Clock::time_point deadline);
+
+    /**
+     * @brief Interval the next idle iteration would sleep for
+     */
+    std::chrono::microseconds getCurrentWait() const noexcept { return currentWait; };
+
+private:
+    std::chrono::microseconds minWait;
+    std::chrono::microseconds maxWait;
+    std::chrono::microseconds currentWait;
+    bool active = false;
+};
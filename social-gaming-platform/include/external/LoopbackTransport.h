@@ -0,0 +1,71 @@
+/**
+ * LoopbackTransport
+ *
+ * Clients that live in the same process as the server, for load tests and
+ * benchmarks of the request pipeline. The test plays the clients: it
+ * connects them, sends their messages and collects what the server sent.
+ * Connections and disconnections reach the server on its next update, as
+ * they do over websockets.
+ *
+ * Either side may run on its own thread. Driven from one thread, with the
+ * server stepped through GameServer::update(), runs are deterministic.
+ */
+#pragma once
+
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include "Transport.h"
+
+class LoopbackTransport : public Transport
+{
+public:
+    // Client side
+
+    /**
+     * @brief Open a connection, the server sees it on its next update
+     */
+    Connection connect();
+
+    /**
+     * @brief Close a connection from the client side
+     */
+    void close(Connection connection);
+
+    /**
+     * @brief Send a message to the server as a connected client.
+     * Returns false when the connection is closed.
+     */
+    bool sendToServer(Connection connection, std::string text);
+
+    /**
+     * @brief Messages the server sent to open connections since the last call
+     */
+    std::deque<Message> takeSent();
+
+    bool isOpen(Connection connection) const;
+
+    // Server side
+
+    void update() override;
+    std::deque<Message> receive() override;
+    void send(const std::deque<Message> &messages) override;
+    void disconnect(Connection connection) override;
+
+private:
+    struct ConnectionEvent
+    {
+        Connection connection;
+        bool opened;
+    };
+
+    mutable std::mutex mutex;
+    uintptr_t nextId = 1;
+    std::unordered_set<uintptr_t> open;
+    std::vector<ConnectionEvent> events;
+    std::deque<Message> inbound;
+    std::deque<Message> outbound;
+
+    void closeLocked(Connection connection);
+};
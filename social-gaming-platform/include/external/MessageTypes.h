@@ -8,6 +8,7 @@ enum class MessageType {
     END = 1,
     ECHO = 2,
     NEW_GAME = 3,
+    JOIN_AUDIENCE = 4,
 
     // Responses that require client input
     INPUT_TEXT = 10,
@@ -19,6 +20,11 @@ enum class MessageType {
     MESSAGE = 20,
     SCORE = 21,
 
+    // Sent by the server itself, never accepted from clients
+    DISCONNECT = 100,
+    PAUSE_SESSION = 101,  // the client fell behind, hold its session's game
+    RESUME_SESSION = 102, // the client caught up
+
     // Undefined action
     UNDEFINED = -1,
 };
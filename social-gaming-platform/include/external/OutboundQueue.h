@@ -0,0 +1,123 @@
+/**
+ * OutboundQueue
+ *
+ * Messages waiting to be sent to one client, bounded by a high-watermark
+ * in messages and bytes, and what the server does when a client passes it.
+ */
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "RequestLatency.h"
+#include "Server.h"
+
+using networking::Connection;
+using networking::Message;
+
+/**
+ * @brief A serialized response, shared by everyone it is sent to
+ */
+using SharedPayload = std::shared_ptr<const std::string>;
+
+/**
+ * @brief What happens to a client whose outbound queue passes its high-watermark
+ */
+enum class BackpressurePolicy
+{
+    DROP_OLDEST,  // discard the oldest queued messages until back under the watermark
+    DISCONNECT,   // close the connection
+    PAUSE_SESSION // hold back the game of the client's session until the client catches up
+};
+
+std::string_view backpressurePolicyName(BackpressurePolicy policy);
+std::expected<BackpressurePolicy, std::string> parseBackpressurePolicy(std::string_view name);
+
+/**
+ * @brief Bounds on a queue, or on how much is taken from it at once
+ */
+struct QueueLimits
+{
+    size_t messages;
+    size_t bytes;
+};
+
+/**
+ * @brief Totals over every client's outbound queue
+ */
+struct OutboundStats
+{
+    size_t backloggedClients = 0;
+    size_t queuedMessages = 0;
+    size_t queuedBytes = 0;
+    size_t deepestQueueMessages = 0;
+    size_t deepestQueueBytes = 0;
+    size_t pausingClients = 0;
+    uint64_t coalesced = 0;
+    uint64_t dropped = 0;
+    uint64_t disconnected = 0;
+};
+
+/**
+ * @brief Messages waiting to be sent to one client, oldest first.
+ *
+ * A message pushed with a supersede key replaces the queued message with
+ * the same key, so a client that falls behind receives the latest state
+ * rather than every update in between. A replaced message leaves a hole
+ * that is skipped when draining and compacted away once holes outnumber
+ * the queued messages.
+ */
+class OutboundQueue
+{
+public:
+    /**
+     * @param supersedeKey 0 for messages that never replace one another
+     * @param trace the request behind the message, timed when the message leaves the queue
+     * @return whether an older message with the same key was replaced
+     */
+    bool push(SharedPayload payload, uint64_t supersedeKey = 0, const LatencyTrace &trace = {});
+
+    /**
+     * @brief Move queued messages into outgoing until either part of the budget is spent.
+     * At least one message moves when any are queued. Returns the number moved.
+     *
+     * @param sent if given, receives the traces of the moved messages that carry one
+     */
+    size_t drainInto(const Connection &connection, const QueueLimits &budget, std::deque<Message> &outgoing,
+                     std::vector<LatencyTrace> *sent = nullptr);
+
+    /**
+     * @brief Discard the oldest messages until within limits. Returns the number discarded.
+     */
+    size_t dropOldest(const QueueLimits &limits);
+
+    bool exceeds(const QueueLimits &limits) const { return count > limits.messages || byteCount > limits.bytes; };
+
+    void clear();
+    size_t size() const { return count; };
+    size_t bytes() const { return byteCount; };
+    bool empty() const { return count == 0; };
+
+private:
+    struct Entry
+    {
+        SharedPayload payload; // empty once superseded
+        uint64_t supersedeKey;
+        LatencyTrace trace;
+    };
+
+    std::deque<Entry> entries;
+    uint64_t frontSequence = 0; // sequence number of entries.front()
+    std::unordered_map<uint64_t, uint64_t> keyedSequences;
+    size_t count = 0;
+    size_t byteCount = 0;
+
+    void popFront();
+    void compact();
+};
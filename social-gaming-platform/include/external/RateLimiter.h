@@ -0,0 +1,106 @@
+/**
+ * RateLimiter
+ *
+ * Token bucket limits on how often one connection may make requests,
+ * over all its requests and per action.
+ */
+#pragma once
+
+#include <chrono>
+#include <expected>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "MessageTypes.h"
+
+/**
+ * @brief Sustained requests per second and how many may come at once
+ */
+struct RateLimit
+{
+    double perSecond = 0; // 0 or less is unlimited
+    double burst = 1;
+
+    bool isUnlimited() const { return perSecond <= 0; };
+};
+
+/**
+ * @brief Parse "<per second>:<burst>", e.g. "0.5:3"
+ */
+std::expected<RateLimit, std::string> parseRateLimit(std::string_view text);
+
+/**
+ * @brief Parse "<action>:<per second>:<burst>", the action as its number in the protocol, e.g. "3:0.5:3"
+ */
+std::expected<std::pair<MessageType, RateLimit>, std::string> parseActionRateLimit(std::string_view text);
+
+/**
+ * @brief The limits every connection is held to
+ */
+struct RateLimits
+{
+    RateLimit perConnection;
+    std::vector<std::pair<MessageType, RateLimit>> perAction;
+
+    const RateLimit *forAction(MessageType action) const;
+};
+
+/**
+ * @brief Requests turned away so far
+ */
+struct AdmissionStats
+{
+    uint64_t rateLimited = 0; // the client was over its rate limit
+    uint64_t shed = 0;        // the server had too much work waiting
+};
+
+/**
+ * @brief Holds up to burst tokens, refilled at perSecond; each request takes one
+ */
+class TokenBucket
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket(RateLimit limit, Clock::time_point now) : limit(limit), tokens(limit.burst), updated(now) {};
+
+    /**
+     * @brief Add the tokens earned since the last refill and return whether count are available
+     */
+    bool refill(Clock::time_point now, unsigned count = 1);
+    void take(unsigned count = 1) { tokens -= count; };
+
+private:
+    RateLimit limit;
+    double tokens;
+    Clock::time_point updated;
+};
+
+/**
+ * @brief Buckets of one connection, created on its first request of each action
+ */
+class ConnectionRateLimiter
+{
+public:
+    /**
+     * @brief Take a token from the connection's bucket and the action's bucket, only if both have one
+     */
+    bool admit(const RateLimits &limits, MessageType action, TokenBucket::Clock::time_point now);
+
+    /**
+     * @brief Admit requests together, e.g. a batch: a token per request from the connection's
+     * bucket and from each action's bucket, taken only if every bucket has enough
+     */
+    bool admit(const RateLimits &limits, std::span<const MessageType> actions, TokenBucket::Clock::time_point now);
+
+private:
+    std::optional<TokenBucket> connectionBucket;
+    std::vector<std::pair<MessageType, TokenBucket>> actionBuckets;
+
+    // Bucket of the action, nullptr when the action has no limit of its own
+    TokenBucket *actionBucketFor(const RateLimits &limits, MessageType action, TokenBucket::Clock::time_point now);
+};
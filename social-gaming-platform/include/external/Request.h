@@ -1,15 +1,20 @@
 #ifndef REQUEST_H
 #define REQUEST_H
 
+#include <chrono>
 #include <string>
+#include <string_view>
 #include "MessageTypes.h"
 #include "data/data.h"
 #include "Server.h"
 #include <cstdint>
 #include <optional>
+#include <vector>
+#include "RequestScanner.h"
+#include "RequestLatency.h"
 
 struct Request {
-    //Possible parameters in the request
+    //Possible parameters in the request, short ones are kept inline by std::string
     MessageType action = MessageType::UNDEFINED;
     std::string body = "";
     std::string sessionId = "";
@@ -18,8 +23,29 @@ struct Request {
     std::optional<std::string> targetVar;
     bool isValid = false;
 
+    // Requests of a batch frame, handled in order and answered together
+    std::vector<Request> batch;
+
+    // When the message arrived, for measuring how long it waits to be handled
+    std::chrono::steady_clock::time_point receivedAt = std::chrono::steady_clock::now();
+
+    // When it was parsed and handled, and its game, for the latency report
+    LatencyTrace latency;
+
     //Constructor will parse the string message from server
-    Request(const std::string& message, const Connection client);
+    Request(std::string_view message, const Connection client);
+
+    //Request from fields already scanned
+    Request(const ScannedRequest& fields, const Connection client);
+
+private:
+    void assign(const ScannedRequest& fields);
 };
 
+//The request deciding where a request or batch is handled: a batch's first join, if any
+const Request& routingRequestOf(const Request& request);
+
+//Trace of a handled request whose response was just serialized
+LatencyTrace traceOf(const Request& request);
+
 #endif
\ No newline at end of file
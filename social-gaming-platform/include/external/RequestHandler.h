@@ -11,16 +11,22 @@ class RequestHandler
 {
 public:
     // Request handler to be constructed with reference to sessionManager
-    RequestHandler(SessionManager &sessionManager, GameManager &gameManager, logic::Scheduler<logic::GameProcess> &scheduler);
+    RequestHandler(SessionManager &sessionManager, GameManager &gameManager, logic::Scheduler<logic::GameProcess> &scheduler, logic::GameDefinitionCache &gameCache);
 
     // Receives Request object to handle and direct to specific endpoint
     // Returns response
     Response handleRequest(Request &request);
 
+    // Rebuilds the game process of a session restored from a checkpoint, false when its game cannot resume
+    bool restoreProcess(Session &session);
+
 private:
+    Response routeRequest(Request &request);
+
     // Handlers specific to each endpoint
 
     Response handleJoin(Request &request);
+    Response handleJoinAudience(Request &request);
 
     Response handleEnd(const Request &request) const;
     Response handleEcho(const Request &request) const;
@@ -36,4 +42,5 @@ private:
     logic::Scheduler<logic::GameProcess> &scheduler;
     SessionManager &sessionManager;
     GameManager &gameManager;
+    logic::GameDefinitionCache &gameCache;
 };
@@ -0,0 +1,166 @@
+/**
+ * RequestLanes
+ *
+ * Multi-level queue of requests waiting to be handled, so a burst of lobby
+ * traffic does not hold up the moves of games in progress. Requests go to
+ * a lane by action: game inputs first, session control second and
+ * diagnostics last.
+ *
+ * Lanes are served by weighted round robin rather than strictly by
+ * priority. Each lane may take its weight in turns before the turns start
+ * over, so while every lane is busy the diagnostics lane still gets one
+ * turn in every sum of the weights; no lane starves.
+ *
+ * A client's requests are handled in the order it sent them: while one of
+ * them is queued, the client's later requests join it in the same lane.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "MessageTypes.h"
+#include "Request.h"
+#include "data/metrics.h"
+
+enum class RequestLane
+{
+    INPUT = 0,      // Player input a game is waiting on
+    CONTROL = 1,    // Creating, joining and leaving sessions
+    DIAGNOSTIC = 2  // Echo and anything unrecognized
+};
+
+const size_t REQUEST_LANE_COUNT = 3;
+
+using LaneWeights = std::array<unsigned, REQUEST_LANE_COUNT>;
+
+RequestLane laneOf(MessageType action);
+
+/**
+ * @brief Lane of a request, for a batch the least urgent lane of its requests
+ */
+RequestLane laneOf(const Request &request);
+std::string_view requestLaneName(RequestLane lane);
+
+/**
+ * @brief Parse "<input>:<control>:<diagnostic>" weights, e.g. "8:4:1"
+ */
+std::expected<LaneWeights, std::string> parseLaneWeights(std::string_view text);
+
+/**
+ * @brief Time requests spent waiting in a lane, from when they were received
+ */
+Histogram &laneWaitHistogram(RequestLane lane);
+
+template <typename T>
+class RequestLanes
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RequestLanes(LaneWeights weights);
+
+    /**
+     * @param lane Lane of the request, unless the client already has one queued
+     * @param received When the request arrived, its wait is measured from then
+     */
+    void push(RequestLane lane, uintptr_t clientID, T item, Clock::time_point received);
+
+    /**
+     * @brief The next request by weighted round robin, nothing when every lane is empty
+     */
+    std::optional<T> pop();
+
+    size_t size() const { return count; };
+    size_t size(RequestLane lane) const { return lanes[static_cast<size_t>(lane)].size(); };
+    bool empty() const { return count == 0; };
+
+private:
+    struct Entry
+    {
+        T item;
+        uintptr_t clientID;
+        Clock::time_point received;
+    };
+
+    struct ClientQueued
+    {
+        size_t lane;
+        size_t count;
+    };
+
+    std::array<std::deque<Entry>, REQUEST_LANE_COUNT> lanes;
+    LaneWeights weights;
+    LaneWeights turns;
+    size_t count = 0;
+
+    // Clients with requests queued, and the lane they are in
+    std::unordered_map<uintptr_t, ClientQueued> clients;
+};
+
+// Implementations
+
+template <typename T>
+RequestLanes<T>::RequestLanes(LaneWeights weights) : weights(weights), turns(weights)
+{
+    // A lane with no weight would never be served
+    for (auto &weight : this->weights)
+    {
+        weight = std::max(weight, 1u);
+    }
+    turns = this->weights;
+}
+
+template <typename T>
+void RequestLanes<T>::push(RequestLane lane, uintptr_t clientID, T item, Clock::time_point received)
+{
+    auto [client, inserted] = clients.try_emplace(clientID, ClientQueued{static_cast<size_t>(lane), 0});
+    client->second.count++;
+    lanes[client->second.lane].push_back(Entry{std::move(item), clientID, received});
+    count++;
+}
+
+template <typename T>
+std::optional<T> RequestLanes<T>::pop()
+{
+    if (count == 0)
+    {
+        return std::nullopt;
+    }
+
+    // At most two passes: the second starts after the turns are handed out again
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t lane = 0; lane < REQUEST_LANE_COUNT; lane++)
+        {
+            if (lanes[lane].empty() || turns[lane] == 0)
+            {
+                continue;
+            }
+
+            turns[lane]--;
+            Entry entry = std::move(lanes[lane].front());
+            lanes[lane].pop_front();
+            count--;
+
+            auto client = clients.find(entry.clientID);
+            if (--client->second.count == 0)
+            {
+                clients.erase(client);
+            }
+
+            laneWaitHistogram(static_cast<RequestLane>(lane)).record(Clock::now() - entry.received);
+            return std::move(entry.item);
+        }
+        turns = weights;
+    }
+    return std::nullopt;
+}
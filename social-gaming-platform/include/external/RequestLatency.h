@@ -0,0 +1,120 @@
+/**
+ * RequestLatency
+ *
+ * Where the time goes between a message arriving and its response being
+ * sent, by action and by game. Each request carries the times it reached
+ * each step, and once its response is handed to the transport they are
+ * recorded as stages. A response for several clients is timed by its first
+ * recipient's copy.
+ *
+ *   parse      receiving the message to the request being parsed
+ *   queue      parsed to its handler starting, waiting in a lane or for a worker
+ *   handle     the handler, RequestHandler's dispatch
+ *   serialize  encoding the response
+ *   send       encoded to sent, including any wait in the client's outbound queue
+ *   total      receiving to sending
+ *
+ * Stages are kept in percentile histograms, reported as p50, p90, p99 and
+ * p99.9 while the server runs: on SIGUSR1 to stderr, and at GET /latency
+ * of the metrics port.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MessageTypes.h"
+#include "data/metrics.h"
+
+enum class LatencyStage
+{
+    PARSE,
+    QUEUE,
+    HANDLE,
+    SERIALIZE,
+    SEND,
+    TOTAL
+};
+
+const size_t LATENCY_STAGE_COUNT = 6;
+
+std::string_view latencyStageName(LatencyStage stage);
+
+/**
+ * @brief Histograms of every stage for one action or one game
+ */
+struct LatencyGroup
+{
+    std::array<LatencyHistogram, LATENCY_STAGE_COUNT> stages;
+
+    LatencyHistogram &operator[](LatencyStage stage) { return stages[static_cast<size_t>(stage)]; };
+    const LatencyHistogram &operator[](LatencyStage stage) const { return stages[static_cast<size_t>(stage)]; };
+};
+
+/**
+ * @brief When a request reached each step, unset times are not recorded
+ */
+struct LatencyTrace
+{
+    using Clock = std::chrono::steady_clock;
+
+    MessageType action = MessageType::UNDEFINED;
+    LatencyGroup *game = nullptr; // the game the request was for, if any
+
+    Clock::time_point receivedAt;
+    Clock::time_point parsedAt;
+    Clock::time_point handleStartedAt;
+    Clock::time_point handledAt;
+    Clock::time_point serializedAt;
+
+    bool isSet() const { return receivedAt != Clock::time_point(); };
+};
+
+class RequestLatency
+{
+public:
+    static RequestLatency &instance();
+
+    LatencyGroup &forAction(MessageType action);
+
+    /**
+     * @brief Histograms of a game, registered on first use; keep the reference
+     */
+    LatencyGroup &forGame(std::string_view gameName);
+
+    /**
+     * @brief Record every stage of a request whose response was sent at sentAt
+     */
+    void record(const LatencyTrace &trace, LatencyTrace::Clock::time_point sentAt);
+
+    /**
+     * @brief One line per action or game and stage with requests: count and percentiles in microseconds
+     */
+    std::string report() const;
+
+    /**
+     * @brief Ask the server loop to write the report. Safe to call from a signal handler.
+     */
+    static void requestDump() noexcept;
+
+    /**
+     * @brief Whether a report was asked for since the last call
+     */
+    static bool takeDumpRequest() noexcept;
+
+private:
+    static std::atomic<bool> dumpRequested;
+
+    // Actions of requests and responses, then everything else
+    std::array<LatencyGroup, 12> actions;
+
+    mutable std::mutex mutex;
+    std::deque<LatencyGroup> games;
+    std::vector<std::pair<std::string, LatencyGroup *>> gameNames;
+};
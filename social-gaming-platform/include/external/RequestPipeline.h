@@ -0,0 +1,100 @@
+/**
+ * RequestPipeline
+ *
+ * Lets a client keep many requests in flight. A request that needs slow
+ * preparation, a new game whose file has to be read and parsed, is prepared
+ * on a pool of threads while its owner goes on with the requests behind it.
+ * Prepared requests come back in completion order and are then handled
+ * like any other on the owning thread, so session state is still only
+ * touched there. Responses carry the request's requestId, which is how
+ * clients match them up.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Request.h"
+#include "logic/GameDefinitionCache.h"
+
+/**
+ * @brief Threads running preparation jobs, shared by every pipeline
+ */
+class PreparationPool
+{
+public:
+    explicit PreparationPool(size_t threadCount);
+
+    /**
+     * @brief Queued jobs that have not started are dropped
+     */
+    ~PreparationPool();
+
+    PreparationPool(const PreparationPool &) = delete;
+    PreparationPool &operator=(const PreparationPool &) = delete;
+
+    void submit(std::function<void()> job);
+
+private:
+    std::mutex mutex;
+    std::condition_variable available;
+    std::deque<std::function<void()>> jobs;
+    bool stopping = false;
+    std::vector<std::jthread> threads;
+
+    void work();
+};
+
+/**
+ * @brief Requests of one owner thread being prepared. Used from that thread only.
+ */
+class RequestPipeline
+{
+public:
+    RequestPipeline(PreparationPool &pool, logic::GameDefinitionCache &gameCache);
+
+    /**
+     * @brief Take the request to prepare it in the background.
+     * Returns false, leaving the request untouched, when it can be handled right away.
+     */
+    bool defer(Request &request);
+
+    /**
+     * @brief Requests prepared since the last call, in completion order
+     */
+    std::vector<Request> takePrepared();
+
+    /**
+     * @brief Drop the requests of a client that left once they are prepared
+     */
+    void forgetClient(uintptr_t clientID);
+
+    size_t inFlight() const { return inFlightCount; };
+
+private:
+    // Shared with the jobs, which may finish after the pipeline is gone
+    struct Completions
+    {
+        std::mutex mutex;
+        std::vector<Request> prepared;
+    };
+
+    struct ClientRequests
+    {
+        size_t inFlight = 0;
+        bool forgotten = false;
+    };
+
+    PreparationPool &pool;
+    logic::GameDefinitionCache &gameCache;
+    std::shared_ptr<Completions> completions = std::make_shared<Completions>();
+
+    size_t inFlightCount = 0;
+    std::unordered_map<uintptr_t, ClientRequests> clients;
+};
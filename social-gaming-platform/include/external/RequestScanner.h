@@ -0,0 +1,63 @@
+/**
+ * RequestScanner
+ *
+ * Reads a client message in one pass and picks out the fields a request
+ * uses, without building a JSON document. The fields are views into the
+ * message, their escapes are only decoded when they are copied out, and
+ * every other member is validated and skipped.
+ *
+ * A message it rejects is malformed JSON, has a request field that is not
+ * a string, or nests other members more than a few hundred levels deep.
+ */
+#pragma once
+
+#include <expected>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief A string value in the message, between its quotes
+ */
+struct ScannedString
+{
+    std::string_view raw;
+    bool escaped = false; // raw holds escape sequences
+
+    /**
+     * @brief Replace out with the decoded value
+     */
+    void assignTo(std::string &out) const;
+
+    std::string decoded() const;
+};
+
+struct ScannedRequest
+{
+    std::optional<ScannedString> action;
+    std::optional<ScannedString> body;
+    std::optional<ScannedString> sessionId;
+    std::optional<ScannedString> requestId;
+    std::optional<ScannedString> targetVar;
+};
+
+/**
+ * @brief Scan a message for the request fields.
+ * A message that is JSON but not an object has none of them.
+ * The result views the message, which must outlive it.
+ */
+std::expected<ScannedRequest, std::string> scanRequest(std::string_view message);
+
+// Most requests one frame may carry
+const size_t MAX_BATCH_REQUESTS = 16;
+
+/**
+ * @brief Whether the message is a JSON array, a batch of requests
+ */
+bool isRequestBatch(std::string_view message);
+
+/**
+ * @brief Scan a batch: a non-empty array of at most MAX_BATCH_REQUESTS request objects
+ */
+std::expected<std::vector<ScannedRequest>, std::string> scanRequestBatch(std::string_view message);
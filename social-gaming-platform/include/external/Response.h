@@ -6,63 +6,70 @@
 #include <vector>
 #include <cstdint>
 #include <optional>
+#include <utility>
 #include <variant>
 #include "MessageTypes.h"
 
 
 //All responses share these attributes
+//Responses are moved from the handler to serialization, never copied on the way
 struct CommonResponse {
-    const std::string gameSessionId;
-    const std::string message; //prompt or general message from server
-    const MessageType type;
-    const std::vector<uintptr_t> clientIds; //optional -- specify clients to respond to
+    std::string gameSessionId;
+    std::string message; //prompt or general message from server
+    MessageType type;
+    std::vector<uintptr_t> clientIds; //optional -- specify clients to respond to
 
     //Optional to specify direct response to client request
     //Implementation can be used by client to resend unanswered requests
-    const std::optional<bool> success;
-    const std::optional<std::string> requestId;
+    std::optional<bool> success;
+    std::optional<std::string> requestId;
+
+    //Also deliver to the session's audience
+    bool toAudience;
 
     //Constructor for the response
     CommonResponse(
         std::string gameSessionId,
         std::string message,
         MessageType type,
-        const std::vector<uintptr_t>& clientIds = {},
+        std::vector<uintptr_t> clientIds = {},
         std::optional<bool> success = std::nullopt,
-        std::optional<std::string> requestId = std::nullopt
-    ) : gameSessionId(gameSessionId),
-        message(message),
+        std::optional<std::string> requestId = std::nullopt,
+        bool toAudience = false
+    ) : gameSessionId(std::move(gameSessionId)),
+        message(std::move(message)),
         type(type),
-        clientIds(clientIds),
+        clientIds(std::move(clientIds)),
         success(success),
-        requestId(requestId) {}
+        requestId(std::move(requestId)),
+        toAudience(toAudience) {}
 };
 
 
 //base response -- no extra attributes
 struct MessageResponse {
-    const CommonResponse common;
+    CommonResponse common;
 
     // Constructor
-    MessageResponse(const CommonResponse& commonResponse)
-        : common(commonResponse) {}
+    MessageResponse(CommonResponse commonResponse)
+        : common(std::move(commonResponse)) {}
 };
 
 
 //response requesting inputs
 struct InputResponse {
-    const CommonResponse common;
-    const std::string_view targetVar;
-    const std::optional<int> timeout;
+    CommonResponse common;
+    std::string_view targetVar;
+    std::optional<int> timeout;
 
     // Constructor
     InputResponse(
-        const CommonResponse& commonResponse,
+        CommonResponse commonResponse,
         std::string_view targetVar, //variable to store input into
 
         //timeout for input (optional)
         std::optional<int> timeout = std::nullopt
-    ) : common(commonResponse),
+    ) : common(std::move(commonResponse)),
         targetVar(targetVar),
         timeout(timeout) {}
 };
@@ -74,4 +81,11 @@ using Response = std::variant<MessageResponse, InputResponse>;
 //return serialized JSON of response
 std::string serializeResponse(const Response& response);
 
-#endif
\ No newline at end of file
+//serialize into out, replacing its contents but keeping its capacity
+void serializeResponse(const Response& response, std::string& out);
+
+//serialize into a buffer reused by every call on this thread,
+//the view is valid until the thread's next call
+std::string_view serializeResponseToBuffer(const Response& response);
+
+#endif
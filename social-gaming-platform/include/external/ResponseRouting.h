@@ -0,0 +1,105 @@
+/**
+ * ResponseRouting
+ *
+ * Turns the result of handling a message into the messages sent to each recipient.
+ */
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "OutboundQueue.h"
+#include "Request.h"
+#include "Response.h"
+#include "Server.h"
+#include "data/session/manager.h"
+
+using networking::Connection;
+using networking::Message;
+
+/**
+ * @brief Struct to hold results after processing the message
+ */
+struct MessageResult
+{
+    std::string result;                     // Response to send to client
+    bool shouldShutdown;                    // Flag which indicates whether server to shut down
+    std::vector<uintptr_t> sendToClientIDs; // specific clients to send to
+    bool toAudience = false;                // also broadcast to the session's audience
+    uintptr_t senderID = 0;                 // client whose message produced this result
+    uint64_t supersedeKey = 0;              // a newer result with the same key replaces this one if still queued
+
+    // Results of a batch's requests, answered to the sender in one frame
+    std::vector<MessageResult> batchItems;
+
+    // The response in the compact wire format, for clients using it
+    std::string compact;
+
+    // When the request behind the response reached each step, recorded once it is sent
+    LatencyTrace trace;
+};
+
+/**
+ * @brief One serialized response and the connections it goes to.
+ * Routing and queueing pass the payload by reference count; it is only
+ * copied per recipient when handed to the networking library.
+ */
+struct Broadcast
+{
+    SharedPayload payload;
+    std::vector<Connection> recipients;
+    uint64_t supersedeKey = 0;
+
+    // For recipients using the compact wire format, when the response has that encoding
+    SharedPayload compactPayload;
+
+    LatencyTrace trace;
+};
+
+/**
+ * @brief Key under which newer state replaces older state a client has not received yet,
+ * 0 for responses every recipient must see
+ */
+uint64_t supersedeKeyOf(const Response &);
+
+/**
+ * @brief Serialize a response for routing, taking over its recipients
+ *
+ * @param compact Also encode it in the compact wire format
+ */
+MessageResult messageResultOf(uintptr_t senderID, Response &&, bool compact = false);
+
+/**
+ * @brief Recipients of one serialized response
+ *
+ * @param payload Serialized response
+ * @param sessionResult Session of the sender, if any
+ * @param clientIDs Recipients the response names; all session players when empty
+ */
+Broadcast buildBroadcast(SharedPayload, const std::expected<Session *, std::string_view> &, const std::vector<uintptr_t> &);
+
+/**
+ * @brief Message building for one serialized response, one message per recipient
+ */
+std::deque<Message> buildOutgoing(const std::string &, const std::expected<Session *, std::string_view> &, const std::vector<uintptr_t> &);
+
+/**
+ * @brief Append the broadcast delivering a result to its recipients, routed through the sender's session
+ */
+void routeResult(SessionManager &, MessageResult, std::deque<Broadcast> &);
+
+/**
+ * @brief Handle the requests of a batch in order.
+ * A request that fails is answered with an error, the ones after it still run.
+ */
+MessageResult batchResultOf(Request &batch, const std::function<MessageResult(Request &)> &handle);
+
+/**
+ * @brief Append one message per recipient of each broadcast, in order, for sending
+ */
+void appendMessages(const std::deque<Broadcast> &, std::deque<Message> &);
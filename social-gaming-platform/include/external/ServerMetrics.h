@@ -0,0 +1,103 @@
+/**
+ * ServerMetrics
+ *
+ * State the server loop and the session workers publish to the metrics
+ * registry, and the HTTP listener that serves the registry.
+ */
+#pragma once
+
+#include <chrono>
+#include <expected>
+#include <string>
+#include <thread>
+
+#include "OutboundQueue.h"
+#include "RateLimiter.h"
+#include "data/metrics.h"
+
+// How often the server loop and each session worker publish their gauges, so gauges are at most this stale
+const std::chrono::milliseconds METRICS_PUBLISH_INTERVAL = std::chrono::milliseconds(250);
+
+/**
+ * @brief Gauges of one shard of the sessions: the server's own, or one worker's
+ */
+class ShardMetrics
+{
+public:
+    explicit ShardMetrics(unsigned shard);
+
+    void publish(size_t sessions, size_t readyProcesses, size_t waitingProcesses) noexcept;
+
+private:
+    Gauge &sessions;
+    Gauge &readyProcesses;
+    Gauge &waitingProcesses;
+};
+
+/**
+ * @brief Connection and queue metrics kept by the network thread
+ */
+class NetworkMetrics
+{
+public:
+    NetworkMetrics();
+
+    /**
+     * @brief Publish the current state; counters advance by what changed since the last call
+     */
+    void publish(size_t clients, size_t pendingRequests, const OutboundStats &outbound,
+                 const AdmissionStats &admission, uint64_t droppedLogRecords) noexcept;
+
+private:
+    Gauge &clients;
+    Gauge &pendingRequests;
+    Gauge &backloggedClients;
+    Gauge &queuedMessages;
+    Gauge &queuedBytes;
+    Gauge &deepestQueueMessages;
+    Gauge &pausingClients;
+    Counter &coalesced;
+    Counter &dropped;
+    Counter &disconnected;
+    Counter &rateLimited;
+    Counter &shed;
+    Counter &droppedLogRecords;
+
+    OutboundStats lastOutbound;
+    AdmissionStats lastAdmission;
+    uint64_t lastDroppedLogRecords = 0;
+};
+
+/**
+ * @brief Serves GET /metrics from the registry on its own port.
+ *
+ * The networking library answers every plain HTTP request with the same
+ * page and cannot route paths, so metrics get a small listener of their
+ * own, on a thread that only ever reads the registry.
+ */
+class MetricsServer
+{
+public:
+    explicit MetricsServer(const MetricsRegistry &registry);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer &) = delete;
+    MetricsServer &operator=(const MetricsServer &) = delete;
+
+    /**
+     * @brief Listen on port, 0 picks a free one
+     */
+    std::expected<void, std::string> start(unsigned short port);
+    void stop();
+
+    unsigned short getPort() const { return port; };
+
+private:
+    const MetricsRegistry &registry;
+    int listener = -1;
+    unsigned short port = 0;
+    std::jthread thread;
+
+    void serve(std::stop_token stopToken);
+    void respond(int client);
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "OutboundQueue.h"
+#include "RateLimiter.h"
+#include "RequestLanes.h"
+#include "data/logger.h"
+
+/**
+ * @brief Startup options of the game server. Background work (watching,
+ * validating and preparing games) is off unless asked for; privateServer
+ * turns it on by default.
+ */
+struct ServerOptions
+{
+    // Session checkpoint file, checkpointing is disabled when empty
+    std::string checkpointPath = "";
+
+    // How often live sessions are checkpointed while the server runs
+    std::chrono::seconds checkpointInterval = std::chrono::seconds(30);
+
+    // Where the game files are
+    std::string gameDirectory = "../../games";
+
+    // Reload game files when they are added, edited or removed
+    bool watchGames = false;
+
+    // Poll the game directory instead of using inotify
+    bool pollGames = false;
+    std::chrono::milliseconds gamePollInterval = std::chrono::milliseconds(2000);
+
+    // Session worker threads, 0 handles everything on the network thread
+    unsigned workerThreads = 0;
+
+    // Bounds on how long an idle server loop sleeps before polling the network again
+    std::chrono::microseconds minIdleWait = std::chrono::microseconds(50);
+    std::chrono::microseconds maxIdleWait = std::chrono::microseconds(2000);
+
+    // Threads loading games for new sessions while other requests go on, 0 loads them in line
+    size_t preparationThreads = 0;
+
+    // Parse every game at startup and report the ones that fail
+    bool validateGames = false;
+
+    // Threads used for validation, 0 uses one per core
+    size_t validationThreads = 0;
+
+    // Keep the games compiled during validation so first sessions skip parsing
+    bool warmGameCache = true;
+
+    // High-watermark of each client's queue of messages waiting to be sent
+    QueueLimits outboundLimit = {1024, 4 << 20};
+
+    // Most sent to one client per server update, the rest waits in its queue
+    QueueLimits sendBudget = {64, 256 << 10};
+
+    // What happens to a client whose queue passes the high-watermark
+    BackpressurePolicy backpressurePolicy = BackpressurePolicy::DROP_OLDEST;
+
+    // How often one client may make requests, over all of them and per action.
+    // New games parse a game file and start a process, so they are limited the most.
+    RateLimits rateLimits = {{50, 100}, {{MessageType::NEW_GAME, {1, 5}}}};
+
+    // Turns each priority lane gets before the turns start over: game inputs, session control, diagnostics
+    LaneWeights laneWeights = {8, 4, 1};
+
+    // Most requests handled per loop iteration, the rest wait in their lane while games run
+    size_t requestsPerUpdate = 256;
+
+    // Accept requests in the compact wire format, answering such clients in it too
+    bool compactProtocol = false;
+
+    // Requests waiting to be handled before new ones are turned away
+    size_t maxPendingRequests = 4096;
+
+    // Session shards of this process when it is one of several backends behind the
+    // shard router, see SessionManager::shardOfJoinCode
+    unsigned shardIndex = 0;
+    unsigned shardCount = 1;
+
+    // Backend mode: serve the shard router on this Unix domain socket instead of websockets
+    std::string shardSocket = "";
+
+    // Backend mode: start by taking over the sockets and sessions of the process serving
+    // the shard socket, see SessionHandoff
+    bool takeOver = false;
+
+    // Router mode: start this many backend processes and route clients to them, 0 disables it
+    unsigned backendProcesses = 0;
+
+    // Port serving GET /metrics, 0 disables it
+    unsigned short metricsPort = 0;
+
+    // Least severe log records written, and where they go; stderr when empty
+    LogLevel logLevel = LogLevel::INFO;
+    std::string logFile = "";
+};
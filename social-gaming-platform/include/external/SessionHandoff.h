@@ -0,0 +1,114 @@
+/**
+ * SessionHandoff
+ *
+ * Restarting a backend process without dropping its clients or games. The
+ * new process starts with --take-over, loads its games, then connects to
+ * the old one on a Unix domain socket next to the shard socket. The old
+ * process finishes the requests it accepted, queues every reply, and sends
+ * its transport's sockets (SCM_RIGHTS) with a snapshot of its sessions and
+ * clients. Clients stay connected to the router throughout, what they send
+ * meanwhile waits in the router's socket.
+ *
+ * Neither process touches the sockets until one of them is known to serve.
+ * The new process sends HANDOFF_READY once it holds the sockets and the
+ * sessions, and the old one answers HANDOFF_COMMIT and exits without
+ * checkpointing. Without HANDOFF_READY in time the old process closes the
+ * connection instead and goes on serving, and the new one gives up.
+ *
+ * Message layout, in host byte order since both ends share the host, after
+ * its uint64 length and with the descriptors riding on its first byte:
+ *   HANDOFF_MAGIC | uint32 version | uint32 descriptor count
+ *   | uint64 length, transport state | uint32 client count, per client
+ *   uint64 id and uint8 wire format | uint64 length, session snapshot
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Transport.h"
+#include "WireCodec.h"
+
+const std::string_view HANDOFF_MAGIC = "SGHO";
+const uint32_t HANDOFF_VERSION = 1;
+
+const char HANDOFF_READY = 'R';
+const char HANDOFF_COMMIT = 'C';
+
+struct HandoffClient
+{
+    uintptr_t id;
+    WireFormat wireFormat;
+};
+
+struct Handoff
+{
+    TransportHandoff transport;
+    std::vector<HandoffClient> clients;
+    std::string sessions; // see SnapshotBuilder
+};
+
+/**
+ * @brief Socket the process serving shardSocket waits on for its successor
+ */
+std::string handoffSocketPath(const std::string &shardSocket);
+
+/**
+ * @brief Send a handoff over a connected Unix domain socket, waiting at most timeout.
+ * The descriptors stay open in this process, closing them is up to the caller.
+ */
+std::expected<void, std::string> sendHandoff(int socket, const Handoff &handoff, std::chrono::milliseconds timeout);
+
+/**
+ * @brief Receive a handoff, the descriptors that came with it belong to the caller
+ */
+std::expected<Handoff, std::string> receiveHandoff(int socket, std::chrono::milliseconds timeout);
+
+/**
+ * @brief Connect to the process serving shardSocket, which answers with a handoff.
+ * The caller owns the descriptor.
+ */
+std::expected<int, std::string> connectForHandoff(const std::string &shardSocket);
+
+/**
+ * @brief New process: report the handoff taken and wait at most timeout for the old process
+ * to stop serving. On an error the old process goes on serving and the sockets are not this one's.
+ */
+std::expected<void, std::string> confirmHandoff(int socket, std::chrono::milliseconds timeout);
+
+/**
+ * @brief Old process: wait at most timeout for the new process to take the handoff, then leave
+ * the sockets to it. On an error the new process gives up and the sockets are still this one's.
+ */
+std::expected<void, std::string> commitHandoff(int socket, std::chrono::milliseconds timeout);
+
+/**
+ * @brief Where a serving process waits for its successor
+ */
+class HandoffListener
+{
+public:
+    static std::expected<std::unique_ptr<HandoffListener>, std::string> listen(const std::string &shardSocket);
+
+    ~HandoffListener();
+
+    HandoffListener(const HandoffListener &) = delete;
+    HandoffListener &operator=(const HandoffListener &) = delete;
+
+    /**
+     * @brief A successor's connection, -1 when none is waiting.
+     * Only processes of the same user are let in. The caller owns the descriptor.
+     */
+    int accept();
+
+private:
+    HandoffListener(int listener, std::string path);
+
+    int listener;
+    std::string path;
+};
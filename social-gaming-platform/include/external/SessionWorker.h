@@ -0,0 +1,255 @@
+/**
+ * SessionWorker
+ *
+ * Session-affine workers: each worker thread owns a shard of the sessions
+ * together with the scheduler running their games, so session state is
+ * only ever touched by one thread and needs no locks. The network thread
+ * hands requests to a worker and collects the routed replies through a pair
+ * of single-producer single-consumer queues per worker.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "LoopPacer.h"
+#include "RequestHandler.h"
+#include "RequestLanes.h"
+#include "RequestPipeline.h"
+#include "ResponseRouting.h"
+#include "ServerMetrics.h"
+#include "ServerOptions.h"
+#include "SpscQueue.h"
+#include "data/session/manager.h"
+#include "logic/GameDefinitionCache.h"
+#include "logic/scheduler/Scheduler.h"
+
+/**
+ * @brief The worker each client is in a session on. Workers claim a client as it enters
+ * a session and release it once it left, so a client is in one session across all of them.
+ */
+class ClientSeats
+{
+public:
+    /**
+     * @brief Worker thread: seat a client on the worker, false when it is seated on another one
+     */
+    bool claim(uintptr_t clientID, unsigned worker);
+    void release(uintptr_t clientID, unsigned worker);
+
+    std::optional<unsigned> workerOf(uintptr_t clientID) const;
+
+    /**
+     * @brief Network thread: the clients seated (true) or released (false) since the last call, in order
+     */
+    std::vector<std::pair<uintptr_t, bool>> takeChanges();
+
+private:
+    mutable std::mutex mutex;
+    std::unordered_map<uintptr_t, unsigned> seats;
+    std::vector<std::pair<uintptr_t, bool>> changes;
+};
+
+class SessionWorker
+{
+public:
+    /**
+     * @param index Shard of the sessions this worker owns
+     * @param workerCount Number of workers sharing the sessions
+     * @param seats Where the clients of every worker are seated, so joining on this one can be refused
+     */
+    SessionWorker(unsigned index, unsigned workerCount, GameManager &gameManager,
+                  logic::GameDefinitionCache &gameCache, const ServerOptions &options,
+                  PreparationPool *preparationPool = nullptr, ClientSeats *seats = nullptr);
+    ~SessionWorker();
+
+    SessionWorker(const SessionWorker &) = delete;
+    SessionWorker &operator=(const SessionWorker &) = delete;
+
+    void start();
+    void stop();
+    bool isRunning() const { return thread.joinable(); };
+
+    /**
+     * @brief Network thread: hand a request to the worker.
+     * Returns false, leaving the request untouched, when the worker's inbox is full.
+     */
+    bool submit(Request &request);
+
+    /**
+     * @brief Network thread: move the replies produced so far into outgoing.
+     * Returns whether there were any.
+     */
+    bool drain(std::deque<Broadcast> &outgoing);
+
+    /**
+     * @brief Network thread: requests handed over that the worker has not handled yet
+     */
+    size_t pendingRequests() const { return inbox.size() + queuedCount.load(std::memory_order_relaxed); };
+
+    /**
+     * @brief Write this worker's sessions to a checkpoint, only while stopped
+     */
+    std::expected<void, std::string> checkpoint(const std::string &path);
+
+    /**
+     * @brief Restore this worker's sessions from a checkpoint, only while stopped
+     */
+    std::expected<size_t, std::string> restoreCheckpoint(const std::string &path);
+
+    /**
+     * @brief Only while stopped: handle every request handed over and the waiting ones,
+     * giving games still loading until deadline, and move all replies into outgoing
+     */
+    void finish(std::deque<Request> &waiting, std::deque<Broadcast> &outgoing,
+                std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief Add this worker's sessions to a handoff snapshot, or take its shard of one, only while stopped
+     */
+    std::expected<void, std::string> addToSnapshot(SnapshotBuilder &snapshot) const;
+    std::expected<size_t, std::string> restoreSnapshot(const SnapshotReader &snapshot);
+
+private:
+    unsigned index;
+    const ServerOptions &options;
+
+    SessionManager sessionManager;
+    logic::Scheduler<logic::GameProcess> scheduler;
+    RequestHandler requestHandler;
+
+    // New games loading in the background, when the pool has threads for them
+    std::unique_ptr<RequestPipeline> pipeline;
+
+    SpscQueue<Request> inbox;
+    SpscQueue<Broadcast> outbox;
+
+    // Worker side: requests taken from the inbox, waiting in their priority lane
+    RequestLanes<Request> queued;
+    std::atomic<size_t> queuedCount = 0;
+
+    // Worker side: replies waiting for room in the outbox
+    std::deque<Broadcast> unsent;
+
+    LoopPacer pacer;
+    std::chrono::steady_clock::time_point lastCheckpoint = std::chrono::steady_clock::now();
+
+    ShardMetrics metrics;
+    std::chrono::steady_clock::time_point lastMetricsPublish;
+    std::jthread thread;
+
+    void run(std::stop_token stopToken);
+    void handle(Request &request);
+    void respond(Request &request);
+    void flush();
+    std::string checkpointPath(const std::string &path) const;
+};
+
+/**
+ * @brief The set of session workers and the routing of requests to them.
+ * Used from the network thread only.
+ */
+class WorkerPool
+{
+public:
+    WorkerPool(unsigned workerCount, GameManager &gameManager, logic::GameDefinitionCache &gameCache,
+               const ServerOptions &options);
+
+    void start();
+    void stop();
+
+    /**
+     * @brief Workers a pool started with these options has, at least one.
+     * Together the workers of every process own shardCount times as many session shards.
+     */
+    static unsigned workerCountFor(const ServerOptions &options);
+
+    /**
+     * @brief Send a request to the worker owning its session.
+     * Requests for a worker whose inbox is full wait here, in order.
+     */
+    void dispatch(Request &&request);
+
+    /**
+     * @brief Retry waiting requests and collect every worker's replies.
+     * Returns whether anything was handed over in either direction.
+     */
+    bool collect(std::deque<Broadcast> &outgoing);
+
+    /**
+     * @brief Take a disconnected client out of its session and drop its worker affinity
+     */
+    void forgetClient(uintptr_t clientID);
+
+    /**
+     * @brief Clients that entered (true) or left (false) a session on any worker since the last call
+     */
+    std::vector<std::pair<uintptr_t, bool>> takeSeatChanges() { return seats.takeChanges(); };
+
+    /**
+     * @brief Hold back or resume the game of the session a client plays in, on the worker owning it.
+     * Returns false when the client never reached a worker.
+     */
+    bool setSessionPaused(uintptr_t clientID, bool paused);
+
+    /**
+     * @brief Checkpoint each worker to its own file next to path, only while stopped
+     */
+    void checkpoint(const std::string &path);
+    void restoreCheckpoint(const std::string &path);
+
+    /**
+     * @brief Stop the workers once they handled every request dispatched to them, collecting
+     * the replies. Games still loading for a request get until deadline.
+     */
+    void finish(std::deque<Broadcast> &outgoing, std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief Hand every worker's sessions over, or take them back with their clients, only while stopped
+     */
+    void addToSnapshot(SnapshotBuilder &snapshot) const;
+    void restoreSnapshot(const SnapshotReader &snapshot);
+
+    /**
+     * @brief Requests dispatched that no worker has taken yet
+     */
+    size_t pendingRequests() const;
+
+    size_t size() const { return workers.size(); };
+
+private:
+    // Declared before the workers so they outlive their pipelines and seats
+    std::unique_ptr<PreparationPool> preparationPool;
+    ClientSeats seats;
+
+    std::vector<std::unique_ptr<SessionWorker>> workers;
+
+    // Session shard of the first worker, when the process owns a part of them
+    unsigned firstShard;
+    std::vector<std::deque<Request>> backlog;
+
+    // Worker each client's requests go to, so a player always reaches their session,
+    // and every worker they went to, one bit each, which all hear of its disconnect
+    struct ClientWorkers
+    {
+        unsigned current;
+        uint64_t reached = 0;
+    };
+    std::unordered_map<uintptr_t, ClientWorkers> clientWorkers;
+
+    // A client in a session stays on its worker, which refuses joining another session.
+    // Joining moves any other client to the worker named by the join code.
+    unsigned workerFor(const Request &request);
+
+    // Pass a request the server makes on behalf of a client to that client's worker,
+    // a disconnect to every worker it reached
+    bool notifyWorker(uintptr_t clientID, MessageType action);
+};
@@ -0,0 +1,106 @@
+/**
+ * ShardLink
+ *
+ * The connection between the shard router and one backend game server
+ * process: a Unix domain stream socket carrying the traffic of every client
+ * the router sent to that backend. Each frame names the client it belongs
+ * to, so one socket multiplexes all of them.
+ *
+ * Frame layout, in host byte order since both ends share the host:
+ *   uint32 length of what follows | uint8 kind | uint64 connection id | text
+ */
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <string>
+#include <string_view>
+
+enum class LinkFrameKind : uint8_t
+{
+    CONNECT = 1,    // Router to backend: a client's first message is coming
+    DISCONNECT = 2, // Either way: the client is gone, or the backend closes it
+    MESSAGE = 3,    // Router to backend: from the client. Backend to router: for the client
+    SEATED = 4,     // Backend to router: the client entered a session on the backend
+    UNSEATED = 5    // Backend to router: the client left its session
+};
+
+struct LinkFrame
+{
+    LinkFrameKind kind;
+    uintptr_t connectionId;
+    std::string text;
+};
+
+/**
+ * @brief Non-blocking framed stream over a connected socket, owns the descriptor
+ */
+class ShardLink
+{
+public:
+    // Frames longer than this mean the stream is corrupt
+    static const size_t MAX_FRAME_SIZE = 16 << 20;
+
+    // Written data the peer has not taken before the link is given up on
+    static const size_t MAX_PENDING_BYTES = 64 << 20;
+
+    ShardLink() = default;
+    explicit ShardLink(int fd);
+
+    /**
+     * @brief Adopt a link another process released, with what it had read and not yet written
+     */
+    ShardLink(int fd, std::string unread, std::string unwritten);
+    ~ShardLink();
+
+    ShardLink(ShardLink &&other) noexcept;
+    ShardLink &operator=(ShardLink &&other) noexcept;
+    ShardLink(const ShardLink &) = delete;
+    ShardLink &operator=(const ShardLink &) = delete;
+
+    /**
+     * @brief Connect to a backend listening on a Unix domain socket
+     */
+    static std::expected<ShardLink, std::string> connect(const std::string &path);
+
+    bool isOpen() const { return fd != -1; };
+    void close();
+
+    /**
+     * @brief Add a frame to what flush() writes
+     */
+    void queue(LinkFrameKind kind, uintptr_t connectionId, std::string_view text = "");
+
+    /**
+     * @brief Write as much queued data as the socket takes without blocking.
+     * Returns false when the link failed and was closed.
+     */
+    bool flush();
+
+    /**
+     * @brief Read what arrived and append every complete frame.
+     * Returns false when the peer closed the link or it failed.
+     */
+    bool receive(std::deque<LinkFrame> &frames);
+
+    size_t pendingBytes() const { return writeBuffer.size() - written; };
+
+    /**
+     * @brief Give up the descriptor, leaving the link closed. unread gets what was
+     * read but is not a whole frame yet, unwritten what was queued but not written.
+     */
+    int release(std::string &unread, std::string &unwritten);
+
+private:
+    int fd = -1;
+    std::string readBuffer;
+    std::string writeBuffer;
+    size_t written = 0;
+};
+
+/**
+ * @brief Listen on a Unix domain socket, replacing a stale socket file.
+ * Returns the non-blocking listening descriptor.
+ */
+std::expected<int, std::string> listenOnUnixSocket(const std::string &path);
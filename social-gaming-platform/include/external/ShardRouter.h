@@ -0,0 +1,189 @@
+/**
+ * ShardRouter
+ *
+ * Front process of the multi-process mode. The router owns the clients'
+ * connections and forwards each client's messages to one of several
+ * backend game server processes over Unix domain sockets; replies stream
+ * back the same way. A client sticks to one backend: joining a session
+ * moves a client in none to the backend named by the join code, while a
+ * client in a session stays with the backend holding it, which refuses
+ * joining another one. Any other request goes to the backend the client
+ * already uses, or one picked by its id.
+ *
+ * Backends are separate processes, so a crashed backend only takes its own
+ * clients with it. The supervisor starts them and restarts any that exit.
+ * On request it also replaces running backends, e.g. with a new binary: each
+ * new backend takes over the sockets and sessions of the one it replaces
+ * (see SessionHandoff), so clients only see a pause.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+
+#include "LoopPacer.h"
+#include "Request.h"
+#include "ServerOptions.h"
+#include "ShardLink.h"
+#include "Transport.h"
+
+/**
+ * @brief Starts the backend processes and restarts the ones that exit
+ */
+class BackendSupervisor
+{
+public:
+    /**
+     * @param command Program and arguments starting a backend; each gets
+     *                --shard-socket <path> --shard <index>/<count> appended
+     * @param count Number of backends
+     * @param socketDirectory Where the backends' sockets are created
+     */
+    BackendSupervisor(std::vector<std::string> command, unsigned count, std::string socketDirectory);
+    ~BackendSupervisor();
+
+    BackendSupervisor(const BackendSupervisor &) = delete;
+    BackendSupervisor &operator=(const BackendSupervisor &) = delete;
+
+    void start();
+
+    /**
+     * @brief Restart backends that exited, no more than once per restart interval each.
+     * A replacement that exits before taking over leaves the backend it replaces serving.
+     */
+    void restartExited();
+
+    /**
+     * @brief Start a replacement for every running backend, taking over from it
+     */
+    void replaceAll();
+
+    /**
+     * @brief Ask every backend to stop and wait for them, they checkpoint on the way out
+     */
+    void stop();
+
+    std::vector<std::string> getSocketPaths() const;
+
+private:
+    struct Backend
+    {
+        pid_t pid = -1;
+        std::chrono::steady_clock::time_point lastStart;
+
+        // Backend being replaced, it exits once its replacement took over
+        pid_t retiring = -1;
+    };
+
+    std::vector<std::string> command;
+    std::string socketDirectory;
+    std::vector<Backend> backends;
+    bool stopping = false;
+
+    void spawn(unsigned index, bool takeOver = false);
+};
+
+class ShardRouter
+{
+public:
+    /**
+     * @param clients Transport the clients connect through
+     * @param backendPaths Socket of each backend, in shard order
+     * @param sessionShardsPerBackend Session shards each backend owns, its worker count
+     * @param options Startup options, for the loop pacing
+     * @param supervisor Restarts exited backends while the router runs, optional
+     */
+    ShardRouter(std::unique_ptr<Transport> clients, std::vector<std::string> backendPaths,
+                unsigned sessionShardsPerBackend, const ServerOptions &options,
+                BackendSupervisor *supervisor = nullptr);
+
+    ShardRouter(const ShardRouter &) = delete;
+    ShardRouter &operator=(const ShardRouter &) = delete;
+
+    /**
+     * @brief Route until asked to stop, then stop the backends
+     */
+    void run();
+
+    /**
+     * @brief Run one iteration of the routing loop without sleeping.
+     * Returns false once a stop was requested.
+     */
+    bool update();
+
+    /**
+     * @brief Safe to call from a signal handler
+     */
+    static void requestStop() noexcept;
+
+    /**
+     * @brief Ask the supervisor to replace every backend. Safe to call from a signal handler.
+     */
+    static void requestRestart() noexcept;
+
+    bool isBackendConnected(unsigned backend) const { return backends[backend].link.isOpen(); };
+
+    /**
+     * @brief Backend the client's messages go to, if it sent any
+     */
+    std::optional<unsigned> backendOf(uintptr_t clientID) const;
+
+private:
+    struct Backend
+    {
+        std::string path;
+        ShardLink link;
+        std::chrono::steady_clock::time_point nextConnectAttempt;
+    };
+
+    static std::atomic<bool> stopRequested;
+    static std::atomic<bool> restartRequested;
+
+    const ServerOptions &options;
+    std::unique_ptr<Transport> clients;
+    std::vector<Backend> backends;
+    unsigned sessionShardsPerBackend;
+    BackendSupervisor *supervisor;
+    LoopPacer pacer;
+
+    // Backend a client's messages go to, every backend told it connected, one bit each,
+    // and the backend it is in a session on, as that backend reported
+    struct RoutedClient
+    {
+        unsigned backend;
+        uint64_t reached = 0;
+        std::optional<unsigned> seat;
+    };
+    std::unordered_map<uintptr_t, RoutedClient> routedClients;
+
+    void onDisconnect(Connection connection);
+
+    /**
+     * @brief Tell every backend the client reached, but the one that closed it, that it is gone
+     */
+    void forgetClient(uintptr_t clientID, std::optional<unsigned> closedBy = std::nullopt);
+
+    void connectBackends();
+
+    /**
+     * @brief Forward one client message, or answer it when its backend is down
+     */
+    void route(const Message &message, std::deque<Message> &outgoing);
+
+    unsigned backendFor(const Request &request) const;
+
+    /**
+     * @brief Take the replies and seats of every backend, disconnecting clients the backends closed
+     */
+    void collect(std::deque<Message> &outgoing);
+
+    /**
+     * @brief Close a failed backend's link and disconnect its clients
+     */
+    void backendFailed(unsigned backend);
+};
@@ -0,0 +1,72 @@
+/**
+ * ShardTransport
+ *
+ * Transport of a backend game server process behind the shard router. The
+ * router connects over a Unix domain socket and forwards the messages of
+ * the clients it sent to this backend; replies go back the same way.
+ * Clients are the router's, so their connection ids are the router's too.
+ *
+ * The transport can be handed to a process taking over from this one: the
+ * listening socket and the router's connection move as they are, so the
+ * router does not notice beyond a pause.
+ */
+#pragma once
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "ShardLink.h"
+#include "Transport.h"
+
+class ShardTransport : public Transport
+{
+public:
+    /**
+     * @brief Listen for the router on a Unix domain socket
+     */
+    static std::expected<std::unique_ptr<ShardTransport>, std::string> listen(const std::string &path);
+
+    /**
+     * @brief A transport without sockets until it takes over from the process serving path
+     */
+    static std::unique_ptr<ShardTransport> awaitHandoff(const std::string &path);
+
+    ~ShardTransport() override;
+
+    ShardTransport(const ShardTransport &) = delete;
+    ShardTransport &operator=(const ShardTransport &) = delete;
+
+    void update() override;
+    std::deque<Message> receive() override;
+    void send(const std::deque<Message> &messages) override;
+    void disconnect(Connection connection) override;
+    void reportSeat(Connection connection, bool seated) override;
+
+    /**
+     * @brief Hands over the listener and the router link, with the link's buffers,
+     * the connected clients and the disconnects not reported yet
+     */
+    bool handOff(TransportHandoff &handoff) override;
+    bool takeOver(TransportHandoff &handoff) override;
+
+    bool hasRouter() const { return router.isOpen(); };
+
+private:
+    ShardTransport(int listener, std::string path);
+
+    int listener;
+    std::string path;
+    ShardLink router;
+
+    std::unordered_set<uintptr_t> clients;
+    std::deque<Message> inbound;
+
+    // Clients closed by the server, reported on the next update
+    std::vector<Connection> closed;
+
+    void acceptRouter();
+
+    // A lost router takes all of its clients with it
+    void dropRouter();
+};
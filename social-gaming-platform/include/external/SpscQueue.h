@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+/**
+ * @brief Bounded lock-free queue for exactly one producer and one consumer thread.
+ *
+ * The producer only writes tail and the consumer only writes head, so each
+ * side needs a single acquire load of the other's index per operation.
+ * Each side also caches the other's last seen index and only reloads it
+ * when the queue looks full (or empty).
+ */
+template <typename T>
+class SpscQueue
+{
+public:
+    /**
+     * @param capacity rounded up to a power of two
+     */
+    explicit SpscQueue(size_t capacity);
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    /**
+     * @brief Producer side. Returns false, leaving value untouched, when the queue is full.
+     */
+    bool tryPush(T &&value);
+
+    /**
+     * @brief Consumer side. Returns nothing when the queue is empty.
+     */
+    std::optional<T> tryPop();
+
+    /**
+     * @brief Approximate when called from neither side
+     */
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Approximate when called from neither side
+     */
+    size_t size() const
+    {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return slots.size(); };
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    std::vector<std::optional<T>> slots;
+    size_t mask;
+
+    // Consumer owned
+    alignas(CACHE_LINE) std::atomic<size_t> head = 0;
+    size_t cachedTail = 0;
+
+    // Producer owned
+    alignas(CACHE_LINE) std::atomic<size_t> tail = 0;
+    size_t cachedHead = 0;
+};
+
+// Implementations
+
+template <typename T>
+SpscQueue<T>::SpscQueue(size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+    slots.resize(size);
+    mask = size - 1;
+}
+
+template <typename T>
+bool SpscQueue<T>::tryPush(T &&value)
+{
+    const size_t currentTail = tail.load(std::memory_order_relaxed);
+    if (currentTail - cachedHead == slots.size())
+    {
+        cachedHead = head.load(std::memory_order_acquire);
+        if (currentTail - cachedHead == slots.size())
+        {
+            return false;
+        }
+    }
+
+    slots[currentTail & mask].emplace(std::move(value));
+    tail.store(currentTail + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+std::optional<T> SpscQueue<T>::tryPop()
+{
+    const size_t currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead == cachedTail)
+    {
+        cachedTail = tail.load(std::memory_order_acquire);
+        if (currentHead == cachedTail)
+        {
+            return std::nullopt;
+        }
+    }
+
+    auto &slot = slots[currentHead & mask];
+    std::optional<T> value = std::move(slot);
+    slot.reset();
+    head.store(currentHead + 1, std::memory_order_release);
+    return value;
+}
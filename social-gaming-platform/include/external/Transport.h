@@ -0,0 +1,120 @@
+/**
+ * Transport
+ *
+ * How the game server reaches its clients. The websocket server is the
+ * transport used in production; the loopback transport keeps clients inside
+ * the process so the whole request pipeline can be driven without sockets.
+ */
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Server.h"
+
+using networking::Connection;
+using networking::Message;
+
+/**
+ * @brief A transport's sockets and state, handed to the process taking over from this one
+ */
+struct TransportHandoff
+{
+    std::vector<int> descriptors; // in the order the transport puts them
+    std::string state;            // encoded by the transport, e.g. buffered data
+};
+
+class Transport
+{
+public:
+    using ConnectionHandler = std::function<void(Connection)>;
+
+    virtual ~Transport() = default;
+
+    /**
+     * @brief Called from update() as clients connect and disconnect
+     */
+    void setHandlers(ConnectionHandler connectHandler, ConnectionHandler disconnectHandler)
+    {
+        onConnect = std::move(connectHandler);
+        onDisconnect = std::move(disconnectHandler);
+    };
+
+    /**
+     * @brief Accept connections and exchange pending data
+     */
+    virtual void update() = 0;
+
+    /**
+     * @brief Messages received from clients since the last call
+     */
+    virtual std::deque<Message> receive() = 0;
+
+    virtual void send(const std::deque<Message> &messages) = 0;
+
+    /**
+     * @brief Close a client's connection from the server side
+     */
+    virtual void disconnect(Connection connection) = 0;
+
+    /**
+     * @brief Tell whoever routes the client here that it entered a session on this server, or left it
+     */
+    virtual void reportSeat(Connection connection, bool seated) {};
+
+    /**
+     * @brief Give up the sockets, with what is still queued, to a process taking over.
+     * Returns false when this transport's sockets cannot be handed over.
+     */
+    virtual bool handOff(TransportHandoff &handoff) { return false; };
+
+    /**
+     * @brief Adopt the sockets another process handed off, or give them back after a failed handoff
+     */
+    virtual bool takeOver(TransportHandoff &handoff) { return false; };
+
+protected:
+    void connected(Connection connection)
+    {
+        if (onConnect)
+        {
+            onConnect(connection);
+        }
+    };
+
+    void disconnected(Connection connection)
+    {
+        if (onDisconnect)
+        {
+            onDisconnect(connection);
+        }
+    };
+
+private:
+    ConnectionHandler onConnect;
+    ConnectionHandler onDisconnect;
+};
+
+/**
+ * @brief Clients connected over websockets, HTTP requests get one fixed page.
+ * The networking library owns the sockets, so this transport cannot be handed off.
+ */
+class WebSocketTransport : public Transport
+{
+public:
+    /**
+     * @param port Port to listen on
+     * @param httpMessage Page answering plain HTTP requests
+     */
+    WebSocketTransport(unsigned short port, std::string httpMessage);
+
+    void update() override;
+    std::deque<Message> receive() override;
+    void send(const std::deque<Message> &messages) override;
+    void disconnect(Connection connection) override;
+
+private:
+    networking::Server server;
+};
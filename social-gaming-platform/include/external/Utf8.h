@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+/**
+ * @brief Length of the well formed UTF-8 sequence text starts with, 0 when it is not one.
+ * Overlong forms, surrogates and code points past U+10FFFF are not well formed.
+ */
+inline size_t utf8SequenceLength(std::string_view text)
+{
+    auto byte = [&text](size_t offset) -> unsigned
+    {
+        return offset < text.size() ? static_cast<unsigned char>(text[offset]) : 0;
+    };
+    auto within = [](unsigned value, unsigned low, unsigned high)
+    {
+        return value >= low && value <= high;
+    };
+
+    unsigned lead = byte(0);
+    if (lead < 0x80)
+    {
+        return text.empty() ? 0 : 1;
+    }
+    if (within(lead, 0xC2, 0xDF))
+    {
+        return within(byte(1), 0x80, 0xBF) ? 2 : 0;
+    }
+    if (within(lead, 0xE0, 0xEF))
+    {
+        unsigned low = lead == 0xE0 ? 0xA0 : 0x80;
+        unsigned high = lead == 0xED ? 0x9F : 0xBF;
+        return within(byte(1), low, high) && within(byte(2), 0x80, 0xBF) ? 3 : 0;
+    }
+    if (within(lead, 0xF0, 0xF4))
+    {
+        unsigned low = lead == 0xF0 ? 0x90 : 0x80;
+        unsigned high = lead == 0xF4 ? 0x8F : 0xBF;
+        return within(byte(1), low, high) && within(byte(2), 0x80, 0xBF) && within(byte(3), 0x80, 0xBF) ? 4 : 0;
+    }
+    return 0;
+}
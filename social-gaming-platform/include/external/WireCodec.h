@@ -0,0 +1,82 @@
+/**
+ * WireCodec
+ *
+ * Compact encoding of requests and responses, an alternative to JSON a
+ * connection can switch to. Fields are laid out by a fixed schema instead
+ * of being named, numbers are variable length and strings are length
+ * prefixed, so decoding is a walk over the frame without any escapes.
+ *
+ * A compact frame starts with COMPACT_FRAME_MARKER, which no JSON text
+ * starts with, and every byte of its framing is below 0x80. With strings
+ * in UTF-8, frames stay valid UTF-8 and travel as websocket text frames.
+ *
+ * Numbers are little endian base 64 digits: the low six bits of each byte,
+ * with 0x40 set on every byte but the last.
+ *
+ * Request:  marker, action, fields present (bit 0 body, 1 session id,
+ *           2 request id, 3 target variable), then each present field as
+ *           length and bytes, in that order.
+ * Response: marker, type, flags (bit 0 success given, 1 success, 2 request
+ *           id, 3 client ids, 4 input response, 5 timeout), game session
+ *           id, message, then when flagged the request id, the client ids
+ *           as count and ids, the target variable and the timeout, zigzag
+ *           encoded.
+ */
+#pragma once
+
+#include <expected>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "MessageTypes.h"
+#include "RequestScanner.h"
+#include "Response.h"
+
+enum class WireFormat
+{
+    JSON,
+    COMPACT
+};
+
+const char COMPACT_FRAME_MARKER = '\x01';
+
+std::string_view wireFormatName(WireFormat format);
+std::expected<WireFormat, std::string> parseWireFormat(std::string_view name);
+
+inline bool isCompactFrame(std::string_view frame)
+{
+    return !frame.empty() && frame.front() == COMPACT_FRAME_MARKER;
+}
+
+struct CompactRequest
+{
+    MessageType action = MessageType::UNDEFINED;
+    ScannedRequest fields; // all but the action, as views into the frame
+};
+
+/**
+ * @brief Decode a request, checking its strings are UTF-8.
+ * Actions outside the client range are undefined, as in JSON requests.
+ */
+std::expected<CompactRequest, std::string> decodeCompactRequest(std::string_view frame);
+
+/**
+ * @brief Encode a request the way a client sends it
+ */
+std::string encodeCompactRequest(MessageType action, std::string_view body, std::string_view requestId,
+                                 std::string_view sessionId = {}, std::optional<std::string_view> targetVar = std::nullopt);
+
+/**
+ * @brief Encode into out, replacing its contents but keeping its capacity.
+ * Invalid UTF-8 in strings is replaced by U+FFFD.
+ */
+void encodeCompactResponse(const Response &response, std::string &out);
+
+std::string encodeCompactResponse(const Response &response);
+
+/**
+ * @brief Decode a response the way a client reads it.
+ * The target variable of an input response views the frame.
+ */
+std::expected<Response, std::string> decodeCompactResponse(std::string_view frame);
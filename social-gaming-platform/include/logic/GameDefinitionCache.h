@@ -0,0 +1,95 @@
+#pragma once
+
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "rule_specifications/BaseRuleSpecification.h"
+#include "data/game/manager.h"
+#include "data/session/session.h"
+
+
+namespace logic
+{
+    /**
+     * Immutable result of parsing a game file.
+     * Shared by every session playing the game; rule specs are never mutated
+     * by the interpreter so sessions only copy the handles.
+     */
+    struct CompiledGame
+    {
+        std::string name;
+        RuleSpecStack ruleSpecs;
+        GameData initialGameData;
+    };
+
+    /**
+     * Parse a game's source code into its rule specs and initial game data.
+     * Fields other than the rules fall back to their defaults when missing,
+     * unless strict is set, in which case any field that fails to parse is an error.
+     */
+    [[nodiscard]] std::expected<std::shared_ptr<const CompiledGame>, std::string>
+    compileGame(const std::string &name, const std::string &sourceCode, bool strict = false) noexcept;
+
+
+    /**
+     * Cache of compiled games, keyed by game name and validated against the
+     * file's path and last write time. A file whose timestamp changed but
+     * whose contents hash is the same is not recompiled.
+     *
+     * Safe to use from several threads; compilation happens outside the lock.
+     */
+    class GameDefinitionCache
+    {
+    public:
+        GameDefinitionCache(GameManager &gameManager);
+
+        /**
+         * Return the compiled game, compiling it on a miss or when the file changed.
+         */
+        [[nodiscard]] std::expected<std::shared_ptr<const CompiledGame>, std::string>
+        getGame(const std::string &gameName);
+
+        /**
+         * Whether getGame would have to read the game file: it exists but is
+         * not cached as it is now.
+         */
+        [[nodiscard]] bool needsLoading(const std::string &gameName) const;
+
+        /**
+         * Drop the cached definition of a game.
+         * Sessions already playing it keep their own reference.
+         */
+        void invalidate(const std::string &gameName);
+
+        /**
+         * Compile a game into the cache unless it is cached as its file is now,
+         * so the next session gets it without parsing.
+         */
+        void reload(const std::string &gameName);
+
+        /**
+         * Add a game compiled elsewhere, e.g. while validating the game library.
+         */
+        void store(const std::string &gameName, const GameFileStamp &stamp, uint64_t contentHash,
+                   std::shared_ptr<const CompiledGame> game);
+
+        [[nodiscard]] size_t size() const noexcept;
+
+    private:
+        struct Entry
+        {
+            GameFileStamp stamp;
+            uint64_t contentHash;
+            std::shared_ptr<const CompiledGame> game;
+        };
+
+        GameManager &gameManager;
+        mutable std::mutex entriesMutex;
+        std::unordered_map<std::string, Entry> entries;
+
+        void erase(const std::string &gameName);
+    };
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "GameDefinitionCache.h"
+
+
+namespace logic
+{
+    /**
+     * Outcome of validating a single game file.
+     */
+    struct GameValidationResult
+    {
+        std::string gameName;
+        std::chrono::microseconds parseTime{0};
+        std::optional<std::string> error;
+    };
+
+    struct GameValidationReport
+    {
+        std::vector<GameValidationResult> results;
+        std::chrono::milliseconds totalTime{0};
+        size_t threadCount = 0;
+
+        [[nodiscard]] size_t failureCount() const noexcept;
+    };
+
+    /**
+     * Parses and validates every game in a GameManager's directory on a pool
+     * of threads. Workers claim games through a shared atomic index and write
+     * into their own result slot, so no locking is needed however large the
+     * library is.
+     */
+    class GameLibraryValidator
+    {
+    public:
+        /**
+         * @param threadCount number of worker threads, 0 uses one per core
+         */
+        GameLibraryValidator(GameManager &gameManager, size_t threadCount = 0);
+
+        /**
+         * Validate every game. Games that pass are added to warmCache if one is given.
+         */
+        [[nodiscard]] GameValidationReport validateAll(GameDefinitionCache *warmCache = nullptr) const;
+
+    private:
+        GameManager &gameManager;
+        size_t threadCount;
+
+        [[nodiscard]] GameValidationResult validateGame(const std::string &gameName,
+                                                        GameDefinitionCache *warmCache) const;
+    };
+
+    /**
+     * Print one line per game followed by a summary.
+     */
+    void printValidationReport(std::ostream &out, const GameValidationReport &report);
+}
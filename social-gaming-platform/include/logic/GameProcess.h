@@ -3,6 +3,10 @@
 #include "IParser.h"
 #include "ProcessTraits.h"
 #include "Interpreter.h"
+#include "GameDefinitionCache.h"
+
+#include <chrono>
+#include <optional>
 
 #include "data/session/session.h"
 
@@ -14,6 +18,7 @@ namespace logic
     {
     public:
         GameProcess(Session *session, std::string sourceCode);
+        GameProcess(Session *session, std::shared_ptr<const CompiledGame> game);
 
         [[nodiscard]] int getSessionId() const noexcept;
 
@@ -21,8 +26,21 @@ namespace logic
         LastOutcome getLastInterpreterOutcome() const noexcept;
         [[nodiscard]] RuleExecutionOutcome execute() noexcept;
 
+        // Resume from the interpreter position stored in the session, false when it cannot be resumed
+        [[nodiscard]] bool restorePosition() noexcept;
+
+        // Whether a slow client is holding the session back
+        [[nodiscard]] bool isPaused() const noexcept;
+
+        // Deadline of the input or timer the game waits on, and waking it once it passed
+        [[nodiscard]] std::optional<std::chrono::steady_clock::time_point> getWakeDeadline() const noexcept;
+        [[nodiscard]] bool hasDeadlinePassed() const noexcept;
+        void wake() noexcept;
+
     private:
         Session *session;
+        // Keeps the definition the session started with alive
+        std::shared_ptr<const CompiledGame> game;
         Interpreter interpreter;
     };
 
@@ -42,5 +60,8 @@ namespace logic
         void tick();
         bool isWaitingForIO() const;
         bool isDone() const;
+
+        std::optional<std::chrono::steady_clock::time_point> getWakeDeadline() const;
+        void wake();
     };
 }
\ No newline at end of file
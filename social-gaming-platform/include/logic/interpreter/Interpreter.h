@@ -33,6 +33,14 @@ namespace logic
 
         [[nodiscard]] InterpreterState const &getState() const noexcept;
 
+        /**
+         * Skip top-level rule specs until only topLevelRulesRemaining are left on the stack.
+         * Used to resume a game from a checkpointed position, see Session::getInterpreterPosition.
+         * Return False for a position inside a rule, whose nested rules and loop state were
+         * not saved, or one past the game's rules. True otherwise.
+         */
+        [[nodiscard]] bool restorePosition(int topLevelRulesRemaining) noexcept;
+
     private:
         std::unordered_map<RuleType, std::shared_ptr<IRule>> rulesRegister;
         InterpreterState interpreterState;
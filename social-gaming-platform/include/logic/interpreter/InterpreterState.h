@@ -36,6 +36,17 @@ namespace logic
          */
         [[nodiscard]] int ruleSpecsRemaining() const noexcept;
 
+        /**
+         * Return the number of rules remaining of those the game started with,
+         * not counting nested rules added since.
+         */
+        [[nodiscard]] int topLevelRulesRemaining() const noexcept;
+
+        /**
+         * Return whether no rule is part way through, i.e. no nested rules are waiting.
+         */
+        [[nodiscard]] bool isBetweenTopLevelRules() const noexcept;
+
         /**
          * Return a reference to the data contents.
          */
@@ -55,6 +66,10 @@ namespace logic
 
     private:
         RuleSpecStack ruleSpecStack;
+        /**
+         * The bottom of ruleSpecStack, nested rules are always added above.
+         */
+        int topLevelRemaining;
         Session *session;
         /**
          * NULL when no rules have been executed yet.
@@ -2,19 +2,43 @@
 
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <optional>
+#include <unordered_map>
 
 #include "ProcessTraits.h"
+#include "TimingWheel.h"
 
 namespace logic
 {
+  /**
+   * @brief Processes that may wait with a deadline: `getWakeDeadline()` is the latest time
+   * the process must run again, `wake()` tells it the deadline passed.
+   */
+  template <typename Process>
+  concept TimedProcess = requires(Process process, const Process &constProcess) {
+    { constProcess.getWakeDeadline() } -> std::convertible_to<std::optional<std::chrono::steady_clock::time_point>>;
+    process.wake();
+  };
+
   /**
    * @brief A class that schedules processes of a given kind.
    * @param ProcessKind The kind of process to be scheduled. Must have a `ProcessTraits` specialization.
+   *
+   * The wake deadlines of timed processes are kept in one timing wheel for all of them.
    */
   template <typename ProcessKind>
   class Scheduler
   {
     using Process = ProcessTraits<ProcessKind>;
+    using Clock = std::chrono::steady_clock;
+
+    struct ArmedTimer
+    {
+      TimerHandle handle;
+      Clock::time_point deadline;
+    };
 
   private:
     // Processes which are ready to be executed are held here
@@ -22,6 +46,21 @@ namespace logic
     // Processes which are waiting for IO operations are held here
     std::vector<Process> ioBoundPool;
 
+    // Wake deadlines of the processes, one timer per process
+    TimingWheel<ProcessID> timers;
+    std::unordered_map<ProcessID, ArmedTimer> armedTimers;
+    std::vector<ProcessID> expiredTimers;
+
+    /**
+     * @brief Wakes the processes whose deadline passed, they are executed in this round.
+     */
+    void fireTimers(Clock::time_point now);
+
+    /**
+     * @brief Keeps the timer of a process in line with its wake deadline, none when it is done.
+     */
+    void armTimer(const Process &process, bool done);
+
     /**
      * @brief Executes a single process for `Scheduler::quantum` ticks. Moves the process to the IO bound pool after an IO operation.
      */
@@ -54,6 +93,47 @@ namespace logic
     {
       return !readyPool.empty() || !ioBoundPool.empty();
     }
+
+    /**
+     * @brief Returns whether any process can make progress without waiting for IO.
+     */
+    bool hasReadyProcesses() const
+    {
+      return !readyPool.empty();
+    }
+
+    /**
+     * @brief Returns the number of processes in the ready pool.
+     */
+    size_t getReadyCount() const
+    {
+      return readyPool.size();
+    }
+
+    /**
+     * @brief Returns the number of processes in the IO bound pool.
+     */
+    size_t getWaitingCount() const
+    {
+      return ioBoundPool.size();
+    }
+
+    /**
+     * @brief Returns the next time a process's deadline may pass, max when none waits with one.
+     * The server sleeps no later than this.
+     */
+    Clock::time_point nextTimerDeadline() const
+    {
+      return timers.nextDeadline();
+    }
+
+    /**
+     * @brief Returns the number of processes waiting with a deadline.
+     */
+    size_t getTimerCount() const
+    {
+      return timers.size();
+    }
   };
 
   // Implementations
@@ -67,6 +147,11 @@ namespace logic
   template <typename ProcessKind>
   void Scheduler<ProcessKind>::executeInParallel()
   {
+    if constexpr (TimedProcess<Process>)
+    {
+      fireTimers(Clock::now());
+    }
+
     for (Process &process : ioBoundPool)
     {
       if (!process.isWaitingForIO())
@@ -96,10 +181,81 @@ namespace logic
 
     if (process.isDone())
     {
+      if constexpr (TimedProcess<Process>)
+      {
+        armTimer(process, true);
+      }
       removeProcess(readyPool, process);
       return;
     }
     process.tick();
+
+    if constexpr (TimedProcess<Process>)
+    {
+      armTimer(process, false);
+    }
+  }
+
+  template <typename ProcessKind>
+  void Scheduler<ProcessKind>::fireTimers(Clock::time_point now)
+  {
+    expiredTimers.clear();
+    timers.advance(now, expiredTimers);
+    if (expiredTimers.empty())
+    {
+      return;
+    }
+    for (ProcessID id : expiredTimers)
+    {
+      armedTimers.erase(id);
+    }
+    std::sort(expiredTimers.begin(), expiredTimers.end());
+
+    auto wakeExpired = [this, now](std::vector<Process> &pool)
+    {
+      for (Process &process : pool)
+      {
+        if (!std::binary_search(expiredTimers.begin(), expiredTimers.end(), process.getId()))
+        {
+          continue;
+        }
+
+        // The deadline may have moved since the timer was set
+        auto deadline = process.getWakeDeadline();
+        if (deadline.has_value() && deadline.value() <= now)
+        {
+          process.wake();
+        }
+        else
+        {
+          armTimer(process, false);
+        }
+      }
+    };
+    wakeExpired(ioBoundPool);
+    wakeExpired(readyPool);
+  }
+
+  template <typename ProcessKind>
+  void Scheduler<ProcessKind>::armTimer(const Process &process, bool done)
+  {
+    std::optional<Clock::time_point> deadline = done ? std::nullopt : process.getWakeDeadline();
+
+    auto armed = armedTimers.find(process.getId());
+    if (armed != armedTimers.end())
+    {
+      if (deadline.has_value() && armed->second.deadline == deadline.value())
+      {
+        return;
+      }
+      timers.cancel(armed->second.handle);
+      armedTimers.erase(armed);
+    }
+
+    if (deadline.has_value())
+    {
+      armedTimers[process.getId()] = ArmedTimer{timers.schedule(deadline.value(), process.getId()), deadline.value()};
+    }
   }
 
   template <typename ProcessKind>
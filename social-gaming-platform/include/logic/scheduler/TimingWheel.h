@@ -0,0 +1,325 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace logic
+{
+  /**
+   * @brief Identifies a scheduled timer, stays invalid once the timer fired or was cancelled.
+   */
+  struct TimerHandle
+  {
+    uint32_t index = std::numeric_limits<uint32_t>::max();
+    uint32_t generation = 0;
+
+    bool operator==(const TimerHandle &) const = default;
+  };
+
+  /**
+   * @brief Hierarchical timing wheel holding a payload per timer.
+   *
+   * Time is cut into ticks of `resolution`. The first level has a slot per
+   * tick for the next 64 ticks, each next level a slot per 64 slots of the
+   * level below, and a slot's timers move down a level when time reaches
+   * it. Four levels cover 64^4 ticks, about 4.6 hours at 1 ms; later timers
+   * wait in the last level and are placed again as it turns.
+   *
+   * Timers live in one vector and each slot is a doubly linked list through
+   * it, so scheduling and cancelling are O(1) and a freed timer's entry is
+   * reused without allocating. Advancing time skips ticks with nothing to do.
+   *
+   * A timer never fires before its deadline, and at most one tick after the
+   * first advance past it.
+   */
+  template <typename Payload>
+  class TimingWheel
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TimingWheel(Clock::duration resolution = std::chrono::milliseconds(1), Clock::time_point start = Clock::now())
+        : resolution(resolution), origin(start)
+    {
+      heads.fill(NONE);
+    }
+
+    /**
+     * @brief Schedule payload for deadline, a deadline already past fires on the next advance.
+     */
+    TimerHandle schedule(Clock::time_point deadline, Payload payload);
+
+    /**
+     * @brief Cancel a timer, returns false if it already fired or was cancelled.
+     */
+    bool cancel(TimerHandle handle);
+
+    /**
+     * @brief Whether the timer is still waiting to fire.
+     */
+    bool isPending(TimerHandle handle) const
+    {
+      return handle.index < timers.size() && timers[handle.index].generation == handle.generation &&
+             timers[handle.index].slot != NONE;
+    }
+
+    /**
+     * @brief Fire the timers due at now, appending their payloads to expired in deadline order.
+     */
+    void advance(Clock::time_point now, std::vector<Payload> &expired);
+
+    /**
+     * @brief The next time advance has work to do, max when no timers are pending.
+     * Timers in the upper levels report when they move down, which may be before their deadline.
+     */
+    Clock::time_point nextDeadline() const;
+
+    size_t size() const { return pending; }
+    bool empty() const { return pending == 0; }
+
+  private:
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr unsigned SLOTS = 1u << SLOT_BITS;
+    static constexpr unsigned LEVELS = 4;
+    static constexpr uint64_t SPAN = uint64_t(1) << (SLOT_BITS * LEVELS);
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    struct Timer
+    {
+      Payload payload{};
+      uint64_t deadline = 0; // in ticks
+      uint32_t previous = NONE;
+      uint32_t next = NONE;  // next in the slot, or in the free list
+      uint32_t slot = NONE;  // NONE when not scheduled
+      uint32_t generation = 0;
+    };
+
+    Clock::duration resolution;
+    Clock::time_point origin;
+    uint64_t currentTick = 0; // every tick up to this one has been handled
+
+    std::vector<Timer> timers;
+    uint32_t freeList = NONE;
+    size_t pending = 0;
+
+    std::array<uint32_t, LEVELS * SLOTS> heads;
+    std::array<uint64_t, LEVELS> occupied = {}; // bit per non-empty slot
+
+    // Deadlines round up to a tick and the present down, so no timer fires early
+    uint64_t tickOf(Clock::time_point time, bool roundUp) const
+    {
+      if (time <= origin)
+      {
+        return 0;
+      }
+      auto elapsed = time - origin + (roundUp ? resolution - Clock::duration(1) : Clock::duration::zero());
+      return static_cast<uint64_t>(elapsed / resolution);
+    }
+
+    void place(uint32_t index);
+    void unlink(uint32_t index);
+    void release(uint32_t index);
+    uint64_t nextEventTick() const;
+    void runTick(uint64_t tick, std::vector<Payload> &expired);
+  };
+
+  // Implementations
+
+  template <typename Payload>
+  TimerHandle TimingWheel<Payload>::schedule(Clock::time_point deadline, Payload payload)
+  {
+    uint32_t index = freeList;
+    if (index != NONE)
+    {
+      freeList = timers[index].next;
+    }
+    else
+    {
+      index = static_cast<uint32_t>(timers.size());
+      timers.emplace_back();
+    }
+
+    Timer &timer = timers[index];
+    timer.payload = std::move(payload);
+    timer.deadline = std::max(tickOf(deadline, true), currentTick + 1);
+    place(index);
+    pending++;
+    return TimerHandle{index, timer.generation};
+  }
+
+  template <typename Payload>
+  bool TimingWheel<Payload>::cancel(TimerHandle handle)
+  {
+    if (!isPending(handle))
+    {
+      return false;
+    }
+    unlink(handle.index);
+    release(handle.index);
+    return true;
+  }
+
+  template <typename Payload>
+  void TimingWheel<Payload>::advance(Clock::time_point now, std::vector<Payload> &expired)
+  {
+    uint64_t target = tickOf(now, false);
+    while (currentTick < target)
+    {
+      uint64_t tick = nextEventTick();
+      if (tick > target)
+      {
+        currentTick = target;
+        break;
+      }
+      currentTick = tick;
+      runTick(tick, expired);
+    }
+  }
+
+  template <typename Payload>
+  typename TimingWheel<Payload>::Clock::time_point TimingWheel<Payload>::nextDeadline() const
+  {
+    if (pending == 0)
+    {
+      return Clock::time_point::max();
+    }
+    return origin + resolution * static_cast<Clock::rep>(nextEventTick());
+  }
+
+  template <typename Payload>
+  void TimingWheel<Payload>::place(uint32_t index)
+  {
+    Timer &timer = timers[index];
+
+    // Past the last level, wait in it until it turns again
+    uint64_t delta = timer.deadline - currentTick;
+    uint64_t placed = delta < SPAN ? timer.deadline : currentTick + SPAN - 1;
+
+    unsigned level = 0;
+    while (level + 1 < LEVELS && (placed - currentTick) >> (SLOT_BITS * (level + 1)) != 0)
+    {
+      level++;
+    }
+    unsigned position = (placed >> (SLOT_BITS * level)) & (SLOTS - 1);
+    uint32_t slot = level * SLOTS + position;
+
+    timer.slot = slot;
+    timer.previous = NONE;
+    timer.next = heads[slot];
+    if (heads[slot] != NONE)
+    {
+      timers[heads[slot]].previous = index;
+    }
+    heads[slot] = index;
+    occupied[level] |= uint64_t(1) << position;
+  }
+
+  template <typename Payload>
+  void TimingWheel<Payload>::unlink(uint32_t index)
+  {
+    Timer &timer = timers[index];
+    if (timer.previous != NONE)
+    {
+      timers[timer.previous].next = timer.next;
+    }
+    else
+    {
+      heads[timer.slot] = timer.next;
+    }
+    if (timer.next != NONE)
+    {
+      timers[timer.next].previous = timer.previous;
+    }
+    if (heads[timer.slot] == NONE)
+    {
+      occupied[timer.slot / SLOTS] &= ~(uint64_t(1) << (timer.slot % SLOTS));
+    }
+    timer.slot = NONE;
+  }
+
+  template <typename Payload>
+  void TimingWheel<Payload>::release(uint32_t index)
+  {
+    Timer &timer = timers[index];
+    timer.payload = Payload{};
+    timer.generation++;
+    timer.next = freeList;
+    freeList = index;
+    pending--;
+  }
+
+  template <typename Payload>
+  uint64_t TimingWheel<Payload>::nextEventTick() const
+  {
+    uint64_t next = std::numeric_limits<uint64_t>::max();
+    for (unsigned level = 0; level < LEVELS; level++)
+    {
+      if (occupied[level] == 0)
+      {
+        continue;
+      }
+
+      // Slots of this level are reached every 64^level ticks, the current one was reached already
+      unsigned shift = SLOT_BITS * level;
+      uint64_t reached = currentTick >> shift;
+      unsigned position = static_cast<unsigned>(reached & (SLOTS - 1));
+      uint64_t ahead = std::rotr(occupied[level], static_cast<int>((position + 1) % SLOTS));
+      uint64_t steps = static_cast<uint64_t>(std::countr_zero(ahead)) + 1;
+      next = std::min(next, (reached + steps) << shift);
+    }
+    return next;
+  }
+
+  template <typename Payload>
+  void TimingWheel<Payload>::runTick(uint64_t tick, std::vector<Payload> &expired)
+  {
+    // Move the timers of every upper slot reached at this tick down, highest level first
+    for (unsigned level = LEVELS - 1; level > 0; level--)
+    {
+      unsigned shift = SLOT_BITS * level;
+      if ((tick & ((uint64_t(1) << shift) - 1)) != 0)
+      {
+        continue;
+      }
+      uint32_t slot = level * SLOTS + static_cast<uint32_t>((tick >> shift) & (SLOTS - 1));
+      uint32_t index = heads[slot];
+      heads[slot] = NONE;
+      occupied[level] &= ~(uint64_t(1) << (slot % SLOTS));
+      while (index != NONE)
+      {
+        uint32_t next = timers[index].next;
+        place(index);
+        index = next;
+      }
+    }
+
+    // The first level slot of this tick only holds timers due now
+    uint32_t slot = static_cast<uint32_t>(tick & (SLOTS - 1));
+    uint32_t index = heads[slot];
+    heads[slot] = NONE;
+    occupied[0] &= ~(uint64_t(1) << slot);
+    if (index == NONE)
+    {
+      return;
+    }
+
+    // Slots are filled newest first, fire from the tail in the order the timers were scheduled
+    while (timers[index].next != NONE)
+    {
+      index = timers[index].next;
+    }
+    while (index != NONE)
+    {
+      uint32_t previous = timers[index].previous;
+      timers[index].slot = NONE;
+      expired.push_back(std::move(timers[index].payload));
+      release(index);
+      index = previous;
+    }
+  }
+}
@@ -1,14 +1,16 @@
 #include "data/game/manager.h"
+#include "data/logger.h"
 
 using namespace std::filesystem;
 
-std::vector<std::string_view> GameManager::listGameNames() const
+std::vector<std::string> GameManager::listGameNames() const
 {
-  std::vector<std::string_view> gameNames;
+  std::lock_guard<std::mutex> lock(gameListMutex);
+  std::vector<std::string> gameNames;
 
   for (const auto &gameFileName : gameFileNames)
   {
-    gameNames.push_back(std::string_view(gameFileName).substr(0, gameFileName.size() - GAME_FILE_EXTENSION.size()));
+    gameNames.push_back(gameFileName.substr(0, gameFileName.size() - GAME_FILE_EXTENSION.size()));
   }
 
   return gameNames;
@@ -28,12 +30,27 @@ std::optional<GameFile> GameManager::readGameFile(std::string gameName) const
   return gameFile;
 }
 
+std::optional<GameFileStamp> GameManager::getGameFileStamp(std::string gameName) const
+{
+  std::string path = getGamePath(gameName);
+
+  std::error_code error;
+  auto lastWriteTime = std::filesystem::last_write_time(path, error);
+  if (error)
+  {
+    return std::nullopt;
+  }
+
+  return GameFileStamp{path, lastWriteTime};
+}
+
 void GameManager::refreshGameList()
 {
+    std::lock_guard<std::mutex> lock(gameListMutex);
     gameFileNames.clear();
 
     if (!std::filesystem::exists(gameDirectory)) {
-        std::cerr << "Error: Game directory does not exist: " << gameDirectory << std::endl;
+        LOG_WARNING("games", "game directory does not exist, creating it", {{"path", gameDirectory}});
         //create directory
         std::filesystem::create_directories(gameDirectory);
     }
@@ -47,6 +64,22 @@ void GameManager::refreshGameList()
     }
 }
 
+void GameManager::applyChange(const GameChange &change)
+{
+  std::lock_guard<std::mutex> lock(gameListMutex);
+  const std::string gameFileName = change.gameName + GAME_FILE_EXTENSION;
+
+  auto it = std::find(gameFileNames.begin(), gameFileNames.end(), gameFileName);
+  if (change.removed && it != gameFileNames.end())
+  {
+    gameFileNames.erase(it);
+  }
+  else if (!change.removed && it == gameFileNames.end())
+  {
+    gameFileNames.push_back(gameFileName);
+  }
+}
+
 std::string GameManager::getGamePath(std::string gameName) const
 {
   return gameDirectory + "/" + gameName + GAME_FILE_EXTENSION;
@@ -0,0 +1,207 @@
+#include "data/game/watcher.h"
+#include "data/game/manager.h"
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace
+{
+  // How long a blocking wait may last before the stop token is checked again
+  const int STOP_CHECK_INTERVAL_MS = 200;
+
+  bool isGameFile(const std::filesystem::path &path)
+  {
+    return path.extension() == GAME_FILE_EXTENSION;
+  }
+}
+
+GameDirectoryWatcher::GameDirectoryWatcher(std::string gameDirectory, ChangeCallback onChange,
+                                           std::chrono::milliseconds pollInterval)
+    : gameDirectory(std::move(gameDirectory)), onChange(std::move(onChange)), pollInterval(pollInterval)
+{
+}
+
+GameDirectoryWatcher::~GameDirectoryWatcher()
+{
+  stop();
+}
+
+void GameDirectoryWatcher::start(bool forcePolling)
+{
+  if (worker.joinable())
+  {
+    return;
+  }
+
+  int inotifyFd = forcePolling ? -1 : inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotifyFd >= 0)
+  {
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF;
+    if (inotify_add_watch(inotifyFd, gameDirectory.c_str(), mask) < 0)
+    {
+      close(inotifyFd);
+      inotifyFd = -1;
+    }
+  }
+
+  // Snapshot before returning so changes made right after start() are seen by polling,
+  // and so inotify can tell what changed when it has to rescan
+  usingInotify = inotifyFd >= 0;
+  if (usingInotify)
+  {
+    worker = std::jthread([this, inotifyFd, known = scanDirectory()](std::stop_token stopToken) mutable
+                          { watchWithInotify(stopToken, inotifyFd, std::move(known)); });
+  }
+  else
+  {
+    worker = std::jthread([this, known = scanDirectory()](std::stop_token stopToken) mutable
+                          { watchWithPolling(stopToken, std::move(known)); });
+  }
+}
+
+void GameDirectoryWatcher::stop()
+{
+  if (worker.joinable())
+  {
+    worker.request_stop();
+    worker.join();
+  }
+}
+
+void GameDirectoryWatcher::watchWithInotify(std::stop_token stopToken, int inotifyFd, GameTimes known)
+{
+  alignas(inotify_event) char buffer[4096];
+  bool watchLost = false;
+
+  while (!stopToken.stop_requested() && !watchLost)
+  {
+    pollfd descriptor{inotifyFd, POLLIN, 0};
+    if (poll(&descriptor, 1, STOP_CHECK_INTERVAL_MS) <= 0)
+    {
+      continue;
+    }
+
+    ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+    for (ssize_t offset = 0; offset < length;)
+    {
+      const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+      offset += sizeof(inotify_event) + event->len;
+
+      // The kernel queue overflowed and events were lost, so compare against a fresh scan
+      if (event->mask & IN_Q_OVERFLOW)
+      {
+        auto current = scanDirectory();
+        reportChanges(known, current);
+        known = std::move(current);
+        continue;
+      }
+
+      // The directory is gone or was moved away, no more events will come for its path
+      if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+      {
+        watchLost = true;
+        break;
+      }
+
+      if (event->len == 0 || (event->mask & IN_ISDIR))
+      {
+        continue;
+      }
+
+      std::filesystem::path path(event->name);
+      if (!isGameFile(path))
+      {
+        continue;
+      }
+
+      std::string gameName = path.stem().string();
+      bool removed = (event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0;
+      if (removed)
+      {
+        known.erase(gameName);
+      }
+      else
+      {
+        std::error_code error;
+        auto lastWriteTime = std::filesystem::last_write_time(std::filesystem::path(gameDirectory) / path, error);
+        if (!error)
+        {
+          known[gameName] = lastWriteTime;
+        }
+      }
+      onChange(GameChange{gameName, removed});
+    }
+  }
+
+  close(inotifyFd);
+
+  if (watchLost)
+  {
+    // Polling notices the directory coming back, which a new inotify watch would miss in between
+    usingInotify = false;
+    watchWithPolling(stopToken, std::move(known));
+  }
+}
+
+void GameDirectoryWatcher::watchWithPolling(std::stop_token stopToken, GameTimes known)
+{
+  while (!stopToken.stop_requested())
+  {
+    // Sleep in short steps so stopping does not wait for a whole interval
+    auto wakeTime = std::chrono::steady_clock::now() + pollInterval;
+    while (!stopToken.stop_requested() && std::chrono::steady_clock::now() < wakeTime)
+    {
+      std::this_thread::sleep_for(std::min(pollInterval, std::chrono::milliseconds(STOP_CHECK_INTERVAL_MS)));
+    }
+    if (stopToken.stop_requested())
+    {
+      break;
+    }
+
+    auto current = scanDirectory();
+    reportChanges(known, current);
+    known = std::move(current);
+  }
+}
+
+void GameDirectoryWatcher::reportChanges(const GameTimes &known, const GameTimes &current) const
+{
+  for (const auto &[gameName, lastWriteTime] : current)
+  {
+    auto previous = known.find(gameName);
+    if (previous == known.end() || previous->second != lastWriteTime)
+    {
+      onChange(GameChange{gameName, false});
+    }
+  }
+
+  for (const auto &entry : known)
+  {
+    if (!current.contains(entry.first))
+    {
+      onChange(GameChange{entry.first, true});
+    }
+  }
+}
+
+GameDirectoryWatcher::GameTimes GameDirectoryWatcher::scanDirectory() const
+{
+  GameTimes games;
+
+  std::error_code error;
+  for (const auto &entry : std::filesystem::directory_iterator(gameDirectory, error))
+  {
+    std::error_code entryError;
+    if (entry.is_regular_file(entryError) && isGameFile(entry.path()))
+    {
+      auto lastWriteTime = entry.last_write_time(entryError);
+      if (!entryError)
+      {
+        games[entry.path().stem().string()] = lastWriteTime;
+      }
+    }
+  }
+
+  return games;
+}
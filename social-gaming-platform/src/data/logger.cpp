@@ -0,0 +1,366 @@
+#include "data/logger.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+namespace
+{
+  const size_t WRITE_BUFFER_SIZE = 1 << 16;
+  const size_t MAX_LINE_LENGTH = 64 + Logger::RECORD_TEXT_CAPACITY;
+
+  /**
+   * Appends to a fixed size buffer, silently stopping when it is full
+   */
+  class TextWriter
+  {
+  public:
+    TextWriter(char *buffer, size_t capacity) : buffer(buffer), capacity(capacity) {}
+
+    void append(char character)
+    {
+      if (length < capacity)
+      {
+        buffer[length++] = character;
+      }
+      else
+      {
+        truncated = true;
+      }
+    }
+
+    void append(std::string_view text)
+    {
+      size_t count = std::min(text.size(), capacity - length);
+      std::memcpy(buffer + length, text.data(), count);
+      length += count;
+      truncated = truncated || count < text.size();
+    }
+
+    // Keeps every record on one line
+    void appendEscaped(std::string_view text, bool quote)
+    {
+      if (quote)
+      {
+        append('"');
+      }
+      for (char character : text)
+      {
+        if (character == '\n')
+        {
+          append("\\n");
+        }
+        else if (character == '"' && quote)
+        {
+          append("\\\"");
+        }
+        else
+        {
+          append(character);
+        }
+      }
+      if (quote)
+      {
+        append('"');
+      }
+    }
+
+    template <typename T>
+    void appendNumber(T value)
+    {
+      char digits[32];
+      auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+      append(std::string_view(digits, end - digits));
+    }
+
+    void appendField(const LogField &field)
+    {
+      append(' ');
+      append(field.key);
+      append('=');
+      switch (field.kind)
+      {
+      case LogField::Kind::SIGNED:
+        appendNumber(field.signedValue);
+        break;
+      case LogField::Kind::UNSIGNED:
+        appendNumber(field.unsignedValue);
+        break;
+      case LogField::Kind::FLOATING:
+        appendNumber(field.floatingValue);
+        break;
+      case LogField::Kind::BOOLEAN:
+        append(field.booleanValue ? "true" : "false");
+        break;
+      case LogField::Kind::TEXT:
+        bool quote = field.text.empty() || field.text.find_first_of(" =\"") != std::string_view::npos;
+        appendEscaped(field.text, quote);
+        break;
+      }
+    }
+
+    size_t finish()
+    {
+      if (truncated && capacity >= 3)
+      {
+        std::memcpy(buffer + capacity - 3, "...", 3);
+      }
+      return length;
+    }
+
+  private:
+    char *buffer;
+    size_t capacity;
+    size_t length = 0;
+    bool truncated = false;
+  };
+
+  void appendTimestamp(TextWriter &writer, int64_t timeMillis)
+  {
+    std::time_t seconds = timeMillis / 1000;
+    std::tm utc;
+    gmtime_r(&seconds, &utc);
+
+    char text[32];
+    size_t length = std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &utc);
+    writer.append(std::string_view(text, length));
+
+    int millis = timeMillis % 1000;
+    writer.append('.');
+    writer.append(static_cast<char>('0' + millis / 100));
+    writer.append(static_cast<char>('0' + millis / 10 % 10));
+    writer.append(static_cast<char>('0' + millis % 10));
+    writer.append('Z');
+  }
+}
+
+std::string_view logLevelName(LogLevel level)
+{
+  switch (level)
+  {
+  case LogLevel::DEBUG:
+    return "DEBUG";
+  case LogLevel::INFO:
+    return "INFO";
+  case LogLevel::WARNING:
+    return "WARNING";
+  case LogLevel::ERROR:
+    return "ERROR";
+  default:
+    return "OFF";
+  }
+}
+
+std::expected<LogLevel, std::string> parseLogLevel(std::string_view name)
+{
+  for (LogLevel level : {LogLevel::DEBUG, LogLevel::INFO, LogLevel::WARNING, LogLevel::ERROR, LogLevel::OFF})
+  {
+    std::string_view levelName = logLevelName(level);
+    if (name.size() == levelName.size() &&
+        std::equal(name.begin(), name.end(), levelName.begin(), [](char a, char b)
+                   { return std::toupper(a) == b; }))
+    {
+      return level;
+    }
+  }
+  return std::unexpected("Unknown log level: " + std::string(name));
+}
+
+Logger::Logger(size_t capacity, FILE *output) : output(output)
+{
+  size_t size = 1;
+  while (size < capacity)
+  {
+    size <<= 1;
+  }
+  slots = std::make_unique<Slot[]>(size);
+  mask = size - 1;
+  for (size_t i = 0; i < size; i++)
+  {
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  writer = std::jthread([this](std::stop_token stopToken)
+                        { writeRecords(stopToken); });
+}
+
+Logger::~Logger()
+{
+  writer.request_stop();
+  wakeWriter();
+  writer.join();
+
+  if (ownedOutput != nullptr)
+  {
+    std::fclose(ownedOutput);
+  }
+}
+
+Logger &Logger::instance()
+{
+  static Logger logger;
+  return logger;
+}
+
+std::expected<void, std::string> Logger::setOutputFile(const std::string &path)
+{
+  FILE *file = std::fopen(path.c_str(), "a");
+  if (file == nullptr)
+  {
+    return std::unexpected("Unable to open log file: " + path);
+  }
+
+  std::lock_guard<std::mutex> lock(outputMutex);
+  if (ownedOutput != nullptr)
+  {
+    std::fclose(ownedOutput);
+  }
+  ownedOutput = file;
+  output = file;
+  return {};
+}
+
+void Logger::setOutput(FILE *newOutput)
+{
+  std::lock_guard<std::mutex> lock(outputMutex);
+  output = newOutput;
+}
+
+void Logger::log(LogLevel level, std::string_view component, std::string_view message,
+                 std::initializer_list<LogField> fields) noexcept
+{
+  // Claim a slot, the Vyukov bounded queue scheme for many producers
+  size_t position = enqueuePosition.load(std::memory_order_relaxed);
+  Slot *slot;
+  while (true)
+  {
+    slot = &slots[position & mask];
+    size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+    if (difference == 0)
+    {
+      if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    else if (difference < 0)
+    {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    else
+    {
+      position = enqueuePosition.load(std::memory_order_relaxed);
+    }
+  }
+
+  Record &record = slot->record;
+  record.timeMillis = std::chrono::duration_cast<std::chrono::milliseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+  record.level = level;
+
+  TextWriter text(record.text, RECORD_TEXT_CAPACITY);
+  text.append('[');
+  text.append(component);
+  text.append("] ");
+  text.appendEscaped(message, false);
+  for (const auto &field : fields)
+  {
+    text.appendField(field);
+  }
+  record.length = text.finish();
+
+  slot->sequence.store(position + 1, std::memory_order_release);
+  wakeWriter();
+}
+
+void Logger::wakeWriter() noexcept
+{
+  // Only a waiting writer costs a wake up, a busy one picks the record up on its next pass
+  published.fetch_add(1, std::memory_order_release);
+  published.notify_one();
+}
+
+void Logger::flush()
+{
+  size_t target = enqueuePosition.load(std::memory_order_acquire);
+  while (writtenPosition.load(std::memory_order_acquire) < target)
+  {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+}
+
+void Logger::writeRecords(std::stop_token stopToken)
+{
+  auto buffer = std::make_unique<char[]>(WRITE_BUFFER_SIZE);
+  size_t position = 0;
+
+  while (!stopToken.stop_requested())
+  {
+    // Read before looking for records, so one published in between ends the wait at once
+    uint32_t seen = published.load(std::memory_order_acquire);
+    size_t written = writeAvailable(position, buffer.get(), WRITE_BUFFER_SIZE);
+    if (written == 0)
+    {
+      published.wait(seen, std::memory_order_acquire);
+    }
+    position += written;
+  }
+
+  // Records logged before stopping are still written
+  while (size_t written = writeAvailable(position, buffer.get(), WRITE_BUFFER_SIZE))
+  {
+    position += written;
+  }
+}
+
+size_t Logger::writeAvailable(size_t position, char *buffer, size_t bufferSize)
+{
+  size_t count = 0;
+  size_t used = 0;
+
+  std::lock_guard<std::mutex> lock(outputMutex);
+
+  while (true)
+  {
+    Slot &slot = slots[(position + count) & mask];
+    if (slot.sequence.load(std::memory_order_acquire) != position + count + 1)
+    {
+      break;
+    }
+
+    if (bufferSize - used < MAX_LINE_LENGTH)
+    {
+      std::fwrite(buffer, 1, used, output);
+      used = 0;
+    }
+
+    const Record &record = slot.record;
+    TextWriter line(buffer + used, MAX_LINE_LENGTH);
+    appendTimestamp(line, record.timeMillis);
+    line.append(' ');
+    std::string_view levelName = logLevelName(record.level);
+    line.append(levelName);
+    line.append(std::string_view("        ", 8 - levelName.size()));
+    line.append(std::string_view(record.text, record.length));
+    line.append('\n');
+    used += line.finish();
+
+    // Hand the slot back to the producers
+    slot.sequence.store(position + count + mask + 1, std::memory_order_release);
+    count++;
+  }
+
+  if (count > 0)
+  {
+    std::fwrite(buffer, 1, used, output);
+    std::fflush(output);
+    writtenPosition.store(position + count, std::memory_order_release);
+  }
+  return count;
+}
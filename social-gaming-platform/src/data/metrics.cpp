@@ -0,0 +1,256 @@
+#include "data/metrics.h"
+
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+  void appendNumber(std::string &out, double value)
+  {
+    if (std::isinf(value))
+    {
+      out += "+Inf";
+      return;
+    }
+    char digits[32];
+    auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, end - digits);
+  }
+
+  void appendNumber(std::string &out, uint64_t value)
+  {
+    char digits[24];
+    auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, end - digits);
+  }
+
+  void appendNumber(std::string &out, int64_t value)
+  {
+    char digits[24];
+    auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, end - digits);
+  }
+
+  // name{labels,extra} with the braces left out when there are no labels
+  void appendSeries(std::string &out, std::string_view name, std::string_view suffix, std::string_view labels,
+                    std::string_view extra = "")
+  {
+    out += name;
+    out += suffix;
+    if (labels.empty() && extra.empty())
+    {
+      out += ' ';
+      return;
+    }
+    out += '{';
+    out += labels;
+    if (!labels.empty() && !extra.empty())
+    {
+      out += ',';
+    }
+    out += extra;
+    out += "} ";
+  }
+
+  const char *typeName(const std::variant<Counter *, Gauge *, Histogram *> &metric)
+  {
+    switch (metric.index())
+    {
+    case 0:
+      return "counter";
+    case 1:
+      return "gauge";
+    default:
+      return "histogram";
+    }
+  }
+}
+
+uint64_t Counter::value() const noexcept
+{
+  uint64_t total = 0;
+  for (const auto &cell : cells)
+  {
+    total += cell.value.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+Histogram::Snapshot Histogram::snapshot() const noexcept
+{
+  Snapshot snapshot;
+  for (const auto &shard : shards)
+  {
+    for (size_t i = 0; i < BUCKETS; i++)
+    {
+      uint64_t count = shard.buckets[i].load(std::memory_order_relaxed);
+      snapshot.buckets[i] += count;
+      snapshot.count += count;
+    }
+    snapshot.sumNanos += shard.sumNanos.load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+double Histogram::upperBoundSeconds(size_t bucket) noexcept
+{
+  if (bucket >= BUCKETS - 1)
+  {
+    return std::numeric_limits<double>::infinity();
+  }
+  return std::ldexp(1.0, FIRST_BOUND_BITS + bucket) / 1e9;
+}
+
+uint64_t LatencyHistogram::count() const noexcept
+{
+  uint64_t total = 0;
+  for (const auto &bucket : buckets)
+  {
+    total += bucket.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+uint64_t LatencyHistogram::quantileNanos(double quantile) const noexcept
+{
+  std::array<uint64_t, BUCKETS> counts;
+  uint64_t total = 0;
+  for (size_t i = 0; i < BUCKETS; i++)
+  {
+    counts[i] = buckets[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total == 0)
+  {
+    return 0;
+  }
+
+  // The smallest value at least this many recorded values are not above
+  uint64_t rank = static_cast<uint64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(total)));
+  rank = std::max<uint64_t>(rank, 1);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKETS; i++)
+  {
+    seen += counts[i];
+    if (seen >= rank)
+    {
+      return highestOf(i);
+    }
+  }
+  return highestOf(BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::highestOf(size_t bucket) noexcept
+{
+  if (bucket < 2 * SUB_BUCKETS)
+  {
+    return bucket;
+  }
+  size_t shift = bucket / SUB_BUCKETS - 1;
+  uint64_t subBucket = bucket % SUB_BUCKETS + SUB_BUCKETS;
+  return ((subBucket + 1) << shift) - 1;
+}
+
+MetricsRegistry &MetricsRegistry::instance()
+{
+  static MetricsRegistry registry;
+  return registry;
+}
+
+template <typename Metric>
+Metric &MetricsRegistry::find(std::deque<Metric> &metrics, std::string_view name, std::string_view help,
+                              std::string_view labels)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto &entry : entries)
+  {
+    if (entry.name == name && entry.labels == labels && std::holds_alternative<Metric *>(entry.metric))
+    {
+      return *std::get<Metric *>(entry.metric);
+    }
+  }
+
+  Metric &metric = metrics.emplace_back();
+  entries.push_back(Entry{std::string(name), std::string(help), std::string(labels), &metric});
+  return metric;
+}
+
+Counter &MetricsRegistry::counter(std::string_view name, std::string_view help, std::string_view labels)
+{
+  return find(counters, name, help, labels);
+}
+
+Gauge &MetricsRegistry::gauge(std::string_view name, std::string_view help, std::string_view labels)
+{
+  return find(gauges, name, help, labels);
+}
+
+Histogram &MetricsRegistry::histogram(std::string_view name, std::string_view help, std::string_view labels)
+{
+  return find(histograms, name, help, labels);
+}
+
+std::string MetricsRegistry::render() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  std::string out;
+
+  std::vector<bool> rendered(entries.size(), false);
+  for (size_t first = 0; first < entries.size(); first++)
+  {
+    if (rendered[first])
+    {
+      continue;
+    }
+
+    const Entry &family = entries[first];
+    out += "# HELP " + family.name + " " + family.help + "\n";
+    out += "# TYPE " + family.name + " " + typeName(family.metric) + "\n";
+
+    for (size_t i = first; i < entries.size(); i++)
+    {
+      const Entry &entry = entries[i];
+      if (rendered[i] || entry.name != family.name)
+      {
+        continue;
+      }
+      rendered[i] = true;
+
+      if (auto *counter = std::get_if<Counter *>(&entry.metric))
+      {
+        appendSeries(out, entry.name, "", entry.labels);
+        appendNumber(out, (*counter)->value());
+        out += '\n';
+      }
+      else if (auto *gauge = std::get_if<Gauge *>(&entry.metric))
+      {
+        appendSeries(out, entry.name, "", entry.labels);
+        appendNumber(out, (*gauge)->value());
+        out += '\n';
+      }
+      else
+      {
+        Histogram::Snapshot snapshot = std::get<Histogram *>(entry.metric)->snapshot();
+        uint64_t cumulative = 0;
+        for (size_t bucket = 0; bucket < Histogram::BUCKETS; bucket++)
+        {
+          cumulative += snapshot.buckets[bucket];
+          std::string bound = "le=\"";
+          appendNumber(bound, Histogram::upperBoundSeconds(bucket));
+          bound += '"';
+          appendSeries(out, entry.name, "_bucket", entry.labels, bound);
+          appendNumber(out, cumulative);
+          out += '\n';
+        }
+        appendSeries(out, entry.name, "_sum", entry.labels);
+        appendNumber(out, static_cast<double>(snapshot.sumNanos) / 1e9);
+        out += '\n';
+        appendSeries(out, entry.name, "_count", entry.labels);
+        appendNumber(out, snapshot.count);
+        out += '\n';
+      }
+    }
+  }
+  return out;
+}
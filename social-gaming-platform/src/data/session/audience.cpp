@@ -0,0 +1,34 @@
+#include "data/session/audience.h"
+
+bool AudienceGroup::add(Connection connection)
+{
+  auto [it, inserted] = memberIndex.try_emplace(connection.id, members.size());
+  if (!inserted)
+  {
+    return false;
+  }
+
+  members.push_back(connection);
+  return true;
+}
+
+bool AudienceGroup::remove(uintptr_t connectionId)
+{
+  auto it = memberIndex.find(connectionId);
+  if (it == memberIndex.end())
+  {
+    return false;
+  }
+
+  // Move the last member into the freed slot so removal stays O(1)
+  size_t slot = it->second;
+  memberIndex.erase(it);
+
+  if (slot != members.size() - 1)
+  {
+    members[slot] = members.back();
+    memberIndex[members[slot].id] = slot;
+  }
+  members.pop_back();
+  return true;
+}
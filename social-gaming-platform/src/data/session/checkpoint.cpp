@@ -0,0 +1,612 @@
+#include "data/session/checkpoint.h"
+#include "data/encoding.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+  enum class NodeTag : uint8_t
+  {
+    MONOSTATE = 0,
+    INT = 1,
+    BOOL = 2,
+    RANGE = 3,
+    STRING = 4,
+    VECTOR = 5,
+    MAP = 6,
+  };
+
+  const size_t HEADER_SIZE = 4 + sizeof(uint32_t) + sizeof(uint32_t) + sizeof(int32_t) + sizeof(uint64_t);
+
+  using encoding::put;
+
+  void putString(std::string &out, std::string_view value)
+  {
+    put<uint32_t>(out, value.size());
+    out.append(value);
+  }
+
+  void putNode(std::string &out, const DataNode &node)
+  {
+    if (node.isInt())
+    {
+      put(out, NodeTag::INT);
+      put<int32_t>(out, node.getInt());
+    }
+    else if (node.isBool())
+    {
+      put(out, NodeTag::BOOL);
+      put<uint8_t>(out, node.getBool());
+    }
+    else if (node.isRange())
+    {
+      put(out, NodeTag::RANGE);
+      put<int32_t>(out, node.getRange().first);
+      put<int32_t>(out, node.getRange().second);
+    }
+    else if (node.isString())
+    {
+      put(out, NodeTag::STRING);
+      putString(out, node.getString());
+    }
+    else if (node.isVector())
+    {
+      put(out, NodeTag::VECTOR);
+      put<uint32_t>(out, node.getVector().size());
+      for (const auto &element : node.getVector())
+      {
+        putNode(out, element);
+      }
+    }
+    else if (node.isMap())
+    {
+      put(out, NodeTag::MAP);
+      put<uint32_t>(out, node.getMap().size());
+      for (const auto &[key, value] : node.getMap())
+      {
+        putString(out, key);
+        putNode(out, value);
+      }
+    }
+    else
+    {
+      put(out, NodeTag::MONOSTATE);
+    }
+  }
+
+  /**
+   * Bounds checked cursor over an encoded buffer
+   */
+  class ByteReader
+  {
+  private:
+    std::string_view bytes;
+    size_t position = 0;
+
+  public:
+    ByteReader(std::string_view bytes) : bytes(bytes) {};
+
+    template <typename T>
+    bool get(T &value)
+    {
+      std::string_view rest = bytes.substr(position);
+      if (!encoding::get(rest, value))
+      {
+        return false;
+      }
+      position += sizeof(T);
+      return true;
+    }
+
+    bool getString(std::string_view &value)
+    {
+      uint32_t length;
+      if (!get(length) || bytes.size() - position < length)
+      {
+        return false;
+      }
+      value = bytes.substr(position, length);
+      position += length;
+      return true;
+    }
+
+    void seek(size_t offset) { position = offset; };
+  };
+
+  bool getNode(ByteReader &reader, DataNode &node)
+  {
+    NodeTag tag;
+    if (!reader.get(tag))
+    {
+      return false;
+    }
+
+    switch (tag)
+    {
+    case NodeTag::MONOSTATE:
+      node = DataNode();
+      return true;
+    case NodeTag::INT:
+    {
+      int32_t value;
+      if (!reader.get(value))
+      {
+        return false;
+      }
+      node = create_int_node(value);
+      return true;
+    }
+    case NodeTag::BOOL:
+    {
+      uint8_t value;
+      if (!reader.get(value))
+      {
+        return false;
+      }
+      node = create_bool_node(value != 0);
+      return true;
+    }
+    case NodeTag::RANGE:
+    {
+      int32_t first, second;
+      if (!reader.get(first) || !reader.get(second))
+      {
+        return false;
+      }
+      node = create_range_node({first, second});
+      return true;
+    }
+    case NodeTag::STRING:
+    {
+      std::string_view value;
+      if (!reader.getString(value))
+      {
+        return false;
+      }
+      node = create_string_node(value);
+      return true;
+    }
+    case NodeTag::VECTOR:
+    {
+      uint32_t count;
+      if (!reader.get(count))
+      {
+        return false;
+      }
+      node = create_vector_node();
+      auto &vec = node.getVector();
+      for (uint32_t i = 0; i < count; i++)
+      {
+        DataNode element;
+        if (!getNode(reader, element))
+        {
+          return false;
+        }
+        vec.push_back(std::move(element));
+      }
+      return true;
+    }
+    case NodeTag::MAP:
+    {
+      uint32_t count;
+      if (!reader.get(count))
+      {
+        return false;
+      }
+      node = create_map_node();
+      auto &map = node.getMap();
+      for (uint32_t i = 0; i < count; i++)
+      {
+        std::string_view key;
+        DataNode value;
+        if (!reader.getString(key) || !getNode(reader, value))
+        {
+          return false;
+        }
+        map.emplace(std::string(key), std::move(value));
+      }
+      return true;
+    }
+    }
+    return false;
+  }
+}
+
+void encodeSession(std::string &out, const Session &session)
+{
+  const GameData &gameData = session.getGameData();
+
+  put<int32_t>(out, session.getId());
+  putString(out, session.getJoinCode());
+  putString(out, session.getGameName());
+  put<int32_t>(out, session.getInterpreterPosition());
+
+  putNode(out, gameData.configuration.getDataNode());
+  putNode(out, gameData.constants.getDataNode());
+  putNode(out, gameData.variables.getDataNode());
+  putNode(out, gameData.perPlayerState.getDataNode());
+  putNode(out, gameData.perAudienceState.getDataNode());
+}
+
+std::expected<Session, std::string> decodeSession(std::string_view record)
+{
+  ByteReader reader(record);
+
+  int32_t id;
+  int32_t interpreterPosition;
+  std::string_view joinCode;
+  std::string_view gameName;
+  if (!reader.get(id) || !reader.getString(joinCode) || !reader.getString(gameName) || !reader.get(interpreterPosition))
+  {
+    return std::unexpected("Checkpoint record is truncated");
+  }
+
+  DataNode nodes[5];
+  for (auto &node : nodes)
+  {
+    if (!getNode(reader, node))
+    {
+      return std::unexpected("Checkpoint record has malformed game data");
+    }
+  }
+
+  GameData gameData{Configuration(nodes[0]), GameStateObject(nodes[1]), GameStateObject(nodes[2]),
+                    GameStateObject(nodes[3]), GameStateObject(nodes[4])};
+
+  Session session(id, gameData, std::string(joinCode));
+  session.setGameName(std::string(gameName));
+  session.setInterpreterPosition(interpreterPosition);
+  return session;
+}
+
+/*
+ * CheckpointBuilder
+ */
+
+void CheckpointBuilder::addSession(const Session &session)
+{
+  size_t offset = records.size();
+  encodeSession(records, session);
+  entries.push_back({session.getId(), session.getJoinCode(), offset, static_cast<uint32_t>(records.size() - offset)});
+  maxSessionId = std::max(maxSessionId, session.getId());
+}
+
+void CheckpointBuilder::addEncodedSession(int sessionId, const std::string &joinCode, std::string_view record)
+{
+  size_t offset = records.size();
+  records.append(record);
+  entries.push_back({sessionId, joinCode, offset, static_cast<uint32_t>(record.size())});
+  maxSessionId = std::max(maxSessionId, sessionId);
+}
+
+std::string CheckpointBuilder::finish() const
+{
+  std::string image;
+  image.reserve(HEADER_SIZE + records.size() + entries.size() * 32);
+
+  image.append(CHECKPOINT_MAGIC);
+  put<uint32_t>(image, CHECKPOINT_VERSION);
+  put<uint32_t>(image, entries.size());
+  put<int32_t>(image, maxSessionId);
+  put<uint64_t>(image, HEADER_SIZE + records.size());
+
+  image.append(records);
+
+  for (const auto &entry : entries)
+  {
+    put<int32_t>(image, entry.sessionId);
+    putString(image, entry.joinCode);
+    put<uint64_t>(image, HEADER_SIZE + entry.offset);
+    put<uint32_t>(image, entry.length);
+  }
+
+  return image;
+}
+
+std::expected<void, std::string> CheckpointBuilder::writeTo(const std::string &path) const
+{
+  const std::string image = finish();
+  const std::string tempPath = path + ".tmp";
+
+  int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    return std::unexpected("Unable to open checkpoint file: " + tempPath);
+  }
+
+  size_t written = 0;
+  while (written < image.size())
+  {
+    ssize_t result = ::write(fd, image.data() + written, image.size() - written);
+    if (result < 0)
+    {
+      ::close(fd);
+      return std::unexpected("Unable to write checkpoint file: " + tempPath);
+    }
+    written += result;
+  }
+
+  ::fsync(fd);
+  ::close(fd);
+
+  if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+  {
+    return std::unexpected("Unable to replace checkpoint file: " + path);
+  }
+  return {};
+}
+
+/*
+ * CheckpointReader
+ */
+
+CheckpointReader::CheckpointReader(CheckpointReader &&other) noexcept
+{
+  *this = std::move(other);
+}
+
+CheckpointReader &CheckpointReader::operator=(CheckpointReader &&other) noexcept
+{
+  if (this != &other)
+  {
+    if (mapped)
+    {
+      ::munmap(const_cast<char *>(data), size);
+    }
+
+    mapped = other.mapped;
+    size = other.size;
+    buffer = std::move(other.buffer);
+    data = mapped ? other.data : buffer.data();
+    maxSessionId = other.maxSessionId;
+    entries = std::move(other.entries);
+
+    other.data = nullptr;
+    other.size = 0;
+    other.mapped = false;
+  }
+  return *this;
+}
+
+CheckpointReader::~CheckpointReader()
+{
+  if (mapped)
+  {
+    ::munmap(const_cast<char *>(data), size);
+  }
+}
+
+std::expected<CheckpointReader, std::string> CheckpointReader::open(const std::string &path)
+{
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return std::unexpected("Unable to open checkpoint file: " + path);
+  }
+
+  struct stat info;
+  if (::fstat(fd, &info) != 0 || info.st_size == 0)
+  {
+    ::close(fd);
+    return std::unexpected("Checkpoint file is empty: " + path);
+  }
+
+  void *region = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (region == MAP_FAILED)
+  {
+    return std::unexpected("Unable to map checkpoint file: " + path);
+  }
+
+  CheckpointReader reader;
+  reader.data = static_cast<const char *>(region);
+  reader.size = info.st_size;
+  reader.mapped = true;
+
+  auto indexResult = reader.readIndex();
+  if (!indexResult.has_value())
+  {
+    return std::unexpected(indexResult.error());
+  }
+  return reader;
+}
+
+std::expected<CheckpointReader, std::string> CheckpointReader::fromBuffer(std::string image)
+{
+  CheckpointReader reader;
+  reader.buffer = std::move(image);
+  reader.data = reader.buffer.data();
+  reader.size = reader.buffer.size();
+
+  auto indexResult = reader.readIndex();
+  if (!indexResult.has_value())
+  {
+    return std::unexpected(indexResult.error());
+  }
+  return reader;
+}
+
+std::expected<void, std::string> CheckpointReader::readIndex()
+{
+  std::string_view image(data, size);
+  if (image.size() < HEADER_SIZE || image.substr(0, CHECKPOINT_MAGIC.size()) != CHECKPOINT_MAGIC)
+  {
+    return std::unexpected("Not a session checkpoint");
+  }
+
+  ByteReader reader(image);
+  reader.seek(CHECKPOINT_MAGIC.size());
+
+  uint32_t version, count;
+  int32_t maxId;
+  uint64_t indexOffset;
+  reader.get(version);
+  reader.get(count);
+  reader.get(maxId);
+  reader.get(indexOffset);
+
+  if (version != CHECKPOINT_VERSION)
+  {
+    return std::unexpected("Unsupported checkpoint version " + std::to_string(version));
+  }
+  if (indexOffset > image.size())
+  {
+    return std::unexpected("Checkpoint index is out of bounds");
+  }
+
+  // Session id, join code length, offset and length with an empty join code, so a corrupt count
+  // cannot ask for more than the file holds
+  const uint64_t minEntrySize = sizeof(int32_t) + sizeof(uint32_t) + sizeof(CheckpointEntry::offset) +
+                                sizeof(CheckpointEntry::length);
+  if (count > (image.size() - indexOffset) / minEntrySize)
+  {
+    return std::unexpected("Checkpoint index is truncated");
+  }
+
+  maxSessionId = maxId;
+  entries.clear();
+  entries.reserve(count);
+
+  reader.seek(indexOffset);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    CheckpointEntry entry;
+    int32_t id;
+    std::string_view joinCode;
+    if (!reader.get(id) || !reader.getString(joinCode) || !reader.get(entry.offset) || !reader.get(entry.length))
+    {
+      return std::unexpected("Checkpoint index is truncated");
+    }
+    if (entry.offset > indexOffset || entry.length > indexOffset - entry.offset)
+    {
+      return std::unexpected("Checkpoint record is out of bounds");
+    }
+    entry.sessionId = id;
+    entry.joinCode = std::string(joinCode);
+    entries.push_back(std::move(entry));
+  }
+  return {};
+}
+
+std::string_view CheckpointReader::getRecord(const CheckpointEntry &entry) const
+{
+  return std::string_view(data + entry.offset, entry.length);
+}
+
+/*
+ * SnapshotBuilder
+ */
+
+void SnapshotBuilder::addSession(const Session &session)
+{
+  sessions.addSession(session);
+
+  const auto &players = session.getPlayers();
+  const auto &audience = session.getAudience().getMembers();
+  if (players.empty() && audience.empty())
+  {
+    return;
+  }
+
+  put<int32_t>(members, session.getId());
+  put<uint32_t>(members, players.size());
+  for (const auto &player : players)
+  {
+    put<uint64_t>(members, player.getId());
+  }
+  put<uint32_t>(members, audience.size());
+  for (const auto &member : audience)
+  {
+    put<uint64_t>(members, member.id);
+  }
+  memberCount++;
+}
+
+void SnapshotBuilder::addEncodedSession(int sessionId, const std::string &joinCode, std::string_view record)
+{
+  sessions.addEncodedSession(sessionId, joinCode, record);
+}
+
+std::string SnapshotBuilder::finish() const
+{
+  const std::string checkpoint = sessions.finish();
+
+  std::string image;
+  image.reserve(sizeof(uint64_t) + checkpoint.size() + sizeof(uint32_t) + members.size());
+  put<uint64_t>(image, checkpoint.size());
+  image.append(checkpoint);
+  put<uint32_t>(image, memberCount);
+  image.append(members);
+  return image;
+}
+
+/*
+ * SnapshotReader
+ */
+
+std::expected<SnapshotReader, std::string> SnapshotReader::fromBuffer(std::string_view image)
+{
+  ByteReader reader(image);
+  uint64_t checkpointLength;
+  if (!reader.get(checkpointLength) || checkpointLength > image.size() - sizeof(uint64_t))
+  {
+    return std::unexpected("Session snapshot is truncated");
+  }
+
+  auto checkpoint = CheckpointReader::fromBuffer(std::string(image.substr(sizeof(uint64_t), checkpointLength)));
+  if (!checkpoint.has_value())
+  {
+    return std::unexpected(checkpoint.error());
+  }
+
+  SnapshotReader snapshot;
+  snapshot.sessions = std::move(checkpoint.value());
+
+  reader.seek(sizeof(uint64_t) + checkpointLength);
+  uint32_t count;
+  if (!reader.get(count))
+  {
+    return std::unexpected("Session snapshot has no members");
+  }
+
+  auto getIds = [&reader](std::vector<uintptr_t> &ids)
+  {
+    uint32_t idCount;
+    if (!reader.get(idCount))
+    {
+      return false;
+    }
+    for (uint32_t i = 0; i < idCount; i++)
+    {
+      uint64_t id;
+      if (!reader.get(id))
+      {
+        return false;
+      }
+      ids.push_back(id);
+    }
+    return true;
+  };
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    int32_t sessionId;
+    SessionMembers members;
+    if (!reader.get(sessionId) || !getIds(members.players) || !getIds(members.audience))
+    {
+      return std::unexpected("Session snapshot members are truncated");
+    }
+    snapshot.members[sessionId] = std::move(members);
+  }
+  return snapshot;
+}
+
+const SessionMembers &SnapshotReader::getMembers(int sessionId) const
+{
+  static const SessionMembers none;
+  auto found = members.find(sessionId);
+  return found != members.end() ? found->second : none;
+}
@@ -2,20 +2,59 @@
 #include "data/session/session.h"
 #include "data/session/helpers.h"
 
+#include <algorithm>
+#include <cstring>
+
+SessionManager::SessionManager(unsigned shardIndex, unsigned shardCount)
+    : shardIndex(shardIndex), shardCount(std::clamp(shardCount, 1u, MAX_SHARDS))
+{
+}
+
+/**
+ * With more than one shard, the first character of a join code names the
+ * shard owning the session so requests can be routed without a lookup.
+ */
 std::string SessionManager::generateJoinCode() const
 {
-  return randomString(JOIN_CODE_LENGTH);
+  if (shardCount == 1)
+  {
+    return randomString(JOIN_CODE_LENGTH);
+  }
+  return SHARD_CODE_CHARSET[shardIndex] + randomString(JOIN_CODE_LENGTH - 1);
+}
+
+std::optional<unsigned> SessionManager::shardOfJoinCode(const std::string &joinCode, unsigned shardCount)
+{
+  if (joinCode.length() != JOIN_CODE_LENGTH)
+  {
+    return std::nullopt;
+  }
+
+  const char *found = std::strchr(SHARD_CODE_CHARSET, joinCode.front());
+  if (found == nullptr || joinCode.front() == '\0')
+  {
+    return std::nullopt;
+  }
+
+  unsigned shard = found - SHARD_CODE_CHARSET;
+  if (shard >= shardCount)
+  {
+    return std::nullopt;
+  }
+  return shard;
 }
 
 /**
  * Find the session with the highest id and return id + 1
  * If there are no sessions, return 0.
  * Mod INT_MAX to prevent overflow.
+ * Sharded managers only hand out ids congruent to their shard index so
+ * ids stay unique across shards.
  */
 
 int SessionManager::getNextId() const
 {
-  int maxId = 0;
+  int maxId = checkpoint.has_value() ? checkpoint->getMaxSessionId() : 0;
 
   for (const auto &sessionPair : sessions)
   {
@@ -25,7 +64,9 @@ int SessionManager::getNextId() const
     }
   }
 
-  return (maxId + 1) % INT_MAX;
+  int nextId = maxId + 1;
+  nextId += (shardIndex + shardCount - nextId % shardCount) % shardCount;
+  return nextId % INT_MAX;
 }
 
 Session &SessionManager::newSession(const GameData &gameData)
@@ -38,7 +79,7 @@ Session &SessionManager::newSession(const GameData &gameData)
 std::expected<Session*, std::string> SessionManager::createSession(uintptr_t playerID, const GameData &gameData)
 {
   //Player cannot be in another session if creating a new one
-  if (isPlayerInAnySession(playerID))
+  if (sessionOfClient(playerID).has_value())
   {
     return std::unexpected("Player is already in another session");
   } else {
@@ -52,8 +93,21 @@ std::expected<void, std::string> SessionManager::destroySession(int sessionId)
   auto it = sessions.find(sessionId);
   if (it != sessions.end())
   {
+    forgetSessionMembers(it->second);
     sessions.erase(it);
     return {};
+  }
+
+  auto pending = pendingSessions.find(sessionId);
+  if (pending != pendingSessions.end())
+  {
+    pendingJoinCodes.erase(pending->second.joinCode);
+    pendingSessions.erase(pending);
+    if (pendingSessions.empty())
+    {
+      checkpoint.reset();
+    }
+    return {};
   } else
   {
     return std::unexpected("Session not found");
@@ -66,6 +120,12 @@ std::expected<Session*, std::string> SessionManager::getSession(int sessionId)
   if (it != sessions.end())
   {
     return &it->second; // Return a pointer to the session if it exists
+  }
+
+  Session *restored = restorePendingSession(sessionId);
+  if (restored != nullptr)
+  {
+    return restored;
   } else
   {
     return std::unexpected("Session not found");
@@ -81,23 +141,31 @@ std::expected<Session*, std::string> SessionManager::getSession(const std::strin
       return &sessionPair.second; // Return a pointer to the session if the join code matches
     }
   }
+
+  auto pending = pendingJoinCodes.find(joinCode);
+  if (pending != pendingJoinCodes.end())
+  {
+    Session *restored = restorePendingSession(pending->second);
+    if (restored != nullptr)
+    {
+      return restored;
+    }
+  }
   return std::unexpected("Session with specified join code not found"); // Throw unexpected if no matching session found
 }
 
 /**
  *
  */
-std::expected<Session*, std::string> SessionManager::findSessionByPlayer(uintptr_t playerID)
+std::expected<Session*, std::string_view> SessionManager::findSessionByPlayer(uintptr_t playerID)
 {
-  for (auto &sessionPair : sessions)
+  auto player = playerSessions.find(playerID);
+  if (player != playerSessions.end())
   {
-    const auto &players = sessionPair.second.getPlayers();
-    for (const auto &player : players)
+    auto session = sessions.find(player->second);
+    if (session != sessions.end())
     {
-      if (player.getId() == playerID)
-      {
-        return &sessionPair.second; // Return a pointer to the session if the player ID matches
-      }
+      return &session->second;
     }
   }
   return std::unexpected("Session with player ID not found"); // return unexpected if session with playerID not found
@@ -133,6 +201,28 @@ bool SessionManager::isPlayerInSession(const Session &session, uintptr_t playerI
 
 std::expected<Session*, std::string> SessionManager::addPlayerToSession(const std::string &joinCode, const Connection &connection)
 {
+  // A client in a session can only go from its audience to its game
+  auto current = sessionOfClient(connection.id);
+  if (current.has_value())
+  {
+    Session &session = sessions.at(current.value());
+    if (session.getJoinCode() != joinCode)
+    {
+      return std::unexpected("Player is already in another session");
+    }
+    if (playerSessions.contains(connection.id))
+    {
+      return std::unexpected("Player is already in this session");
+    }
+
+    // A spectator who joins the game leaves the audience
+    session.getAudience().remove(connection.id);
+    audienceSessions.erase(connection.id);
+    session.addPlayer(connection);
+    playerSessions[connection.id] = session.getId();
+    return &session;
+  }
+
   // Get session
   auto sessionResult = getSession(joinCode);
   if (sessionResult.has_value())
@@ -145,18 +235,372 @@ std::expected<Session*, std::string> SessionManager::addPlayerToSession(const st
       return std::unexpected("Player is already in this session");
     }
 
-    // Check if player is already in any other session
-    if (isPlayerInAnySession(connection.id))
+    // Check if player is in a session on another manager
+    if (!claimClient(connection.id))
     {
       return std::unexpected("Player is already in another session");
     }
 
-    // Add player to session
     session->addPlayer(connection);
+    playerSessions[connection.id] = session->getId();
     return session;
   }
   else
   {
     return std::unexpected(sessionResult.error()); // return unknown error
   }
+}
+Session *SessionManager::restorePendingSession(int sessionId)
+{
+  auto pending = pendingSessions.find(sessionId);
+  if (pending == pendingSessions.end())
+  {
+    return nullptr;
+  }
+
+  auto decoded = decodeSession(checkpoint->getRecord(pending->second));
+  pendingJoinCodes.erase(pending->second.joinCode);
+  pendingSessions.erase(pending);
+
+  // Release the mapping once every session has been decoded
+  if (pendingSessions.empty())
+  {
+    checkpoint.reset();
+  }
+
+  if (!decoded.has_value())
+  {
+    return nullptr;
+  }
+
+  Session &session = sessions[sessionId] = std::move(decoded.value());
+  if (onSessionRestored && !onSessionRestored(session))
+  {
+    sessions.erase(sessionId);
+    return nullptr;
+  }
+  indexSessionMembers(session);
+  return &session;
+}
+
+std::expected<Session*, std::string> SessionManager::addAudienceMemberToSession(const std::string &joinCode, const Connection &connection)
+{
+  auto current = sessionOfClient(connection.id);
+  if (current.has_value())
+  {
+    if (sessions.at(current.value()).getJoinCode() != joinCode)
+    {
+      return std::unexpected("Player is already in another session");
+    }
+    if (playerSessions.contains(connection.id))
+    {
+      return std::unexpected("Player is already in this session");
+    }
+    return std::unexpected("Already in the audience of this session");
+  }
+
+  auto sessionResult = getSession(joinCode);
+  if (!sessionResult.has_value())
+  {
+    return std::unexpected(sessionResult.error());
+  }
+
+  Session *session = sessionResult.value();
+
+  // Games without an audience setting accept spectators
+  try
+  {
+    if (!session->getGameData().configuration.isAudienceEnabled())
+    {
+      return std::unexpected("Session does not allow an audience");
+    }
+  }
+  catch (const std::exception &)
+  {
+  }
+
+  if (isPlayerInSession(*session, connection.id))
+  {
+    return std::unexpected("Player is already in this session");
+  }
+
+  if (session->getAudience().contains(connection.id))
+  {
+    return std::unexpected("Already in the audience of this session");
+  }
+
+  if (!claimClient(connection.id))
+  {
+    return std::unexpected("Player is already in another session");
+  }
+
+  session->getAudience().add(connection);
+  audienceSessions[connection.id] = session->getId();
+  return session;
+}
+
+std::expected<void, std::string> SessionManager::writeCheckpoint(const std::string &path) const
+{
+  CheckpointBuilder builder;
+
+  for (const auto &sessionPair : sessions)
+  {
+    builder.addSession(sessionPair.second);
+  }
+
+  // Sessions that were never touched since the last restore are copied without decoding
+  for (const auto &pendingPair : pendingSessions)
+  {
+    const CheckpointEntry &entry = pendingPair.second;
+    builder.addEncodedSession(entry.sessionId, entry.joinCode, checkpoint->getRecord(entry));
+  }
+
+  return builder.writeTo(path);
+}
+
+std::expected<size_t, std::string> SessionManager::restoreFromCheckpoint(const std::string &path)
+{
+  auto reader = CheckpointReader::open(path);
+  if (!reader.has_value())
+  {
+    return std::unexpected(reader.error());
+  }
+
+  checkpoint = std::move(reader.value());
+
+  size_t restored = 0;
+  for (const auto &entry : checkpoint->getEntries())
+  {
+    // Live sessions take precedence over checkpointed ones
+    if (sessions.contains(entry.sessionId))
+    {
+      continue;
+    }
+    pendingSessions[entry.sessionId] = entry;
+    pendingJoinCodes[entry.joinCode] = entry.sessionId;
+    restored++;
+  }
+
+  if (pendingSessions.empty())
+  {
+    checkpoint.reset();
+  }
+  return restored;
+}
+
+void SessionManager::addToSnapshot(SnapshotBuilder &snapshot) const
+{
+  for (const auto &sessionPair : sessions)
+  {
+    snapshot.addSession(sessionPair.second);
+  }
+
+  // Nobody is in a session that was never decoded
+  for (const auto &pendingPair : pendingSessions)
+  {
+    const CheckpointEntry &entry = pendingPair.second;
+    snapshot.addEncodedSession(entry.sessionId, entry.joinCode, checkpoint->getRecord(entry));
+  }
+}
+
+std::expected<size_t, std::string> SessionManager::restoreSnapshot(const SnapshotReader &snapshot)
+{
+  const CheckpointReader &snapshotSessions = snapshot.getSessions();
+
+  size_t restored = 0;
+  for (const auto &entry : snapshotSessions.getEntries())
+  {
+    if (shardCount > 1 && shardOfJoinCode(entry.joinCode, shardCount) != shardIndex)
+    {
+      continue;
+    }
+    if (sessions.contains(entry.sessionId))
+    {
+      continue;
+    }
+
+    auto decoded = decodeSession(snapshotSessions.getRecord(entry));
+    if (!decoded.has_value())
+    {
+      return std::unexpected(decoded.error());
+    }
+
+    Session &session = sessions[entry.sessionId] = std::move(decoded.value());
+    const SessionMembers &members = snapshot.getMembers(entry.sessionId);
+    for (uintptr_t player : members.players)
+    {
+      session.addPlayer(Connection{player});
+    }
+    for (uintptr_t member : members.audience)
+    {
+      session.getAudience().add(Connection{member});
+    }
+    if (onSessionRestored && !onSessionRestored(session))
+    {
+      sessions.erase(entry.sessionId);
+      continue;
+    }
+    indexSessionMembers(session);
+    restored++;
+  }
+  return restored;
+}
+
+void SessionManager::setRestoreCallback(std::function<bool(Session &)> callback)
+{
+  onSessionRestored = std::move(callback);
+}
+
+void SessionManager::setMembershipCallbacks(std::function<bool(uintptr_t)> onJoining, std::function<void(uintptr_t)> onLeft)
+{
+  onClientJoining = std::move(onJoining);
+  onClientLeft = std::move(onLeft);
+}
+
+std::optional<int> SessionManager::sessionOfClient(uintptr_t clientID) const
+{
+  auto player = playerSessions.find(clientID);
+  if (player != playerSessions.end())
+  {
+    return player->second;
+  }
+
+  auto spectator = audienceSessions.find(clientID);
+  if (spectator != audienceSessions.end())
+  {
+    return spectator->second;
+  }
+  return std::nullopt;
+}
+
+bool SessionManager::claimClient(uintptr_t clientID)
+{
+  return !onClientJoining || onClientJoining(clientID);
+}
+
+void SessionManager::releaseClient(uintptr_t clientID)
+{
+  if (onClientLeft)
+  {
+    onClientLeft(clientID);
+  }
+}
+
+std::expected<void, std::string> SessionManager::addPlayer(Session &session, const Connection &connection)
+{
+  if (sessionOfClient(connection.id).has_value() || !claimClient(connection.id))
+  {
+    return std::unexpected("Player is already in another session");
+  }
+
+  session.addPlayer(connection);
+  playerSessions[connection.id] = session.getId();
+  return {};
+}
+
+std::optional<int> SessionManager::removeClient(uintptr_t clientID)
+{
+  resumeSessionFor(clientID);
+
+  auto spectator = audienceSessions.find(clientID);
+  if (spectator != audienceSessions.end())
+  {
+    auto session = sessions.find(spectator->second);
+    if (session != sessions.end())
+    {
+      session->second.getAudience().remove(clientID);
+    }
+    audienceSessions.erase(spectator);
+    releaseClient(clientID);
+  }
+
+  auto player = playerSessions.find(clientID);
+  if (player == playerSessions.end())
+  {
+    return std::nullopt;
+  }
+
+  int sessionId = player->second;
+  playerSessions.erase(player);
+  releaseClient(clientID);
+
+  auto session = sessions.find(sessionId);
+  if (session != sessions.end())
+  {
+    session->second.removePlayer(clientID);
+  }
+  return sessionId;
+}
+
+bool SessionManager::pauseSessionFor(uintptr_t clientID)
+{
+  if (pausingClients.contains(clientID))
+  {
+    return true;
+  }
+
+  auto session = findSessionByPlayer(clientID);
+  if (!session.has_value())
+  {
+    return false;
+  }
+
+  session.value()->holdPause();
+  pausingClients[clientID] = session.value()->getId();
+  return true;
+}
+
+void SessionManager::resumeSessionFor(uintptr_t clientID)
+{
+  auto pausing = pausingClients.find(clientID);
+  if (pausing == pausingClients.end())
+  {
+    return;
+  }
+
+  auto session = sessions.find(pausing->second);
+  if (session != sessions.end())
+  {
+    session->second.releasePause();
+  }
+  pausingClients.erase(pausing);
+}
+
+/**
+ * Restored members were admitted before, claiming them only records where they are.
+ */
+void SessionManager::indexSessionMembers(const Session &session)
+{
+  for (const auto &player : session.getPlayers())
+  {
+    playerSessions[player.getId()] = session.getId();
+    claimClient(player.getId());
+  }
+
+  for (const auto &member : session.getAudience().getMembers())
+  {
+    audienceSessions[member.id] = session.getId();
+    claimClient(member.id);
+  }
+}
+
+void SessionManager::forgetSessionMembers(const Session &session)
+{
+  for (const auto &player : session.getPlayers())
+  {
+    if (playerSessions.erase(player.getId()) > 0)
+    {
+      releaseClient(player.getId());
+    }
+  }
+
+  for (const auto &member : session.getAudience().getMembers())
+  {
+    auto spectator = audienceSessions.find(member.id);
+    if (spectator != audienceSessions.end() && spectator->second == session.getId())
+    {
+      audienceSessions.erase(spectator);
+      releaseClient(member.id);
+    }
+  }
 }
\ No newline at end of file
@@ -1,19 +1,432 @@
 #include "GameServer.h"
+#include "RequestLatency.h"
+#include "ShardRouter.h"
+#include "ShardTransport.h"
+
+#include <charconv>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+
+void handleStopSignal(int)
+{
+  GameServer::requestStop();
+  ShardRouter::requestStop();
+}
+
+void handleLatencyDumpSignal(int)
+{
+  RequestLatency::requestDump();
+}
+
+void handleRestartSignal(int)
+{
+  ShardRouter::requestRestart();
+}
+
+/**
+ * Router mode: start the backends with the same options and route the
+ * websocket clients to them
+ */
+int runShardRouter(unsigned short port, char *htmlResponseFile, const ServerOptions &options,
+                   std::vector<std::string> backendCommand)
+{
+  std::string socketDirectory = (std::filesystem::temp_directory_path() /
+                                 ("social-gaming-" + std::to_string(getpid())))
+                                    .string();
+  std::error_code error;
+  std::filesystem::create_directories(socketDirectory, error);
+  if (error)
+  {
+    std::cerr << "Unable to create " << socketDirectory << ": " << error.message() << "\n";
+    return 1;
+  }
+
+  BackendSupervisor supervisor(std::move(backendCommand), options.backendProcesses, socketDirectory);
+  supervisor.start();
+
+  ServerOptions backendOptions = options;
+  backendOptions.shardCount = options.backendProcesses;
+  ShardRouter router(std::make_unique<WebSocketTransport>(port, GameServer::getHTTPMessage(htmlResponseFile)),
+                     supervisor.getSocketPaths(), WorkerPool::workerCountFor(backendOptions), options, &supervisor);
+  router.run();
+
+  std::filesystem::remove_all(socketDirectory, error);
+  return 0;
+}
+
+int printUsage(const char *program)
+{
+  std::cerr << "Usage:\n  " << program << " <port> <html response> [options]\n"
+            << "  e.g. " << program << " 4002 ./webchat.html\n"
+            << "Options:\n"
+            << "  --checkpoint <file>             checkpoint sessions to file and restore them on startup\n"
+            << "  --checkpoint-interval <seconds> time between periodic checkpoints (default 30)\n"
+            << "  --game-directory <directory>     where the game files are (default ../../games)\n"
+            << "  --watch-games <inotify|poll|off> how changed game files are picked up (default inotify)\n"
+            << "  --validate-games <on|off|N>      validate games at startup, N sets the thread count (default on)\n"
+            << "  --max-idle-wait <microseconds>   longest sleep of an idle server loop (default 2000)\n"
+            << "  --workers <count>                spread sessions over worker threads (default 0, single threaded)\n"
+            << "  --prepare-threads <count>        threads loading games for new sessions in the background (default 2, 0 for none)\n"
+            << "  --outbound-limit <messages>      messages queued for one client before backpressure applies (default 1024)\n"
+            << "  --outbound-bytes <bytes>         bytes queued for one client before backpressure applies (default 4 MiB)\n"
+            << "  --backpressure <drop-oldest|disconnect|pause> what happens to a client that falls behind (default drop-oldest)\n"
+            << "  --rate-limit <per second>:<burst> requests one client may make (default 50:100, 0 for none)\n"
+            << "  --action-rate-limit <action>:<per second>:<burst> limit one action per client, repeatable (default 3:1:5, new games)\n"
+            << "  --lane-weights <input>:<control>:<diagnostic> turns of each priority lane (default 8:4:1)\n"
+            << "  --requests-per-update <count>    most requests handled per loop iteration (default 256)\n"
+            << "  --max-pending <count>            requests waiting to be handled before new ones are turned away (default 4096)\n"
+            << "  --compact-protocol <on|off>      also accept requests in the compact wire format, answering in kind (default off)\n"
+            << "  --backends <count>               run sessions in this many backend processes behind a router (default 0, one process),\n"
+            << "                                   SIGHUP replaces the backends, e.g. after a new build, keeping clients and sessions\n"
+            << "  --metrics-port <port>            serve Prometheus metrics at /metrics and latency percentiles at /latency\n"
+            << "                                   on this port (default off), SIGUSR1 prints the percentiles to stderr,\n"
+            << "                                   backend N of --backends serves them on port + 1 + N\n"
+            << "  --log-level <debug|info|warning|error|off> least severe records logged (default info)\n"
+            << "  --log-file <file>                append log records to file instead of stderr\n";
+  return 1;
+}
+
+/**
+ * Parse a whole argument as a number, refusing signs the type cannot hold and trailing text
+ */
+template <typename T>
+bool parseNumber(const char *text, T &value)
+{
+  const char *end = text + std::strlen(text);
+  auto [parsed, error] = std::from_chars(text, end, value);
+  return error == std::errc() && parsed == end;
+}
+
+/**
+ * Parse on or off
+ */
+bool parseSwitch(const char *text, bool &value)
+{
+  if (std::strcmp(text, "on") != 0 && std::strcmp(text, "off") != 0)
+  {
+    return false;
+  }
+  value = std::strcmp(text, "on") == 0;
+  return true;
+}
+
+int invalidValue(const char *program, const char *option, const std::string &error)
+{
+  std::cerr << "Invalid value for " << option << ": " << error << "\n";
+  return printUsage(program);
+}
 
 int main(int args, char *argv[])
 {
   if (args < 3)
   {
-    std::cerr << "Usage:\n  " << argv[0] << " <port> <html response>\n"
-              << "  e.g. " << argv[0] << " 4002 ./webchat.html\n";
+    return printUsage(argv[0]);
+  }
+
+  unsigned short port;
+  if (!parseNumber(argv[1], port))
+  {
+    std::cerr << "Invalid port: " << argv[1] << "\n";
+    return printUsage(argv[0]);
+  }
+
+  ServerOptions options;
+  options.watchGames = true;
+  options.preparationThreads = 2;
+  options.validateGames = true;
+
+  // Backends are started with the same options, less the one starting them
+  std::vector<std::string> backendCommand = {std::filesystem::canonical("/proc/self/exe").string(), argv[1], argv[2]};
+
+  for (int i = 3; i < args; i += 2)
+  {
+    const char *option = argv[i];
+    if (i + 1 == args)
+    {
+      std::cerr << "Missing value for " << option << "\n";
+      return printUsage(argv[0]);
+    }
+    const char *value = argv[i + 1];
+
+    if (std::strcmp(option, "--backends") != 0)
+    {
+      backendCommand.insert(backendCommand.end(), {option, value});
+    }
+
+    if (std::strcmp(option, "--checkpoint") == 0)
+    {
+      options.checkpointPath = value;
+    }
+    else if (std::strcmp(option, "--checkpoint-interval") == 0)
+    {
+      unsigned seconds;
+      if (!parseNumber(value, seconds))
+      {
+        return invalidValue(argv[0], option, value);
+      }
+      options.checkpointInterval = std::chrono::seconds(seconds);
+    }
+    else if (std::strcmp(option, "--game-directory") == 0)
+    {
+      options.gameDirectory = value;
+    }
+    else if (std::strcmp(option, "--watch-games") == 0)
+    {
+      if (std::strcmp(value, "inotify") != 0 && std::strcmp(value, "poll") != 0 && std::strcmp(value, "off") != 0)
+      {
+        return invalidValue(argv[0], option, value);
+      }
+      options.watchGames = std::strcmp(value, "off") != 0;
+      options.pollGames = std::strcmp(value, "poll") == 0;
+    }
+    else if (std::strcmp(option, "--validate-games") == 0)
+    {
+      options.validateGames = std::strcmp(value, "off") != 0;
+      if (options.validateGames && std::strcmp(value, "on") != 0)
+      {
+        if (!parseNumber(value, options.validationThreads))
+        {
+          return invalidValue(argv[0], option, value);
+        }
+      }
+    }
+    else if (std::strcmp(option, "--max-idle-wait") == 0)
+    {
+      unsigned microseconds;
+      if (!parseNumber(value, microseconds))
+      {
+        return invalidValue(argv[0], option, value);
+      }
+      options.maxIdleWait = std::chrono::microseconds(microseconds);
+    }
+    else if (std::strcmp(option, "--workers") == 0)
+    {
+      if (!parseNumber(value, options.workerThreads))
+      {
+        return invalidValue(argv[0], option, value);
+      }
+    }
+    else if (std::strcmp(option, "--prepare-threads") == 0)
+    {
+      if (!parseNumber(value, options.preparationThreads))
+      {
+        return invalidValue(argv[0], option, value);
+      }
+    }
+    else if (std::strcmp(option, "--outbound-limit") == 0)
+    {
+      if (!parseNumber(value, options.outboundLimit.messages))
+      {
+        return invalidValue(argv[0], option, value);
+      }
+    }
+    else if (std::strcmp(option, "--outbound-bytes") == 0)
+    {
+      if (!parseNumber(value, options.outboundLimit.bytes))
+      {
+        return invalidValue(argv[0], option, value);
+      }
+    }
+    else if (std::strcmp(option, "--backpressure") == 0)
+    {
+      auto policy = parseBackpressurePolicy(value);
+      if (!policy.has_value())
+      {
+        return invalidValue(argv[0], option, policy.error());
+      }
+      options.backpressurePolicy = policy.value();
+    }
+    else if (std::strcmp(option, "--rate-limit") == 0)
+    {
+      auto limit = parseRateLimit(value);
+      if (!limit.has_value())
+      {
+        return invalidValue(argv[0], option, limit.error());
+      }
+      options.rateLimits.perConnection = limit.value();
+    }
+    else if (std::strcmp(option, "--action-rate-limit") == 0)
+    {
+      auto limit = parseActionRateLimit(value);
+      if (!limit.has_value())
+      {
+        return invalidValue(argv[0], option, limit.error());
+      }
+      auto &perAction = options.rateLimits.perAction;
+      std::erase_if(perAction, [&](const auto &existing)
+                    { return existing.first == limit.value().first; });
+      perAction.push_back(limit.value());
+    }
+    else if (std::strcmp(option, "--lane-weights") == 0)
+    {
+      auto weights = parseLaneWeights(value);
+      if (!weights.has_value())
+      {
+        return invalidValue(argv[0], option, weights.error());
+      }
+      options.laneWeights = weights.value();
+    }
+    else if (std::strcmp(option, "--requests-per-update") == 0)
+    {
+      if (!parseNumber(value, options.requestsPerUpdate))
+      {
+        return invalidValue(argv[0], option, value);
+      }
+      options.requestsPerUpdate = std::max<size_t>(1, options.requestsPerUpdate);
+    }
+    else if (std::strcmp(option, "--compact-protocol") == 0)
+    {
+      if (!parseSwitch(value, options.compactProtocol))
+      {
+        return invalidValue(argv[0], option, value);
+      }
+    }
+    else if (std::strcmp(option, "--max-pending") == 0)
+    {
+      if (!parseNumber(value, options.maxPendingRequests))
+      {
+        return invalidValue(argv[0], option, value);
+      }
+    }
+    else if (std::strcmp(option, "--backends") == 0)
+    {
+      if (!parseNumber(value, options.backendProcesses))
+      {
+        return invalidValue(argv[0], option, value);
+      }
+      if (options.backendProcesses > SessionManager::MAX_SHARDS)
+      {
+        return invalidValue(argv[0], option, "at most " + std::to_string(SessionManager::MAX_SHARDS) + " backends");
+      }
+    }
+    else if (std::strcmp(option, "--shard-socket") == 0)
+    {
+      options.shardSocket = value;
+    }
+    else if (std::strcmp(option, "--take-over") == 0)
+    {
+      // Passed by the router to a backend replacing another
+      if (!parseSwitch(value, options.takeOver))
+      {
+        return invalidValue(argv[0], option, value);
+      }
+    }
+    else if (std::strcmp(option, "--shard") == 0)
+    {
+      // <index>/<count>, passed to backends by the router
+      std::string shard = value;
+      size_t slash = shard.find('/');
+      if (slash == std::string::npos ||
+          !parseNumber(shard.substr(0, slash).c_str(), options.shardIndex) ||
+          !parseNumber(shard.substr(slash + 1).c_str(), options.shardCount) ||
+          options.shardIndex >= options.shardCount)
+      {
+        return invalidValue(argv[0], option, "expected <index>/<count>, got " + shard);
+      }
+    }
+    else if (std::strcmp(option, "--metrics-port") == 0)
+    {
+      if (!parseNumber(value, options.metricsPort))
+      {
+        return invalidValue(argv[0], option, value);
+      }
+    }
+    else if (std::strcmp(option, "--log-level") == 0)
+    {
+      auto level = parseLogLevel(value);
+      if (!level.has_value())
+      {
+        return invalidValue(argv[0], option, level.error());
+      }
+      options.logLevel = level.value();
+    }
+    else if (std::strcmp(option, "--log-file") == 0)
+    {
+      options.logFile = value;
+    }
+    else
+    {
+      std::cerr << "Unknown option: " << option << "\n";
+      return printUsage(argv[0]);
+    }
+  }
+
+  if (options.takeOver && options.shardSocket.empty())
+  {
+    std::cerr << "Only backends take over, see --backends\n";
     return 1;
   }
 
-  unsigned short port = std::stoi(argv[1]);
+  Logger::instance().setLevel(options.logLevel);
+  if (!options.logFile.empty())
+  {
+    auto opened = Logger::instance().setOutputFile(options.logFile);
+    if (!opened.has_value())
+    {
+      std::cerr << opened.error() << "\n";
+      return 1;
+    }
+  }
+
+  // Stop cleanly so sessions are checkpointed on shutdown
+  std::signal(SIGINT, handleStopSignal);
+  std::signal(SIGTERM, handleStopSignal);
+
+  // Print request latency percentiles and keep running
+  std::signal(SIGUSR1, handleLatencyDumpSignal);
+
+  // Router mode: replace the backends without dropping their clients
+  std::signal(SIGHUP, handleRestartSignal);
+
+  // Backends keep their own checkpoint and metrics port
+  if (!options.shardSocket.empty())
+  {
+    if (!options.checkpointPath.empty())
+    {
+      options.checkpointPath += ".shard" + std::to_string(options.shardIndex);
+    }
+    if (options.metricsPort != 0)
+    {
+      options.metricsPort += 1 + options.shardIndex;
+    }
+  }
 
   try
   {
-    GameServer gameServer{port, argv[2]};
+    if (options.backendProcesses > 0)
+    {
+      return runShardRouter(port, argv[2], options, std::move(backendCommand));
+    }
+
+    if (!options.shardSocket.empty() && options.takeOver)
+    {
+      // Ready before taking over, so the backend being replaced serves until the handoff
+      GameServer gameServer{ShardTransport::awaitHandoff(options.shardSocket), options};
+      auto takenOver = gameServer.takeOver();
+      if (!takenOver.has_value())
+      {
+        std::cerr << "Unable to take over: " << takenOver.error() << "\n";
+        return 1;
+      }
+      gameServer.start();
+      return 0;
+    }
+
+    if (!options.shardSocket.empty())
+    {
+      auto transport = ShardTransport::listen(options.shardSocket);
+      if (!transport.has_value())
+      {
+        std::cerr << transport.error() << "\n";
+        return 1;
+      }
+      GameServer gameServer{std::move(transport.value()), options};
+      gameServer.start();
+      return 0;
+    }
+
+    GameServer gameServer{port, argv[2], options};
     gameServer.start();
   }
 catch (const std::exception& e)
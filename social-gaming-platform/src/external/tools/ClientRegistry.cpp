@@ -0,0 +1,63 @@
+/**
+ * ClientRegistry.cpp
+ */
+#include "ClientRegistry.h"
+
+bool ClientRegistry::add(const Connection &connection, Clock::time_point now)
+{
+    auto [index, inserted] = indices.try_emplace(connection.id, connections.size());
+    if (!inserted)
+    {
+        return false;
+    }
+
+    connections.push_back(connection);
+    infos.push_back(ClientInfo{now, now, std::nullopt, {}, false, {}});
+    return true;
+}
+
+std::optional<ClientInfo> ClientRegistry::remove(uintptr_t connectionId)
+{
+    auto found = indices.find(connectionId);
+    if (found == indices.end())
+    {
+        return std::nullopt;
+    }
+
+    size_t index = found->second;
+    indices.erase(found);
+    ClientInfo removed = std::move(infos[index]);
+
+    // Move the last client into the hole
+    size_t last = connections.size() - 1;
+    if (index != last)
+    {
+        connections[index] = connections[last];
+        infos[index] = std::move(infos[last]);
+        indices[connections[index].id] = index;
+    }
+    connections.pop_back();
+    infos.pop_back();
+
+    return removed;
+}
+
+ClientInfo *ClientRegistry::find(uintptr_t connectionId)
+{
+    auto found = indices.find(connectionId);
+    return found == indices.end() ? nullptr : &infos[found->second];
+}
+
+const ClientInfo *ClientRegistry::find(uintptr_t connectionId) const
+{
+    auto found = indices.find(connectionId);
+    return found == indices.end() ? nullptr : &infos[found->second];
+}
+
+void ClientRegistry::touch(uintptr_t connectionId, Clock::time_point now)
+{
+    if (ClientInfo *info = find(connectionId))
+    {
+        info->lastActivity = now;
+    }
+}
@@ -3,31 +3,138 @@
  */
 #include "GameServer.h"
 
-GameServer::GameServer(unsigned short port, char *&htmlResponseFile)
-    : server(port, getHTTPMessage(htmlResponseFile), [this](Connection c)
-             { this->onConnect(c); }, // Lambda to call onConnect
-             [this](Connection c)
-             { this->onDisconnect(c); }) // Lambda to call onDisconnect
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+std::atomic<bool> GameServer::stopRequested = false;
+
+namespace
 {
+    // Error sent instead of handling a request that was turned away
+    Response rejectionResponse(uintptr_t clientID, const std::string &message,
+                               const std::optional<std::string> &requestId = std::nullopt)
+    {
+        return MessageResponse(CommonResponse("N/A", message, MessageType::MESSAGE, {clientID}, false, requestId));
+    }
+
+    const std::string OVERLOADED_MESSAGE = "[OVERLOADED] Server is busy, try again later";
+    const std::string RATE_LIMITED_MESSAGE = "[RATE LIMITED] Too many requests, slow down";
+
+    // Games still loading for a request when handing off get this long, then their requests are dropped
+    const std::chrono::milliseconds HANDOFF_DRAIN_LIMIT = std::chrono::milliseconds(2000);
+
+    // Longest a handoff may take to cross the socket, including the serving process finishing its requests
+    const std::chrono::milliseconds HANDOFF_TIMEOUT = std::chrono::milliseconds(10000);
+}
+
+GameServer::GameServer(unsigned short port, char *&htmlResponseFile, const ServerOptions &options)
+    : GameServer(std::make_unique<WebSocketTransport>(port, getHTTPMessage(htmlResponseFile)), options)
+{
+}
+
+GameServer::GameServer(std::unique_ptr<Transport> transport, const ServerOptions &options)
+    : options(options),
+      transport(std::move(transport))
+{
+    this->transport->setHandlers([this](Connection c)
+                                 { this->onConnect(c); }, // Lambda to call onConnect
+                                 [this](Connection c)
+                                 { this->onDisconnect(c); }); // Lambda to call onDisconnect
+
+    validateGameLibrary();
+    if (options.workerThreads > 0)
+    {
+        // Workers restore their own shard of the checkpoint, a successor gets the sessions handed over instead
+        workerPool = std::make_unique<WorkerPool>(options.workerThreads, gameManager, gameCache, this->options);
+        if (!options.checkpointPath.empty() && !options.takeOver)
+        {
+            workerPool->restoreCheckpoint(options.checkpointPath);
+        }
+        workerPool->start();
+    }
+    else
+    {
+        // Sessions are all here, the router in front only hears where its clients are
+        sessionManager.setMembershipCallbacks([this](uintptr_t clientID)
+                                              {
+                                                  this->transport->reportSeat(Connection{clientID}, true);
+                                                  return true;
+                                              },
+                                              [this](uintptr_t clientID)
+                                              { this->transport->reportSeat(Connection{clientID}, false); });
+        if (!options.takeOver)
+        {
+            restoreCheckpoint();
+        }
+        if (options.preparationThreads > 0)
+        {
+            preparationPool = std::make_unique<PreparationPool>(options.preparationThreads);
+            pipeline = std::make_unique<RequestPipeline>(*preparationPool, gameCache);
+        }
+    }
+    watchGameDirectory();
+
+    // A successor listens once it took over, the serving process is still on the socket
+    if (!options.takeOver)
+    {
+        listenForSuccessor();
+    }
+
+    if (options.metricsPort != 0)
+    {
+        metricsServer = std::make_unique<MetricsServer>(MetricsRegistry::instance());
+        auto started = metricsServer->start(options.metricsPort);
+        if (started.has_value())
+        {
+            LOG_INFO("server", "serving metrics", {{"port", metricsServer->getPort()}, {"path", "/metrics"}});
+        }
+        else
+        {
+            LOG_ERROR("server", "unable to serve metrics", {{"error", started.error()}});
+            metricsServer.reset();
+        }
+    }
 }
 
 void GameServer::onConnect(Connection c)
 {
     // Alert New connection
-    std::cout << "<" << c.id << "> New Client Connected\n";
+    LOG_INFO("server", "client connected", {{"client", c.id}});
 
-    // Store c (= Client) into clients list
-    clients.push_back(c);
+    // Store c (= Client) into the client registry
+    clients.add(c);
 }
 
 void GameServer::onDisconnect(Connection c)
 {
     // Alert disconnection
-    std::cout << "<" << c.id << "> Client Disconnected\n";
+    LOG_INFO("server", "client disconnected", {{"client", c.id}});
 
-    // Erase the disconnected c (= Client)
-    auto eraseBegin = std::remove(std::begin(clients), std::end(clients), c);
-    clients.erase(eraseBegin, std::end(clients));
+    forgetClient(c);
+}
+
+void GameServer::forgetClient(Connection c)
+{
+    // Erase the disconnected c (= Client) and take them out of their sessions.
+    // Clients the server disconnected itself are already gone.
+    if (!clients.remove(c.id).has_value())
+    {
+        return;
+    }
+
+    if (workerPool)
+    {
+        workerPool->forgetClient(c.id);
+    }
+    else
+    {
+        sessionManager.removeClient(c.id);
+        if (pipeline)
+        {
+            pipeline->forgetClient(c.id);
+        }
+    }
 }
 
 MessageResult
@@ -47,7 +154,7 @@ MessageResult
 GameServer::handleMessage(const Message &msg, std::ostringstream &result)
 {
     // To server
-    std::cout << "<" << msg.connection.id << "> sends Invalid Message \"" << msg.text << "\"\n";
+    LOG_WARNING("server", "invalid message", {{"client", msg.connection.id}, {"text", msg.text}});
 
     // To client
     result << "<" << msg.connection.id << "> " << "Invalid Message!" << std::endl;
@@ -57,55 +164,84 @@ GameServer::handleMessage(const Message &msg, std::ostringstream &result)
 
 MessageResult
 GameServer::processValidMessage(const Message &msg, std::ostringstream &result)
+{
+    auto admitted = admitMessage(msg, result);
+    if (auto *request = std::get_if<Request>(&admitted))
+    {
+        return handleRequest(*request);
+    }
+    return std::get<MessageResult>(std::move(admitted));
+}
+
+std::variant<MessageResult, Request>
+GameServer::admitMessage(const Message &msg, std::ostringstream &result)
 {
     // Create Request object from incoming message
     Request request(msg.text, msg.connection);
 
     // If the request is invalid (not a JSON message), return error response
-    if (!request.isValid)
+    if (!acceptWireFormat(msg) || !request.isValid)
     {
         result << "<" << msg.connection.id << "> Invalid Message!" << std::endl;
-        return MessageResult{result.str(), false, {}};
+        return MessageResult{result.str(), false, {}, false, msg.connection.id};
     }
 
-    // Add the request to the incoming queue
-    incomingQueue.push(request);
-
-    // Process the request
-    while (!incomingQueue.empty())
+    if (!admitRequest(request))
     {
-        Request request = incomingQueue.front();
-        incomingQueue.pop();
-
-        // Generate response for the request
-        Response response = requestHandler.handleRequest(request);
+        Response rejection = rejectionResponse(msg.connection.id, RATE_LIMITED_MESSAGE, request.requestId);
+        return MessageResult{serializeResponse(rejection), false, {msg.connection.id}, false, msg.connection.id};
+    }
 
-        // Add response to outgoing queue
-        outgoingQueue.push(response);
+    // Answered once its game is loaded, the client's later requests go on meanwhile
+    if (pipeline && pipeline->defer(request))
+    {
+        return MessageResult{"", false, {}, false, msg.connection.id};
     }
 
-    // Process and send outgoing messages
-    return processOutgoingMessages();
+    return request;
 }
 
-MessageResult
-GameServer::processOutgoingMessages()
+MessageResult GameServer::handleRequest(Request &request)
 {
-    // Handle responses from the outgoing queue
-    while (!outgoingQueue.empty())
+    if (!request.batch.empty())
     {
-        Response response = outgoingQueue.front();
-        outgoingQueue.pop();
+        return batchResultOf(request, [this](Request &item)
+                             { return handleRequest(item); });
+    }
 
-        // Get list of client IDs to send the response to
-        std::vector<uintptr_t> responseClientIDs = extractClientIdsFromResponse(response);
+    // Generate response for the request
+    Response response = requestHandler.handleRequest(request);
 
-        // Return the serialized response to be sent
-        return MessageResult{serializeResponse(response), false, responseClientIDs};
+    // Remember the session of clients who just created or joined one
+    if (request.action == MessageType::NEW_GAME || request.action == MessageType::JOIN)
+    {
+        if (ClientInfo *client = clients.find(request.client.id))
+        {
+            auto session = sessionManager.findSessionByPlayer(request.client.id);
+            client->sessionId = session.has_value() ? std::optional<int>(session.value()->getId()) : std::nullopt;
+        }
     }
 
-    // Return empty if no outgoing responses to send
-    return MessageResult{"", false, {}};
+    // Every request produces exactly one response
+    MessageResult result = messageResultOf(request.client.id, std::move(response), options.compactProtocol);
+    result.trace = traceOf(request);
+    return result;
+}
+
+void GameServer::handlePreparedRequests(std::deque<Broadcast> &outgoing)
+{
+    for (auto &request : pipeline->takePrepared())
+    {
+        pacer.markActive();
+        try
+        {
+            appendOutgoing(handleRequest(request), outgoing);
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR("server", "exception processing message", {{"client", request.client.id}, {"error", e.what()}});
+        }
+    }
 }
 
 std::vector<uintptr_t>
@@ -124,97 +260,102 @@ GameServer::extractClientIdsFromResponse(const Response &response)
     return clientIDs;
 }
 
-MessageResult
-GameServer::processMessages(const std::deque<Message> &incoming)
+std::vector<MessageResult>
+GameServer::processMessages(const std::deque<Message> &incoming, size_t handleLimit)
 {
-    std::ostringstream result;
+    std::vector<MessageResult> results;
+    results.reserve(incoming.size());
+    const uint64_t batch = ++batchCount;
 
     for (const auto &msg : incoming)
     {
         MessageResult shutDownResult = handleShutDown(msg);
         if (shutDownResult.shouldShutdown)
         {
-            return shutDownResult;
+            shutDownResult.senderID = msg.connection.id;
+            results.push_back(std::move(shutDownResult));
+            break;
+        }
+
+        // Everything queued earlier is handled first, shed what would wait too long
+        if (incomingLanes.size() >= options.maxPendingRequests)
+        {
+            admissionStats.shed++;
+            results.push_back(MessageResult{serializeResponse(rejectionResponse(msg.connection.id, OVERLOADED_MESSAGE)),
+                                            false, {msg.connection.id}, false, msg.connection.id});
+            continue;
         }
 
         try
         {
-            return processValidMessage(msg, result);
+            std::ostringstream result;
+            auto admitted = admitMessage(msg, result);
+            if (auto *request = std::get_if<Request>(&admitted))
+            {
+                // Handled in lane order below, its result keeps its place in the batch
+                results.push_back(MessageResult{"", false, {}, false, msg.connection.id});
+                auto received = request->receivedAt;
+                RequestLane lane = laneOf(*request);
+                incomingLanes.push(lane, msg.connection.id, QueuedRequest{std::move(*request), batch, results.size() - 1},
+                                   received);
+            }
+            else
+            {
+                results.push_back(std::get<MessageResult>(std::move(admitted)));
+            }
         }
         catch (const std::exception &e)
         {
-            std::cerr << "Exception: " << e.what() << std::endl;
-            return MessageResult{"Error processing message", false, {}};
+            LOG_ERROR("server", "exception processing message", {{"client", msg.connection.id}, {"error", e.what()}});
+            results.push_back(MessageResult{"Error processing message", false, {msg.connection.id}, false, msg.connection.id});
         }
     }
 
-    // Return empty response
-    return MessageResult{result.str(), false, {}};
-}
-
-std::deque<Message>
-GameServer::buildOutgoing(const std::string &log,
-                          const std::expected<Session *, std::string> &sessionResult,
-                          const std::vector<uintptr_t> &clientIDs)
-{
-    // Messages to send
-    std::deque<Message> outgoing;
-
-    try
+    // Game inputs first, what is over the limit waits for the next call
+    for (size_t handled = 0; handled < handleLimit; handled++)
     {
-        // If player is in a session
-        if (sessionResult.has_value())
+        auto queued = incomingLanes.pop();
+        if (!queued.has_value())
         {
-            Session *session = sessionResult.value();
-            const auto &players = session->getPlayers();
+            break;
+        }
 
-            // If clientIDs was provided in response, only send to them
-            if (!clientIDs.empty())
-            {
-                for (const auto &client : players)
-                {
-                    // If client in session is found in provided list, send to them
-                    if (std::find(clientIDs.begin(), clientIDs.end(), client.getId()) != clientIDs.end())
-                    {
-                        outgoing.push_back({client.getConnection(), log});
-                    }
-                }
-            }
-            else
-            {
-                // Otherwise send to all in session - Iterate over each player in the session and send them the message
-                for (const auto &client : players)
-                {
-                    outgoing.push_back({client.getConnection(), log});
-                }
-            }
+        MessageResult result;
+        try
+        {
+            result = handleRequest(queued->request);
+        }
+        catch (const std::exception &e)
+        {
+            uintptr_t clientID = queued->request.client.id;
+            LOG_ERROR("server", "exception processing message", {{"client", clientID}, {"error", e.what()}});
+            result = MessageResult{"Error processing message", false, {clientID}, false, clientID};
+        }
 
-            // Player is not in a session
+        if (queued->batch == batch)
+        {
+            results[queued->slot] = std::move(result);
         }
         else
         {
-            if (!clientIDs.empty())
-            {
-                for (const auto &clientID : clientIDs)
-                {
-                    // Assuming clientID is the connection ID for the user
-                    outgoing.push_back(Message{clientID, log});
-                }
-            }
-            else
-            {
-                // If no clientIDs are provided, log an error
-                std::cerr << "Error: Session not found and no client IDs provided to send the message." << std::endl;
-            }
+            results.push_back(std::move(result));
         }
     }
-    catch (const std::runtime_error &e)
-    {
-        std::cerr << "Error: " << e.what() << std::endl;
-        std::cout << "No players found in Session" << std::endl;
-    }
 
-    return outgoing;
+    return results;
+}
+
+void GameServer::appendOutgoing(MessageResult result, std::deque<Broadcast> &outgoing)
+{
+    routeResult(sessionManager, std::move(result), outgoing);
+}
+
+std::deque<Message>
+GameServer::buildOutgoing(const std::string &log,
+                          const std::expected<Session *, std::string_view> &sessionResult,
+                          const std::vector<uintptr_t> &clientIDs)
+{
+    return ::buildOutgoing(log, sessionResult, clientIDs);
 }
 
 /**
@@ -252,118 +393,769 @@ GameServer::getHTTPMessage(const char *htmlLocation)
                            std::istreambuf_iterator<char>()};
     }
     // Send error message if not exist
-    std::cerr << "Unable to open HTML index file:\n"
-              << htmlLocation << "\n";
+    LOG_ERROR("server", "unable to open HTML index file", {{"path", htmlLocation}});
 
     throw std::runtime_error(std::string("Unable to open HTML index file: ") + htmlLocation);
 }
 
 void GameServer::start()
 {
-    std::cout << "Game server starting..." << std::endl;
+    LOG_INFO("server", "game server starting");
     run();
 }
 
 void GameServer::stop()
 {
-    std::cout << "\n\n******************************************\n";
-    std::cout << "******** Shutting Down the Server ********\n";
-    std::cout << "******************************************\n";
+    LOG_INFO("server", "shutting down the server");
+
+    if (workerPool)
+    {
+        workerPool->stop();
+    }
+
+    checkpoint();
 }
 
-void GameServer::run()
+void GameServer::requestStop() noexcept
 {
-    while (1)
+    stopRequested = true;
+}
+
+void GameServer::checkpoint()
+{
+    if (options.checkpointPath.empty())
     {
-        try {
-            bool serverUpdateSucceeded = handleServerUpdates();
+        return;
+    }
 
-            if (!serverUpdateSucceeded)
-            {
-                break;
-            }
+    if (workerPool)
+    {
+        // Running workers checkpoint themselves; this only writes stopped ones
+        workerPool->checkpoint(options.checkpointPath);
+    }
+    else
+    {
+        auto result = sessionManager.writeCheckpoint(options.checkpointPath);
+        if (!result.has_value())
+        {
+            LOG_ERROR("session", "checkpoint failed", {{"error", result.error()}});
+        }
+    }
+    lastCheckpoint = std::chrono::steady_clock::now();
+}
+
+void GameServer::restoreCheckpoint()
+{
+    if (options.checkpointPath.empty() || access(options.checkpointPath.c_str(), R_OK) == -1)
+    {
+        return;
+    }
+
+    // Game processes are rebuilt when their session is first accessed
+    sessionManager.setRestoreCallback([this](Session &session)
+                                      { return requestHandler.restoreProcess(session); });
+
+    auto result = sessionManager.restoreFromCheckpoint(options.checkpointPath);
+    if (result.has_value())
+    {
+        LOG_INFO("session", "restored checkpoint", {{"sessions", result.value()}, {"path", options.checkpointPath}});
+    }
+    else
+    {
+        LOG_ERROR("session", "unable to restore checkpoint", {{"error", result.error()}});
+    }
+}
+
+void GameServer::listenForSuccessor()
+{
+    if (options.shardSocket.empty())
+    {
+        return;
+    }
+
+    auto listener = HandoffListener::listen(options.shardSocket);
+    if (listener.has_value())
+    {
+        handoffListener = std::move(listener.value());
+    }
+    else
+    {
+        LOG_ERROR("handoff", "unable to wait for a successor", {{"error", listener.error()}});
+    }
+}
+
+bool GameServer::handOff(int successor)
+{
+    LOG_INFO("handoff", "handing over to a new process", {{"clients", clients.size()}});
+    const auto deadline = std::chrono::steady_clock::now() + HANDOFF_DRAIN_LIMIT;
 
-            bool gameUpdateSucceeded = handleGameUpdates();
+    // The successor waits on the same socket once it took over
+    handoffListener.reset();
 
-            if (!gameUpdateSucceeded)
+    // Finish what was accepted, messages arriving meanwhile wait in the transport for the successor
+    std::deque<Broadcast> outgoing;
+    if (workerPool)
+    {
+        workerPool->finish(outgoing, deadline);
+    }
+    else
+    {
+        for (auto &result : processMessages({}))
+        {
+            appendOutgoing(std::move(result), outgoing);
+        }
+        while (pipeline && pipeline->inFlight() > 0 && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            handlePreparedRequests(outgoing);
+        }
+    }
+
+    // Every reply is queued in the transport before it is handed over
+    std::deque<Message> messages;
+    std::vector<LatencyTrace> sent;
+    enqueueOutgoing(outgoing, messages, sent);
+    while (!backloggedClients.empty())
+    {
+        flushOutbound(messages, sent);
+    }
+    if (!messages.empty())
+    {
+        transport->send(messages);
+    }
+    recordSent(sent);
+
+    Handoff handoff;
+    bool handedOver = false;
+    if (transport->handOff(handoff.transport))
+    {
+        for (const auto &connection : clients.getConnections())
+        {
+            handoff.clients.push_back(HandoffClient{connection.id, clients.find(connection.id)->wireFormat});
+        }
+
+        SnapshotBuilder snapshot;
+        if (workerPool)
+        {
+            workerPool->addToSnapshot(snapshot);
+        }
+        else
+        {
+            sessionManager.addToSnapshot(snapshot);
+        }
+        handoff.sessions = snapshot.finish();
+
+        // The sockets are still this process's until the successor holds them and the sessions
+        auto sent = sendHandoff(successor, handoff, HANDOFF_TIMEOUT);
+        if (sent.has_value())
+        {
+            sent = commitHandoff(successor, HANDOFF_TIMEOUT);
+        }
+        handedOver = sent.has_value();
+        if (!handedOver)
+        {
+            LOG_ERROR("handoff", "handoff failed", {{"error", sent.error()}});
+        }
+    }
+    else
+    {
+        LOG_ERROR("handoff", "this transport cannot be handed over");
+    }
+    close(successor);
+
+    if (handedOver)
+    {
+        for (int fd : handoff.transport.descriptors)
+        {
+            close(fd);
+        }
+        LOG_INFO("handoff", "handed over to a new process", {{"clients", handoff.clients.size()}, {"bytes", handoff.sessions.size()}});
+        return true;
+    }
+
+    // Nobody took over, go on serving
+    if (!handoff.transport.descriptors.empty())
+    {
+        transport->takeOver(handoff.transport);
+    }
+    if (workerPool)
+    {
+        workerPool->start();
+    }
+    listenForSuccessor();
+    return false;
+}
+
+std::expected<void, std::string> GameServer::takeOver()
+{
+    auto predecessor = connectForHandoff(options.shardSocket);
+    if (!predecessor.has_value())
+    {
+        return std::unexpected(predecessor.error());
+    }
+
+    // Closing the connection without confirming leaves the old process serving
+    auto giveUp = [&predecessor](std::string error, const std::vector<int> &descriptors = {})
+    {
+        for (int fd : descriptors)
+        {
+            close(fd);
+        }
+        close(predecessor.value());
+        return std::unexpected(std::move(error));
+    };
+
+    auto handoff = receiveHandoff(predecessor.value(), HANDOFF_TIMEOUT);
+    if (!handoff.has_value())
+    {
+        return giveUp(handoff.error());
+    }
+
+    auto snapshot = SnapshotReader::fromBuffer(handoff->sessions);
+    if (!snapshot.has_value())
+    {
+        return giveUp("Unable to read the sessions handed over: " + snapshot.error(), handoff->transport.descriptors);
+    }
+    if (!transport->takeOver(handoff->transport))
+    {
+        return giveUp("Unable to take over the transport", handoff->transport.descriptors);
+    }
+
+    for (const auto &handed : handoff->clients)
+    {
+        clients.add(Connection{handed.id});
+        clients.find(handed.id)->wireFormat = handed.wireFormat;
+    }
+
+    if (workerPool)
+    {
+        workerPool->stop();
+        workerPool->restoreSnapshot(snapshot.value());
+        workerPool->start();
+    }
+    else
+    {
+        sessionManager.setRestoreCallback([this](Session &session)
+                                          { return requestHandler.restoreProcess(session); });
+        auto restored = sessionManager.restoreSnapshot(snapshot.value());
+        if (!restored.has_value())
+        {
+            TransportHandoff released;
+            transport->handOff(released);
+            return giveUp("Unable to restore the sessions handed over: " + restored.error(), released.descriptors);
+        }
+
+        for (const auto &handed : handoff->clients)
+        {
+            auto session = sessionManager.findSessionByPlayer(handed.id);
+            if (session.has_value())
             {
-                break;
+                clients.find(handed.id)->sessionId = session.value()->getId();
             }
+        }
+    }
+
+    // Nothing has touched the sockets yet, they are only this process's once the old one lets go
+    auto confirmed = confirmHandoff(predecessor.value(), HANDOFF_TIMEOUT);
+    if (!confirmed.has_value())
+    {
+        TransportHandoff released;
+        transport->handOff(released);
+        return giveUp(confirmed.error(), released.descriptors);
+    }
+    close(predecessor.value());
+
+    LOG_INFO("handoff", "took over", {{"clients", handoff->clients.size()}, {"sessions", snapshot->getSessions().getEntries().size()}});
+    listenForSuccessor();
+    return {};
+}
+
+void GameServer::validateGameLibrary()
+{
+    if (!options.validateGames)
+    {
+        return;
+    }
+
+    logic::GameLibraryValidator validator(gameManager, options.validationThreads);
+    auto report = validator.validateAll(options.warmGameCache ? &gameCache : nullptr);
+    for (const auto &result : report.results)
+    {
+        if (result.error.has_value())
+        {
+            LOG_WARNING("games", "game failed validation", {{"game", result.gameName}, {"error", result.error.value()}});
+        }
+    }
+    LOG_INFO("games", "validated game library", {{"games", report.results.size()}, {"failed", report.failureCount()}, {"threads", report.threadCount}, {"ms", report.totalTime.count()}});
+}
+
+void GameServer::watchGameDirectory()
+{
+    if (!options.watchGames)
+    {
+        return;
+    }
+
+    gameWatcher = std::make_unique<GameDirectoryWatcher>(
+        gameManager.getGameDirectory(),
+        [this](const GameChange &change)
+        { onGameChanged(change); },
+        options.gamePollInterval);
+    gameWatcher->start(options.pollGames);
+}
+
+void GameServer::onGameChanged(const GameChange &change)
+{
+    gameManager.applyChange(change);
+
+    // Running sessions hold their own definition, only new sessions see the change
+    if (change.removed)
+    {
+        gameCache.invalidate(change.gameName);
+    }
+    else
+    {
+        gameCache.reload(change.gameName);
+    }
+}
+
+std::chrono::steady_clock::time_point GameServer::nextDeadline() const
+{
+    // Workers keep their own checkpoints and game timers
+    if (workerPool)
+    {
+        return std::chrono::steady_clock::time_point::max();
+    }
+
+    // Wake for the first game whose input or timer runs out
+    auto deadline = scheduler.nextTimerDeadline();
+    if (!options.checkpointPath.empty())
+    {
+        deadline = std::min(deadline, lastCheckpoint + options.checkpointInterval);
+    }
+    return deadline;
+}
+
+void GameServer::handleCheckpoint()
+{
+    if (!options.checkpointPath.empty() && !workerPool && std::chrono::steady_clock::now() - lastCheckpoint >= options.checkpointInterval)
+    {
+        checkpoint();
+    }
+}
+
+void GameServer::publishMetrics()
+{
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastMetricsPublish < METRICS_PUBLISH_INTERVAL)
+    {
+        return;
+    }
+    lastMetricsPublish = now;
 
-        } catch (const std::exception &e) {
-            std::cerr << "Exception: " << typeid(e).name() << " - " << e.what() << std::endl;
+    // Workers publish their own shards
+    if (!workerPool)
+    {
+        shardMetrics.publish(sessionManager.getSessionCount(), scheduler.getReadyCount(), scheduler.getWaitingCount());
+    }
+    networkMetrics.publish(clients.size(), workerPool ? workerPool->pendingRequests() : 0, getOutboundStats(),
+                           admissionStats, Logger::instance().getDroppedCount());
+}
+
+void GameServer::run()
+{
+    while (update())
+    {
+        // Sleep only when idle, and never past the next deadline
+        pacer.pace(nextDeadline());
+    }
+}
+
+bool GameServer::update()
+{
+    if (stopRequested)
+    {
+        stop();
+        return false;
+    }
+
+    // A process taking over from this one asked for everything, see SessionHandoff
+    if (handoffListener)
+    {
+        int successor = handoffListener->accept();
+        if (successor != -1 && handOff(successor))
+        {
+            return false;
         }
     }
 
+    // Report where request time goes without stopping, e.g. on SIGUSR1
+    if (RequestLatency::takeDumpRequest())
+    {
+        std::cerr << RequestLatency::instance().report() << std::flush;
+    }
+
+    try {
+        bool serverUpdateSucceeded = handleServerUpdates();
+
+        if (!serverUpdateSucceeded)
+        {
+            return false;
+        }
+
+        bool gameUpdateSucceeded = handleGameUpdates();
+
+        if (!gameUpdateSucceeded)
+        {
+            return false;
+        }
+
+        handleCheckpoint();
+        publishMetrics();
+
+    } catch (const std::exception &e) {
+        LOG_ERROR("server", "exception in server loop", {{"type", typeid(e).name()}, {"error", e.what()}});
+    }
+
+    return true;
 }
 
 bool GameServer::handleServerUpdates()
 {
     try
     {
-        // From Server.h
-        server.update();
+        transport->update();
     }
     catch (std::exception &e) // Exception from server
     {
-        std::cerr << "ERROR: Exception from Server update:\n"
-                  << " " << e.what() << "\n\n";
+        LOG_ERROR("server", "exception from server update", {{"error", e.what()}});
         return false;
     }
 
     // Incoming from Server
-    const auto incoming = server.receive();
+    const auto incoming = transport->receive();
+
+    const auto now = ClientRegistry::Clock::now();
+    for (const auto &msg : incoming)
+    {
+        clients.touch(msg.connection.id, now);
+    }
 
-    // Process Message from server
-    const auto [log, shouldQuit, sendToClientIDs] = processMessages(incoming);
+    std::deque<Broadcast> outgoing;
+    bool shouldQuit = false;
 
-    // Find the session ID from the last processed message
-    if (!incoming.empty())
+    if (workerPool)
     {
-        const auto &lastMessage = incoming.back();
-        uintptr_t playerID = lastMessage.connection.id;
+        if (!incoming.empty())
+        {
+            pacer.markActive();
+            shouldQuit = dispatchToWorkers(incoming, outgoing);
+        }
 
-        try
+        // Replies arrive from the workers whether or not anything was received
+        if (workerPool->collect(outgoing))
+        {
+            pacer.markActive();
+        }
+        for (const auto &[clientID, seated] : workerPool->takeSeatChanges())
         {
-            // Find if player has session
-            auto sessionResult = sessionManager.findSessionByPlayer(playerID);
+            transport->reportSeat(Connection{clientID}, seated);
+        }
+    }
+    else if (!incoming.empty() || !incomingLanes.empty())
+    {
+        pacer.markActive();
+
+        // Process the batch up to the budget, then answer it with a single send
+        for (auto &result : processMessages(incoming, options.requestsPerUpdate))
+        {
+            shouldQuit = shouldQuit || result.shouldShutdown;
+            appendOutgoing(std::move(result), outgoing);
+        }
+    }
 
-            // Build outgoing messages (passes sessionResult directly)
-            const auto outgoing = buildOutgoing(log, sessionResult, sendToClientIDs);
+    if (pipeline)
+    {
+        handlePreparedRequests(outgoing);
+    }
 
-            // Send the outgoing messages
-            server.send(outgoing);
+    // Queue the outgoing messages and send what each client's budget allows
+    if (!outgoing.empty() || !backloggedClients.empty())
+    {
+        std::deque<Message> messages;
+        std::vector<LatencyTrace> sent;
+        enqueueOutgoing(outgoing, messages, sent);
+        flushOutbound(messages, sent);
+        if (!messages.empty())
+        {
+            transport->send(messages);
         }
-        catch (const std::runtime_error &e)
+        recordSent(sent);
+    }
+
+    if (shouldQuit)
+    {
+        stop();
+        return false;
+    }
+
+    return true;
+}
+
+bool GameServer::acceptWireFormat(const Message &msg)
+{
+    WireFormat format = isCompactFrame(msg.text) ? WireFormat::COMPACT : WireFormat::JSON;
+    if (format == WireFormat::COMPACT && !options.compactProtocol)
+    {
+        return false;
+    }
+    if (ClientInfo *client = clients.find(msg.connection.id))
+    {
+        client->wireFormat = format;
+    }
+    return true;
+}
+
+void GameServer::enqueueOutgoing(const std::deque<Broadcast> &outgoing, std::deque<Message> &messages,
+                                 std::vector<LatencyTrace> &sent)
+{
+    for (const auto &broadcast : outgoing)
+    {
+        // A response is timed by its first recipient's copy, including its wait in that client's queue
+        const LatencyTrace *trace = &broadcast.trace;
+        for (const auto &recipient : broadcast.recipients)
         {
-            if (!shouldQuit)
+            ClientInfo *client = clients.find(recipient.id);
+            if (client == nullptr)
             {
-                std::cout << "<" << playerID << "> Error: " << e.what() << std::endl;
+                messages.push_back(Message{recipient, *broadcast.payload});
+                if (trace != nullptr && trace->isSet())
+                {
+                    sent.push_back(*trace);
+                }
+                trace = nullptr;
+                continue;
             }
-            else
+
+            const SharedPayload &payload = client->wireFormat == WireFormat::COMPACT && broadcast.compactPayload
+                                               ? broadcast.compactPayload
+                                               : broadcast.payload;
+            if (client->outbound.empty())
             {
-                std::cout << "<" << playerID << "> Error: " << e.what() << std::endl;
+                backloggedClients.push_back(recipient.id);
             }
+            if (client->outbound.push(payload, broadcast.supersedeKey, trace != nullptr ? *trace : LatencyTrace{}))
+            {
+                outboundStats.coalesced++;
+            }
+            trace = nullptr;
+
+            if (client->outbound.exceeds(options.outboundLimit))
+            {
+                applyBackpressure(recipient, *client);
+            }
+        }
+    }
+}
+
+void GameServer::recordSent(const std::vector<LatencyTrace> &sent)
+{
+    auto sentAt = std::chrono::steady_clock::now();
+    for (const auto &trace : sent)
+    {
+        RequestLatency::instance().record(trace, sentAt);
+    }
+}
+
+void GameServer::flushOutbound(std::deque<Message> &messages, std::vector<LatencyTrace> &sent)
+{
+    // Clients resume their session once their queue is back under half the limit
+    const QueueLimits resumeLimit{options.outboundLimit.messages / 2, options.outboundLimit.bytes / 2};
+
+    size_t kept = 0;
+    for (uintptr_t clientID : backloggedClients)
+    {
+        ClientInfo *client = clients.find(clientID);
+        if (client == nullptr)
+        {
+            continue;
+        }
+
+        client->outbound.drainInto(Connection{clientID}, options.sendBudget, messages, &sent);
+
+        if (client->pausingSession && !client->outbound.exceeds(resumeLimit))
+        {
+            setSessionPaused(clientID, false);
+            client->pausingSession = false;
+        }
+
+        if (!client->outbound.empty())
+        {
+            backloggedClients[kept++] = clientID;
+        }
+    }
+    backloggedClients.resize(kept);
+}
+
+void GameServer::applyBackpressure(const Connection &connection, ClientInfo &client)
+{
+    switch (options.backpressurePolicy)
+    {
+    case BackpressurePolicy::DISCONNECT:
+        LOG_WARNING("server", "disconnecting client that fell behind",
+                    {{"client", connection.id}, {"queued", client.outbound.size()}, {"bytes", client.outbound.bytes()}});
+        outboundStats.disconnected++;
+        outboundStats.dropped += client.outbound.size();
+        transport->disconnect(connection);
+        forgetClient(connection);
+        return;
+
+    case BackpressurePolicy::PAUSE_SESSION:
+        if (!client.pausingSession && setSessionPaused(connection.id, true))
+        {
+            LOG_WARNING("server", "pausing session of client that fell behind",
+                        {{"client", connection.id}, {"queued", client.outbound.size()}, {"bytes", client.outbound.bytes()}});
+            client.pausingSession = true;
         }
 
-        if (shouldQuit)
+        // Output that is not the game's, or a client outside any game, is still bounded
+        if (client.outbound.exceeds({options.outboundLimit.messages * 2, options.outboundLimit.bytes * 2}))
         {
-            stop();
+            outboundStats.dropped += client.outbound.dropOldest(options.outboundLimit);
         }
+        return;
 
-        // Every 1 second, it updates
-        sleep(1);
+    case BackpressurePolicy::DROP_OLDEST:
+        outboundStats.dropped += client.outbound.dropOldest(options.outboundLimit);
+        return;
     }
+}
 
+bool GameServer::admitRequest(const Request &request)
+{
+    // Only registered clients have buckets
+    ClientInfo *client = clients.find(request.client.id);
+    if (client == nullptr)
+    {
+        return true;
+    }
+
+    // A batch costs what its requests cost, it is turned away whole without using any tokens
+    std::vector<MessageType> actions;
+    if (request.batch.empty())
+    {
+        actions.push_back(request.action);
+    }
+    for (const auto &item : request.batch)
+    {
+        actions.push_back(item.action);
+    }
+    if (client->rateLimiter.admit(options.rateLimits, actions, ClientRegistry::Clock::now()))
+    {
+        return true;
+    }
+
+    admissionStats.rateLimited++;
+    LOG_DEBUG("server", "request rate limited", {{"client", request.client.id}, {"action", static_cast<int>(request.action)}});
+    return false;
+}
+
+bool GameServer::setSessionPaused(uintptr_t clientID, bool paused)
+{
+    if (workerPool)
+    {
+        return workerPool->setSessionPaused(clientID, paused);
+    }
+
+    if (paused)
+    {
+        return sessionManager.pauseSessionFor(clientID);
+    }
+    sessionManager.resumeSessionFor(clientID);
     return true;
 }
 
+OutboundStats GameServer::getOutboundStats() const
+{
+    OutboundStats stats = outboundStats;
+    for (uintptr_t clientID : backloggedClients)
+    {
+        const ClientInfo *client = clients.find(clientID);
+        if (client == nullptr || client->outbound.empty())
+        {
+            continue;
+        }
+
+        stats.backloggedClients++;
+        stats.queuedMessages += client->outbound.size();
+        stats.queuedBytes += client->outbound.bytes();
+        stats.deepestQueueMessages = std::max(stats.deepestQueueMessages, client->outbound.size());
+        stats.deepestQueueBytes = std::max(stats.deepestQueueBytes, client->outbound.bytes());
+        stats.pausingClients += client->pausingSession ? 1 : 0;
+    }
+    return stats;
+}
+
+bool GameServer::dispatchToWorkers(const std::deque<Message> &incoming, std::deque<Broadcast> &outgoing)
+{
+    size_t pending = workerPool->pendingRequests();
+
+    for (const auto &msg : incoming)
+    {
+        if (handleShutDown(msg).shouldShutdown)
+        {
+            return true;
+        }
+
+        // Turn requests away before parsing them while the workers are saturated
+        if (pending >= options.maxPendingRequests)
+        {
+            admissionStats.shed++;
+            outgoing.push_back(Broadcast{std::make_shared<const std::string>(serializeResponse(rejectionResponse(msg.connection.id, OVERLOADED_MESSAGE))),
+                                         {msg.connection}});
+            continue;
+        }
+
+        Request request(msg.text, msg.connection);
+        if (!acceptWireFormat(msg) || !request.isValid)
+        {
+            std::ostringstream result;
+            result << "<" << msg.connection.id << "> Invalid Message!" << std::endl;
+            outgoing.push_back(Broadcast{std::make_shared<const std::string>(result.str()), {msg.connection}});
+            continue;
+        }
+
+        if (!admitRequest(request))
+        {
+            Response rejection = rejectionResponse(msg.connection.id, RATE_LIMITED_MESSAGE, request.requestId);
+            outgoing.push_back(Broadcast{std::make_shared<const std::string>(serializeResponse(rejection)), {msg.connection}});
+            continue;
+        }
+
+        workerPool->dispatch(std::move(request));
+        pending++;
+    }
+
+    return false;
+}
+
 bool GameServer::handleGameUpdates()
 {
+    // Workers run the games of their own sessions
+    if (workerPool)
+    {
+        return true;
+    }
+
     try {
+        // Keep ticking without sleeping while any game can make progress
+        if (scheduler.hasReadyProcesses())
+        {
+            pacer.markActive();
+        }
         scheduler.executeInParallel();
     } catch (const std::exception &e) {
-        std::cerr << "Exception: " << typeid(e).name() << " - " << e.what() << std::endl;
+        LOG_ERROR("logic", "exception running games", {{"type", typeid(e).name()}, {"error", e.what()}});
         return false;
     }
     return true;
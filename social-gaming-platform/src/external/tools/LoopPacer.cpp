@@ -0,0 +1,29 @@
+#include "LoopPacer.h"
+
+#include <algorithm>
+#include <thread>
+
+LoopPacer::LoopPacer(std::chrono::microseconds minWait, std::chrono::microseconds maxWait)
+    : minWait(minWait), maxWait(std::max(minWait, maxWait)), currentWait(minWait)
+{
+}
+
+void LoopPacer::pace(Clock::time_point deadline)
+{
+    if (active)
+    {
+        // Work tends to arrive in bursts, check again straight away
+        active = false;
+        currentWait = minWait;
+        return;
+    }
+
+    auto untilDeadline = std::chrono::duration_cast<std::chrono::microseconds>(deadline - Clock::now());
+    auto wait = std::min(currentWait, untilDeadline);
+    if (wait > std::chrono::microseconds::zero())
+    {
+        std::this_thread::sleep_for(wait);
+    }
+
+    currentWait = std::min(currentWait * 2, maxWait);
+}
@@ -0,0 +1,101 @@
+/**
+ * LoopbackTransport.cpp
+ */
+#include "LoopbackTransport.h"
+
+Connection LoopbackTransport::connect()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Connection connection{nextId++};
+    open.insert(connection.id);
+    events.push_back({connection, true});
+    return connection;
+}
+
+void LoopbackTransport::close(Connection connection)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    closeLocked(connection);
+}
+
+void LoopbackTransport::closeLocked(Connection connection)
+{
+    if (open.erase(connection.id) > 0)
+    {
+        events.push_back({connection, false});
+    }
+}
+
+bool LoopbackTransport::sendToServer(Connection connection, std::string text)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!open.contains(connection.id))
+    {
+        return false;
+    }
+    inbound.push_back(Message{connection, std::move(text)});
+    return true;
+}
+
+std::deque<Message> LoopbackTransport::takeSent()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::deque<Message> sent;
+    sent.swap(outbound);
+    return sent;
+}
+
+bool LoopbackTransport::isOpen(Connection connection) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return open.contains(connection.id);
+}
+
+void LoopbackTransport::update()
+{
+    std::vector<ConnectionEvent> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.swap(events);
+    }
+
+    // Outside the lock, the handlers may call back into the transport
+    for (const auto &event : pending)
+    {
+        if (event.opened)
+        {
+            connected(event.connection);
+        }
+        else
+        {
+            disconnected(event.connection);
+        }
+    }
+}
+
+std::deque<Message> LoopbackTransport::receive()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::deque<Message> received;
+    received.swap(inbound);
+    return received;
+}
+
+void LoopbackTransport::send(const std::deque<Message> &messages)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &message : messages)
+    {
+        // Like a closed socket, messages to a closed connection are lost
+        if (open.contains(message.connection.id))
+        {
+            outbound.push_back(message);
+        }
+    }
+}
+
+void LoopbackTransport::disconnect(Connection connection)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    closeLocked(connection);
+}
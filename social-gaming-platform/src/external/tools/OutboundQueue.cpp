@@ -0,0 +1,152 @@
+/**
+ * OutboundQueue.cpp
+ */
+#include "OutboundQueue.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+    // Holes are only compacted away once there are more of them than this
+    const size_t MIN_HOLES_TO_COMPACT = 16;
+}
+
+std::string_view backpressurePolicyName(BackpressurePolicy policy)
+{
+    switch (policy)
+    {
+    case BackpressurePolicy::DISCONNECT:
+        return "disconnect";
+    case BackpressurePolicy::PAUSE_SESSION:
+        return "pause";
+    default:
+        return "drop-oldest";
+    }
+}
+
+std::expected<BackpressurePolicy, std::string> parseBackpressurePolicy(std::string_view name)
+{
+    for (BackpressurePolicy policy : {BackpressurePolicy::DROP_OLDEST, BackpressurePolicy::DISCONNECT, BackpressurePolicy::PAUSE_SESSION})
+    {
+        std::string_view policyName = backpressurePolicyName(policy);
+        if (name.size() == policyName.size() &&
+            std::equal(name.begin(), name.end(), policyName.begin(), [](char a, char b)
+                       { return std::tolower(a) == b; }))
+        {
+            return policy;
+        }
+    }
+    return std::unexpected("Unknown backpressure policy: " + std::string(name));
+}
+
+bool OutboundQueue::push(SharedPayload payload, uint64_t supersedeKey, const LatencyTrace &trace)
+{
+    const uint64_t sequence = frontSequence + entries.size();
+    bool superseded = false;
+
+    if (supersedeKey != 0)
+    {
+        auto [keyed, inserted] = keyedSequences.try_emplace(supersedeKey, sequence);
+        if (!inserted)
+        {
+            Entry &older = entries[keyed->second - frontSequence];
+            count--;
+            byteCount -= older.payload->size();
+            older.payload.reset();
+
+            keyed->second = sequence;
+            superseded = true;
+        }
+    }
+
+    count++;
+    byteCount += payload->size();
+    entries.push_back(Entry{std::move(payload), supersedeKey, trace});
+
+    if (superseded && entries.size() - count > std::max(count, MIN_HOLES_TO_COMPACT))
+    {
+        compact();
+    }
+    return superseded;
+}
+
+size_t OutboundQueue::drainInto(const Connection &connection, const QueueLimits &budget, std::deque<Message> &outgoing,
+                                std::vector<LatencyTrace> *sent)
+{
+    size_t moved = 0;
+    size_t movedBytes = 0;
+
+    while (count > 0 && (moved == 0 || (moved < budget.messages && movedBytes < budget.bytes)))
+    {
+        const Entry &front = entries.front();
+        if (front.payload)
+        {
+            outgoing.push_back(Message{connection, *front.payload});
+            moved++;
+            movedBytes += front.payload->size();
+            if (sent != nullptr && front.trace.isSet())
+            {
+                sent->push_back(front.trace);
+            }
+        }
+        popFront();
+    }
+    return moved;
+}
+
+size_t OutboundQueue::dropOldest(const QueueLimits &limits)
+{
+    size_t dropped = 0;
+    while (exceeds(limits))
+    {
+        if (entries.front().payload)
+        {
+            dropped++;
+        }
+        popFront();
+    }
+    return dropped;
+}
+
+void OutboundQueue::clear()
+{
+    entries.clear();
+    keyedSequences.clear();
+    frontSequence = 0;
+    count = 0;
+    byteCount = 0;
+}
+
+void OutboundQueue::popFront()
+{
+    Entry &front = entries.front();
+    if (front.payload)
+    {
+        count--;
+        byteCount -= front.payload->size();
+        if (front.supersedeKey != 0)
+        {
+            keyedSequences.erase(front.supersedeKey);
+        }
+    }
+    entries.pop_front();
+    frontSequence++;
+}
+
+void OutboundQueue::compact()
+{
+    std::deque<Entry> live;
+    for (auto &entry : entries)
+    {
+        if (entry.payload)
+        {
+            if (entry.supersedeKey != 0)
+            {
+                keyedSequences[entry.supersedeKey] = frontSequence + live.size();
+            }
+            live.push_back(std::move(entry));
+        }
+    }
+    entries = std::move(live);
+}
@@ -0,0 +1,144 @@
+/**
+ * RateLimiter.cpp
+ */
+#include "RateLimiter.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace
+{
+    std::optional<double> parseNumber(std::string_view text)
+    {
+        double value = 0;
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc() || end != text.data() + text.size())
+        {
+            return std::nullopt;
+        }
+        return value;
+    }
+}
+
+std::expected<RateLimit, std::string> parseRateLimit(std::string_view text)
+{
+    size_t separator = text.find(':');
+    auto perSecond = parseNumber(text.substr(0, separator));
+    auto burst = separator == std::string_view::npos ? perSecond : parseNumber(text.substr(separator + 1));
+
+    if (!perSecond.has_value() || !burst.has_value() || (perSecond.value() > 0 && burst.value() < 1))
+    {
+        return std::unexpected("Invalid rate limit, expected <per second>:<burst>: " + std::string(text));
+    }
+    return RateLimit{perSecond.value(), burst.value()};
+}
+
+std::expected<std::pair<MessageType, RateLimit>, std::string> parseActionRateLimit(std::string_view text)
+{
+    size_t separator = text.find(':');
+    auto action = parseNumber(text.substr(0, separator));
+    if (!action.has_value() || separator == std::string_view::npos)
+    {
+        return std::unexpected("Invalid action rate limit, expected <action>:<per second>:<burst>: " + std::string(text));
+    }
+
+    auto limit = parseRateLimit(text.substr(separator + 1));
+    if (!limit.has_value())
+    {
+        return std::unexpected(limit.error());
+    }
+    return std::pair{static_cast<MessageType>(static_cast<int>(action.value())), limit.value()};
+}
+
+const RateLimit *RateLimits::forAction(MessageType action) const
+{
+    auto found = std::find_if(perAction.begin(), perAction.end(), [action](const auto &limit)
+                              { return limit.first == action; });
+    return found == perAction.end() ? nullptr : &found->second;
+}
+
+bool TokenBucket::refill(Clock::time_point now, unsigned count)
+{
+    if (limit.isUnlimited())
+    {
+        return true;
+    }
+
+    std::chrono::duration<double> elapsed = now - updated;
+    tokens = std::min(limit.burst, tokens + elapsed.count() * limit.perSecond);
+    updated = now;
+    return tokens >= count;
+}
+
+TokenBucket *ConnectionRateLimiter::actionBucketFor(const RateLimits &limits, MessageType action,
+                                                    TokenBucket::Clock::time_point now)
+{
+    const RateLimit *actionLimit = limits.forAction(action);
+    if (actionLimit == nullptr)
+    {
+        return nullptr;
+    }
+
+    // A connection only makes a handful of different requests, a scan beats hashing
+    auto found = std::find_if(actionBuckets.begin(), actionBuckets.end(), [action](const auto &bucket)
+                              { return bucket.first == action; });
+    if (found == actionBuckets.end())
+    {
+        actionBuckets.emplace_back(action, TokenBucket(*actionLimit, now));
+        found = actionBuckets.end() - 1;
+    }
+    return &found->second;
+}
+
+bool ConnectionRateLimiter::admit(const RateLimits &limits, MessageType action, TokenBucket::Clock::time_point now)
+{
+    return admit(limits, std::span<const MessageType>(&action, 1), now);
+}
+
+bool ConnectionRateLimiter::admit(const RateLimits &limits, std::span<const MessageType> actions,
+                                  TokenBucket::Clock::time_point now)
+{
+    if (!connectionBucket.has_value())
+    {
+        connectionBucket.emplace(limits.perConnection, now);
+    }
+
+    // What each limited action's bucket has to give
+    std::vector<std::pair<TokenBucket *, unsigned>> needed;
+    for (MessageType action : actions)
+    {
+        TokenBucket *bucket = actionBucketFor(limits, action, now);
+        if (bucket == nullptr)
+        {
+            continue;
+        }
+        auto found = std::find_if(needed.begin(), needed.end(), [bucket](const auto &need)
+                                  { return need.first == bucket; });
+        if (found == needed.end())
+        {
+            needed.emplace_back(bucket, 1);
+        }
+        else
+        {
+            found->second++;
+        }
+    }
+
+    // Every bucket refills before any is checked, so none is left behind by an early refusal
+    bool available = connectionBucket->refill(now, actions.size());
+    for (auto &[bucket, count] : needed)
+    {
+        available = bucket->refill(now, count) && available;
+    }
+    if (!available)
+    {
+        return false;
+    }
+
+    connectionBucket->take(actions.size());
+    for (auto &[bucket, count] : needed)
+    {
+        bucket->take(count);
+    }
+    return true;
+}
@@ -1,49 +1,112 @@
 #include "Request.h"
-#include <nlohmann/json.hpp> // Library for parsing JSON
-#include <iostream>
 
-using json = nlohmann::json;
+#include <charconv>
 
+#include "RequestScanner.h"
+#include "WireCodec.h"
 
-//Constructor for request
-Request::Request(const std::string& message, Connection client)
-    : client(client) {
-    //Parse JSON using nlohmann library and initilize Request
-
-    try { 
-        // Parse string into JSON object
-        std::cout << "Message: " << message << std::endl;
-        json jsonRequest = json::parse(message);
-
-        //Set fields from JSON object
-        if(jsonRequest.contains("action")) {
-            // Get and convert the stringed integer to MessageType
-            int intAction = std::stoi(jsonRequest["action"].get<std::string>());
-            action = static_cast<MessageType>(intAction);
-        }
-        
-        if(jsonRequest.contains("body")) {
-            std::string strBody = jsonRequest["body"].get<std::string>();
-            body = strBody;
+namespace {
+    // Actions are sent as stringed integers, anything else is undefined
+    MessageType actionOf(const ScannedString& field) {
+        std::string decoded;
+        std::string_view text = field.raw;
+        if (field.escaped) {
+            decoded = field.decoded();
+            text = decoded;
         }
 
-        if(jsonRequest.contains("sessionID")) {
-            std::string strSession = jsonRequest["sessionID"].get<std::string>();
-            sessionId = strSession;
+        int intAction = 0;
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), intAction);
+        if (error != std::errc() || end != text.data() + text.size() ||
+            intAction >= static_cast<int>(MessageType::DISCONNECT)) {
+            return MessageType::UNDEFINED;
         }
+        return static_cast<MessageType>(intAction);
+    }
+}
 
-        if(jsonRequest.contains("request_id")) {
-            std::string strRequestId = jsonRequest["request_id"].get<std::string>();
-            requestId = strRequestId;
-        }
+//Constructor for request
+Request::Request(std::string_view message, Connection client)
+    : client(client) {
+    //Scan the message for the request fields, without building a JSON document
 
-        if(jsonRequest.contains("target_var")) {
-            targetVar = jsonRequest["target_var"].get<std::string>();
-        }
+    static Histogram &parseDuration = MetricsRegistry::instance().histogram(
+        "request_parse_duration_seconds", "Time to parse a client message into a request");
+    auto start = std::chrono::steady_clock::now();
 
+    if (isCompactFrame(message)) {
+        auto decoded = decodeCompactRequest(message);
+        if (decoded.has_value()) {
+            assign(decoded->fields);
+            action = decoded->action;
+            isValid = true;
+        } else {
+            LOG_DEBUG("request", "compact parse error", {{"client", client.id}, {"error", decoded.error()}});
+        }
+    } else if (isRequestBatch(message)) {
+        auto scanned = scanRequestBatch(message);
+        if (scanned.has_value()) {
+            batch.reserve(scanned->size());
+            for (const auto& fields : scanned.value()) {
+                batch.emplace_back(fields, client);
+                batch.back().receivedAt = receivedAt;
+            }
+            isValid = true;
+        } else {
+            LOG_DEBUG("request", "batch parse error", {{"client", client.id}, {"error", scanned.error()}, {"text", message}});
+        }
+    } else if (auto scanned = scanRequest(message); scanned.has_value()) {
+        assign(scanned.value());
         isValid = true;
+    } else {
+        LOG_DEBUG("request", "JSON parse error", {{"client", client.id}, {"error", scanned.error()}, {"text", message}});
+    }
 
-    } catch (json::parse_error& e) {
-        std::cerr << "JSON Parse Error: " << e.what() << std::endl;
+    latency.parsedAt = std::chrono::steady_clock::now();
+    parseDuration.record(latency.parsedAt - start);
+    for (auto& item : batch) {
+        item.latency.parsedAt = latency.parsedAt;
     }
-}
\ No newline at end of file
+}
+
+Request::Request(const ScannedRequest& fields, Connection client)
+    : client(client) {
+    assign(fields);
+    isValid = true;
+}
+
+void Request::assign(const ScannedRequest& fields) {
+    //Set fields from the message, copying each once
+    if (fields.action.has_value()) {
+        action = actionOf(fields.action.value());
+    }
+    if (fields.body.has_value()) {
+        fields.body->assignTo(body);
+    }
+    if (fields.sessionId.has_value()) {
+        fields.sessionId->assignTo(sessionId);
+    }
+    if (fields.requestId.has_value()) {
+        fields.requestId->assignTo(requestId);
+    }
+    if (fields.targetVar.has_value()) {
+        targetVar = fields.targetVar->decoded();
+    }
+}
+
+const Request& routingRequestOf(const Request& request) {
+    for (const auto& item : request.batch) {
+        if (item.action == MessageType::JOIN || item.action == MessageType::JOIN_AUDIENCE) {
+            return item;
+        }
+    }
+    return request.batch.empty() ? request : request.batch.front();
+}
+
+LatencyTrace traceOf(const Request& request) {
+    LatencyTrace trace = request.latency;
+    trace.action = request.action;
+    trace.receivedAt = request.receivedAt;
+    trace.serializedAt = std::chrono::steady_clock::now();
+    return trace;
+}
@@ -4,10 +4,82 @@
 using json = nlohmann::json;
 
 // Constructor implementation
-RequestHandler::RequestHandler(SessionManager &sessionManager, GameManager &gameManager, logic::Scheduler<logic::GameProcess> &scheduler)
-    : sessionManager(sessionManager), gameManager(gameManager), scheduler(scheduler) {};
+RequestHandler::RequestHandler(SessionManager &sessionManager, GameManager &gameManager, logic::Scheduler<logic::GameProcess> &scheduler, logic::GameDefinitionCache &gameCache)
+    : sessionManager(sessionManager), gameManager(gameManager), scheduler(scheduler), gameCache(gameCache) {};
+
+namespace
+{
+    /**
+     * Request count and handling time for one action
+     */
+    struct ActionMetrics
+    {
+        Counter &requests;
+        Histogram &duration;
+
+        explicit ActionMetrics(std::string_view action)
+            : requests(MetricsRegistry::instance().counter(
+                  "requests_total", "Requests handled, by action", "action=\"" + std::string(action) + "\"")),
+              duration(MetricsRegistry::instance().histogram(
+                  "request_duration_seconds", "Time to handle a request, by action",
+                  "action=\"" + std::string(action) + "\""))
+        {
+        }
+    };
+
+    ActionMetrics &actionMetrics(MessageType action)
+    {
+        static ActionMetrics join("join");
+        static ActionMetrics joinAudience("join_audience");
+        static ActionMetrics end("end");
+        static ActionMetrics echo("echo");
+        static ActionMetrics newGame("new_game");
+        static ActionMetrics inputText("input_text");
+        static ActionMetrics other("other");
+
+        switch (action)
+        {
+        case MessageType::JOIN:
+            return join;
+        case MessageType::JOIN_AUDIENCE:
+            return joinAudience;
+        case MessageType::END:
+            return end;
+        case MessageType::ECHO:
+            return echo;
+        case MessageType::NEW_GAME:
+            return newGame;
+        case MessageType::INPUT_TEXT:
+            return inputText;
+        default:
+            return other;
+        }
+    }
+}
 
 Response RequestHandler::handleRequest(Request &request)
+{
+    ActionMetrics &metrics = actionMetrics(request.action);
+    auto start = std::chrono::steady_clock::now();
+
+    Response response = routeRequest(request);
+
+    auto end = std::chrono::steady_clock::now();
+    metrics.duration.record(end - start);
+    metrics.requests.add();
+
+    // Attribute the request to the game of the sender's session, once it is in one
+    request.latency.handleStartedAt = start;
+    request.latency.handledAt = end;
+    auto session = sessionManager.findSessionByPlayer(request.client.id);
+    if (session.has_value() && !session.value()->getGameName().empty())
+    {
+        request.latency.game = &RequestLatency::instance().forGame(session.value()->getGameName());
+    }
+    return response;
+}
+
+Response RequestHandler::routeRequest(Request &request)
 {
     // Logic for directing specific requests
     // May require more complex logic as endpoints change
@@ -21,6 +93,8 @@ Response RequestHandler::handleRequest(Request &request)
         {
         case (MessageType::JOIN):
             return handleJoin(request);
+        case (MessageType::JOIN_AUDIENCE):
+            return handleJoinAudience(request);
         case (MessageType::END):
             return handleEnd(request);
         case (MessageType::ECHO):
@@ -45,7 +119,7 @@ Response RequestHandler::handleRequest(Request &request)
  */
 Response RequestHandler::handleJoin(Request &request)
 {
-    std::cout << "\nJoin------" << std::endl; // debug
+    LOG_DEBUG("session", "join requested", {{"client", request.client.id}, {"join_code", request.body}});
 
     const std::string &joinCode = request.body;
 
@@ -66,25 +140,57 @@ Response RequestHandler::handleJoin(Request &request)
             {request.client.id},
             true,
             request.requestId);
-        MessageResponse response(commonRes);
+        MessageResponse response(std::move(commonRes));
         return response;
     }
     else
     {
         // Failed through unexpected, create error response with the error message
-        std::cout << "\tRH - Error: " << addPlayerResult.error() << std::endl; // debug
+        LOG_DEBUG("session", "join failed", {{"client", request.client.id}, {"error", addPlayerResult.error()}});
         return createErrorResponse(request, "[JOIN] " + addPlayerResult.error());
     }
 }
 
+/**
+ * @brief Entering existed session as a spectator via join code
+ * @param request Request
+ * @return response Message whether joining the audience completed or denied
+ */
+Response RequestHandler::handleJoinAudience(Request &request)
+{
+    const std::string &joinCode = request.body;
+
+    auto addAudienceResult = sessionManager.addAudienceMemberToSession(joinCode, request.client);
+
+    if (addAudienceResult.has_value())
+    {
+        Session *session = addAudienceResult.value();
+
+        CommonResponse commonRes(
+            std::to_string(session->getId()),
+            "[AUDIENCE] Joined the audience",
+            MessageType::MESSAGE,
+            {request.client.id},
+            true,
+            request.requestId);
+        MessageResponse response(std::move(commonRes));
+        return response;
+    }
+    else
+    {
+        return createErrorResponse(request, "[AUDIENCE] " + addAudienceResult.error());
+    }
+}
+
 /**
  * @todo stopping the game
  */
 Response RequestHandler::handleEnd(const Request &request) const
 {
     // Placeholder for an example of a potentally async call to LOGIC
-    CommonResponse commonRes("gameIdXXXX", "[Game Ended]", MessageType::MESSAGE, {});
-    MessageResponse response(commonRes);
+    // Goes to the whole session, spectators included
+    CommonResponse commonRes("gameIdXXXX", "[Game Ended]", MessageType::MESSAGE, {}, std::nullopt, std::nullopt, true);
+    MessageResponse response(std::move(commonRes));
     return response;
 }
 
@@ -93,10 +199,10 @@ Response RequestHandler::handleEcho(const Request &request) const
     // Uncomment line below and replace {} to send only to client_id of sender (private response)
     // std::vector<uintptr_t> clientIds = {request.client.id};
 
-    // Direct response from server
+    // Direct response from server, broadcast to the session and its audience
     CommonResponse commonRes("gameIdXXXX", request.body,
-                             MessageType::MESSAGE, {}, true, request.requestId);
-    MessageResponse response(commonRes);
+                             MessageType::MESSAGE, {}, true, request.requestId, true);
+    MessageResponse response(std::move(commonRes));
     return response;
 }
 
@@ -107,34 +213,38 @@ Response RequestHandler::handleEcho(const Request &request) const
  */
 Response RequestHandler::handleNewGame(Request &request)
 {
-    std::cout << "\nNEW GAME------\n";
+    LOG_DEBUG("session", "new game requested", {{"client", request.client.id}, {"game", request.body}});
 
-    // Create new session
-    auto sessionResult = sessionManager.createSession(request.client.id, GameData());
+    // Get the compiled game specified, parsing it only if it is not cached
+    auto game = gameCache.getGame(request.body);
+    if (!game.has_value())
+    {
+        LOG_DEBUG("session", "game not available", {{"game", request.body}, {"error", game.error()}});
+        return createErrorResponse(request, "[NEW GAME] " + game.error());
+    }
+
+    // Create new session from the game's initial state
+    auto sessionResult = sessionManager.createSession(request.client.id, game.value()->initialGameData);
 
     if (sessionResult.has_value())
     {
         Session *newSession = sessionResult.value();
 
-        // Get Game file specified
-        auto sourceCode = gameManager.readGameFile(request.body);
-        if (!sourceCode.has_value())
+        // Add player to session, refused when the client got into a session on another worker meanwhile
+        // @todo : Should be added as host of session instead of regular player
+        auto hostResult = sessionManager.addPlayer(*newSession, request.client);
+        if (!hostResult.has_value())
         {
-            std::cout << "\tGame file specified not found" << std::endl; // debug
-            return createErrorResponse(request, "[NEW GAME] Game file not found with specified name: " + request.body);
+            sessionManager.destroySession(newSession->getId());
+            return createErrorResponse(request, "[NEW GAME] " + hostResult.error());
         }
 
-        // If game type found
-        logic::GameProcess newProcess(newSession, sourceCode.value().getContents());
+        newSession->setGameName(request.body);
+        logic::GameProcess newProcess(newSession, game.value());
 
         scheduler.addProcess(logic::ProcessTraits(newProcess));
 
-        // Add player to session
-        // @todo : Should be added as host of session instead of regular player
-        newSession->addPlayer(request.client);
-
-        std::cout << "\tNew session created with ID: " << newSession->getId() << std::endl; // debug
-        std::cout << "\tPlayer added to new session" << std::endl;                          // debug
+        LOG_INFO("session", "session created", {{"session", newSession->getId()}, {"game", request.body}, {"host", request.client.id}});
         // Return success response with join code
         std::string message = "Join Code: " + newSession->getJoinCode();
         CommonResponse commonRes(
@@ -144,16 +254,41 @@ Response RequestHandler::handleNewGame(Request &request)
             {request.client.id},
             true,
             request.requestId);
-        MessageResponse response(commonRes);
+        MessageResponse response(std::move(commonRes));
         return response;
     }
     else
     {
-        std::cout << "\tRH - Error: " << sessionResult.error() << std::endl; // debug
+        LOG_DEBUG("session", "session creation failed", {{"client", request.client.id}, {"error", sessionResult.error()}});
         return createErrorResponse(request, "[NEW GAME] " + sessionResult.error());
     }
 }
 
+bool RequestHandler::restoreProcess(Session &session)
+{
+    // Sessions checkpointed before their game was chosen have nothing to resume
+    if (session.getGameName().empty())
+    {
+        return true;
+    }
+
+    auto game = gameCache.getGame(session.getGameName());
+    if (!game.has_value())
+    {
+        LOG_ERROR("session", "unable to restore session", {{"session", session.getId()}, {"error", game.error()}});
+        return false;
+    }
+
+    logic::GameProcess restoredProcess(&session, game.value());
+    if (!restoredProcess.restorePosition())
+    {
+        LOG_ERROR("session", "unable to restore session", {{"session", session.getId()}, {"error", "its game stopped inside a rule"}});
+        return false;
+    }
+    scheduler.addProcess(logic::ProcessTraits(restoredProcess));
+    return true;
+}
+
 Response RequestHandler::handleInputText(const Request &request) const
 {
     // Process the input text from the client
@@ -167,7 +302,7 @@ Response RequestHandler::handleInputText(const Request &request) const
         // Prepare a response (if needed)
         CommonResponse commonRes(request.sessionId, "Input received",
                                  MessageType::MESSAGE, {request.client.id}, true, request.requestId);
-        MessageResponse response(commonRes);
+        MessageResponse response(std::move(commonRes));
         return response;
     }
     else
@@ -181,7 +316,7 @@ Response RequestHandler::handleBadRequest(const Request &request) const
     // Placeholder for error request
     CommonResponse commonRes("gameIdXXXX", "400 Bad Request",
                              MessageType::MESSAGE, {}, false, request.requestId);
-    MessageResponse response(commonRes);
+    MessageResponse response(std::move(commonRes));
     return response;
 }
 
@@ -194,6 +329,6 @@ Response RequestHandler::createErrorResponse(const Request &request, const std::
         {request.client.id},
         false,
         request.requestId);
-    MessageResponse response(commonRes);
+    MessageResponse response(std::move(commonRes));
     return response;
 }
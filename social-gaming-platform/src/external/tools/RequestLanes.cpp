@@ -0,0 +1,95 @@
+/**
+ * RequestLanes.cpp
+ */
+#include "RequestLanes.h"
+
+#include <charconv>
+
+RequestLane laneOf(MessageType action)
+{
+    switch (action)
+    {
+    case MessageType::INPUT_TEXT:
+    case MessageType::INPUT_CHOICE:
+    case MessageType::INPUT_RANGE:
+    case MessageType::INPUT_VOTE:
+        return RequestLane::INPUT;
+
+    // Session changes, and notices the server makes about a client
+    case MessageType::JOIN:
+    case MessageType::JOIN_AUDIENCE:
+    case MessageType::NEW_GAME:
+    case MessageType::END:
+    case MessageType::DISCONNECT:
+    case MessageType::PAUSE_SESSION:
+    case MessageType::RESUME_SESSION:
+        return RequestLane::CONTROL;
+
+    default:
+        return RequestLane::DIAGNOSTIC;
+    }
+}
+
+RequestLane laneOf(const Request &request)
+{
+    if (request.batch.empty())
+    {
+        return laneOf(request.action);
+    }
+
+    RequestLane lane = RequestLane::INPUT;
+    for (const auto &item : request.batch)
+    {
+        lane = std::max(lane, laneOf(item.action));
+    }
+    return lane;
+}
+
+std::string_view requestLaneName(RequestLane lane)
+{
+    switch (lane)
+    {
+    case RequestLane::INPUT:
+        return "input";
+    case RequestLane::CONTROL:
+        return "control";
+    default:
+        return "diagnostic";
+    }
+}
+
+std::expected<LaneWeights, std::string> parseLaneWeights(std::string_view text)
+{
+    LaneWeights weights;
+    const char *position = text.data();
+    const char *end = text.data() + text.size();
+
+    for (size_t lane = 0; lane < REQUEST_LANE_COUNT; lane++)
+    {
+        auto [next, error] = std::from_chars(position, end, weights[lane]);
+        bool separatorExpected = lane + 1 < REQUEST_LANE_COUNT;
+        if (error != std::errc() || weights[lane] == 0 ||
+            (separatorExpected ? next == end || *next != ':' : next != end))
+        {
+            return std::unexpected("Expected <input>:<control>:<diagnostic> weights of at least 1: " + std::string(text));
+        }
+        position = next + 1;
+    }
+    return weights;
+}
+
+Histogram &laneWaitHistogram(RequestLane lane)
+{
+    static std::array<Histogram *, REQUEST_LANE_COUNT> histograms = []()
+    {
+        std::array<Histogram *, REQUEST_LANE_COUNT> registered;
+        for (size_t i = 0; i < REQUEST_LANE_COUNT; i++)
+        {
+            registered[i] = &MetricsRegistry::instance().histogram(
+                "request_queue_wait_seconds", "Time requests waited to be handled, from when they were received, by lane",
+                "lane=\"" + std::string(requestLaneName(static_cast<RequestLane>(i))) + "\"");
+        }
+        return registered;
+    }();
+    return *histograms[static_cast<size_t>(lane)];
+}
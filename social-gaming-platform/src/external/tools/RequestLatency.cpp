@@ -0,0 +1,186 @@
+/**
+ * RequestLatency.cpp
+ */
+#include "RequestLatency.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace
+{
+    struct NamedAction
+    {
+        MessageType action;
+        std::string_view name;
+    };
+
+    // Order of the action histograms, the last one counts every other action
+    const NamedAction REPORTED_ACTIONS[] = {
+        {MessageType::JOIN, "join"},
+        {MessageType::END, "end"},
+        {MessageType::ECHO, "echo"},
+        {MessageType::NEW_GAME, "new_game"},
+        {MessageType::JOIN_AUDIENCE, "join_audience"},
+        {MessageType::INPUT_TEXT, "input_text"},
+        {MessageType::INPUT_CHOICE, "input_choice"},
+        {MessageType::INPUT_RANGE, "input_range"},
+        {MessageType::INPUT_VOTE, "input_vote"},
+        {MessageType::MESSAGE, "message"},
+        {MessageType::SCORE, "score"},
+        {MessageType::UNDEFINED, "other"},
+    };
+    const size_t OTHER_ACTIONS = std::size(REPORTED_ACTIONS) - 1;
+    static_assert(std::size(REPORTED_ACTIONS) == 12, "one action histogram group per reported action");
+
+    const double REPORTED_QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+    size_t actionIndex(MessageType action)
+    {
+        for (size_t i = 0; i < OTHER_ACTIONS; i++)
+        {
+            if (REPORTED_ACTIONS[i].action == action)
+            {
+                return i;
+            }
+        }
+        return OTHER_ACTIONS;
+    }
+
+    void appendMicros(std::string &out, uint64_t nanos)
+    {
+        char digits[32];
+        auto [end, error] = std::to_chars(digits, digits + sizeof(digits), static_cast<double>(nanos) / 1000.0,
+                                          std::chars_format::fixed, 1);
+        out += ' ';
+        out.append(digits, end - digits);
+    }
+
+    void appendGroup(std::string &out, std::string_view kind, std::string_view name, const LatencyGroup &group)
+    {
+        for (size_t i = 0; i < LATENCY_STAGE_COUNT; i++)
+        {
+            const LatencyHistogram &histogram = group.stages[i];
+            uint64_t count = histogram.count();
+            if (count == 0)
+            {
+                continue;
+            }
+
+            out += kind;
+            out += ' ';
+            out += name;
+            out += ' ';
+            out += latencyStageName(static_cast<LatencyStage>(i));
+            out += ' ';
+            out += std::to_string(count);
+            for (double quantile : REPORTED_QUANTILES)
+            {
+                appendMicros(out, histogram.quantileNanos(quantile));
+            }
+            out += '\n';
+        }
+    }
+
+    void recordStage(LatencyGroup &group, LatencyGroup *game, LatencyStage stage,
+                     LatencyTrace::Clock::time_point from, LatencyTrace::Clock::time_point to)
+    {
+        if (from == LatencyTrace::Clock::time_point() || to == LatencyTrace::Clock::time_point())
+        {
+            return;
+        }
+        group[stage].record(to - from);
+        if (game != nullptr)
+        {
+            (*game)[stage].record(to - from);
+        }
+    }
+}
+
+std::atomic<bool> RequestLatency::dumpRequested = false;
+
+std::string_view latencyStageName(LatencyStage stage)
+{
+    switch (stage)
+    {
+    case LatencyStage::PARSE:
+        return "parse";
+    case LatencyStage::QUEUE:
+        return "queue";
+    case LatencyStage::HANDLE:
+        return "handle";
+    case LatencyStage::SERIALIZE:
+        return "serialize";
+    case LatencyStage::SEND:
+        return "send";
+    default:
+        return "total";
+    }
+}
+
+RequestLatency &RequestLatency::instance()
+{
+    static RequestLatency latency;
+    return latency;
+}
+
+LatencyGroup &RequestLatency::forAction(MessageType action)
+{
+    return actions[actionIndex(action)];
+}
+
+LatencyGroup &RequestLatency::forGame(std::string_view gameName)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &[name, group] : gameNames)
+    {
+        if (name == gameName)
+        {
+            return *group;
+        }
+    }
+    LatencyGroup &group = games.emplace_back();
+    gameNames.emplace_back(std::string(gameName), &group);
+    return group;
+}
+
+void RequestLatency::record(const LatencyTrace &trace, LatencyTrace::Clock::time_point sentAt)
+{
+    if (!trace.isSet())
+    {
+        return;
+    }
+
+    LatencyGroup &action = forAction(trace.action);
+    recordStage(action, trace.game, LatencyStage::PARSE, trace.receivedAt, trace.parsedAt);
+    recordStage(action, trace.game, LatencyStage::QUEUE, trace.parsedAt, trace.handleStartedAt);
+    recordStage(action, trace.game, LatencyStage::HANDLE, trace.handleStartedAt, trace.handledAt);
+    recordStage(action, trace.game, LatencyStage::SERIALIZE, trace.handledAt, trace.serializedAt);
+    recordStage(action, trace.game, LatencyStage::SEND, trace.serializedAt, sentAt);
+    recordStage(action, trace.game, LatencyStage::TOTAL, trace.receivedAt, sentAt);
+}
+
+std::string RequestLatency::report() const
+{
+    std::string out = "# kind name stage count p50_us p90_us p99_us p999_us\n";
+    for (size_t i = 0; i <= OTHER_ACTIONS; i++)
+    {
+        appendGroup(out, "action", REPORTED_ACTIONS[i].name, actions[i]);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &[name, group] : gameNames)
+    {
+        appendGroup(out, "game", name, *group);
+    }
+    return out;
+}
+
+void RequestLatency::requestDump() noexcept
+{
+    dumpRequested = true;
+}
+
+bool RequestLatency::takeDumpRequest() noexcept
+{
+    return dumpRequested.exchange(false);
+}
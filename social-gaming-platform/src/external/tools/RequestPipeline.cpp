@@ -0,0 +1,122 @@
+/**
+ * RequestPipeline.cpp
+ */
+#include "RequestPipeline.h"
+
+PreparationPool::PreparationPool(size_t threadCount)
+{
+    for (size_t i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back([this]()
+                             { work(); });
+    }
+}
+
+PreparationPool::~PreparationPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    available.notify_all();
+    threads.clear();
+}
+
+void PreparationPool::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    available.notify_one();
+}
+
+void PreparationPool::work()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this]()
+                           { return stopping || !jobs.empty(); });
+            if (stopping)
+            {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+
+RequestPipeline::RequestPipeline(PreparationPool &pool, logic::GameDefinitionCache &gameCache)
+    : pool(pool), gameCache(gameCache)
+{
+}
+
+bool RequestPipeline::defer(Request &request)
+{
+    // Only reading and parsing a game file is slow enough to be worth it
+    if (request.action != MessageType::NEW_GAME || !gameCache.needsLoading(request.body))
+    {
+        return false;
+    }
+
+    inFlightCount++;
+    clients[request.client.id].inFlight++;
+
+    pool.submit([&gameCache = gameCache, completions = completions, request = std::move(request)]() mutable
+                {
+                    // Handling the request finds the game cached, or the error to report
+                    gameCache.reload(request.body);
+
+                    std::lock_guard<std::mutex> lock(completions->mutex);
+                    completions->prepared.push_back(std::move(request)); });
+    return true;
+}
+
+std::vector<Request> RequestPipeline::takePrepared()
+{
+    std::vector<Request> prepared;
+    if (inFlightCount == 0)
+    {
+        return prepared;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(completions->mutex);
+        prepared.swap(completions->prepared);
+    }
+    inFlightCount -= prepared.size();
+
+    size_t kept = 0;
+    for (auto &request : prepared)
+    {
+        auto client = clients.find(request.client.id);
+        bool forgotten = client->second.forgotten;
+        if (--client->second.inFlight == 0)
+        {
+            clients.erase(client);
+        }
+
+        if (!forgotten)
+        {
+            prepared[kept++] = std::move(request);
+        }
+    }
+    prepared.erase(prepared.begin() + kept, prepared.end());
+    return prepared;
+}
+
+void RequestPipeline::forgetClient(uintptr_t clientID)
+{
+    auto client = clients.find(clientID);
+    if (client != clients.end())
+    {
+        client->second.forgotten = true;
+    }
+}
@@ -0,0 +1,584 @@
+/**
+ * RequestScanner.cpp
+ */
+#include "RequestScanner.h"
+#include "Utf8.h"
+
+#include <cstdint>
+
+namespace
+{
+    // Deeper nesting in a member no request uses is refused rather than recursed into
+    const size_t MAX_NESTING_DEPTH = 256;
+
+    int hexValue(char character)
+    {
+        if (character >= '0' && character <= '9')
+        {
+            return character - '0';
+        }
+        if (character >= 'a' && character <= 'f')
+        {
+            return character - 'a' + 10;
+        }
+        if (character >= 'A' && character <= 'F')
+        {
+            return character - 'A' + 10;
+        }
+        return -1;
+    }
+
+    // Code unit of a \uXXXX escape at text, -1 when it is not one
+    int32_t unicodeEscape(std::string_view text)
+    {
+        if (text.size() < 6 || text[0] != '\\' || text[1] != 'u')
+        {
+            return -1;
+        }
+        int32_t unit = 0;
+        for (size_t i = 2; i < 6; i++)
+        {
+            int digit = hexValue(text[i]);
+            if (digit < 0)
+            {
+                return -1;
+            }
+            unit = unit * 16 + digit;
+        }
+        return unit;
+    }
+
+    void appendUtf8(std::string &out, uint32_t codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            out.push_back(static_cast<char>(codePoint));
+        }
+        else if (codePoint < 0x800)
+        {
+            out.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+        else if (codePoint < 0x10000)
+        {
+            out.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+        else
+        {
+            out.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+    }
+
+    class Scanner
+    {
+    public:
+        explicit Scanner(std::string_view text) : text(text) {}
+
+        std::expected<ScannedRequest, std::string> scan()
+        {
+            ScannedRequest request;
+            skipWhitespace();
+            bool scanned = peek() == '{' ? scanRequestObject(request) : skipValue(0);
+            if (!scanned)
+            {
+                return std::unexpected(error);
+            }
+
+            if (!scanEnd())
+            {
+                return std::unexpected(error);
+            }
+            return request;
+        }
+
+        std::expected<std::vector<ScannedRequest>, std::string> scanBatch()
+        {
+            std::vector<ScannedRequest> requests;
+            skipWhitespace();
+            if (!expect('['))
+            {
+                return std::unexpected(error);
+            }
+
+            while (true)
+            {
+                skipWhitespace();
+                if (peek() != '{')
+                {
+                    fail("batch item is not a request");
+                    return std::unexpected(error);
+                }
+                if (requests.size() == MAX_BATCH_REQUESTS)
+                {
+                    fail("batch has too many requests");
+                    return std::unexpected(error);
+                }
+                if (!scanRequestObject(requests.emplace_back()))
+                {
+                    return std::unexpected(error);
+                }
+
+                skipWhitespace();
+                if (peek() == ',')
+                {
+                    position++;
+                    continue;
+                }
+                if (!expect(']') || !scanEnd())
+                {
+                    return std::unexpected(error);
+                }
+                return requests;
+            }
+        }
+
+    private:
+        std::string_view text;
+        size_t position = 0;
+        std::string error;
+
+        char peek() const { return position < text.size() ? text[position] : '\0'; };
+
+        bool fail(const char *reason)
+        {
+            error = std::string(reason) + " at offset " + std::to_string(position);
+            return false;
+        }
+
+        bool scanEnd()
+        {
+            skipWhitespace();
+            if (position != text.size())
+            {
+                return fail("unexpected text after the message");
+            }
+            return true;
+        }
+
+        bool expect(char character)
+        {
+            if (peek() != character)
+            {
+                return fail("unexpected character");
+            }
+            position++;
+            return true;
+        }
+
+        void skipWhitespace()
+        {
+            while (position < text.size())
+            {
+                char character = text[position];
+                if (character != ' ' && character != '\n' && character != '\r' && character != '\t')
+                {
+                    return;
+                }
+                position++;
+            }
+        }
+
+        std::optional<ScannedString> *fieldNamed(ScannedRequest &request, std::string_view name)
+        {
+            if (name == "action")
+            {
+                return &request.action;
+            }
+            if (name == "body")
+            {
+                return &request.body;
+            }
+            if (name == "sessionID")
+            {
+                return &request.sessionId;
+            }
+            if (name == "request_id")
+            {
+                return &request.requestId;
+            }
+            if (name == "target_var")
+            {
+                return &request.targetVar;
+            }
+            return nullptr;
+        }
+
+        bool scanRequestObject(ScannedRequest &request)
+        {
+            position++;
+            skipWhitespace();
+            if (peek() == '}')
+            {
+                position++;
+                return true;
+            }
+
+            while (true)
+            {
+                skipWhitespace();
+                ScannedString key;
+                if (!scanString(key))
+                {
+                    return false;
+                }
+                skipWhitespace();
+                if (!expect(':'))
+                {
+                    return false;
+                }
+                skipWhitespace();
+
+                // A repeated member replaces the earlier one, as in a parsed document
+                std::string decodedKey;
+                std::string_view name = key.raw;
+                if (key.escaped)
+                {
+                    decodedKey = key.decoded();
+                    name = decodedKey;
+                }
+                auto *field = fieldNamed(request, name);
+                if (field != nullptr)
+                {
+                    if (peek() != '"')
+                    {
+                        return fail("request field is not a string");
+                    }
+                    ScannedString value;
+                    if (!scanString(value))
+                    {
+                        return false;
+                    }
+                    *field = value;
+                }
+                else if (!skipValue(1))
+                {
+                    return false;
+                }
+
+                skipWhitespace();
+                if (peek() == ',')
+                {
+                    position++;
+                    continue;
+                }
+                return expect('}');
+            }
+        }
+
+        bool skipValue(size_t depth)
+        {
+            if (depth > MAX_NESTING_DEPTH)
+            {
+                return fail("nested too deeply");
+            }
+
+            switch (peek())
+            {
+            case '{':
+                return skipContainer('}', true, depth);
+            case '[':
+                return skipContainer(']', false, depth);
+            case '"':
+            {
+                ScannedString ignored;
+                return scanString(ignored);
+            }
+            case 't':
+                return skipLiteral("true");
+            case 'f':
+                return skipLiteral("false");
+            case 'n':
+                return skipLiteral("null");
+            default:
+                return skipNumber();
+            }
+        }
+
+        bool skipContainer(char close, bool isObject, size_t depth)
+        {
+            position++;
+            skipWhitespace();
+            if (peek() == close)
+            {
+                position++;
+                return true;
+            }
+
+            while (true)
+            {
+                skipWhitespace();
+                if (isObject)
+                {
+                    ScannedString key;
+                    if (!scanString(key))
+                    {
+                        return false;
+                    }
+                    skipWhitespace();
+                    if (!expect(':'))
+                    {
+                        return false;
+                    }
+                    skipWhitespace();
+                }
+                if (!skipValue(depth + 1))
+                {
+                    return false;
+                }
+
+                skipWhitespace();
+                if (peek() == ',')
+                {
+                    position++;
+                    continue;
+                }
+                return expect(close);
+            }
+        }
+
+        bool skipLiteral(std::string_view literal)
+        {
+            if (text.substr(position, literal.size()) != literal)
+            {
+                return fail("invalid literal");
+            }
+            position += literal.size();
+            return true;
+        }
+
+        bool skipDigits()
+        {
+            size_t start = position;
+            while (peek() >= '0' && peek() <= '9')
+            {
+                position++;
+            }
+            return position > start;
+        }
+
+        bool skipNumber()
+        {
+            if (peek() == '-')
+            {
+                position++;
+            }
+            if (peek() == '0')
+            {
+                position++;
+            }
+            else if (!skipDigits())
+            {
+                return fail("invalid value");
+            }
+
+            if (peek() == '.')
+            {
+                position++;
+                if (!skipDigits())
+                {
+                    return fail("invalid number");
+                }
+            }
+            if (peek() == 'e' || peek() == 'E')
+            {
+                position++;
+                if (peek() == '+' || peek() == '-')
+                {
+                    position++;
+                }
+                if (!skipDigits())
+                {
+                    return fail("invalid number");
+                }
+            }
+            return true;
+        }
+
+        bool scanString(ScannedString &out)
+        {
+            if (!expect('"'))
+            {
+                return false;
+            }
+
+            size_t start = position;
+            while (position < text.size())
+            {
+                auto character = static_cast<unsigned char>(text[position]);
+                if (character == '"')
+                {
+                    out.raw = text.substr(start, position - start);
+                    position++;
+                    return true;
+                }
+                if (character == '\\')
+                {
+                    out.escaped = true;
+                    if (!skipEscape())
+                    {
+                        return false;
+                    }
+                }
+                else if (character < 0x20)
+                {
+                    return fail("control character in string");
+                }
+                else if (character >= 0x80)
+                {
+                    if (!skipUtf8())
+                    {
+                        return false;
+                    }
+                }
+                else
+                {
+                    position++;
+                }
+            }
+            return fail("unterminated string");
+        }
+
+        bool skipEscape()
+        {
+            if (position + 1 >= text.size())
+            {
+                return fail("unterminated string");
+            }
+
+            switch (text[position + 1])
+            {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                position += 2;
+                return true;
+            case 'u':
+                break;
+            default:
+                return fail("invalid escape");
+            }
+
+            // Surrogates only come in pairs
+            int32_t unit = unicodeEscape(text.substr(position));
+            if (unit < 0 || (unit >= 0xDC00 && unit <= 0xDFFF))
+            {
+                return fail("invalid unicode escape");
+            }
+            position += 6;
+            if (unit >= 0xD800 && unit <= 0xDBFF)
+            {
+                int32_t low = unicodeEscape(text.substr(position));
+                if (low < 0xDC00 || low > 0xDFFF)
+                {
+                    return fail("invalid unicode escape");
+                }
+                position += 6;
+            }
+            return true;
+        }
+
+        bool skipUtf8()
+        {
+            size_t length = utf8SequenceLength(text.substr(position));
+            if (length == 0)
+            {
+                return fail("invalid UTF-8");
+            }
+            position += length;
+            return true;
+        }
+    };
+}
+
+void ScannedString::assignTo(std::string &out) const
+{
+    if (!escaped)
+    {
+        out.assign(raw);
+        return;
+    }
+
+    // Escapes were validated by the scan
+    out.clear();
+    out.reserve(raw.size());
+    for (size_t i = 0; i < raw.size(); i++)
+    {
+        // Copy up to the next escape in one go
+        size_t escapeAt = raw.find('\\', i);
+        out.append(raw.substr(i, escapeAt - i));
+        if (escapeAt == std::string_view::npos)
+        {
+            break;
+        }
+        i = escapeAt;
+
+        char escape = raw[++i];
+        switch (escape)
+        {
+        case 'b':
+            out.push_back('\b');
+            break;
+        case 'f':
+            out.push_back('\f');
+            break;
+        case 'n':
+            out.push_back('\n');
+            break;
+        case 'r':
+            out.push_back('\r');
+            break;
+        case 't':
+            out.push_back('\t');
+            break;
+        case 'u':
+        {
+            uint32_t codePoint = unicodeEscape(raw.substr(i - 1));
+            i += 4;
+            if (codePoint >= 0xD800 && codePoint <= 0xDBFF)
+            {
+                uint32_t low = unicodeEscape(raw.substr(i + 1));
+                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                i += 6;
+            }
+            appendUtf8(out, codePoint);
+            break;
+        }
+        default:
+            out.push_back(escape);
+            break;
+        }
+    }
+}
+
+std::string ScannedString::decoded() const
+{
+    std::string out;
+    assignTo(out);
+    return out;
+}
+
+std::expected<ScannedRequest, std::string> scanRequest(std::string_view message)
+{
+    return Scanner(message).scan();
+}
+
+bool isRequestBatch(std::string_view message)
+{
+    size_t start = message.find_first_not_of(" \n\r\t");
+    return start != std::string_view::npos && message[start] == '[';
+}
+
+std::expected<std::vector<ScannedRequest>, std::string> scanRequestBatch(std::string_view message)
+{
+    return Scanner(message).scanBatch();
+}
@@ -1,45 +1,126 @@
 #include "Response.h"
-#include <nlohmann/json.hpp>
+#include "Utf8.h"
 
-using json = nlohmann::json;
+#include <charconv>
+
+namespace {
+    const char HEX_DIGITS[] = "0123456789abcdef";
+
+    //append text as a JSON string, invalid UTF-8 is replaced by U+FFFD
+    void appendString(std::string& out, std::string_view text) {
+        out.push_back('"');
+        size_t plain = 0;
+        for (size_t i = 0; i < text.size();) {
+            auto character = static_cast<unsigned char>(text[i]);
+            if (character >= 0x20 && character != '"' && character != '\\' && character < 0x80) {
+                i++;
+                continue;
+            }
+
+            size_t length = character >= 0x80 ? utf8SequenceLength(text.substr(i)) : 0;
+            if (length > 0) {
+                i += length;
+                continue;
+            }
+
+            //copy the plain run before the character in one go
+            out.append(text.substr(plain, i - plain));
+            switch (character) {
+                case '"': out.append("\\\""); break;
+                case '\\': out.append("\\\\"); break;
+                case '\b': out.append("\\b"); break;
+                case '\f': out.append("\\f"); break;
+                case '\n': out.append("\\n"); break;
+                case '\r': out.append("\\r"); break;
+                case '\t': out.append("\\t"); break;
+                default:
+                    if (character < 0x20) {
+                        out.append("\\u00");
+                        out.push_back(HEX_DIGITS[character >> 4]);
+                        out.push_back(HEX_DIGITS[character & 0xF]);
+                    } else {
+                        out.append("\xEF\xBF\xBD");
+                    }
+                    break;
+            }
+            plain = ++i;
+        }
+        out.append(text.substr(plain));
+        out.push_back('"');
+    }
+
+    template <typename T>
+    void appendNumber(std::string& out, T value) {
+        char digits[24];
+        auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, end - digits);
+    }
+}
 
 
 std::string serializeResponse(const Response& response) {
+    std::string out;
+    serializeResponse(response, out);
+    return out;
+}
 
-    //std::visit uses correct variant of response
-    return std::visit([](const auto& res) -> std::string {
-        json jsonResponse;
+void serializeResponse(const Response& response, std::string& out) {
+    out.clear();
 
-        //First assign common attributes
+    //std::visit uses correct variant of response
+    std::visit([&out](const auto& res) {
+        //Members are written in key order, the same output as a serialized JSON object
         const auto& common = res.common;
-        jsonResponse["game_session_id"] = common.gameSessionId;
-        jsonResponse["message"] = common.message;
-        jsonResponse["type"] = static_cast<int>(common.type);
+        out.push_back('{');
 
         //Optional attributes
         if (!common.clientIds.empty()) {
-            jsonResponse["client_ids"] = common.clientIds;
-        }
-        if (common.success.has_value()) {
-            jsonResponse["success"] = common.success.value();
+            out.append("\"client_ids\":[");
+            for (size_t i = 0; i < common.clientIds.size(); i++) {
+                if (i > 0) {
+                    out.push_back(',');
+                }
+                appendNumber(out, common.clientIds[i]);
+            }
+            out.append("],");
         }
+
+        out.append("\"game_session_id\":");
+        appendString(out, common.gameSessionId);
+        out.append(",\"message\":");
+        appendString(out, common.message);
+
         if (common.requestId.has_value()) {
-            jsonResponse["request_id"] = common.requestId.value();
+            out.append(",\"request_id\":");
+            appendString(out, common.requestId.value());
+        }
+        if (common.success.has_value()) {
+            out.append(common.success.value() ? ",\"success\":true" : ",\"success\":false");
         }
 
         //Now check to see type of variant at compile time to assign more attributes
         using T = std::decay_t<decltype(res)>;
         if constexpr (std::is_same_v<T, InputResponse>){
             //Extra attributes from InputResponse
-            jsonResponse["target_var"] = res.targetVar;
+            out.append(",\"target_var\":");
+            appendString(out, res.targetVar);
             if (res.timeout.has_value()) {
-                jsonResponse["timeout"] = res.timeout.value();
+                out.append(",\"timeout\":");
+                appendNumber(out, res.timeout.value());
             }
         } else if constexpr (std::is_same_v<T, MessageResponse>){
             //no extra attributes from MessageResponse
         }
-        return jsonResponse.dump();
+
+        out.append(",\"type\":");
+        appendNumber(out, static_cast<int>(common.type));
+        out.push_back('}');
 
     }, response);
+}
 
-}
\ No newline at end of file
+std::string_view serializeResponseToBuffer(const Response& response) {
+    thread_local std::string buffer;
+    serializeResponse(response, buffer);
+    return buffer;
+}
@@ -0,0 +1,323 @@
+/**
+ * ResponseRouting.cpp
+ */
+#include "ResponseRouting.h"
+#include "WireCodec.h"
+#include "data/logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <unordered_set>
+
+namespace
+{
+    /**
+     * Strings and payloads of the responses one thread routes, reused once
+     * every queue holding them let go, so routing does not allocate for the
+     * text of a response after the first ones.
+     */
+    class PayloadPool
+    {
+    public:
+        PayloadPool()
+        {
+            spare.reserve(MAX_SPARE);
+            payloads.reserve(MAX_PAYLOADS);
+        }
+
+        // An empty string keeping the capacity of a text routed before
+        std::string takeBuffer()
+        {
+            if (spare.empty())
+            {
+                return {};
+            }
+            std::string buffer = std::move(spare.back());
+            spare.pop_back();
+            return buffer;
+        }
+
+        // Payload holding the text, one no recipient holds anymore when there is one
+        SharedPayload share(std::string &&text)
+        {
+            // Payloads are let go of about in the order they were sent, so look from the oldest
+            for (size_t looked = 0; looked < std::min(payloads.size(), MAX_LOOKED); looked++)
+            {
+                auto &payload = payloads[next];
+                next = (next + 1) % payloads.size();
+                if (payload.use_count() == 1)
+                {
+                    // Orders the last holder's reads of the text before it is replaced
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    payload->swap(text);
+                    recycle(std::move(text));
+                    return payload;
+                }
+            }
+
+            auto payload = std::make_shared<std::string>(std::move(text));
+            if (payloads.size() < MAX_PAYLOADS)
+            {
+                payloads.push_back(payload);
+            }
+            return payload;
+        }
+
+    private:
+        static constexpr size_t MAX_SPARE = 64;
+        static constexpr size_t MAX_PAYLOADS = 1024;
+        static constexpr size_t MAX_LOOKED = 8;
+        static constexpr size_t MAX_KEPT_BYTES = 64 * 1024;
+
+        std::vector<std::string> spare;
+        std::vector<std::shared_ptr<std::string>> payloads;
+        size_t next = 0;
+
+        void recycle(std::string &&buffer)
+        {
+            // Room for an unusually large response is given back rather than kept
+            if (spare.size() < MAX_SPARE && buffer.capacity() <= MAX_KEPT_BYTES)
+            {
+                buffer.clear();
+                spare.push_back(std::move(buffer));
+            }
+        }
+    };
+
+    thread_local PayloadPool payloadPool;
+}
+
+Broadcast
+buildBroadcast(SharedPayload payload,
+               const std::expected<Session *, std::string_view> &sessionResult,
+               const std::vector<uintptr_t> &clientIDs)
+{
+    // Recipients of the payload
+    Broadcast broadcast{std::move(payload), {}};
+
+    try
+    {
+        // If player is in a session
+        if (sessionResult.has_value())
+        {
+            Session *session = sessionResult.value();
+            const auto &players = session->getPlayers();
+
+            // If clientIDs was provided in response, only send to them
+            if (!clientIDs.empty())
+            {
+                const std::unordered_set<uintptr_t> named(clientIDs.begin(), clientIDs.end());
+                for (const auto &client : players)
+                {
+                    // If client in session is found in provided list, send to them
+                    if (named.contains(client.getId()))
+                    {
+                        broadcast.recipients.push_back(client.getConnection());
+                    }
+                }
+            }
+            else
+            {
+                // Otherwise send to all in session
+                broadcast.recipients.reserve(players.size());
+                for (const auto &client : players)
+                {
+                    broadcast.recipients.push_back(client.getConnection());
+                }
+            }
+
+            // Player is not in a session
+        }
+        else
+        {
+            if (!clientIDs.empty())
+            {
+                for (const auto &clientID : clientIDs)
+                {
+                    // Assuming clientID is the connection ID for the user
+                    broadcast.recipients.push_back(Connection{clientID});
+                }
+            }
+            else
+            {
+                // If no clientIDs are provided, log an error
+                LOG_WARNING("server", "response has no recipients, sender is not in a session and no client ids were given");
+            }
+        }
+    }
+    catch (const std::runtime_error &e)
+    {
+        LOG_ERROR("server", "no players found in session", {{"error", e.what()}});
+    }
+
+    return broadcast;
+}
+
+std::deque<Message>
+buildOutgoing(const std::string &log,
+              const std::expected<Session *, std::string_view> &sessionResult,
+              const std::vector<uintptr_t> &clientIDs)
+{
+    std::deque<Broadcast> broadcasts;
+    broadcasts.push_back(buildBroadcast(std::make_shared<const std::string>(log), sessionResult, clientIDs));
+
+    std::deque<Message> outgoing;
+    appendMessages(broadcasts, outgoing);
+    return outgoing;
+}
+
+uint64_t supersedeKeyOf(const Response &response)
+{
+    const CommonResponse &common = std::visit([](const auto &resp) -> const CommonResponse &
+                                              { return resp.common; }, response);
+
+    // Scores are snapshots of the game, only the latest one matters
+    if (common.type != MessageType::SCORE)
+    {
+        return 0;
+    }
+
+    uint64_t key = std::hash<std::string>{}(common.gameSessionId) * 31 + static_cast<uint64_t>(common.type);
+    return key == 0 ? 1 : key;
+}
+
+MessageResult messageResultOf(uintptr_t senderID, Response &&response, bool compact)
+{
+    uint64_t supersedeKey = supersedeKeyOf(response);
+    std::string_view serialized = serializeResponseToBuffer(response);
+
+    MessageResult result{payloadPool.takeBuffer(), false, {}, false, senderID, supersedeKey};
+    result.result.assign(serialized);
+    if (compact)
+    {
+        result.compact = payloadPool.takeBuffer();
+        encodeCompactResponse(response, result.compact);
+    }
+
+    CommonResponse &common = std::visit([](auto &resp) -> CommonResponse &
+                                        { return resp.common; }, response);
+    result.sendToClientIDs = std::move(common.clientIds);
+    result.toAudience = common.toAudience;
+    return result;
+}
+
+namespace
+{
+    const char BATCH_ERROR_MESSAGE[] = "Error processing request";
+
+    /**
+     * Every reply of a batch goes back to its sender in one frame, a JSON array
+     * in the order of the requests. Replies reaching other clients too are
+     * still delivered to them one by one.
+     */
+    void routeBatch(SessionManager &sessionManager, MessageResult &&result, std::deque<Broadcast> &outgoing)
+    {
+        std::string frame = payloadPool.takeBuffer();
+        frame += "[";
+        for (const auto &item : result.batchItems)
+        {
+            if (!item.result.empty())
+            {
+                frame += frame.size() > 1 ? "," : "";
+                frame += item.result;
+            }
+        }
+        frame += "]";
+        outgoing.push_back(Broadcast{payloadPool.share(std::move(frame)), {Connection{result.senderID}}});
+
+        for (auto &item : result.batchItems)
+        {
+            std::deque<Broadcast> routed;
+            routeResult(sessionManager, std::move(item), routed);
+            for (auto &broadcast : routed)
+            {
+                std::erase_if(broadcast.recipients, [&result](const Connection &recipient)
+                              { return recipient.id == result.senderID; });
+                if (!broadcast.recipients.empty())
+                {
+                    outgoing.push_back(std::move(broadcast));
+                }
+            }
+        }
+    }
+}
+
+MessageResult batchResultOf(Request &batch, const std::function<MessageResult(Request &)> &handle)
+{
+    MessageResult result{"", false, {}, false, batch.client.id};
+    result.batchItems.reserve(batch.batch.size());
+
+    for (auto &request : batch.batch)
+    {
+        try
+        {
+            result.batchItems.push_back(handle(request));
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR("server", "exception processing batched request", {{"client", request.client.id}, {"error", e.what()}});
+            Response error = MessageResponse(CommonResponse("N/A", BATCH_ERROR_MESSAGE, MessageType::MESSAGE,
+                                                            {request.client.id}, false, request.requestId));
+            result.batchItems.push_back(messageResultOf(request.client.id, std::move(error)));
+        }
+    }
+    return result;
+}
+
+void routeResult(SessionManager &sessionManager, MessageResult result, std::deque<Broadcast> &outgoing)
+{
+    if (!result.batchItems.empty())
+    {
+        routeBatch(sessionManager, std::move(result), outgoing);
+        return;
+    }
+
+    if (result.result.empty())
+    {
+        return;
+    }
+
+    try
+    {
+        // Find if player has session
+        auto sessionResult = sessionManager.findSessionByPlayer(result.senderID);
+
+        // Serialized once, whatever the number of recipients
+        Broadcast broadcast = buildBroadcast(payloadPool.share(std::move(result.result)), sessionResult, result.sendToClientIDs);
+
+        // Spectators share the payload serialized for the players
+        if (result.toAudience && sessionResult.has_value())
+        {
+            const auto &members = sessionResult.value()->getAudience().getMembers();
+            broadcast.recipients.insert(broadcast.recipients.end(), members.begin(), members.end());
+        }
+
+        broadcast.supersedeKey = result.supersedeKey;
+        broadcast.trace = result.trace;
+        if (!result.compact.empty())
+        {
+            broadcast.compactPayload = payloadPool.share(std::move(result.compact));
+        }
+        if (!broadcast.recipients.empty())
+        {
+            outgoing.push_back(std::move(broadcast));
+        }
+    }
+    catch (const std::runtime_error &e)
+    {
+        LOG_ERROR("server", "unable to route response", {{"client", result.senderID}, {"error", e.what()}});
+    }
+}
+
+void appendMessages(const std::deque<Broadcast> &broadcasts, std::deque<Message> &outgoing)
+{
+    // The networking library owns the text of every message it sends
+    for (const auto &broadcast : broadcasts)
+    {
+        for (const auto &recipient : broadcast.recipients)
+        {
+            outgoing.push_back(Message{recipient, *broadcast.payload});
+        }
+    }
+}
@@ -0,0 +1,211 @@
+/**
+ * ServerMetrics.cpp
+ */
+#include "ServerMetrics.h"
+#include "RequestLatency.h"
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+    // How often the listener checks whether it was asked to stop
+    const int ACCEPT_POLL_MILLIS = 100;
+
+    const size_t MAX_REQUEST_SIZE = 4096;
+
+    std::string shardLabel(unsigned shard)
+    {
+        return "shard=\"" + std::to_string(shard) + "\"";
+    }
+
+    void writeAll(int socket, std::string_view data)
+    {
+        while (!data.empty())
+        {
+            ssize_t written = send(socket, data.data(), data.size(), MSG_NOSIGNAL);
+            if (written <= 0)
+            {
+                return;
+            }
+            data.remove_prefix(written);
+        }
+    }
+}
+
+ShardMetrics::ShardMetrics(unsigned shard)
+    : sessions(MetricsRegistry::instance().gauge("game_sessions", "Live game sessions", shardLabel(shard))),
+      readyProcesses(MetricsRegistry::instance().gauge("scheduler_ready_processes", "Game processes ready to run", shardLabel(shard))),
+      waitingProcesses(MetricsRegistry::instance().gauge("scheduler_waiting_processes", "Game processes waiting for input or output", shardLabel(shard)))
+{
+}
+
+void ShardMetrics::publish(size_t sessionCount, size_t readyCount, size_t waitingCount) noexcept
+{
+    sessions.set(sessionCount);
+    readyProcesses.set(readyCount);
+    waitingProcesses.set(waitingCount);
+}
+
+NetworkMetrics::NetworkMetrics()
+    : clients(MetricsRegistry::instance().gauge("connected_clients", "Connected clients")),
+      pendingRequests(MetricsRegistry::instance().gauge("worker_pending_requests", "Requests waiting for a session worker")),
+      backloggedClients(MetricsRegistry::instance().gauge("outbound_backlogged_clients", "Clients with messages waiting to be sent")),
+      queuedMessages(MetricsRegistry::instance().gauge("outbound_queued_messages", "Messages waiting to be sent, over all clients")),
+      queuedBytes(MetricsRegistry::instance().gauge("outbound_queued_bytes", "Bytes waiting to be sent, over all clients")),
+      deepestQueueMessages(MetricsRegistry::instance().gauge("outbound_deepest_queue_messages", "Messages waiting for the client furthest behind")),
+      pausingClients(MetricsRegistry::instance().gauge("outbound_pausing_clients", "Clients holding their session paused")),
+      coalesced(MetricsRegistry::instance().counter("outbound_coalesced_total", "Queued messages replaced by newer state")),
+      dropped(MetricsRegistry::instance().counter("outbound_dropped_total", "Queued messages dropped by backpressure")),
+      disconnected(MetricsRegistry::instance().counter("outbound_disconnected_total", "Clients disconnected by backpressure")),
+      rateLimited(MetricsRegistry::instance().counter("requests_rate_limited_total", "Requests turned away by rate limits")),
+      shed(MetricsRegistry::instance().counter("requests_shed_total", "Requests turned away while the server was saturated")),
+      droppedLogRecords(MetricsRegistry::instance().counter("log_records_dropped_total", "Log records dropped because the log buffer was full"))
+{
+}
+
+void NetworkMetrics::publish(size_t clientCount, size_t pendingCount, const OutboundStats &outbound,
+                             const AdmissionStats &admission, uint64_t droppedLogs) noexcept
+{
+    clients.set(clientCount);
+    pendingRequests.set(pendingCount);
+    backloggedClients.set(outbound.backloggedClients);
+    queuedMessages.set(outbound.queuedMessages);
+    queuedBytes.set(outbound.queuedBytes);
+    deepestQueueMessages.set(outbound.deepestQueueMessages);
+    pausingClients.set(outbound.pausingClients);
+
+    coalesced.add(outbound.coalesced - lastOutbound.coalesced);
+    dropped.add(outbound.dropped - lastOutbound.dropped);
+    disconnected.add(outbound.disconnected - lastOutbound.disconnected);
+    rateLimited.add(admission.rateLimited - lastAdmission.rateLimited);
+    shed.add(admission.shed - lastAdmission.shed);
+    droppedLogRecords.add(droppedLogs - lastDroppedLogRecords);
+
+    lastOutbound = outbound;
+    lastAdmission = admission;
+    lastDroppedLogRecords = droppedLogs;
+}
+
+MetricsServer::MetricsServer(const MetricsRegistry &registry) : registry(registry)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+std::expected<void, std::string> MetricsServer::start(unsigned short requestedPort)
+{
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener == -1)
+    {
+        return std::unexpected(std::string("Unable to create metrics socket: ") + std::strerror(errno));
+    }
+
+    // A backend taking over from another binds the port while the old one still serves it
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    setsockopt(listener, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(requestedPort);
+
+    socklen_t length = sizeof(address);
+    if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == -1 ||
+        listen(listener, SOMAXCONN) == -1 ||
+        getsockname(listener, reinterpret_cast<sockaddr *>(&address), &length) == -1)
+    {
+        std::string error = std::strerror(errno);
+        close(listener);
+        listener = -1;
+        return std::unexpected("Unable to listen for metrics on port " + std::to_string(requestedPort) + ": " + error);
+    }
+    port = ntohs(address.sin_port);
+
+    thread = std::jthread([this](std::stop_token stopToken)
+                          { serve(stopToken); });
+    return {};
+}
+
+void MetricsServer::stop()
+{
+    if (thread.joinable())
+    {
+        thread.request_stop();
+        thread.join();
+    }
+    if (listener != -1)
+    {
+        close(listener);
+        listener = -1;
+    }
+}
+
+void MetricsServer::serve(std::stop_token stopToken)
+{
+    pollfd listening{listener, POLLIN, 0};
+    while (!stopToken.stop_requested())
+    {
+        if (poll(&listening, 1, ACCEPT_POLL_MILLIS) <= 0)
+        {
+            continue;
+        }
+
+        int client = accept(listener, nullptr, nullptr);
+        if (client == -1)
+        {
+            continue;
+        }
+
+        // A client that never sends its request does not hold the listener for long
+        timeval timeout{1, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        respond(client);
+        close(client);
+    }
+}
+
+void MetricsServer::respond(int client)
+{
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_SIZE)
+    {
+        ssize_t received = recv(client, buffer, sizeof(buffer), 0);
+        if (received <= 0)
+        {
+            break;
+        }
+        request.append(buffer, received);
+    }
+
+    std::string_view status = "404 Not Found";
+    std::string body = "Not found\n";
+    std::string_view contentType = "text/plain";
+
+    if (request.starts_with("GET /metrics ") || request.starts_with("GET /metrics?"))
+    {
+        status = "200 OK";
+        body = registry.render();
+        contentType = "text/plain; version=0.0.4";
+    }
+    else if (request.starts_with("GET /latency ") || request.starts_with("GET /latency?"))
+    {
+        status = "200 OK";
+        body = RequestLatency::instance().report();
+    }
+
+    std::string response = "HTTP/1.1 " + std::string(status) + "\r\n" +
+                           "Content-Type: " + std::string(contentType) + "\r\n" +
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n" +
+                           "Connection: close\r\n\r\n" + body;
+    writeAll(client, response);
+}
@@ -0,0 +1,387 @@
+/**
+ * SessionHandoff.cpp
+ */
+#include "SessionHandoff.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ShardLink.h"
+#include "data/encoding.h"
+#include "data/logger.h"
+
+namespace
+{
+    // More descriptors than any transport hands over means the message is not a handoff
+    const size_t MAX_DESCRIPTORS = 8;
+
+    const uint64_t MAX_HANDOFF_SIZE = uint64_t(4) << 30;
+
+    using encoding::get;
+    using encoding::getBytes;
+    using encoding::put;
+    using encoding::putBytes;
+
+    void setTimeouts(int socket, std::chrono::milliseconds timeout)
+    {
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+        timeval limit{static_cast<time_t>(seconds.count()),
+                      static_cast<suseconds_t>(std::chrono::duration_cast<std::chrono::microseconds>(timeout - seconds).count())};
+        setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &limit, sizeof(limit));
+        setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &limit, sizeof(limit));
+    }
+
+    std::string socketError(const std::string &what)
+    {
+        return what + ": " + (errno == EAGAIN || errno == EWOULDBLOCK ? "timed out" : std::strerror(errno));
+    }
+
+    void closeAll(const std::vector<int> &descriptors)
+    {
+        for (int fd : descriptors)
+        {
+            close(fd);
+        }
+    }
+
+    std::string encodeHandoff(const Handoff &handoff)
+    {
+        std::string body;
+        body.append(HANDOFF_MAGIC);
+        put<uint32_t>(body, HANDOFF_VERSION);
+        put<uint32_t>(body, handoff.transport.descriptors.size());
+        putBytes(body, handoff.transport.state);
+        put<uint32_t>(body, handoff.clients.size());
+        for (const auto &client : handoff.clients)
+        {
+            put<uint64_t>(body, client.id);
+            put<uint8_t>(body, static_cast<uint8_t>(client.wireFormat));
+        }
+        putBytes(body, handoff.sessions);
+
+        std::string message;
+        message.reserve(sizeof(uint64_t) + body.size());
+        put<uint64_t>(message, body.size());
+        message.append(body);
+        return message;
+    }
+
+    std::expected<void, std::string> decodeHandoff(std::string_view body, size_t descriptorCount, Handoff &handoff)
+    {
+        uint32_t version, descriptors, clientCount;
+        if (!body.starts_with(HANDOFF_MAGIC))
+        {
+            return std::unexpected("Not a handoff");
+        }
+        body.remove_prefix(HANDOFF_MAGIC.size());
+        if (!get(body, version))
+        {
+            return std::unexpected("Handoff is truncated");
+        }
+        if (version != HANDOFF_VERSION)
+        {
+            return std::unexpected("Unsupported handoff version " + std::to_string(version));
+        }
+        if (!get(body, descriptors) || descriptors != descriptorCount)
+        {
+            return std::unexpected("Handoff lost its sockets");
+        }
+        if (!getBytes(body, handoff.transport.state) || !get(body, clientCount))
+        {
+            return std::unexpected("Handoff is truncated");
+        }
+
+        // Each client is an id and a wire format, a count the body cannot hold is corrupt
+        if (clientCount > body.size() / (sizeof(uint64_t) + sizeof(uint8_t)))
+        {
+            return std::unexpected("Handoff is truncated");
+        }
+        handoff.clients.reserve(clientCount);
+        for (uint32_t i = 0; i < clientCount; i++)
+        {
+            uint64_t id;
+            uint8_t format;
+            if (!get(body, id) || !get(body, format))
+            {
+                return std::unexpected("Handoff is truncated");
+            }
+            handoff.clients.push_back(HandoffClient{id, format == static_cast<uint8_t>(WireFormat::COMPACT)
+                                                            ? WireFormat::COMPACT
+                                                            : WireFormat::JSON});
+        }
+
+        if (!getBytes(body, handoff.sessions))
+        {
+            return std::unexpected("Handoff is truncated");
+        }
+        return {};
+    }
+
+    bool sendAll(int socket, const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t sent = send(socket, data, size, MSG_NOSIGNAL);
+            if (sent == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            if (sent <= 0)
+            {
+                return false;
+            }
+            data += sent;
+            size -= sent;
+        }
+        return true;
+    }
+
+    bool receiveAll(int socket, char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t received = recv(socket, data, size, 0);
+            if (received == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            if (received == 0)
+            {
+                errno = ECONNRESET; // the peer closed the connection
+                return false;
+            }
+            if (received < 0)
+            {
+                return false;
+            }
+            data += received;
+            size -= received;
+        }
+        return true;
+    }
+}
+
+std::string handoffSocketPath(const std::string &shardSocket)
+{
+    return shardSocket + ".handoff";
+}
+
+std::expected<void, std::string> sendHandoff(int socket, const Handoff &handoff, std::chrono::milliseconds timeout)
+{
+    const auto &descriptors = handoff.transport.descriptors;
+    if (descriptors.empty() || descriptors.size() > MAX_DESCRIPTORS)
+    {
+        return std::unexpected("Handoff needs between 1 and " + std::to_string(MAX_DESCRIPTORS) + " sockets");
+    }
+    setTimeouts(socket, timeout);
+
+    const std::string message = encodeHandoff(handoff);
+
+    // The descriptors go with the first byte, the rest follows as plain data
+    iovec first{const_cast<char *>(message.data()), 1};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_DESCRIPTORS)] = {};
+    msghdr header{};
+    header.msg_iov = &first;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = CMSG_SPACE(sizeof(int) * descriptors.size());
+
+    cmsghdr *rights = CMSG_FIRSTHDR(&header);
+    rights->cmsg_level = SOL_SOCKET;
+    rights->cmsg_type = SCM_RIGHTS;
+    rights->cmsg_len = CMSG_LEN(sizeof(int) * descriptors.size());
+    std::memcpy(CMSG_DATA(rights), descriptors.data(), sizeof(int) * descriptors.size());
+
+    ssize_t sent;
+    do
+    {
+        sent = sendmsg(socket, &header, MSG_NOSIGNAL);
+    } while (sent == -1 && errno == EINTR);
+
+    if (sent != 1 || !sendAll(socket, message.data() + 1, message.size() - 1))
+    {
+        return std::unexpected(socketError("Unable to send the handoff"));
+    }
+    return {};
+}
+
+std::expected<Handoff, std::string> receiveHandoff(int socket, std::chrono::milliseconds timeout)
+{
+    setTimeouts(socket, timeout);
+
+    char lengthBytes[sizeof(uint64_t)];
+    iovec first{lengthBytes, 1};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_DESCRIPTORS)] = {};
+    msghdr header{};
+    header.msg_iov = &first;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+
+    ssize_t received;
+    do
+    {
+        received = recvmsg(socket, &header, MSG_CMSG_CLOEXEC);
+    } while (received == -1 && errno == EINTR);
+    if (received != 1)
+    {
+        return std::unexpected(received == 0 ? std::string("The serving process closed the handoff")
+                                             : socketError("Unable to receive the handoff"));
+    }
+
+    Handoff handoff;
+    for (cmsghdr *rights = CMSG_FIRSTHDR(&header); rights != nullptr; rights = CMSG_NXTHDR(&header, rights))
+    {
+        if (rights->cmsg_level == SOL_SOCKET && rights->cmsg_type == SCM_RIGHTS)
+        {
+            size_t count = (rights->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            handoff.transport.descriptors.resize(count);
+            std::memcpy(handoff.transport.descriptors.data(), CMSG_DATA(rights), sizeof(int) * count);
+        }
+    }
+
+    auto fail = [&handoff](std::string error) -> std::expected<Handoff, std::string>
+    {
+        closeAll(handoff.transport.descriptors);
+        return std::unexpected(std::move(error));
+    };
+
+    if ((header.msg_flags & MSG_CTRUNC) != 0)
+    {
+        return fail("Handoff carried too many sockets");
+    }
+
+    uint64_t length;
+    if (!receiveAll(socket, lengthBytes + 1, sizeof(lengthBytes) - 1))
+    {
+        return fail(socketError("Unable to receive the handoff"));
+    }
+    std::memcpy(&length, lengthBytes, sizeof(length));
+    if (length > MAX_HANDOFF_SIZE)
+    {
+        return fail("Handoff is too large");
+    }
+
+    std::string body(length, '\0');
+    if (!receiveAll(socket, body.data(), body.size()))
+    {
+        return fail(socketError("Unable to receive the handoff"));
+    }
+
+    auto decoded = decodeHandoff(body, handoff.transport.descriptors.size(), handoff);
+    if (!decoded.has_value())
+    {
+        return fail(decoded.error());
+    }
+    return handoff;
+}
+
+std::expected<int, std::string> connectForHandoff(const std::string &shardSocket)
+{
+    const std::string path = handoffSocketPath(shardSocket);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        return std::unexpected("Socket path is too long: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+    {
+        return std::unexpected(socketError("Unable to create socket"));
+    }
+    if (connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == -1)
+    {
+        std::string error = socketError("Unable to reach the serving process at " + path);
+        close(fd);
+        return std::unexpected(error);
+    }
+
+    return fd;
+}
+
+std::expected<void, std::string> confirmHandoff(int socket, std::chrono::milliseconds timeout)
+{
+    setTimeouts(socket, timeout);
+
+    char answer = 0;
+    if (!sendAll(socket, &HANDOFF_READY, 1) || !receiveAll(socket, &answer, 1))
+    {
+        return std::unexpected(socketError("The serving process did not let go"));
+    }
+    if (answer != HANDOFF_COMMIT)
+    {
+        return std::unexpected("The serving process did not let go");
+    }
+    return {};
+}
+
+std::expected<void, std::string> commitHandoff(int socket, std::chrono::milliseconds timeout)
+{
+    setTimeouts(socket, timeout);
+
+    char ready = 0;
+    if (!receiveAll(socket, &ready, 1))
+    {
+        return std::unexpected(socketError("The new process did not take over"));
+    }
+    if (ready != HANDOFF_READY)
+    {
+        return std::unexpected("The new process did not take over");
+    }
+    if (!sendAll(socket, &HANDOFF_COMMIT, 1))
+    {
+        return std::unexpected(socketError("The new process did not take over"));
+    }
+    return {};
+}
+
+/*
+ * HandoffListener
+ */
+
+std::expected<std::unique_ptr<HandoffListener>, std::string> HandoffListener::listen(const std::string &shardSocket)
+{
+    const std::string path = handoffSocketPath(shardSocket);
+    auto listener = listenOnUnixSocket(path);
+    if (!listener.has_value())
+    {
+        return std::unexpected(listener.error());
+    }
+    return std::unique_ptr<HandoffListener>(new HandoffListener(listener.value(), path));
+}
+
+HandoffListener::HandoffListener(int listener, std::string path) : listener(listener), path(std::move(path))
+{
+}
+
+HandoffListener::~HandoffListener()
+{
+    close(listener);
+    unlink(path.c_str());
+}
+
+int HandoffListener::accept()
+{
+    int fd = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    // Sessions only go to a process of the same user
+    ucred peer{};
+    socklen_t size = sizeof(peer);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &size) == -1 || peer.uid != geteuid())
+    {
+        LOG_WARNING("handoff", "refused a process of another user", {{"socket", path}, {"uid", peer.uid}});
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
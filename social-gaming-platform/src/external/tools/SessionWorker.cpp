@@ -0,0 +1,588 @@
+/**
+ * SessionWorker.cpp
+ */
+#include "SessionWorker.h"
+
+#include <algorithm>
+#include <iterator>
+#include <unistd.h>
+
+namespace
+{
+    const size_t WORKER_QUEUE_CAPACITY = 4096;
+
+    static_assert(SessionManager::MAX_SHARDS <= 64, "a client's workers are one bit each");
+}
+
+bool ClientSeats::claim(uintptr_t clientID, unsigned worker)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto [seat, inserted] = seats.try_emplace(clientID, worker);
+    if (inserted)
+    {
+        changes.emplace_back(clientID, true);
+    }
+    return seat->second == worker;
+}
+
+void ClientSeats::release(uintptr_t clientID, unsigned worker)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto seat = seats.find(clientID);
+    if (seat != seats.end() && seat->second == worker)
+    {
+        seats.erase(seat);
+        changes.emplace_back(clientID, false);
+    }
+}
+
+std::optional<unsigned> ClientSeats::workerOf(uintptr_t clientID) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto seat = seats.find(clientID);
+    if (seat == seats.end())
+    {
+        return std::nullopt;
+    }
+    return seat->second;
+}
+
+std::vector<std::pair<uintptr_t, bool>> ClientSeats::takeChanges()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::pair<uintptr_t, bool>> taken;
+    taken.swap(changes);
+    return taken;
+}
+
+SessionWorker::SessionWorker(unsigned index, unsigned workerCount, GameManager &gameManager,
+                             logic::GameDefinitionCache &gameCache, const ServerOptions &options,
+                             PreparationPool *preparationPool, ClientSeats *seats)
+    : index(index),
+      options(options),
+      sessionManager(options.shardIndex * workerCount + index, options.shardCount * workerCount),
+      requestHandler(sessionManager, gameManager, scheduler, gameCache),
+      inbox(WORKER_QUEUE_CAPACITY),
+      outbox(WORKER_QUEUE_CAPACITY),
+      queued(options.laneWeights),
+      pacer(options.minIdleWait, options.maxIdleWait),
+      metrics(index)
+{
+    if (preparationPool != nullptr)
+    {
+        pipeline = std::make_unique<RequestPipeline>(*preparationPool, gameCache);
+    }
+    if (seats != nullptr)
+    {
+        sessionManager.setMembershipCallbacks([seats, index](uintptr_t clientID)
+                                              { return seats->claim(clientID, index); },
+                                              [seats, index](uintptr_t clientID)
+                                              { seats->release(clientID, index); });
+    }
+}
+
+SessionWorker::~SessionWorker()
+{
+    stop();
+}
+
+void SessionWorker::start()
+{
+    if (!thread.joinable())
+    {
+        thread = std::jthread([this](std::stop_token stopToken)
+                              { run(stopToken); });
+    }
+}
+
+void SessionWorker::stop()
+{
+    if (thread.joinable())
+    {
+        thread.request_stop();
+        thread.join();
+    }
+}
+
+bool SessionWorker::submit(Request &request)
+{
+    return inbox.tryPush(std::move(request));
+}
+
+bool SessionWorker::drain(std::deque<Broadcast> &outgoing)
+{
+    bool drained = false;
+    while (auto message = outbox.tryPop())
+    {
+        outgoing.push_back(std::move(message.value()));
+        drained = true;
+    }
+    return drained;
+}
+
+void SessionWorker::run(std::stop_token stopToken)
+{
+    while (!stopToken.stop_requested())
+    {
+        try
+        {
+            while (auto request = inbox.tryPop())
+            {
+                auto received = request->receivedAt;
+                uintptr_t clientID = request->client.id;
+                queued.push(laneOf(request.value()), clientID, std::move(request.value()), received);
+            }
+            queuedCount.store(queued.size(), std::memory_order_relaxed);
+
+            // Game inputs first, what is over the budget waits while the games run
+            for (size_t handled = 0; handled < options.requestsPerUpdate; handled++)
+            {
+                auto request = queued.pop();
+                if (!request.has_value())
+                {
+                    break;
+                }
+                pacer.markActive();
+                queuedCount.store(queued.size(), std::memory_order_relaxed);
+                handle(request.value());
+            }
+
+            if (pipeline)
+            {
+                for (auto &request : pipeline->takePrepared())
+                {
+                    pacer.markActive();
+                    respond(request);
+                }
+            }
+
+            if (scheduler.hasReadyProcesses())
+            {
+                pacer.markActive();
+            }
+            scheduler.executeInParallel();
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR("worker", "exception in worker loop", {{"worker", index}, {"type", typeid(e).name()}, {"error", e.what()}});
+        }
+
+        flush();
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastMetricsPublish >= METRICS_PUBLISH_INTERVAL)
+        {
+            metrics.publish(sessionManager.getSessionCount(), scheduler.getReadyCount(), scheduler.getWaitingCount());
+            lastMetricsPublish = now;
+        }
+
+        auto deadline = std::chrono::steady_clock::time_point::max();
+        if (!options.checkpointPath.empty())
+        {
+            if (std::chrono::steady_clock::now() - lastCheckpoint >= options.checkpointInterval)
+            {
+                auto result = sessionManager.writeCheckpoint(checkpointPath(options.checkpointPath));
+                if (!result.has_value())
+                {
+                    LOG_ERROR("session", "checkpoint failed", {{"worker", index}, {"error", result.error()}});
+                }
+                lastCheckpoint = std::chrono::steady_clock::now();
+            }
+            deadline = lastCheckpoint + options.checkpointInterval;
+        }
+        deadline = std::min(deadline, scheduler.nextTimerDeadline());
+
+        // Keep spinning while replies are waiting for the network thread or requests in a lane
+        if (!unsent.empty() || !queued.empty())
+        {
+            pacer.markActive();
+        }
+        pacer.pace(deadline);
+    }
+}
+
+void SessionWorker::handle(Request &request)
+{
+    switch (request.action)
+    {
+    case MessageType::DISCONNECT:
+        sessionManager.removeClient(request.client.id);
+        if (pipeline)
+        {
+            pipeline->forgetClient(request.client.id);
+        }
+        return;
+    case MessageType::PAUSE_SESSION:
+        sessionManager.pauseSessionFor(request.client.id);
+        return;
+    case MessageType::RESUME_SESSION:
+        sessionManager.resumeSessionFor(request.client.id);
+        return;
+    default:
+        break;
+    }
+
+    // Answered once its game is loaded, later requests go on meanwhile
+    if (pipeline && pipeline->defer(request))
+    {
+        return;
+    }
+    respond(request);
+}
+
+void SessionWorker::respond(Request &request)
+{
+    auto resultOf = [this](Request &item)
+    {
+        MessageResult result = messageResultOf(item.client.id, requestHandler.handleRequest(item), options.compactProtocol);
+        result.trace = traceOf(item);
+        return result;
+    };
+
+    if (!request.batch.empty())
+    {
+        routeResult(sessionManager, batchResultOf(request, resultOf), unsent);
+        return;
+    }
+    routeResult(sessionManager, resultOf(request), unsent);
+}
+
+void SessionWorker::flush()
+{
+    while (!unsent.empty() && outbox.tryPush(std::move(unsent.front())))
+    {
+        unsent.pop_front();
+    }
+}
+
+std::string SessionWorker::checkpointPath(const std::string &path) const
+{
+    return path + "." + std::to_string(index);
+}
+
+std::expected<void, std::string> SessionWorker::checkpoint(const std::string &path)
+{
+    if (isRunning())
+    {
+        return std::unexpected("Worker is running");
+    }
+    return sessionManager.writeCheckpoint(checkpointPath(path));
+}
+
+std::expected<size_t, std::string> SessionWorker::restoreCheckpoint(const std::string &path)
+{
+    if (isRunning())
+    {
+        return std::unexpected("Worker is running");
+    }
+
+    const std::string workerPath = checkpointPath(path);
+    if (access(workerPath.c_str(), R_OK) == -1)
+    {
+        return 0;
+    }
+
+    sessionManager.setRestoreCallback([this](Session &session)
+                                      { return requestHandler.restoreProcess(session); });
+    return sessionManager.restoreFromCheckpoint(workerPath);
+}
+
+void SessionWorker::finish(std::deque<Request> &waiting, std::deque<Broadcast> &outgoing,
+                           std::chrono::steady_clock::time_point deadline)
+{
+    if (isRunning())
+    {
+        return;
+    }
+
+    auto enqueue = [this](Request &request)
+    {
+        auto received = request.receivedAt;
+        uintptr_t clientID = request.client.id;
+        queued.push(laneOf(request), clientID, std::move(request), received);
+    };
+    while (auto request = inbox.tryPop())
+    {
+        enqueue(request.value());
+    }
+    for (auto &request : waiting)
+    {
+        enqueue(request);
+    }
+    waiting.clear();
+
+    while (auto request = queued.pop())
+    {
+        handle(request.value());
+    }
+    queuedCount.store(0, std::memory_order_relaxed);
+
+    while (pipeline && pipeline->inFlight() > 0 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        for (auto &request : pipeline->takePrepared())
+        {
+            respond(request);
+        }
+    }
+
+    drain(outgoing);
+    std::move(unsent.begin(), unsent.end(), std::back_inserter(outgoing));
+    unsent.clear();
+}
+
+std::expected<void, std::string> SessionWorker::addToSnapshot(SnapshotBuilder &snapshot) const
+{
+    if (isRunning())
+    {
+        return std::unexpected("Worker is running");
+    }
+    sessionManager.addToSnapshot(snapshot);
+    return {};
+}
+
+std::expected<size_t, std::string> SessionWorker::restoreSnapshot(const SnapshotReader &snapshot)
+{
+    if (isRunning())
+    {
+        return std::unexpected("Worker is running");
+    }
+
+    sessionManager.setRestoreCallback([this](Session &session)
+                                      { return requestHandler.restoreProcess(session); });
+    return sessionManager.restoreSnapshot(snapshot);
+}
+
+
+unsigned WorkerPool::workerCountFor(const ServerOptions &options)
+{
+    return std::clamp(options.workerThreads, 1u, SessionManager::MAX_SHARDS / std::max(options.shardCount, 1u));
+}
+
+WorkerPool::WorkerPool(unsigned workerCount, GameManager &gameManager, logic::GameDefinitionCache &gameCache,
+                       const ServerOptions &options)
+{
+    ServerOptions requested = options;
+    requested.workerThreads = workerCount;
+    workerCount = workerCountFor(requested);
+    firstShard = options.shardIndex * workerCount;
+
+    if (options.preparationThreads > 0)
+    {
+        preparationPool = std::make_unique<PreparationPool>(options.preparationThreads);
+    }
+    for (unsigned i = 0; i < workerCount; i++)
+    {
+        workers.push_back(std::make_unique<SessionWorker>(i, workerCount, gameManager, gameCache, options,
+                                                          preparationPool.get(), &seats));
+    }
+    backlog.resize(workerCount);
+}
+
+void WorkerPool::start()
+{
+    for (auto &worker : workers)
+    {
+        worker->start();
+    }
+}
+
+void WorkerPool::stop()
+{
+    for (auto &worker : workers)
+    {
+        worker->stop();
+    }
+}
+
+unsigned WorkerPool::workerFor(const Request &dispatched)
+{
+    const Request &request = routingRequestOf(dispatched);
+
+    std::optional<unsigned> worker = seats.workerOf(request.client.id);
+    if (!worker.has_value() && (request.action == MessageType::JOIN || request.action == MessageType::JOIN_AUDIENCE))
+    {
+        auto shard = SessionManager::shardOfJoinCode(request.body, firstShard + workers.size());
+        if (shard.has_value() && shard.value() >= firstShard)
+        {
+            worker = shard.value() - firstShard;
+        }
+    }
+
+    // A join racing the client's first session elsewhere is refused by the claim on its seat
+    auto [client, inserted] = clientWorkers.try_emplace(request.client.id,
+                                                        ClientWorkers{unsigned(request.client.id % workers.size())});
+    if (worker.has_value())
+    {
+        client->second.current = worker.value();
+    }
+    client->second.reached |= uint64_t{1} << client->second.current;
+    return client->second.current;
+}
+
+void WorkerPool::dispatch(Request &&request)
+{
+    unsigned worker = workerFor(request);
+
+    // Requests already waiting go first so each client's order is kept
+    if (!backlog[worker].empty() || !workers[worker]->submit(request))
+    {
+        backlog[worker].push_back(std::move(request));
+    }
+}
+
+bool WorkerPool::collect(std::deque<Broadcast> &outgoing)
+{
+    bool active = false;
+
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        auto &waiting = backlog[i];
+        while (!waiting.empty() && workers[i]->submit(waiting.front()))
+        {
+            waiting.pop_front();
+            active = true;
+        }
+
+        active = workers[i]->drain(outgoing) || active;
+    }
+
+    return active;
+}
+
+bool WorkerPool::notifyWorker(uintptr_t clientID, MessageType action)
+{
+    auto client = clientWorkers.find(clientID);
+    if (client == clientWorkers.end())
+    {
+        return false;
+    }
+
+    uint64_t targets = action == MessageType::DISCONNECT
+                           ? client->second.reached
+                           : uint64_t{1} << seats.workerOf(clientID).value_or(client->second.current);
+    for (unsigned worker = 0; worker < workers.size(); worker++)
+    {
+        if ((targets & (uint64_t{1} << worker)) == 0)
+        {
+            continue;
+        }
+
+        Request notice("", Connection{clientID});
+        notice.action = action;
+        notice.isValid = true;
+        if (!backlog[worker].empty() || !workers[worker]->submit(notice))
+        {
+            backlog[worker].push_back(std::move(notice));
+        }
+    }
+    return true;
+}
+
+void WorkerPool::forgetClient(uintptr_t clientID)
+{
+    // The workers the client reached take it out of its session
+    if (notifyWorker(clientID, MessageType::DISCONNECT))
+    {
+        clientWorkers.erase(clientID);
+    }
+}
+
+bool WorkerPool::setSessionPaused(uintptr_t clientID, bool paused)
+{
+    return notifyWorker(clientID, paused ? MessageType::PAUSE_SESSION : MessageType::RESUME_SESSION);
+}
+
+size_t WorkerPool::pendingRequests() const
+{
+    size_t pending = 0;
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        pending += backlog[i].size() + workers[i]->pendingRequests();
+    }
+    return pending;
+}
+
+void WorkerPool::checkpoint(const std::string &path)
+{
+    for (auto &worker : workers)
+    {
+        auto result = worker->checkpoint(path);
+        if (!result.has_value())
+        {
+            LOG_ERROR("session", "checkpoint failed", {{"error", result.error()}});
+        }
+    }
+}
+
+void WorkerPool::finish(std::deque<Broadcast> &outgoing, std::chrono::steady_clock::time_point deadline)
+{
+    stop();
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i]->finish(backlog[i], outgoing, deadline);
+    }
+}
+
+void WorkerPool::addToSnapshot(SnapshotBuilder &snapshot) const
+{
+    for (const auto &worker : workers)
+    {
+        auto result = worker->addToSnapshot(snapshot);
+        if (!result.has_value())
+        {
+            LOG_ERROR("handoff", "unable to snapshot worker", {{"error", result.error()}});
+        }
+    }
+}
+
+void WorkerPool::restoreSnapshot(const SnapshotReader &snapshot)
+{
+    for (auto &worker : workers)
+    {
+        auto result = worker->restoreSnapshot(snapshot);
+        if (!result.has_value())
+        {
+            LOG_ERROR("handoff", "unable to restore sessions", {{"error", result.error()}});
+        }
+    }
+
+    // Members go on reaching the worker owning their session
+    for (const auto &entry : snapshot.getSessions().getEntries())
+    {
+        auto shard = SessionManager::shardOfJoinCode(entry.joinCode, firstShard + workers.size());
+        unsigned worker = shard.has_value() && shard.value() >= firstShard ? shard.value() - firstShard : 0;
+
+        const SessionMembers &members = snapshot.getMembers(entry.sessionId);
+        for (uintptr_t clientID : members.players)
+        {
+            clientWorkers[clientID] = ClientWorkers{worker, uint64_t{1} << worker};
+        }
+        for (uintptr_t clientID : members.audience)
+        {
+            clientWorkers[clientID] = ClientWorkers{worker, uint64_t{1} << worker};
+        }
+    }
+}
+
+void WorkerPool::restoreCheckpoint(const std::string &path)
+{
+    size_t restored = 0;
+    for (auto &worker : workers)
+    {
+        auto result = worker->restoreCheckpoint(path);
+        if (result.has_value())
+        {
+            restored += result.value();
+        }
+        else
+        {
+            LOG_ERROR("session", "unable to restore checkpoint", {{"error", result.error()}});
+        }
+    }
+
+    if (restored > 0)
+    {
+        LOG_INFO("session", "restored checkpoint", {{"sessions", restored}, {"path", path}, {"workers", workers.size()}});
+    }
+}
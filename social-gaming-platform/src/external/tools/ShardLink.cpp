@@ -0,0 +1,268 @@
+/**
+ * ShardLink.cpp
+ */
+#include "ShardLink.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+    const size_t HEADER_SIZE = sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint64_t);
+    const size_t READ_CHUNK = 64 << 10;
+
+    std::expected<sockaddr_un, std::string> unixAddress(const std::string &path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            return std::unexpected("Socket path is too long: " + path);
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return address;
+    }
+
+    void setNonBlocking(int fd)
+    {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+}
+
+ShardLink::ShardLink(int fd) : fd(fd)
+{
+    setNonBlocking(fd);
+}
+
+ShardLink::ShardLink(int fd, std::string unread, std::string unwritten)
+    : fd(fd), readBuffer(std::move(unread)), writeBuffer(std::move(unwritten))
+{
+    setNonBlocking(fd);
+}
+
+ShardLink::~ShardLink()
+{
+    close();
+}
+
+ShardLink::ShardLink(ShardLink &&other) noexcept
+    : fd(other.fd),
+      readBuffer(std::move(other.readBuffer)),
+      writeBuffer(std::move(other.writeBuffer)),
+      written(other.written)
+{
+    other.fd = -1;
+    other.written = 0;
+}
+
+ShardLink &ShardLink::operator=(ShardLink &&other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        fd = other.fd;
+        readBuffer = std::move(other.readBuffer);
+        writeBuffer = std::move(other.writeBuffer);
+        written = other.written;
+        other.fd = -1;
+        other.written = 0;
+    }
+    return *this;
+}
+
+std::expected<ShardLink, std::string> ShardLink::connect(const std::string &path)
+{
+    auto address = unixAddress(path);
+    if (!address.has_value())
+    {
+        return std::unexpected(address.error());
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+    {
+        return std::unexpected(std::string("Unable to create socket: ") + std::strerror(errno));
+    }
+
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&address.value()), sizeof(sockaddr_un)) == -1)
+    {
+        std::string error = std::strerror(errno);
+        ::close(fd);
+        return std::unexpected("Unable to connect to " + path + ": " + error);
+    }
+    return ShardLink(fd);
+}
+
+void ShardLink::close()
+{
+    if (fd != -1)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+    readBuffer.clear();
+    writeBuffer.clear();
+    written = 0;
+}
+
+int ShardLink::release(std::string &unread, std::string &unwritten)
+{
+    int released = fd;
+    unread = std::move(readBuffer);
+    unwritten = writeBuffer.substr(written);
+    fd = -1;
+    close();
+    return released;
+}
+
+void ShardLink::queue(LinkFrameKind kind, uintptr_t connectionId, std::string_view text)
+{
+    uint32_t length = sizeof(uint8_t) + sizeof(uint64_t) + text.size();
+    uint64_t id = connectionId;
+
+    size_t start = writeBuffer.size();
+    writeBuffer.resize(start + HEADER_SIZE);
+    char *header = writeBuffer.data() + start;
+    std::memcpy(header, &length, sizeof(length));
+    header[sizeof(length)] = static_cast<char>(kind);
+    std::memcpy(header + sizeof(length) + 1, &id, sizeof(id));
+    writeBuffer.append(text);
+}
+
+bool ShardLink::flush()
+{
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    while (written < writeBuffer.size())
+    {
+        ssize_t sent = send(fd, writeBuffer.data() + written, writeBuffer.size() - written, MSG_NOSIGNAL);
+        if (sent > 0)
+        {
+            written += sent;
+        }
+        else if (sent == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        else
+        {
+            close();
+            return false;
+        }
+    }
+
+    if (written == writeBuffer.size())
+    {
+        writeBuffer.clear();
+        written = 0;
+    }
+    else if (pendingBytes() > MAX_PENDING_BYTES)
+    {
+        // The peer stopped reading
+        close();
+        return false;
+    }
+    else if (written > writeBuffer.size() / 2)
+    {
+        writeBuffer.erase(0, written);
+        written = 0;
+    }
+    return true;
+}
+
+bool ShardLink::receive(std::deque<LinkFrame> &frames)
+{
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    bool open = true;
+    char chunk[READ_CHUNK];
+    while (true)
+    {
+        ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+        if (received > 0)
+        {
+            readBuffer.append(chunk, received);
+        }
+        else if (received == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        else
+        {
+            open = received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+            break;
+        }
+    }
+
+    size_t offset = 0;
+    while (readBuffer.size() - offset >= sizeof(uint32_t))
+    {
+        uint32_t length;
+        std::memcpy(&length, readBuffer.data() + offset, sizeof(length));
+        if (length < sizeof(uint8_t) + sizeof(uint64_t) || length > MAX_FRAME_SIZE)
+        {
+            close();
+            return false;
+        }
+        if (readBuffer.size() - offset < sizeof(length) + length)
+        {
+            break;
+        }
+
+        const char *body = readBuffer.data() + offset + sizeof(length);
+        uint64_t id;
+        std::memcpy(&id, body + 1, sizeof(id));
+        frames.push_back(LinkFrame{static_cast<LinkFrameKind>(body[0]), static_cast<uintptr_t>(id),
+                                   std::string(body + 1 + sizeof(id), length - 1 - sizeof(id))});
+        offset += sizeof(length) + length;
+    }
+    readBuffer.erase(0, offset);
+
+    if (!open)
+    {
+        close();
+    }
+    return open;
+}
+
+std::expected<int, std::string> listenOnUnixSocket(const std::string &path)
+{
+    auto address = unixAddress(path);
+    if (!address.has_value())
+    {
+        return std::unexpected(address.error());
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+    {
+        return std::unexpected(std::string("Unable to create socket: ") + std::strerror(errno));
+    }
+
+    // A socket file left behind by a previous run
+    unlink(path.c_str());
+
+    if (bind(fd, reinterpret_cast<const sockaddr *>(&address.value()), sizeof(sockaddr_un)) == -1 ||
+        listen(fd, SOMAXCONN) == -1)
+    {
+        std::string error = std::strerror(errno);
+        ::close(fd);
+        return std::unexpected("Unable to listen on " + path + ": " + error);
+    }
+    setNonBlocking(fd);
+    return fd;
+}
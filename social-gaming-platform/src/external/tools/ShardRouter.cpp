@@ -0,0 +1,478 @@
+/**
+ * ShardRouter.cpp
+ */
+#include "ShardRouter.h"
+
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Response.h"
+#include "data/logger.h"
+#include "data/session/manager.h"
+
+std::atomic<bool> ShardRouter::stopRequested = false;
+std::atomic<bool> ShardRouter::restartRequested = false;
+
+namespace
+{
+    // How long a down backend is left alone before connecting again
+    const std::chrono::milliseconds RECONNECT_INTERVAL = std::chrono::milliseconds(250);
+
+    // A backend that keeps exiting is restarted at most this often
+    const std::chrono::seconds RESTART_INTERVAL = std::chrono::seconds(1);
+
+    const std::string UNAVAILABLE_MESSAGE = "[UNAVAILABLE] This game is not reachable right now, try again later";
+
+    static_assert(SessionManager::MAX_SHARDS <= 64, "a client's backends are one bit each");
+}
+
+BackendSupervisor::BackendSupervisor(std::vector<std::string> command, unsigned count, std::string socketDirectory)
+    : command(std::move(command)), socketDirectory(std::move(socketDirectory)), backends(count)
+{
+}
+
+BackendSupervisor::~BackendSupervisor()
+{
+    stop();
+}
+
+std::vector<std::string> BackendSupervisor::getSocketPaths() const
+{
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < backends.size(); i++)
+    {
+        paths.push_back(socketDirectory + "/shard-" + std::to_string(i) + ".sock");
+    }
+    return paths;
+}
+
+void BackendSupervisor::start()
+{
+    for (unsigned i = 0; i < backends.size(); i++)
+    {
+        spawn(i);
+    }
+}
+
+void BackendSupervisor::spawn(unsigned index, bool takeOver)
+{
+    std::vector<std::string> arguments = command;
+    arguments.insert(arguments.end(), {"--shard-socket", getSocketPaths()[index],
+                                       "--shard", std::to_string(index) + "/" + std::to_string(backends.size())});
+    if (takeOver)
+    {
+        arguments.insert(arguments.end(), {"--take-over", "on"});
+    }
+
+    std::vector<char *> argv;
+    for (auto &argument : arguments)
+    {
+        argv.push_back(argument.data());
+    }
+    argv.push_back(nullptr);
+
+    Backend &backend = backends[index];
+    backend.lastStart = std::chrono::steady_clock::now();
+    backend.pid = fork();
+    if (backend.pid == 0)
+    {
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    if (backend.pid == -1)
+    {
+        LOG_ERROR("shard", "unable to start backend", {{"shard", index}});
+        return;
+    }
+    LOG_INFO("shard", "started backend", {{"shard", index}, {"pid", backend.pid}});
+}
+
+void BackendSupervisor::restartExited()
+{
+    if (stopping)
+    {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < backends.size(); i++)
+    {
+        Backend &backend = backends[i];
+        int status;
+        if (backend.retiring > 0 && waitpid(backend.retiring, &status, WNOHANG) == backend.retiring)
+        {
+            LOG_INFO("shard", "replaced backend", {{"shard", i}, {"retired", backend.retiring}, {"pid", backend.pid}});
+            backend.retiring = -1;
+        }
+
+        if (backend.pid > 0 && waitpid(backend.pid, &status, WNOHANG) == backend.pid)
+        {
+            LOG_ERROR("shard", "backend exited",
+                      {{"shard", i}, {"pid", backend.pid}, {"status", WIFEXITED(status) ? WEXITSTATUS(status) : -WTERMSIG(status)}});
+            backend.pid = -1;
+
+            // The replacement did not take over, the backend it was replacing still serves
+            if (backend.retiring > 0)
+            {
+                LOG_WARNING("shard", "backend replacement failed", {{"shard", i}, {"pid", backend.retiring}});
+                backend.pid = backend.retiring;
+                backend.retiring = -1;
+            }
+        }
+
+        if (backend.pid <= 0 && now - backend.lastStart >= RESTART_INTERVAL)
+        {
+            spawn(i);
+        }
+    }
+}
+
+void BackendSupervisor::replaceAll()
+{
+    if (stopping)
+    {
+        return;
+    }
+
+    for (unsigned i = 0; i < backends.size(); i++)
+    {
+        Backend &backend = backends[i];
+        if (backend.pid > 0 && backend.retiring <= 0)
+        {
+            backend.retiring = backend.pid;
+            spawn(i, true);
+        }
+    }
+}
+
+void BackendSupervisor::stop()
+{
+    stopping = true;
+    for (auto &backend : backends)
+    {
+        for (pid_t pid : {backend.pid, backend.retiring})
+        {
+            if (pid > 0)
+            {
+                kill(pid, SIGTERM);
+            }
+        }
+    }
+    for (auto &backend : backends)
+    {
+        for (pid_t *pid : {&backend.pid, &backend.retiring})
+        {
+            if (*pid > 0)
+            {
+                waitpid(*pid, nullptr, 0);
+                *pid = -1;
+            }
+        }
+    }
+}
+
+
+ShardRouter::ShardRouter(std::unique_ptr<Transport> clients, std::vector<std::string> backendPaths,
+                         unsigned sessionShardsPerBackend, const ServerOptions &options,
+                         BackendSupervisor *supervisor)
+    : options(options),
+      clients(std::move(clients)),
+      sessionShardsPerBackend(std::max(sessionShardsPerBackend, 1u)),
+      supervisor(supervisor),
+      pacer(options.minIdleWait, options.maxIdleWait)
+{
+    for (auto &path : backendPaths)
+    {
+        backends.push_back(Backend{std::move(path), ShardLink(), std::chrono::steady_clock::now()});
+    }
+
+    // Clients only become known to a backend with their first message
+    this->clients->setHandlers([](Connection c)
+                               { LOG_INFO("router", "client connected", {{"client", c.id}}); },
+                               [this](Connection c)
+                               { onDisconnect(c); });
+}
+
+void ShardRouter::requestStop() noexcept
+{
+    stopRequested = true;
+}
+
+void ShardRouter::requestRestart() noexcept
+{
+    restartRequested = true;
+}
+
+std::optional<unsigned> ShardRouter::backendOf(uintptr_t clientID) const
+{
+    auto client = routedClients.find(clientID);
+    if (client == routedClients.end())
+    {
+        return std::nullopt;
+    }
+    return client->second.backend;
+}
+
+void ShardRouter::run()
+{
+    LOG_INFO("router", "shard router starting", {{"backends", backends.size()}});
+    while (update())
+    {
+        if (supervisor != nullptr)
+        {
+            if (restartRequested.exchange(false))
+            {
+                LOG_INFO("router", "replacing the backends");
+                supervisor->replaceAll();
+            }
+            supervisor->restartExited();
+        }
+        pacer.pace(std::chrono::steady_clock::time_point::max());
+    }
+
+    LOG_INFO("router", "shutting down the shard router");
+    if (supervisor != nullptr)
+    {
+        supervisor->stop();
+    }
+}
+
+bool ShardRouter::update()
+{
+    if (stopRequested)
+    {
+        return false;
+    }
+
+    connectBackends();
+
+    std::deque<Message> outgoing;
+    try
+    {
+        clients->update();
+        auto incoming = clients->receive();
+        if (!incoming.empty())
+        {
+            pacer.markActive();
+        }
+        for (const auto &message : incoming)
+        {
+            route(message, outgoing);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERROR("router", "exception from client transport", {{"error", e.what()}});
+    }
+
+    for (unsigned i = 0; i < backends.size(); i++)
+    {
+        if (backends[i].link.isOpen() && !backends[i].link.flush())
+        {
+            backendFailed(i);
+        }
+    }
+
+    collect(outgoing);
+    if (!outgoing.empty())
+    {
+        pacer.markActive();
+        clients->send(outgoing);
+    }
+    return true;
+}
+
+void ShardRouter::connectBackends()
+{
+    auto now = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < backends.size(); i++)
+    {
+        Backend &backend = backends[i];
+        if (backend.link.isOpen() || now < backend.nextConnectAttempt)
+        {
+            continue;
+        }
+
+        auto link = ShardLink::connect(backend.path);
+        if (link.has_value())
+        {
+            backend.link = std::move(link.value());
+            LOG_INFO("router", "connected to backend", {{"shard", i}, {"socket", backend.path}});
+        }
+        else
+        {
+            backend.nextConnectAttempt = now + RECONNECT_INTERVAL;
+        }
+    }
+}
+
+unsigned ShardRouter::backendFor(const Request &request) const
+{
+    auto client = routedClients.find(request.client.id);
+    bool seated = client != routedClients.end() && client->second.seat.has_value();
+
+    // Joining goes to the backend owning the session of the join code, unless the client
+    // is in a session: the backend holding it refuses joining another one
+    if (!seated && (request.action == MessageType::JOIN || request.action == MessageType::JOIN_AUDIENCE))
+    {
+        auto shard = SessionManager::shardOfJoinCode(request.body, backends.size() * sessionShardsPerBackend);
+        if (shard.has_value())
+        {
+            return shard.value() / sessionShardsPerBackend;
+        }
+    }
+
+    if (client != routedClients.end())
+    {
+        return client->second.seat.value_or(client->second.backend);
+    }
+
+    // New clients skip backends that are down
+    unsigned first = request.client.id % backends.size();
+    for (unsigned i = 0; i < backends.size(); i++)
+    {
+        unsigned backend = (first + i) % backends.size();
+        if (backends[backend].link.isOpen())
+        {
+            return backend;
+        }
+    }
+    return first;
+}
+
+void ShardRouter::route(const Message &message, std::deque<Message> &outgoing)
+{
+    Request request(message.text, message.connection);
+    unsigned backend = backendFor(routingRequestOf(request));
+
+    ShardLink &link = backends[backend].link;
+    if (!link.isOpen())
+    {
+        Response unavailable = MessageResponse(CommonResponse("N/A", UNAVAILABLE_MESSAGE, MessageType::MESSAGE,
+                                                              {message.connection.id}, false, request.requestId));
+        outgoing.push_back(Message{message.connection, serializeResponse(unavailable)});
+        return;
+    }
+
+    // A client moving on stays connected to the backends it reached until it disconnects,
+    // it is in no session there
+    auto [client, inserted] = routedClients.try_emplace(message.connection.id, RoutedClient{backend});
+    client->second.backend = backend;
+    if ((client->second.reached & (uint64_t{1} << backend)) == 0)
+    {
+        client->second.reached |= uint64_t{1} << backend;
+        link.queue(LinkFrameKind::CONNECT, message.connection.id);
+    }
+    link.queue(LinkFrameKind::MESSAGE, message.connection.id, message.text);
+}
+
+void ShardRouter::collect(std::deque<Message> &outgoing)
+{
+    for (unsigned i = 0; i < backends.size(); i++)
+    {
+        if (!backends[i].link.isOpen())
+        {
+            continue;
+        }
+
+        std::deque<LinkFrame> frames;
+        bool open = backends[i].link.receive(frames);
+
+        for (auto &frame : frames)
+        {
+            Connection connection{frame.connectionId};
+            if (frame.kind == LinkFrameKind::MESSAGE)
+            {
+                outgoing.push_back(Message{connection, std::move(frame.text)});
+                continue;
+            }
+
+            auto client = routedClients.find(frame.connectionId);
+            if (client == routedClients.end() || (client->second.reached & (uint64_t{1} << i)) == 0)
+            {
+                continue;
+            }
+
+            if (frame.kind == LinkFrameKind::DISCONNECT)
+            {
+                // The backend closed the client, e.g. for falling behind
+                forgetClient(frame.connectionId, i);
+                clients->disconnect(connection);
+            }
+            else if (frame.kind == LinkFrameKind::SEATED)
+            {
+                if (!client->second.seat.has_value())
+                {
+                    client->second.seat = i;
+                }
+                else if (client->second.seat != i)
+                {
+                    // A join that raced the client's session on another backend, before that was reported
+                    LOG_WARNING("router", "client in sessions on two backends", {{"client", frame.connectionId}, {"shard", i}});
+                    backends[i].link.queue(LinkFrameKind::DISCONNECT, frame.connectionId);
+                    client->second.reached &= ~(uint64_t{1} << i);
+                }
+            }
+            else if (frame.kind == LinkFrameKind::UNSEATED && client->second.seat == i)
+            {
+                client->second.seat.reset();
+            }
+        }
+
+        if (!open)
+        {
+            backendFailed(i);
+        }
+    }
+}
+
+void ShardRouter::onDisconnect(Connection connection)
+{
+    LOG_INFO("router", "client disconnected", {{"client", connection.id}});
+    forgetClient(connection.id);
+}
+
+void ShardRouter::forgetClient(uintptr_t clientID, std::optional<unsigned> closedBy)
+{
+    auto client = routedClients.find(clientID);
+    if (client == routedClients.end())
+    {
+        return;
+    }
+
+    for (unsigned i = 0; i < backends.size(); i++)
+    {
+        if (i != closedBy && (client->second.reached & (uint64_t{1} << i)) != 0 && backends[i].link.isOpen())
+        {
+            backends[i].link.queue(LinkFrameKind::DISCONNECT, clientID);
+        }
+    }
+    routedClients.erase(client);
+}
+
+void ShardRouter::backendFailed(unsigned backend)
+{
+    backends[backend].link.close();
+    backends[backend].nextConnectAttempt = std::chrono::steady_clock::now() + RECONNECT_INTERVAL;
+
+    // The sessions of its clients are gone with it, or will be restored from its checkpoint.
+    // Clients that only passed through it go on.
+    std::vector<uintptr_t> lost;
+    for (auto &[clientID, client] : routedClients)
+    {
+        if (client.seat.value_or(client.backend) == backend)
+        {
+            lost.push_back(clientID);
+        }
+        client.reached &= ~(uint64_t{1} << backend);
+    }
+    LOG_ERROR("router", "lost backend", {{"shard", backend}, {"clients", lost.size()}});
+
+    for (uintptr_t clientID : lost)
+    {
+        forgetClient(clientID);
+        clients->disconnect(Connection{clientID});
+    }
+}
@@ -0,0 +1,295 @@
+/**
+ * ShardTransport.cpp
+ */
+#include "ShardTransport.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "data/encoding.h"
+#include "data/logger.h"
+
+namespace
+{
+    using encoding::get;
+    using encoding::getBytes;
+    using encoding::put;
+    using encoding::putBytes;
+
+    template <typename Ids>
+    void putIds(std::string &out, const Ids &ids)
+    {
+        put<uint32_t>(out, ids.size());
+        for (uintptr_t id : ids)
+        {
+            put<uint64_t>(out, id);
+        }
+    }
+
+    template <typename Add>
+    bool getIds(std::string_view &in, Add add)
+    {
+        uint32_t count;
+        if (!get(in, count))
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint64_t id;
+            if (!get(in, id))
+            {
+                return false;
+            }
+            add(static_cast<uintptr_t>(id));
+        }
+        return true;
+    }
+}
+
+std::expected<std::unique_ptr<ShardTransport>, std::string> ShardTransport::listen(const std::string &path)
+{
+    auto listener = listenOnUnixSocket(path);
+    if (!listener.has_value())
+    {
+        return std::unexpected(listener.error());
+    }
+    return std::unique_ptr<ShardTransport>(new ShardTransport(listener.value(), path));
+}
+
+std::unique_ptr<ShardTransport> ShardTransport::awaitHandoff(const std::string &path)
+{
+    return std::unique_ptr<ShardTransport>(new ShardTransport(-1, path));
+}
+
+ShardTransport::ShardTransport(int listener, std::string path) : listener(listener), path(std::move(path))
+{
+}
+
+ShardTransport::~ShardTransport()
+{
+    router.close();
+
+    // A transport that handed its socket off leaves it to the new owner
+    if (listener != -1)
+    {
+        close(listener);
+        unlink(path.c_str());
+    }
+}
+
+bool ShardTransport::handOff(TransportHandoff &handoff)
+{
+    if (listener == -1)
+    {
+        return false;
+    }
+
+    std::string unread, unwritten;
+    handoff.descriptors = {listener};
+    if (router.isOpen())
+    {
+        handoff.descriptors.push_back(router.release(unread, unwritten));
+    }
+
+    // Messages already taken by receive() are the server's to hand over, the rest go here
+    handoff.state.clear();
+    putBytes(handoff.state, unread);
+    putBytes(handoff.state, unwritten);
+    putIds(handoff.state, clients);
+    std::vector<uintptr_t> closedIds;
+    for (const auto &connection : closed)
+    {
+        closedIds.push_back(connection.id);
+    }
+    putIds(handoff.state, closedIds);
+    put<uint32_t>(handoff.state, inbound.size());
+    for (const auto &message : inbound)
+    {
+        put<uint64_t>(handoff.state, message.connection.id);
+        putBytes(handoff.state, message.text);
+    }
+
+    listener = -1;
+    clients.clear();
+    closed.clear();
+    inbound.clear();
+    return true;
+}
+
+bool ShardTransport::takeOver(TransportHandoff &handoff)
+{
+    std::string_view state = handoff.state;
+    std::string unread, unwritten;
+    std::unordered_set<uintptr_t> handedClients;
+    std::vector<Connection> handedClosed;
+    std::deque<Message> handedInbound;
+    uint32_t inboundCount = 0;
+    if (listener != -1 || handoff.descriptors.empty() || handoff.descriptors.size() > 2 ||
+        !getBytes(state, unread) || !getBytes(state, unwritten) ||
+        !getIds(state, [&](uintptr_t id)
+                { handedClients.insert(id); }) ||
+        !getIds(state, [&](uintptr_t id)
+                { handedClosed.push_back(Connection{id}); }) ||
+        !get(state, inboundCount))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < inboundCount; i++)
+    {
+        uint64_t id;
+        std::string text;
+        if (!get(state, id) || !getBytes(state, text))
+        {
+            return false;
+        }
+        handedInbound.push_back(Message{Connection{static_cast<uintptr_t>(id)}, std::move(text)});
+    }
+
+    listener = handoff.descriptors[0];
+    if (handoff.descriptors.size() == 2)
+    {
+        router = ShardLink(handoff.descriptors[1], std::move(unread), std::move(unwritten));
+    }
+    clients = std::move(handedClients);
+    closed = std::move(handedClosed);
+    inbound = std::move(handedInbound);
+    handoff.descriptors.clear();
+
+    LOG_INFO("shard", "took over the shard socket", {{"socket", path}, {"router", router.isOpen()}, {"clients", clients.size()}});
+    return true;
+}
+
+void ShardTransport::acceptRouter()
+{
+    if (listener == -1)
+    {
+        return;
+    }
+
+    int fd = accept(listener, nullptr, nullptr);
+    if (fd == -1)
+    {
+        return;
+    }
+
+    // A router that reconnects starts over, its old clients are gone
+    if (router.isOpen())
+    {
+        dropRouter();
+    }
+    router = ShardLink(fd);
+    LOG_INFO("shard", "router connected", {{"socket", path}});
+}
+
+void ShardTransport::dropRouter()
+{
+    LOG_WARNING("shard", "router disconnected", {{"socket", path}, {"clients", clients.size()}});
+    router.close();
+    inbound.clear();
+    for (uintptr_t client : clients)
+    {
+        closed.push_back(Connection{client});
+    }
+    clients.clear();
+}
+
+void ShardTransport::update()
+{
+    acceptRouter();
+
+    std::deque<LinkFrame> frames;
+    if (router.isOpen() && !router.receive(frames))
+    {
+        dropRouter();
+    }
+
+    std::vector<Connection> disconnected;
+    disconnected.swap(closed);
+    for (const auto &connection : disconnected)
+    {
+        this->disconnected(connection);
+    }
+
+    for (auto &frame : frames)
+    {
+        Connection connection{frame.connectionId};
+        switch (frame.kind)
+        {
+        case LinkFrameKind::CONNECT:
+            if (clients.insert(frame.connectionId).second)
+            {
+                connected(connection);
+            }
+            break;
+        case LinkFrameKind::DISCONNECT:
+            // Reported on the next update, after the client's last messages are handled
+            if (clients.erase(frame.connectionId) > 0)
+            {
+                closed.push_back(connection);
+            }
+            break;
+        case LinkFrameKind::MESSAGE:
+            inbound.push_back(Message{connection, std::move(frame.text)});
+            break;
+        case LinkFrameKind::SEATED:
+        case LinkFrameKind::UNSEATED:
+            // Only backends report seats
+            break;
+        }
+    }
+
+    if (router.isOpen() && !router.flush())
+    {
+        dropRouter();
+    }
+}
+
+std::deque<Message> ShardTransport::receive()
+{
+    std::deque<Message> received;
+    received.swap(inbound);
+    return received;
+}
+
+void ShardTransport::send(const std::deque<Message> &messages)
+{
+    if (!router.isOpen())
+    {
+        return;
+    }
+
+    for (const auto &message : messages)
+    {
+        if (clients.contains(message.connection.id))
+        {
+            router.queue(LinkFrameKind::MESSAGE, message.connection.id, message.text);
+        }
+    }
+    if (!router.flush())
+    {
+        dropRouter();
+    }
+}
+
+void ShardTransport::reportSeat(Connection connection, bool seated)
+{
+    if (router.isOpen() && clients.contains(connection.id))
+    {
+        router.queue(seated ? LinkFrameKind::SEATED : LinkFrameKind::UNSEATED, connection.id);
+    }
+}
+
+void ShardTransport::disconnect(Connection connection)
+{
+    if (clients.erase(connection.id) == 0)
+    {
+        return;
+    }
+
+    if (router.isOpen())
+    {
+        router.queue(LinkFrameKind::DISCONNECT, connection.id);
+    }
+    closed.push_back(connection);
+}
@@ -0,0 +1,32 @@
+/**
+ * Transport.cpp
+ */
+#include "Transport.h"
+
+WebSocketTransport::WebSocketTransport(unsigned short port, std::string httpMessage)
+    : server(port, std::move(httpMessage), [this](Connection c)
+             { connected(c); },
+             [this](Connection c)
+             { disconnected(c); })
+{
+}
+
+void WebSocketTransport::update()
+{
+    server.update();
+}
+
+std::deque<Message> WebSocketTransport::receive()
+{
+    return server.receive();
+}
+
+void WebSocketTransport::send(const std::deque<Message> &messages)
+{
+    server.send(messages);
+}
+
+void WebSocketTransport::disconnect(Connection connection)
+{
+    server.disconnect(connection);
+}
@@ -0,0 +1,402 @@
+/**
+ * WireCodec.cpp
+ */
+#include "WireCodec.h"
+#include "Utf8.h"
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace
+{
+    const unsigned DIGIT_BITS = 6;
+    const uint64_t DIGIT_MASK = 0x3F;
+    const uint64_t MORE_DIGITS = 0x40;
+
+    // Digits of the longest number, 64 bits
+    const size_t MAX_NUMBER_DIGITS = 11;
+
+    // Fields present in a request
+    const uint64_t REQUEST_BODY = 1 << 0;
+    const uint64_t REQUEST_SESSION_ID = 1 << 1;
+    const uint64_t REQUEST_ID = 1 << 2;
+    const uint64_t REQUEST_TARGET_VAR = 1 << 3;
+    const uint64_t REQUEST_FIELDS = 0xF;
+
+    // Response flags
+    const uint64_t RESPONSE_SUCCESS_GIVEN = 1 << 0;
+    const uint64_t RESPONSE_SUCCESS = 1 << 1;
+    const uint64_t RESPONSE_REQUEST_ID = 1 << 2;
+    const uint64_t RESPONSE_CLIENT_IDS = 1 << 3;
+    const uint64_t RESPONSE_INPUT = 1 << 4;
+    const uint64_t RESPONSE_TIMEOUT = 1 << 5;
+    const uint64_t RESPONSE_FLAGS = 0x3F;
+
+    const std::string_view REPLACEMENT_CHARACTER = "\xEF\xBF\xBD";
+
+    void appendNumber(std::string &out, uint64_t value)
+    {
+        while (value > DIGIT_MASK)
+        {
+            out.push_back(static_cast<char>((value & DIGIT_MASK) | MORE_DIGITS));
+            value >>= DIGIT_BITS;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    bool isUtf8(std::string_view text)
+    {
+        for (size_t i = 0; i < text.size();)
+        {
+            size_t length = utf8SequenceLength(text.substr(i));
+            if (length == 0)
+            {
+                return false;
+            }
+            i += length;
+        }
+        return true;
+    }
+
+    // Valid UTF-8 is copied as is, anything else becomes U+FFFD
+    void appendString(std::string &out, std::string_view text)
+    {
+        if (isUtf8(text))
+        {
+            appendNumber(out, text.size());
+            out.append(text);
+            return;
+        }
+
+        std::string replaced;
+        for (size_t i = 0; i < text.size();)
+        {
+            size_t length = utf8SequenceLength(text.substr(i));
+            if (length == 0)
+            {
+                replaced.append(REPLACEMENT_CHARACTER);
+                i++;
+            }
+            else
+            {
+                replaced.append(text.substr(i, length));
+                i += length;
+            }
+        }
+        appendNumber(out, replaced.size());
+        out.append(replaced);
+    }
+
+    uint64_t zigzag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t unzigzag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    // Reads the fields of a frame after its marker
+    class FrameReader
+    {
+    public:
+        explicit FrameReader(std::string_view frame) : frame(frame) {}
+
+        std::optional<uint64_t> number()
+        {
+            uint64_t value = 0;
+            for (size_t digit = 0; digit < MAX_NUMBER_DIGITS && position < frame.size(); digit++)
+            {
+                auto byte = static_cast<unsigned char>(frame[position++]);
+                if (byte >= 0x80)
+                {
+                    return std::nullopt;
+                }
+                value |= (byte & DIGIT_MASK) << (digit * DIGIT_BITS);
+                if ((byte & MORE_DIGITS) == 0)
+                {
+                    return value;
+                }
+            }
+            return std::nullopt;
+        }
+
+        std::optional<std::string_view> string()
+        {
+            auto length = number();
+            if (!length.has_value() || length.value() > frame.size() - position)
+            {
+                return std::nullopt;
+            }
+
+            std::string_view text = frame.substr(position, length.value());
+            if (!isUtf8(text))
+            {
+                return std::nullopt;
+            }
+            position += text.size();
+            return text;
+        }
+
+        bool atEnd() const
+        {
+            return position == frame.size();
+        }
+
+    private:
+        std::string_view frame;
+        size_t position = 1;
+    };
+
+    std::unexpected<std::string> malformed(std::string_view part)
+    {
+        return std::unexpected("Malformed compact " + std::string(part));
+    }
+
+    // Types go on the wire as non-negative numbers, UNDEFINED as the largest
+    const uint64_t UNDEFINED_TYPE = std::numeric_limits<uint32_t>::max();
+
+    uint64_t numberOf(MessageType type)
+    {
+        int value = static_cast<int>(type);
+        return value < 0 ? UNDEFINED_TYPE : static_cast<uint64_t>(value);
+    }
+
+    MessageType typeOf(uint64_t value)
+    {
+        return value < UNDEFINED_TYPE ? static_cast<MessageType>(value) : MessageType::UNDEFINED;
+    }
+
+    // Clients may only send actions below the server's own types
+    MessageType actionOf(uint64_t value)
+    {
+        return value < static_cast<uint64_t>(MessageType::DISCONNECT) ? static_cast<MessageType>(value)
+                                                                       : MessageType::UNDEFINED;
+    }
+}
+
+std::string_view wireFormatName(WireFormat format)
+{
+    return format == WireFormat::COMPACT ? "compact" : "json";
+}
+
+std::expected<WireFormat, std::string> parseWireFormat(std::string_view name)
+{
+    if (name == "json")
+    {
+        return WireFormat::JSON;
+    }
+    if (name == "compact")
+    {
+        return WireFormat::COMPACT;
+    }
+    return std::unexpected("Unknown protocol: " + std::string(name));
+}
+
+std::expected<CompactRequest, std::string> decodeCompactRequest(std::string_view frame)
+{
+    if (!isCompactFrame(frame))
+    {
+        return malformed("request marker");
+    }
+
+    FrameReader reader(frame);
+    auto action = reader.number();
+    auto present = reader.number();
+    if (!action.has_value() || !present.has_value() || (present.value() & ~REQUEST_FIELDS) != 0)
+    {
+        return malformed("request header");
+    }
+
+    CompactRequest request;
+    request.action = actionOf(action.value());
+
+    const std::pair<uint64_t, std::optional<ScannedString> *> fields[] = {
+        {REQUEST_BODY, &request.fields.body},
+        {REQUEST_SESSION_ID, &request.fields.sessionId},
+        {REQUEST_ID, &request.fields.requestId},
+        {REQUEST_TARGET_VAR, &request.fields.targetVar},
+    };
+    for (const auto &[flag, field] : fields)
+    {
+        if ((present.value() & flag) == 0)
+        {
+            continue;
+        }
+        auto text = reader.string();
+        if (!text.has_value())
+        {
+            return malformed("request field");
+        }
+        *field = ScannedString{text.value()};
+    }
+
+    if (!reader.atEnd())
+    {
+        return malformed("request length");
+    }
+    return request;
+}
+
+std::string encodeCompactRequest(MessageType action, std::string_view body, std::string_view requestId,
+                                 std::string_view sessionId, std::optional<std::string_view> targetVar)
+{
+    uint64_t present = REQUEST_BODY | REQUEST_ID;
+    present |= sessionId.empty() ? 0 : REQUEST_SESSION_ID;
+    present |= targetVar.has_value() ? REQUEST_TARGET_VAR : 0;
+
+    std::string out(1, COMPACT_FRAME_MARKER);
+    appendNumber(out, numberOf(action));
+    appendNumber(out, present);
+    appendString(out, body);
+    if (!sessionId.empty())
+    {
+        appendString(out, sessionId);
+    }
+    appendString(out, requestId);
+    if (targetVar.has_value())
+    {
+        appendString(out, targetVar.value());
+    }
+    return out;
+}
+
+void encodeCompactResponse(const Response &response, std::string &out)
+{
+    out.clear();
+    out.push_back(COMPACT_FRAME_MARKER);
+
+    std::visit([&out](const auto &res)
+               {
+        const auto &common = res.common;
+        using T = std::decay_t<decltype(res)>;
+
+        uint64_t flags = 0;
+        flags |= common.success.has_value() ? RESPONSE_SUCCESS_GIVEN : 0;
+        flags |= common.success.value_or(false) ? RESPONSE_SUCCESS : 0;
+        flags |= common.requestId.has_value() ? RESPONSE_REQUEST_ID : 0;
+        flags |= common.clientIds.empty() ? 0 : RESPONSE_CLIENT_IDS;
+        if constexpr (std::is_same_v<T, InputResponse>)
+        {
+            flags |= RESPONSE_INPUT;
+            flags |= res.timeout.has_value() ? RESPONSE_TIMEOUT : 0;
+        }
+
+        appendNumber(out, numberOf(common.type));
+        appendNumber(out, flags);
+        appendString(out, common.gameSessionId);
+        appendString(out, common.message);
+        if (common.requestId.has_value())
+        {
+            appendString(out, common.requestId.value());
+        }
+        if (!common.clientIds.empty())
+        {
+            appendNumber(out, common.clientIds.size());
+            for (uintptr_t id : common.clientIds)
+            {
+                appendNumber(out, id);
+            }
+        }
+        if constexpr (std::is_same_v<T, InputResponse>)
+        {
+            appendString(out, res.targetVar);
+            if (res.timeout.has_value())
+            {
+                appendNumber(out, zigzag(res.timeout.value()));
+            }
+        } }, response);
+}
+
+std::string encodeCompactResponse(const Response &response)
+{
+    std::string out;
+    encodeCompactResponse(response, out);
+    return out;
+}
+
+std::expected<Response, std::string> decodeCompactResponse(std::string_view frame)
+{
+    if (!isCompactFrame(frame))
+    {
+        return malformed("response marker");
+    }
+
+    FrameReader reader(frame);
+    auto type = reader.number();
+    auto flags = reader.number();
+    auto gameSessionId = reader.string();
+    auto message = reader.string();
+    if (!type.has_value() || !flags.has_value() || (flags.value() & ~RESPONSE_FLAGS) != 0 ||
+        !gameSessionId.has_value() || !message.has_value())
+    {
+        return malformed("response header");
+    }
+
+    CommonResponse common(std::string(gameSessionId.value()), std::string(message.value()), typeOf(type.value()));
+    if ((flags.value() & RESPONSE_SUCCESS_GIVEN) != 0)
+    {
+        common.success = (flags.value() & RESPONSE_SUCCESS) != 0;
+    }
+    if ((flags.value() & RESPONSE_REQUEST_ID) != 0)
+    {
+        auto requestId = reader.string();
+        if (!requestId.has_value())
+        {
+            return malformed("response request id");
+        }
+        common.requestId = std::string(requestId.value());
+    }
+    if ((flags.value() & RESPONSE_CLIENT_IDS) != 0)
+    {
+        auto count = reader.number();
+        if (!count.has_value() || count.value() > frame.size())
+        {
+            return malformed("response client ids");
+        }
+        common.clientIds.reserve(count.value());
+        for (uint64_t i = 0; i < count.value(); i++)
+        {
+            auto id = reader.number();
+            if (!id.has_value())
+            {
+                return malformed("response client ids");
+            }
+            common.clientIds.push_back(static_cast<uintptr_t>(id.value()));
+        }
+    }
+
+    if ((flags.value() & RESPONSE_INPUT) == 0)
+    {
+        if (!reader.atEnd())
+        {
+            return malformed("response length");
+        }
+        return MessageResponse(std::move(common));
+    }
+
+    auto targetVar = reader.string();
+    if (!targetVar.has_value())
+    {
+        return malformed("response target variable");
+    }
+    std::optional<int> timeout;
+    if ((flags.value() & RESPONSE_TIMEOUT) != 0)
+    {
+        auto encoded = reader.number();
+        if (!encoded.has_value())
+        {
+            return malformed("response timeout");
+        }
+        timeout = static_cast<int>(unzigzag(encoded.value()));
+    }
+    if (!reader.atEnd())
+    {
+        return malformed("response length");
+    }
+    return InputResponse(std::move(common), targetVar.value(), timeout);
+}
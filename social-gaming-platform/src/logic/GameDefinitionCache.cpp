@@ -0,0 +1,180 @@
+#include "GameDefinitionCache.h"
+#include "tree_sitter/TSParser.h"
+#include "data/metrics.h"
+
+namespace logic
+{
+    [[nodiscard]] static std::expected<std::shared_ptr<const CompiledGame>, std::string>
+    parseGame(const std::string &name, const std::string &sourceCode, bool strict) noexcept
+    {
+        try
+        {
+            TSParser parser{sourceCode};
+
+            auto ruleSpecs = parser.parseRuleSpecs();
+            if (!ruleSpecs.has_value())
+            {
+                return std::unexpected("Failed to parse rule specs: " + ruleSpecs.error());
+            }
+
+            auto game = std::make_shared<CompiledGame>();
+            game->name = name;
+            game->ruleSpecs = std::move(ruleSpecs.value());
+
+            GameData &gameData = game->initialGameData;
+            std::optional<std::string> fieldError;
+
+            auto assignField = [&fieldError](auto &field, auto parsed)
+            {
+                if (parsed.has_value())
+                {
+                    field = parsed.value();
+                }
+                else if (!fieldError.has_value())
+                {
+                    fieldError = parsed.error();
+                }
+            };
+
+            assignField(gameData.configuration, parser.parseConfigurationField());
+            assignField(gameData.constants, parser.parseGlobalConstantsField());
+            assignField(gameData.variables, parser.parseGlobalVariablesField());
+            assignField(gameData.perPlayerState, parser.parsePlayerField());
+            assignField(gameData.perAudienceState, parser.parseAudienceField());
+
+            if (strict && fieldError.has_value())
+            {
+                return std::unexpected(fieldError.value());
+            }
+            return game;
+        }
+        catch (const std::exception &e)
+        {
+            return std::unexpected(std::string(e.what()));
+        }
+    } // end of parseGame()
+
+
+    [[nodiscard]] std::expected<std::shared_ptr<const CompiledGame>, std::string>
+    compileGame(const std::string &name, const std::string &sourceCode, bool strict) noexcept
+    {
+        static Histogram &parseDuration = MetricsRegistry::instance().histogram(
+            "game_parse_duration_seconds", "Time to parse a game file into its rules and initial state");
+
+        auto start = std::chrono::steady_clock::now();
+        auto game = parseGame(name, sourceCode, strict);
+        parseDuration.record(std::chrono::steady_clock::now() - start);
+        return game;
+    } // end of compileGame()
+
+
+    GameDefinitionCache::GameDefinitionCache(GameManager &gameManager)
+        : gameManager(gameManager) {}
+
+
+    [[nodiscard]] std::expected<std::shared_ptr<const CompiledGame>, std::string>
+    GameDefinitionCache::getGame(const std::string &gameName)
+    {
+        auto stamp = gameManager.getGameFileStamp(gameName);
+        if (!stamp.has_value())
+        {
+            erase(gameName);
+            return std::unexpected("Game file not found with specified name: " + gameName);
+        }
+
+        std::optional<Entry> cached;
+        {
+            std::lock_guard<std::mutex> lock(entriesMutex);
+            auto it = entries.find(gameName);
+            if (it != entries.end())
+            {
+                // Hit: same file, untouched since it was compiled
+                if (it->second.stamp.path == stamp->path
+                    && it->second.stamp.lastWriteTime == stamp->lastWriteTime)
+                {
+                    return it->second.game;
+                }
+                cached = it->second;
+            }
+        }
+
+        auto gameFile = gameManager.readGameFile(gameName);
+        if (!gameFile.has_value())
+        {
+            erase(gameName);
+            return std::unexpected("Game file not found with specified name: " + gameName);
+        }
+
+        std::shared_ptr<const CompiledGame> game;
+        if (cached.has_value() && cached->contentHash == gameFile->getContentHash())
+        {
+            // Touched but unchanged
+            game = cached->game;
+        }
+        else
+        {
+            auto compiled = compileGame(gameName, gameFile->getContents());
+            if (!compiled.has_value())
+            {
+                erase(gameName);
+                return compiled;
+            }
+            game = compiled.value();
+        }
+
+        std::lock_guard<std::mutex> lock(entriesMutex);
+        entries.insert_or_assign(gameName, Entry{stamp.value(), gameFile->getContentHash(), game});
+        return game;
+    } // end of getGame()
+
+
+    [[nodiscard]] bool GameDefinitionCache::needsLoading(const std::string &gameName) const
+    {
+        auto stamp = gameManager.getGameFileStamp(gameName);
+        if (!stamp.has_value())
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(entriesMutex);
+        auto it = entries.find(gameName);
+        return it == entries.end()
+            || it->second.stamp.path != stamp->path
+            || it->second.stamp.lastWriteTime != stamp->lastWriteTime;
+    } // end of needsLoading()
+
+
+    void GameDefinitionCache::invalidate(const std::string &gameName)
+    {
+        erase(gameName);
+    } // end of invalidate()
+
+
+    void GameDefinitionCache::reload(const std::string &gameName)
+    {
+        // Only the cached entry matters here, a failure is reported by the next getGame
+        (void)getGame(gameName);
+    } // end of reload()
+
+
+    void GameDefinitionCache::store(const std::string &gameName, const GameFileStamp &stamp, uint64_t contentHash,
+                                    std::shared_ptr<const CompiledGame> game)
+    {
+        std::lock_guard<std::mutex> lock(entriesMutex);
+        entries.insert_or_assign(gameName, Entry{stamp, contentHash, std::move(game)});
+    } // end of store()
+
+
+    [[nodiscard]] size_t GameDefinitionCache::size() const noexcept
+    {
+        std::lock_guard<std::mutex> lock(entriesMutex);
+        return entries.size();
+    } // end of size()
+
+
+    void GameDefinitionCache::erase(const std::string &gameName)
+    {
+        std::lock_guard<std::mutex> lock(entriesMutex);
+        entries.erase(gameName);
+    } // end of erase()
+}
@@ -0,0 +1,99 @@
+#include "GameLibraryValidator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace logic
+{
+    [[nodiscard]] size_t GameValidationReport::failureCount() const noexcept
+    {
+        return std::count_if(results.begin(), results.end(), [](const GameValidationResult &result)
+                             { return result.error.has_value(); });
+    } // end of failureCount()
+
+
+    GameLibraryValidator::GameLibraryValidator(GameManager &gameManager, size_t threadCount)
+        : gameManager(gameManager),
+          threadCount(threadCount > 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency())) {}
+
+
+    [[nodiscard]] GameValidationReport
+    GameLibraryValidator::validateAll(GameDefinitionCache *warmCache) const
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const std::vector<std::string> gameNames = gameManager.listGameNames();
+
+        GameValidationReport report;
+        report.results.resize(gameNames.size());
+        report.threadCount = std::min(threadCount, std::max<size_t>(gameNames.size(), 1));
+
+        std::atomic<size_t> nextGame = 0;
+        auto worker = [&]()
+        {
+            for (size_t i = nextGame++; i < gameNames.size(); i = nextGame++)
+            {
+                report.results[i] = validateGame(gameNames[i], warmCache);
+            }
+        };
+
+        {
+            std::vector<std::jthread> workers;
+            for (size_t i = 1; i < report.threadCount; i++)
+            {
+                workers.emplace_back(worker);
+            }
+            worker(); // the calling thread takes part too
+        }
+
+        report.totalTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        return report;
+    } // end of validateAll()
+
+
+    [[nodiscard]] GameValidationResult
+    GameLibraryValidator::validateGame(const std::string &gameName, GameDefinitionCache *warmCache) const
+    {
+        GameValidationResult result{gameName};
+
+        auto stamp = gameManager.getGameFileStamp(gameName);
+        auto gameFile = gameManager.readGameFile(gameName);
+        if (!stamp.has_value() || !gameFile.has_value())
+        {
+            result.error = "Unable to read game file";
+            return result;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        auto game = compileGame(gameName, gameFile->getContents(), true);
+        result.parseTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        if (!game.has_value())
+        {
+            result.error = game.error();
+        }
+        else if (warmCache != nullptr)
+        {
+            warmCache->store(gameName, stamp.value(), gameFile->getContentHash(), game.value());
+        }
+        return result;
+    } // end of validateGame()
+
+
+    void printValidationReport(std::ostream &out, const GameValidationReport &report)
+    {
+        for (const auto &result : report.results)
+        {
+            out << (result.error ? "FAIL " : "OK   ") << result.gameName
+                << " (" << result.parseTime.count() << " us)";
+            if (result.error)
+            {
+                out << ": " << result.error.value();
+            }
+            out << "\n";
+        }
+
+        out << report.results.size() << " games validated on " << report.threadCount << " threads in "
+            << report.totalTime.count() << " ms, " << report.failureCount() << " failed" << std::endl;
+    } // end of printValidationReport()
+}
@@ -3,6 +3,9 @@
 
 namespace logic
 {
+    // Position saved while a rule is part way through, see Session::getInterpreterPosition
+    const int MID_RULE_POSITION = -2;
+
     Interpreter createInterpreter(std::string sourceCode, Session *session)
     {
         TSParser parser{sourceCode};
@@ -24,6 +27,11 @@ namespace logic
     {
     }
 
+    GameProcess::GameProcess(Session *session, std::shared_ptr<const CompiledGame> game)
+        : session(session), game(game), interpreter(game->ruleSpecs, session)
+    {
+    }
+
     int GameProcess::getSessionId() const noexcept
     {
         return session->getId();
@@ -37,7 +45,37 @@ namespace logic
     [[nodiscard]] RuleExecutionOutcome 
     GameProcess::execute() noexcept
     {
-        return interpreter.executeRules();
+        RuleExecutionOutcome outcome = interpreter.executeRules();
+        const InterpreterState &state = interpreter.getState();
+        session->setInterpreterPosition(state.isBetweenTopLevelRules() ? state.topLevelRulesRemaining() : MID_RULE_POSITION);
+        // The rules woken by a deadline have seen it pass
+        session->clearPassedDeadline();
+        return outcome;
+    }
+
+    bool GameProcess::restorePosition() noexcept
+    {
+        return interpreter.restorePosition(session->getInterpreterPosition());
+    }
+
+    bool GameProcess::isPaused() const noexcept
+    {
+        return session->isPaused();
+    }
+
+    std::optional<std::chrono::steady_clock::time_point> GameProcess::getWakeDeadline() const noexcept
+    {
+        return session->getWakeDeadline();
+    }
+
+    bool GameProcess::hasDeadlinePassed() const noexcept
+    {
+        return session->hasDeadlinePassed();
+    }
+
+    void GameProcess::wake() noexcept
+    {
+        session->passDeadline();
     }
 
     /*
@@ -53,8 +91,11 @@ namespace logic
 
     bool ProcessTraits<GameProcess>::isWaitingForIO() const
     {
-        return process.getLastInterpreterOutcome() == RuleExecutionOutcome::SUCCESS_WAITING_FOR_INPUT
-            || process.getLastInterpreterOutcome() == RuleExecutionOutcome::SUCCESS_DELIVERING_OUTPUT;
+        // A paused session waits like one waiting for its players, a passed deadline ends the wait
+        return process.isPaused()
+            || (!process.hasDeadlinePassed()
+                && (process.getLastInterpreterOutcome() == RuleExecutionOutcome::SUCCESS_WAITING_FOR_INPUT
+                    || process.getLastInterpreterOutcome() == RuleExecutionOutcome::SUCCESS_DELIVERING_OUTPUT));
     }
 
     bool ProcessTraits<GameProcess>::isDone() const
@@ -63,6 +104,16 @@ namespace logic
             || process.getLastInterpreterOutcome() == RuleExecutionOutcome::INTERNAL_FAILURE;
     }
 
+    std::optional<std::chrono::steady_clock::time_point> ProcessTraits<GameProcess>::getWakeDeadline() const
+    {
+        return process.getWakeDeadline();
+    }
+
+    void ProcessTraits<GameProcess>::wake()
+    {
+        process.wake();
+    }
+
     void ProcessTraits<GameProcess>::tick()
     {
         RuleExecutionOutcome result = process.execute();
@@ -1,5 +1,6 @@
 #include "AssignmentRule.h"
 #include "Interpreter.h"
+#include "data/metrics.h"
 
 
 namespace logic {
@@ -19,7 +20,11 @@ namespace logic {
 
 
     [[nodiscard]] RuleExecutionOutcome Interpreter::executeRules() noexcept { 
+        static Counter &ruleExecutions = MetricsRegistry::instance().counter(
+            "rule_executions_total", "Game rules executed by the interpreter");
+
         RuleExecutionOutcome ruleOutcome = RuleExecutionOutcome::SUCCESS_WITH_NO_NESTED_RULES_REMAINING;
+        uint64_t executed = 0;
 
         while (ruleOutcome != RuleExecutionOutcome::INTERNAL_FAILURE
                && ruleOutcome != RuleExecutionOutcome::NO_MORE_RULES_TO_EXECUTE
@@ -42,16 +47,31 @@ namespace logic {
 
             ExecuteRuleResult result = rulesRegister[ruleSpec.value()->ruleType]->execute(*ruleSpec, interpreterState);
             ruleOutcome = result.outcome;
+            executed++;
             if (ruleOutcome == RuleExecutionOutcome::INTERNAL_FAILURE) {
                 break;
             }
             
         }
         interpreterState.setLastOutcome(ruleOutcome);
+        ruleExecutions.add(executed);
         return ruleOutcome;
     } // end of executeRule()
 
     [[nodiscard]] InterpreterState const& Interpreter::getState() const noexcept {
         return interpreterState;
     }
+
+    [[nodiscard]] bool Interpreter::restorePosition(int topLevelRulesRemaining) noexcept {
+        if (topLevelRulesRemaining == -1) {
+            return true; // the game had not started executing
+        }
+        if (topLevelRulesRemaining < 0 || topLevelRulesRemaining > interpreterState.topLevelRulesRemaining()) {
+            return false;
+        }
+        while (interpreterState.topLevelRulesRemaining() > topLevelRulesRemaining) {
+            (void)interpreterState.getNextRuleSpec();
+        }
+        return true;
+    } // end of restorePosition()
 }
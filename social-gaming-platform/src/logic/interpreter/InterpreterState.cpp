@@ -3,7 +3,10 @@
 namespace logic
 {
     InterpreterState::InterpreterState(RuleSpecStack ruleSpecStack, Session *session)
-        : ruleSpecStack(std::move(ruleSpecStack)), session(session) {}
+        : ruleSpecStack(std::move(ruleSpecStack)), session(session)
+    {
+        topLevelRemaining = this->ruleSpecStack.size();
+    }
 
     [[nodiscard]] std::optional<std::shared_ptr<BaseRuleSpecification>>
     InterpreterState::getNextRuleSpec() noexcept
@@ -13,6 +16,10 @@ namespace logic
             return std::nullopt;
         }
 
+        if (isBetweenTopLevelRules())
+        {
+            topLevelRemaining--;
+        }
         auto spec = std::move(ruleSpecStack.top());
         ruleSpecStack.pop();
         return std::move(spec);
@@ -29,6 +36,18 @@ namespace logic
         return ruleSpecStack.size();
     } // end of rulesRemaining()
 
+    [[nodiscard]] int
+    InterpreterState::topLevelRulesRemaining() const noexcept
+    {
+        return topLevelRemaining;
+    } // end of topLevelRulesRemaining()
+
+    [[nodiscard]] bool
+    InterpreterState::isBetweenTopLevelRules() const noexcept
+    {
+        return static_cast<int>(ruleSpecStack.size()) == topLevelRemaining;
+    } // end of isBetweenTopLevelRules()
+
     [[nodiscard]] Session *
     InterpreterState::getSession() const noexcept
     {
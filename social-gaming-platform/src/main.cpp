@@ -1,67 +1,61 @@
+#include <cstring>
 #include <iostream>
-#include <fstream>
-#include <vector>
+#include <stdexcept>
+#include <string>
 
 #include "data/data.h"
-#include "logic/parsers/tree_sitter/TSParser.h"
+#include "logic/GameLibraryValidator.h"
 
 
+int printUsage(const char *program)
+{
+    std::cerr << "Usage:\n  " << program << " <game directory> [--threads N]\n"
+              << "  e.g. " << program << " ../games\n";
+    return 1;
+}
 
-int main()
+int main(int args, char *argv[])
 {
-    std::string sourceCode;
-    
-    std::string filePath = "../games/RPS.game";
-    std::ifstream file(filePath);
-      if (file.is_open())
-    {
-      std::string line;
-      while (getline(file, line))
-      {
-        sourceCode += line + "\n";
-      }
-      file.close();
-    }
-    else{
-      std::cerr << "Unable to open file: " << filePath << std::endl;
-      return 1;
-    }
-    if (sourceCode.empty())
+    if (args < 2)
     {
-      std::cerr << "File is empty: " << filePath << std::endl;
-      return 1;
-    }
-    logic::TSParser parser(sourceCode);
-
-    auto configuration = parser.parseConfigurationField();
-    if (!configuration) {
-        std::cerr << "Error: " << configuration.error() << std::endl;
-        return 1;
-    }
-
-    auto globalConstants = parser.parseGlobalConstantsField();
-    if (!globalConstants) {
-        std::cerr << "Error: " << globalConstants.error() << std::endl;
-        return 1;
-    }
-
-    auto globalVariables = parser.parseGlobalVariablesField();
-    if (!globalVariables) {
-        std::cerr << "Error: " << globalVariables.error() << std::endl;
-        return 1;
-    }
-
-    auto player = parser.parsePlayerField();
-    if (!player) {
-        std::cerr << "Error: " << player.error() << std::endl;
-        return 1;
-    }
-
-    auto audience = parser.parseAudienceField();
-    if (!audience) {
-        std::cerr << "Error: " << audience.error() << std::endl;
-        return 1;
+        return printUsage(argv[0]);
     }
 
-    return 0;
+    size_t threadCount = 0;
+    for (int i = 2; i < args; i += 2)
+    {
+        if (std::strcmp(argv[i], "--threads") != 0)
+        {
+            std::cerr << "Unknown option: " << argv[i] << "\n";
+            return printUsage(argv[0]);
+        }
+        if (i + 1 == args)
+        {
+            std::cerr << "Missing value for " << argv[i] << "\n";
+            return printUsage(argv[0]);
+        }
+
+        try
+        {
+            size_t parsed = 0;
+            threadCount = std::stoul(argv[i + 1], &parsed);
+            if (argv[i + 1][0] == '-' || argv[i + 1][parsed] != '\0')
+            {
+                throw std::invalid_argument(argv[i + 1]);
+            }
+        }
+        catch (const std::logic_error &)
+        {
+            std::cerr << "Invalid thread count: " << argv[i + 1] << "\n";
+            return printUsage(argv[0]);
+        }
+    }
+
+    GameManager gameManager(argv[1]);
+    logic::GameLibraryValidator validator(gameManager, threadCount);
+
+    auto report = validator.validateAll();
+    logic::printValidationReport(std::cout, report);
+
+    return report.failureCount() > 0 ? 1 : 0;
 }
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include "data/data.h"
+
+TEST(AudienceGroupTest, AddAndRemoveMembers) {
+    AudienceGroup audience;
+
+    EXPECT_TRUE(audience.add({101}));
+    EXPECT_TRUE(audience.add({102}));
+    EXPECT_TRUE(audience.add({103}));
+    EXPECT_FALSE(audience.add({102}));
+    EXPECT_EQ(audience.size(), 3);
+
+    EXPECT_TRUE(audience.remove(101));
+    EXPECT_FALSE(audience.remove(101));
+    EXPECT_EQ(audience.size(), 2);
+    EXPECT_FALSE(audience.contains(101));
+    EXPECT_TRUE(audience.contains(102));
+    EXPECT_TRUE(audience.contains(103));
+
+    // The index must follow the member that was moved into the freed slot
+    EXPECT_TRUE(audience.remove(103));
+    EXPECT_TRUE(audience.remove(102));
+    EXPECT_EQ(audience.size(), 0);
+}
+
+TEST(AudienceGroupTest, SessionKeepsAudienceApartFromPlayers) {
+    SessionManager sessionManager;
+    Session *session = sessionManager.createSession(1, GameData()).value();
+    session->addPlayer({1});
+
+    auto spectator = sessionManager.addAudienceMemberToSession(session->getJoinCode(), {2});
+    ASSERT_TRUE(spectator.has_value());
+    EXPECT_EQ(session->getPlayers().size(), 1);
+    EXPECT_EQ(session->getAudience().size(), 1);
+
+    EXPECT_FALSE(sessionManager.addAudienceMemberToSession(session->getJoinCode(), {1}).has_value());
+    EXPECT_FALSE(sessionManager.addAudienceMemberToSession(session->getJoinCode(), {2}).has_value());
+
+    // Spectators who join the game move from the audience to the players
+    ASSERT_TRUE(sessionManager.addPlayerToSession(session->getJoinCode(), {2}).has_value());
+    EXPECT_EQ(session->getPlayers().size(), 2);
+    EXPECT_EQ(session->getAudience().size(), 0);
+}
+
+TEST(AudienceGroupTest, RejectsAudienceWhenDisabled) {
+    DataNode configNode;
+    configNode.setMapValue("audience", create_bool_node(false));
+    GameData gameData;
+    gameData.configuration = Configuration(configNode);
+
+    SessionManager sessionManager;
+    Session *session = sessionManager.createSession(1, gameData).value();
+
+    EXPECT_FALSE(sessionManager.addAudienceMemberToSession(session->getJoinCode(), {2}).has_value());
+}
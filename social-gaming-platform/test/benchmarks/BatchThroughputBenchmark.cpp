@@ -0,0 +1,68 @@
+/**
+ * Measures how the cost of processing a receive batch grows with its size.
+ * Per-message time should stay flat as the batch grows.
+ *
+ * Usage: batch_throughput_benchmark [html response file] [port]
+ */
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include "external/GameServer.h"
+
+namespace
+{
+    const size_t MESSAGES_PER_SIZE = 1 << 15;
+
+    std::deque<Message> makeBatch(size_t size)
+    {
+        std::deque<Message> batch;
+        for (size_t i = 0; i < size; i++)
+        {
+            Connection client{1000 + i};
+            batch.push_back(Message{client, R"({"action":"2","body":"benchmark","request_id":")" + std::to_string(i) + "\"}"});
+        }
+        return batch;
+    }
+}
+
+int main(int args, char *argv[])
+{
+    char defaultHtml[] = "../src/external/src/external/web-socket-networking/webchat.html";
+    char *html = args > 1 ? argv[1] : defaultHtml;
+    unsigned short port = args > 2 ? std::stoi(argv[2]) : 8100;
+
+    ServerOptions options;
+    options.validateGames = false;
+    options.watchGames = false;
+    GameServer gameServer(port, html, options);
+
+    // Keep logging out of the measurement
+    Logger::instance().setLevel(LogLevel::OFF);
+    std::ostream &report = std::cout;
+
+    report << std::setw(10) << "batch" << std::setw(16) << "ns/message" << std::setw(16) << "messages/s" << "\n";
+
+    for (size_t batchSize = 1; batchSize <= 4096; batchSize *= 2)
+    {
+        const auto batch = makeBatch(batchSize);
+        const size_t rounds = std::max<size_t>(1, MESSAGES_PER_SIZE / batchSize);
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < rounds; round++)
+        {
+            std::deque<Broadcast> outgoing;
+            for (auto &result : gameServer.processMessages(batch))
+            {
+                gameServer.appendOutgoing(std::move(result), outgoing);
+            }
+        }
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+
+        double nsPerMessage = elapsed.count() / static_cast<double>(rounds * batchSize);
+        report << std::setw(10) << batchSize << std::setw(16) << std::fixed << std::setprecision(1) << nsPerMessage
+               << std::setw(16) << std::setprecision(0) << 1e9 / nsPerMessage << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+/**
+ * Measures fanning one response out to every player of a large session,
+ * serialized once into a shared payload, against copying the payload into
+ * a message per player with a linear scan of the named recipients.
+ *
+ * Usage: broadcast_fanout_benchmark [recipients] [payload bytes]
+ */
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include "external/ResponseRouting.h"
+
+namespace
+{
+    const size_t ROUNDS = 200;
+
+    // How responses were fanned out before payloads were shared
+    std::deque<Message> copyPerRecipient(const std::string &log, const Session &session, const std::vector<uintptr_t> &clientIDs)
+    {
+        std::deque<Message> outgoing;
+        for (const auto &client : session.getPlayers())
+        {
+            if (clientIDs.empty() || std::find(clientIDs.begin(), clientIDs.end(), client.getId()) != clientIDs.end())
+            {
+                outgoing.push_back({client.getConnection(), log});
+            }
+        }
+        return outgoing;
+    }
+
+    template <typename Fanout>
+    double microsPerRound(Fanout fanout)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < ROUNDS; round++)
+        {
+            fanout();
+        }
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / ROUNDS;
+    }
+}
+
+int main(int args, char *argv[])
+{
+    size_t recipients = args > 1 ? std::stoul(argv[1]) : 5000;
+    size_t payloadSize = args > 2 ? std::stoul(argv[2]) : 1024;
+
+    SessionManager sessionManager;
+    GameData gameData;
+    Session *session = sessionManager.createSession(0, gameData).value();
+    for (uintptr_t player = 0; player < recipients; player++)
+    {
+        sessionManager.addPlayer(*session, Connection{player});
+    }
+
+    const std::string log(payloadSize, 'x');
+    std::expected<Session *, std::string_view> sessionResult = session;
+
+    // Every second player is named explicitly
+    std::vector<uintptr_t> named;
+    for (uintptr_t player = 0; player < recipients; player += 2)
+    {
+        named.push_back(player);
+    }
+
+    std::ostream &report = std::cout;
+    report << recipients << " recipients, " << payloadSize << " byte payload, microseconds per response\n";
+    report << std::setw(12) << "recipients" << std::setw(18) << "copy per player" << std::setw(18) << "shared payload"
+           << std::setw(18) << "+ send copies" << "\n";
+
+    const std::vector<uintptr_t> everyone;
+    const std::pair<const char *, const std::vector<uintptr_t> &> cases[] = {{"named", named}, {"all", everyone}};
+
+    for (const auto &[label, ids] : cases)
+    {
+        double copied = microsPerRound([&]
+                                       { copyPerRecipient(log, *session, ids); });
+        double shared = microsPerRound([&]
+                                       { buildBroadcast(std::make_shared<const std::string>(log), sessionResult, ids); });
+
+        // The networking library still takes one string per message when sending
+        double sent = microsPerRound([&]
+                                     {
+            std::deque<Broadcast> broadcasts;
+            broadcasts.push_back(buildBroadcast(std::make_shared<const std::string>(log), sessionResult, ids));
+            std::deque<Message> messages;
+            appendMessages(broadcasts, messages); });
+
+        report << std::setw(12) << label << std::fixed << std::setprecision(1)
+               << std::setw(18) << copied << std::setw(18) << shared << std::setw(18) << sent << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * Measures the whole request pipeline of the game server, from a received
+ * message to the reply handed to the transport, with clients on the
+ * loopback transport instead of sockets. Every client creates its own
+ * session, then sends echo requests answered inside that session.
+ *
+ * Usage: loopback_pipeline_benchmark <game directory> [clients] [rounds] [workers]
+ */
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include "external/GameServer.h"
+#include "external/LoopbackTransport.h"
+
+namespace
+{
+    std::string makeMessage(const std::string &action, const std::string &body)
+    {
+        return R"({"action":")" + action + R"(","body":")" + body + R"(","request_id":"1"})";
+    }
+
+    // Step the server until the clients got the given number of replies
+    size_t pumpReplies(GameServer &server, LoopbackTransport &transport, size_t expectedReplies)
+    {
+        // Replies only go to players in a session, give up if some never arrive
+        auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+
+        size_t replies = 0;
+        while (replies < expectedReplies && std::chrono::steady_clock::now() < giveUp)
+        {
+            server.update();
+            replies += transport.takeSent().size();
+        }
+        return replies;
+    }
+}
+
+int main(int args, char *argv[])
+{
+    if (args < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <game directory> [clients] [rounds] [workers]\n";
+        return 1;
+    }
+
+    size_t clientCount = args > 2 ? std::stoul(argv[2]) : 1024;
+    size_t rounds = args > 3 ? std::stoul(argv[3]) : 256;
+
+    ServerOptions options;
+    options.gameDirectory = argv[1];
+    options.workerThreads = args > 4 ? std::stoul(argv[4]) : 0;
+    options.preparationThreads = 2;
+    options.rateLimits = {};
+    options.maxPendingRequests = clientCount * rounds;
+    options.outboundLimit = {rounds + 1, 1 << 30};
+    options.sendBudget = {rounds + 1, 1 << 30};
+
+    auto gameNames = GameManager(options.gameDirectory).listGameNames();
+    if (gameNames.empty())
+    {
+        std::cerr << "No games found in " << argv[1] << "\n";
+        return 1;
+    }
+
+    // Keep logging out of the measurement
+    Logger::instance().setLevel(LogLevel::OFF);
+
+    auto owned = std::make_unique<LoopbackTransport>();
+    LoopbackTransport &transport = *owned;
+    GameServer server(std::move(owned), options);
+
+    std::vector<Connection> clients;
+    for (size_t i = 0; i < clientCount; i++)
+    {
+        clients.push_back(transport.connect());
+        transport.sendToServer(clients.back(), makeMessage("3", gameNames.front()));
+    }
+    pumpReplies(server, transport, clientCount);
+
+    const std::string echo = makeMessage("2", "benchmark");
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; round++)
+    {
+        for (const auto &client : clients)
+        {
+            transport.sendToServer(client, echo);
+        }
+    }
+    size_t replies = pumpReplies(server, transport, clientCount * rounds);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << std::fixed << std::setprecision(0)
+              << "clients " << clientCount << ", workers " << options.workerThreads << ": "
+              << replies << " replies in " << std::setprecision(3) << elapsed.count() << " s, "
+              << std::setprecision(0) << replies / elapsed.count() << " requests/s\n";
+
+    server.stop();
+    return replies == clientCount * rounds ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+/**
+ * Measures the cost of recording into a counter and a latency histogram,
+ * from one thread and from several threads sharing the same metrics.
+ *
+ * Usage: metrics_recording_benchmark [threads] [records per thread]
+ */
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "data/metrics.h"
+
+namespace
+{
+    template <typename Record>
+    double nanosPerRecord(unsigned threads, size_t records, Record record)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::jthread> workers;
+        for (unsigned i = 0; i < threads; i++)
+        {
+            workers.emplace_back([records, &record]()
+                                 {
+                                     for (size_t j = 0; j < records; j++)
+                                     {
+                                         record(j);
+                                     } });
+        }
+        workers.clear();
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / records;
+    }
+}
+
+int main(int args, char *argv[])
+{
+    unsigned threads = args > 1 ? std::stoul(argv[1]) : std::max(2u, std::thread::hardware_concurrency());
+    size_t records = args > 2 ? std::stoul(argv[2]) : 10000000;
+
+    Counter counter;
+    Histogram histogram;
+
+    auto count = [&counter](size_t)
+    { counter.add(); };
+    auto observe = [&histogram](size_t j)
+    { histogram.recordNanos(j & 0xFFFFF); };
+    auto timed = [&histogram](size_t)
+    {
+        auto start = std::chrono::steady_clock::now();
+        histogram.record(std::chrono::steady_clock::now() - start);
+    };
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "threads  counter ns  histogram ns  timed histogram ns\n";
+    for (unsigned n : {1u, threads})
+    {
+        std::cout << std::setw(7) << n
+                  << std::setw(12) << nanosPerRecord(n, records, count)
+                  << std::setw(14) << nanosPerRecord(n, records, observe)
+                  << std::setw(20) << nanosPerRecord(n, records, timed) << "\n";
+    }
+
+    // Keep the recordings from being optimized away
+    return counter.value() == 0 || histogram.snapshot().count == 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * Measures the cost of parsing a client message into a request: building
+ * a JSON document and copying its fields out, as requests used to be
+ * parsed, against scanning the message for the fields in one pass.
+ *
+ * Usage: request_parse_benchmark [messages per kind]
+ */
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "external/Request.h"
+#include "external/RequestScanner.h"
+
+namespace
+{
+    using json = nlohmann::json;
+
+    // The fields the document based parse kept
+    struct DocumentRequest
+    {
+        int action = -1;
+        std::string body;
+        std::string sessionId;
+        std::string requestId;
+        std::optional<std::string> targetVar;
+    };
+
+    DocumentRequest parseDocument(const std::string &message)
+    {
+        DocumentRequest request;
+        json document = json::parse(message);
+        if (document.contains("action"))
+        {
+            request.action = std::stoi(document["action"].get<std::string>());
+        }
+        if (document.contains("body"))
+        {
+            request.body = document["body"].get<std::string>();
+        }
+        if (document.contains("sessionID"))
+        {
+            request.sessionId = document["sessionID"].get<std::string>();
+        }
+        if (document.contains("request_id"))
+        {
+            request.requestId = document["request_id"].get<std::string>();
+        }
+        if (document.contains("target_var"))
+        {
+            request.targetVar = document["target_var"].get<std::string>();
+        }
+        return request;
+    }
+
+    template <typename Parse>
+    double nanosPerMessage(const std::vector<std::string> &messages, size_t repeats, Parse parse)
+    {
+        size_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < repeats; i++)
+        {
+            for (const auto &message : messages)
+            {
+                checksum += parse(message);
+            }
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+        // Keep the parses from being optimized away
+        if (checksum == 0)
+        {
+            std::cerr << "nothing parsed\n";
+        }
+        return elapsed.count() / (repeats * messages.size());
+    }
+}
+
+int main(int args, char *argv[])
+{
+    size_t repeats = args > 1 ? std::stoul(argv[1]) : 200000;
+
+    struct Kind
+    {
+        const char *name;
+        std::string message;
+    };
+    std::vector<Kind> kinds = {
+        {"input", R"({"action":"11","body":"rock","sessionID":"ABCD","request_id":"42","target_var":"choice"})"},
+        {"echo", R"({"action":"2","body":"hello","request_id":"43"})"},
+        {"new game", R"({"action":"3","body":"rock_paper_scissors","request_id":"44","client":{"version":"1.4.2","features":["audience","pause"]}})"},
+        {"chat", R"({"action":"20","body":")" + std::string(400, 'x') + R"(\n\"quoted\"","sessionID":"ABCD","request_id":"45"})"},
+    };
+
+    Connection client{1};
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "message     document ns  scanned ns  request ns\n";
+    for (const auto &kind : kinds)
+    {
+        std::vector<std::string> messages(1, kind.message);
+
+        double document = nanosPerMessage(messages, repeats, [](const std::string &message)
+                                          { return parseDocument(message).body.size(); });
+        double scanned = nanosPerMessage(messages, repeats, [](const std::string &message)
+                                         { return scanRequest(message).has_value() ? 1 : 0; });
+        double request = nanosPerMessage(messages, repeats, [client](const std::string &message)
+                                         { return Request(message, client).body.size(); });
+
+        std::cout << std::left << std::setw(10) << kind.name << std::right
+                  << std::setw(13) << document
+                  << std::setw(12) << scanned
+                  << std::setw(12) << request << "\n";
+    }
+    return 0;
+}
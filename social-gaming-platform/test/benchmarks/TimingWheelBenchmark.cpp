@@ -0,0 +1,86 @@
+/**
+ * Measures the timer service with many pending input timeouts: scheduling,
+ * cancelling when inputs arrive, and firing the rest, per timer, at each
+ * number of pending timers.
+ *
+ * Usage: timing_wheel_benchmark [largest pending count]
+ */
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "logic/scheduler/TimingWheel.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double nanosPer(Clock::time_point start, size_t count)
+    {
+        std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+        return elapsed.count() / count;
+    }
+}
+
+int main(int args, char *argv[])
+{
+    size_t largest = args > 1 ? std::stoul(argv[1]) : 1000000;
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "pending    schedule ns  cancel ns  fire ns\n";
+    for (size_t pending = 1000; pending <= largest; pending *= 10)
+    {
+        auto origin = Clock::now();
+        logic::TimingWheel<int> wheel(std::chrono::milliseconds(1), origin);
+        std::mt19937 random(1);
+
+        // Input timeouts of 1 to 60 seconds
+        std::uniform_int_distribution<int> delay(1000, 60000);
+        std::vector<Clock::time_point> deadlines;
+        deadlines.reserve(pending);
+        for (size_t i = 0; i < pending; i++)
+        {
+            deadlines.push_back(origin + std::chrono::milliseconds(delay(random)));
+        }
+
+        std::vector<logic::TimerHandle> handles;
+        handles.reserve(pending);
+        auto start = Clock::now();
+        for (size_t i = 0; i < pending; i++)
+        {
+            handles.push_back(wheel.schedule(deadlines[i], static_cast<int>(i)));
+        }
+        double schedule = nanosPer(start, pending);
+
+        // Most players answer in time
+        start = Clock::now();
+        for (size_t i = 0; i < pending; i++)
+        {
+            if (i % 4 != 0)
+            {
+                wheel.cancel(handles[i]);
+            }
+        }
+        double cancel = nanosPer(start, pending - (pending + 3) / 4);
+
+        // The server loop advances every few milliseconds
+        std::vector<int> expired;
+        expired.reserve(pending);
+        size_t remaining = wheel.size();
+        start = Clock::now();
+        for (auto now = origin; !wheel.empty(); now += std::chrono::milliseconds(5))
+        {
+            wheel.advance(now, expired);
+        }
+        double fire = nanosPer(start, remaining);
+
+        std::cout << std::left << std::setw(9) << pending << std::right
+                  << std::setw(14) << schedule
+                  << std::setw(11) << cancel
+                  << std::setw(9) << fire << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+/**
+ * Compares the JSON wire format with the compact one on the traffic of a
+ * rock paper scissors round: the size of each message, the time to decode
+ * a client's request and the time to encode the server's reply.
+ *
+ * Usage: wire_codec_benchmark [messages per kind]
+ */
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "external/Request.h"
+#include "external/Response.h"
+#include "external/WireCodec.h"
+
+namespace
+{
+    template <typename Run>
+    double nanosPerMessage(size_t repeats, Run run)
+    {
+        size_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < repeats; i++)
+        {
+            checksum += run();
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+        // Keep the work from being optimized away
+        if (checksum == 0)
+        {
+            std::cerr << "nothing encoded\n";
+        }
+        return elapsed.count() / repeats;
+    }
+
+    void printRow(const char *name, size_t jsonBytes, size_t compactBytes, double jsonNanos, double compactNanos)
+    {
+        std::cout << std::left << std::setw(12) << name << std::right
+                  << std::setw(11) << jsonBytes
+                  << std::setw(14) << compactBytes
+                  << std::setw(10) << jsonNanos
+                  << std::setw(13) << compactNanos << "\n";
+    }
+}
+
+int main(int args, char *argv[])
+{
+    size_t repeats = args > 1 ? std::stoul(argv[1]) : 200000;
+    Connection client{1};
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "message     json bytes  compact bytes  json ns  compact ns\n";
+
+    // Requests, decoded by the server
+    struct RequestKind
+    {
+        const char *name;
+        std::string json;
+        std::string compact;
+    };
+    RequestKind requests[] = {
+        {"choice", R"({"action":"11","body":"rock","sessionID":"ABCD","request_id":"42","target_var":"choice"})",
+         encodeCompactRequest(MessageType::INPUT_CHOICE, "rock", "42", "ABCD", "choice")},
+        {"join", R"({"action":"0","body":"ABCD","request_id":"1"})",
+         encodeCompactRequest(MessageType::JOIN, "ABCD", "1")},
+    };
+    for (const auto &kind : requests)
+    {
+        double json = nanosPerMessage(repeats, [&]()
+                                      { return Request(kind.json, client).body.size(); });
+        double compact = nanosPerMessage(repeats, [&]()
+                                         { return Request(kind.compact, client).body.size(); });
+        printRow(kind.name, kind.json.size(), kind.compact.size(), json, compact);
+    }
+
+    // Responses, encoded by the server into a reused buffer
+    struct ResponseKind
+    {
+        const char *name;
+        Response response;
+    };
+    ResponseKind responses[] = {
+        {"prompt", InputResponse(CommonResponse("ABCD", "Choose rock, paper or scissors", MessageType::INPUT_CHOICE,
+                                                {101, 102, 103, 104}), "choice", 30)},
+        {"score", MessageResponse(CommonResponse("ABCD", "alice: 2, bob: 1, carol: 0", MessageType::SCORE))},
+        {"reply", MessageResponse(CommonResponse("ABCD", "rock", MessageType::MESSAGE, {101}, true, "42"))},
+    };
+    std::string buffer;
+    for (const auto &kind : responses)
+    {
+        double json = nanosPerMessage(repeats, [&]()
+                                      { serializeResponse(kind.response, buffer); return buffer.size(); });
+        double compact = nanosPerMessage(repeats, [&]()
+                                         { encodeCompactResponse(kind.response, buffer); return buffer.size(); });
+        printRow(kind.name, serializeResponse(kind.response).size(), encodeCompactResponse(kind.response).size(), json,
+                 compact);
+    }
+    return 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * Measures request throughput of the session worker pool as workers are added.
+ * Every client creates its own session, then sends echo requests that are
+ * answered inside that session, so the load spreads over many sessions.
+ *
+ * Usage: worker_scaling_benchmark <game directory> [max workers]
+ */
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include "external/SessionWorker.h"
+
+namespace
+{
+    const uintptr_t CLIENTS = 2048;
+    const size_t ECHO_ROUNDS = 32;
+
+    Request makeRequest(uintptr_t client, const std::string &action, const std::string &body)
+    {
+        return Request(R"({"action":")" + action + R"(","body":")" + body + R"(","request_id":"1"})", Connection{client});
+    }
+
+    // Dispatch every request and wait for the given number of replies
+    void runPhase(WorkerPool &pool, std::vector<Request> requests, size_t expectedReplies)
+    {
+        for (auto &request : requests)
+        {
+            pool.dispatch(std::move(request));
+        }
+
+        // Replies only go to players in a session, give up if some never arrive
+        auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+
+        std::deque<Broadcast> replies;
+        while (replies.size() < expectedReplies && std::chrono::steady_clock::now() < giveUp)
+        {
+            if (!pool.collect(replies))
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+int main(int args, char *argv[])
+{
+    if (args < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <game directory> [max workers]\n";
+        return 1;
+    }
+
+    GameManager gameManager(argv[1]);
+    auto gameNames = gameManager.listGameNames();
+    if (gameNames.empty())
+    {
+        std::cerr << "No games found in " << argv[1] << "\n";
+        return 1;
+    }
+    logic::GameDefinitionCache gameCache(gameManager);
+    unsigned maxWorkers = args > 2 ? std::stoul(argv[2]) : std::thread::hardware_concurrency();
+
+    // Keep logging out of the measurement
+    Logger::instance().setLevel(LogLevel::OFF);
+    std::ostream &report = std::cout;
+
+    report << std::setw(10) << "workers" << std::setw(16) << "requests/s" << std::setw(12) << "speedup" << "\n";
+
+    double baseline = 0;
+    for (unsigned workers = 1; workers <= maxWorkers; workers *= 2)
+    {
+        ServerOptions options;
+        WorkerPool pool(workers, gameManager, gameCache, options);
+        pool.start();
+
+        std::vector<Request> sessions;
+        for (uintptr_t client = 0; client < CLIENTS; client++)
+        {
+            sessions.push_back(makeRequest(client, "3", gameNames.front()));
+        }
+        runPhase(pool, std::move(sessions), CLIENTS);
+
+        std::vector<Request> echoes;
+        for (size_t round = 0; round < ECHO_ROUNDS; round++)
+        {
+            for (uintptr_t client = 0; client < CLIENTS; client++)
+            {
+                echoes.push_back(makeRequest(client, "2", "benchmark"));
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        runPhase(pool, std::move(echoes), CLIENTS * ECHO_ROUNDS);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        pool.stop();
+
+        double throughput = CLIENTS * ECHO_ROUNDS / elapsed.count();
+        baseline = baseline > 0 ? baseline : throughput;
+        report << std::setw(10) << workers << std::setw(16) << std::fixed << std::setprecision(0) << throughput
+               << std::setw(12) << std::setprecision(2) << throughput / baseline << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+
+#include "external/ClientRegistry.h"
+
+TEST(ClientRegistryTest, AddFindAndRemove)
+{
+    ClientRegistry registry;
+    auto connected = ClientRegistry::Clock::now();
+
+    EXPECT_TRUE(registry.add(Connection{1}, connected));
+    EXPECT_TRUE(registry.add(Connection{2}, connected));
+    EXPECT_TRUE(registry.add(Connection{3}, connected));
+    EXPECT_FALSE(registry.add(Connection{2}, connected));
+    EXPECT_EQ(registry.size(), 3);
+
+    ASSERT_NE(registry.find(2), nullptr);
+    EXPECT_EQ(registry.find(2)->connectedAt, connected);
+    EXPECT_EQ(registry.find(4), nullptr);
+
+    registry.find(1)->sessionId = 7;
+    auto removed = registry.remove(1);
+    ASSERT_TRUE(removed.has_value());
+    EXPECT_EQ(removed->sessionId, 7);
+    EXPECT_FALSE(registry.remove(1).has_value());
+    EXPECT_FALSE(registry.contains(1));
+
+    // The client moved into the freed position is still found
+    EXPECT_EQ(registry.size(), 2);
+    ASSERT_NE(registry.find(3), nullptr);
+    EXPECT_TRUE(registry.remove(3).has_value());
+    EXPECT_TRUE(registry.remove(2).has_value());
+    EXPECT_EQ(registry.size(), 0);
+    EXPECT_TRUE(registry.getConnections().empty());
+}
+
+TEST(ClientRegistryTest, ConnectionsStayInParallelWithInfo)
+{
+    ClientRegistry registry;
+    for (uintptr_t id = 0; id < 100; id++)
+    {
+        registry.add(Connection{id});
+        registry.find(id)->sessionId = static_cast<int>(id);
+    }
+    for (uintptr_t id = 0; id < 100; id += 3)
+    {
+        registry.remove(id);
+    }
+
+    for (const auto &connection : registry.getConnections())
+    {
+        ASSERT_NE(registry.find(connection.id), nullptr);
+        EXPECT_EQ(registry.find(connection.id)->sessionId, static_cast<int>(connection.id));
+    }
+}
+
+TEST(ClientRegistryTest, TouchUpdatesLastActivity)
+{
+    ClientRegistry registry;
+    auto connected = ClientRegistry::Clock::now();
+    registry.add(Connection{1}, connected);
+
+    auto later = connected + std::chrono::seconds(5);
+    registry.touch(1, later);
+    registry.touch(2, later);
+
+    EXPECT_EQ(registry.find(1)->lastActivity, later);
+    EXPECT_EQ(registry.find(1)->connectedAt, connected);
+}
@@ -1,12 +1,13 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 #include <regex>
+#include <thread>
 
 #include "external/GameServer.h"
+#include "external/LoopbackTransport.h"
 
 using networking::Connection;
 using networking::Message;
-using networking::Server;
 using json = nlohmann::json;
 
 class GameServerTest : public ::testing::Test
@@ -175,6 +176,19 @@ TEST_F(GameServerTest, ProcessValidMessageEcho)
     EXPECT_FALSE(result.shouldShutdown);
 }
 
+TEST_F(GameServerTest, ProcessesBatchedRequestsInOrder)
+{
+    Message batchMessage;
+    batchMessage.text = R"([{"action":"2","body":"first","request_id":"1"},{"action":"2","body":"second","request_id":"2"}])";
+
+    std::ostringstream os;
+    MessageResult result = gs->processValidMessage(batchMessage, os);
+
+    ASSERT_EQ(result.batchItems.size(), 2);
+    EXPECT_THAT(result.batchItems[0].result, ::testing::HasSubstr("\"message\":\"first\",\"request_id\":\"1\",\"success\":true"));
+    EXPECT_THAT(result.batchItems[1].result, ::testing::HasSubstr("\"message\":\"second\",\"request_id\":\"2\",\"success\":true"));
+}
+
 TEST_F(GameServerTest, SessionConnectionTest)
 {
 
@@ -403,4 +417,177 @@ TEST_F(GameServerTest, BroadcastMessageToAllClients)
     gs->onDisconnect(conn_1);
     gs->onDisconnect(conn_2);
     gs->onDisconnect(conn_3);
-}
\ No newline at end of file
+}
+TEST_F(GameServerTest, ProcessesEveryMessageInBatch)
+{
+    std::deque<Message> incoming;
+    incoming.push_back(Message{{201}, R"({"action":"2","body":"first", "request_id":"1"})"});
+    incoming.push_back(Message{{202}, "INVALID!!"});
+    incoming.push_back(Message{{203}, R"({"action":"2","body":"third", "request_id":"3"})"});
+
+    std::vector<MessageResult> results = gs->processMessages(incoming);
+
+    ASSERT_EQ(results.size(), 3);
+    EXPECT_THAT(results[0].result, ::testing::HasSubstr("\"message\":\"first\""));
+    EXPECT_THAT(results[1].result, ::testing::HasSubstr("Invalid Message!"));
+    EXPECT_THAT(results[2].result, ::testing::HasSubstr("\"message\":\"third\""));
+    EXPECT_EQ(results[0].senderID, 201);
+    EXPECT_EQ(results[1].senderID, 202);
+    EXPECT_EQ(results[2].senderID, 203);
+}
+
+TEST_F(GameServerTest, StopsBatchAtShutdown)
+{
+    std::deque<Message> incoming;
+    incoming.push_back(Message{{201}, R"({"action":"2","body":"first", "request_id":"1"})"});
+    incoming.push_back(Message{{202}, "shutdown"});
+    incoming.push_back(Message{{203}, R"({"action":"2","body":"ignored", "request_id":"3"})"});
+
+    std::vector<MessageResult> results = gs->processMessages(incoming);
+
+    ASSERT_EQ(results.size(), 2);
+    EXPECT_FALSE(results[0].shouldShutdown);
+    EXPECT_TRUE(results[1].shouldShutdown);
+}
+
+TEST(GameServerLoopbackTest, AnswersClientsWithoutSockets)
+{
+    ServerOptions options;
+    options.validateGames = false;
+    options.watchGames = false;
+
+    auto transport = std::make_unique<LoopbackTransport>();
+    LoopbackTransport &clients = *transport;
+    GameServer gs(std::move(transport), options);
+
+    Connection client = clients.connect();
+    ASSERT_TRUE(gs.update());
+    EXPECT_EQ(gs.getClients().size(), 1u);
+
+    clients.sendToServer(client, R"({"action":"3","body":"any", "request_id":"1"})");
+    ASSERT_TRUE(gs.update());
+    auto created = clients.takeSent();
+    ASSERT_FALSE(created.empty());
+    EXPECT_THAT(created.front().text, ::testing::HasSubstr("Join Code"));
+
+    clients.sendToServer(client, R"({"action":"2","body":"Text To Echo", "request_id":"2"})");
+    ASSERT_TRUE(gs.update());
+    auto echoed = clients.takeSent();
+    ASSERT_FALSE(echoed.empty());
+    EXPECT_EQ(echoed.back().connection.id, client.id);
+    EXPECT_THAT(echoed.back().text, ::testing::HasSubstr("Text To Echo"));
+
+    clients.close(client);
+    ASSERT_TRUE(gs.update());
+    EXPECT_TRUE(gs.getClients().empty());
+}
+
+namespace
+{
+    // Update until the workers answered, or give up after a while
+    std::deque<Message> awaitReplies(GameServer &gs, LoopbackTransport &clients, size_t count)
+    {
+        std::deque<Message> replies;
+        for (int i = 0; i < 2000 && replies.size() < count; i++)
+        {
+            gs.update();
+            for (auto &message : clients.takeSent())
+            {
+                replies.push_back(std::move(message));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return replies;
+    }
+
+    std::string joinCodeOf(const std::deque<Message> &replies)
+    {
+        std::regex joinCode("Join Code: ([A-Za-z0-9]+)");
+        std::smatch match;
+        for (const auto &reply : replies)
+        {
+            if (std::regex_search(reply.text, match, joinCode))
+            {
+                return match[1];
+            }
+        }
+        return "";
+    }
+}
+
+TEST(GameServerLoopbackTest, JoiningOnAnotherWorkerIsRefusedInASession)
+{
+    ServerOptions options;
+    options.validateGames = false;
+    options.watchGames = false;
+    options.workerThreads = 2;
+
+    auto transport = std::make_unique<LoopbackTransport>();
+    LoopbackTransport &clients = *transport;
+    GameServer gs(std::move(transport), options);
+
+    // Hosts on different workers, as clients go to the worker of their id until they join
+    Connection first = clients.connect();
+    Connection second = clients.connect();
+    Connection guest = clients.connect();
+    ASSERT_NE(first.id % 2, second.id % 2);
+
+    clients.sendToServer(first, R"({"action":"3","body":"any", "request_id":"1"})");
+    std::string firstCode = joinCodeOf(awaitReplies(gs, clients, 1));
+    clients.sendToServer(second, R"({"action":"3","body":"any", "request_id":"1"})");
+    std::string secondCode = joinCodeOf(awaitReplies(gs, clients, 1));
+    ASSERT_FALSE(firstCode.empty());
+    ASSERT_FALSE(secondCode.empty());
+
+    clients.sendToServer(guest, R"({"action":"0","body":")" + firstCode + R"(", "request_id":"2"})");
+    auto joined = awaitReplies(gs, clients, 1);
+    ASSERT_EQ(joined.size(), 1u);
+    EXPECT_THAT(joined.front().text, ::testing::HasSubstr("\"success\":true"));
+
+    // Joining a session on the other worker, or a code naming it that has no session, is refused like on one thread
+    const std::string unknownCode = secondCode.substr(0, 1) + (secondCode.substr(1) == "ZZZZZ" ? "YYYYY" : "ZZZZZ");
+    for (const std::string &code : {secondCode, unknownCode})
+    {
+        clients.sendToServer(guest, R"({"action":"0","body":")" + code + R"(", "request_id":"3"})");
+        auto refused = awaitReplies(gs, clients, 1);
+        ASSERT_EQ(refused.size(), 1u);
+        EXPECT_THAT(refused.front().text, ::testing::HasSubstr("Player is already in another session"));
+    }
+
+    // The guest still plays in the first session, and not in the second
+    clients.sendToServer(first, R"({"action":"2","body":"both", "request_id":"4"})");
+    auto echoed = awaitReplies(gs, clients, 3);
+    EXPECT_EQ(echoed.size(), 2u);
+
+    clients.sendToServer(second, R"({"action":"2","body":"second only", "request_id":"5"})");
+    echoed = awaitReplies(gs, clients, 2);
+    ASSERT_EQ(echoed.size(), 1u);
+    EXPECT_EQ(echoed.front().connection.id, second.id);
+}
+
+TEST(GameServerLoopbackTest, RefusedBatchLeavesTheClientsTokens)
+{
+    ServerOptions options;
+    options.validateGames = false;
+    options.watchGames = false;
+    options.rateLimits.perConnection = {1, 2};
+
+    auto transport = std::make_unique<LoopbackTransport>();
+    LoopbackTransport &clients = *transport;
+    GameServer gs(std::move(transport), options);
+
+    Connection client = clients.connect();
+    ASSERT_TRUE(gs.update());
+
+    clients.sendToServer(client, R"([{"action":"2","body":"one"},{"action":"2","body":"two"},{"action":"2","body":"three"}])");
+    ASSERT_TRUE(gs.update());
+    auto refused = clients.takeSent();
+    ASSERT_EQ(refused.size(), 1u);
+    EXPECT_THAT(refused.front().text, ::testing::HasSubstr("RATE LIMITED"));
+
+    clients.sendToServer(client, R"({"action":"2","body":"alone", "request_id":"2"})");
+    ASSERT_TRUE(gs.update());
+    auto echoed = clients.takeSent();
+    ASSERT_EQ(echoed.size(), 1u);
+    EXPECT_THAT(echoed.front().text, ::testing::HasSubstr("alone"));
+}
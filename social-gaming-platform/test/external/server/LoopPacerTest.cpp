@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include "external/LoopPacer.h"
+
+using namespace std::chrono;
+
+TEST(LoopPacerTest, BacksOffWhileIdle)
+{
+    LoopPacer pacer(microseconds(10), microseconds(80));
+    auto farDeadline = LoopPacer::Clock::now() + seconds(10);
+
+    EXPECT_EQ(pacer.getCurrentWait(), microseconds(10));
+    pacer.pace(farDeadline);
+    EXPECT_EQ(pacer.getCurrentWait(), microseconds(20));
+    pacer.pace(farDeadline);
+    pacer.pace(farDeadline);
+    pacer.pace(farDeadline);
+    EXPECT_EQ(pacer.getCurrentWait(), microseconds(80));
+}
+
+TEST(LoopPacerTest, ActivityResetsBackoffWithoutSleeping)
+{
+    LoopPacer pacer(microseconds(10), seconds(1));
+    auto farDeadline = LoopPacer::Clock::now() + seconds(10);
+    for (int i = 0; i < 10; i++)
+    {
+        pacer.pace(farDeadline);
+    }
+
+    pacer.markActive();
+    auto start = LoopPacer::Clock::now();
+    pacer.pace(farDeadline);
+
+    EXPECT_LT(LoopPacer::Clock::now() - start, milliseconds(5));
+    EXPECT_EQ(pacer.getCurrentWait(), microseconds(10));
+}
+
+TEST(LoopPacerTest, NeverSleepsPastDeadline)
+{
+    LoopPacer pacer(seconds(5), seconds(5));
+
+    auto start = LoopPacer::Clock::now();
+    pacer.pace(start + milliseconds(20));
+
+    EXPECT_LT(LoopPacer::Clock::now() - start, seconds(1));
+}
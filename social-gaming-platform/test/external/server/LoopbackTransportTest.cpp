@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include "external/LoopbackTransport.h"
+
+namespace
+{
+    struct RecordingHandlers
+    {
+        std::vector<uintptr_t> connected;
+        std::vector<uintptr_t> disconnected;
+
+        void attach(Transport &transport)
+        {
+            transport.setHandlers([this](Connection c)
+                                  { connected.push_back(c.id); },
+                                  [this](Connection c)
+                                  { disconnected.push_back(c.id); });
+        }
+    };
+}
+
+TEST(LoopbackTransportTest, ConnectionsReachServerOnUpdate)
+{
+    LoopbackTransport transport;
+    RecordingHandlers handlers;
+    handlers.attach(transport);
+
+    Connection first = transport.connect();
+    Connection second = transport.connect();
+    EXPECT_NE(first.id, second.id);
+    EXPECT_TRUE(handlers.connected.empty());
+
+    transport.update();
+    EXPECT_EQ(handlers.connected, (std::vector<uintptr_t>{first.id, second.id}));
+
+    transport.close(first);
+    EXPECT_FALSE(transport.isOpen(first));
+    transport.update();
+    EXPECT_EQ(handlers.disconnected, (std::vector<uintptr_t>{first.id}));
+}
+
+TEST(LoopbackTransportTest, MessagesFlowBothWays)
+{
+    LoopbackTransport transport;
+    Connection client = transport.connect();
+    transport.update();
+
+    EXPECT_TRUE(transport.sendToServer(client, "hello"));
+    EXPECT_TRUE(transport.sendToServer(client, "again"));
+
+    auto received = transport.receive();
+    ASSERT_EQ(received.size(), 2u);
+    EXPECT_EQ(received[0].connection.id, client.id);
+    EXPECT_EQ(received[0].text, "hello");
+    EXPECT_EQ(received[1].text, "again");
+    EXPECT_TRUE(transport.receive().empty());
+
+    transport.send({Message{client, "reply"}});
+    auto sent = transport.takeSent();
+    ASSERT_EQ(sent.size(), 1u);
+    EXPECT_EQ(sent[0].text, "reply");
+    EXPECT_TRUE(transport.takeSent().empty());
+}
+
+TEST(LoopbackTransportTest, ServerDisconnectClosesConnection)
+{
+    LoopbackTransport transport;
+    RecordingHandlers handlers;
+    handlers.attach(transport);
+
+    Connection client = transport.connect();
+    transport.update();
+
+    transport.disconnect(client);
+    EXPECT_FALSE(transport.isOpen(client));
+    EXPECT_FALSE(transport.sendToServer(client, "too late"));
+
+    // Messages to a closed connection are lost
+    transport.send({Message{client, "reply"}});
+    EXPECT_TRUE(transport.takeSent().empty());
+
+    transport.update();
+    EXPECT_EQ(handlers.disconnected, (std::vector<uintptr_t>{client.id}));
+
+    // Closing twice reports once
+    transport.close(client);
+    transport.update();
+    EXPECT_EQ(handlers.disconnected.size(), 1u);
+}
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "external/ServerMetrics.h"
+
+namespace
+{
+    std::string fetch(unsigned short port, const std::string &path)
+    {
+        int socketFd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(socketFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == -1)
+        {
+            close(socketFd);
+            return "";
+        }
+
+        std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        send(socketFd, request.data(), request.size(), 0);
+
+        std::string response;
+        char buffer[4096];
+        while (ssize_t received = recv(socketFd, buffer, sizeof(buffer), 0))
+        {
+            if (received < 0)
+            {
+                break;
+            }
+            response.append(buffer, received);
+        }
+        close(socketFd);
+        return response;
+    }
+}
+
+TEST(MetricsServerTest, ServesRegistryOnMetricsPath)
+{
+    MetricsRegistry registry;
+    registry.counter("requests_total", "Requests handled", "action=\"echo\"").add(2);
+
+    MetricsServer server(registry);
+    ASSERT_TRUE(server.start(0).has_value());
+    ASSERT_NE(server.getPort(), 0);
+
+    std::string response = fetch(server.getPort(), "/metrics");
+    EXPECT_TRUE(response.starts_with("HTTP/1.1 200 OK\r\n")) << response;
+    EXPECT_NE(response.find("Content-Type: text/plain; version=0.0.4\r\n"), std::string::npos) << response;
+    EXPECT_NE(response.find("requests_total{action=\"echo\"} 2\n"), std::string::npos) << response;
+}
+
+TEST(MetricsServerTest, OtherPathsAreNotFound)
+{
+    MetricsRegistry registry;
+    MetricsServer server(registry);
+    ASSERT_TRUE(server.start(0).has_value());
+
+    std::string response = fetch(server.getPort(), "/");
+    EXPECT_TRUE(response.starts_with("HTTP/1.1 404 Not Found\r\n")) << response;
+
+    server.stop();
+}
+
+TEST(ShardMetricsTest, PublishesLabelledGauges)
+{
+    ShardMetrics metrics(3);
+    metrics.publish(5, 2, 1);
+
+    std::string text = MetricsRegistry::instance().render();
+    EXPECT_NE(text.find("game_sessions{shard=\"3\"} 5\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("scheduler_ready_processes{shard=\"3\"} 2\n"), std::string::npos) << text;
+}
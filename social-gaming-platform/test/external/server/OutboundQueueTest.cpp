@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+
+#include "external/OutboundQueue.h"
+
+namespace
+{
+    SharedPayload payload(const std::string &text)
+    {
+        return std::make_shared<const std::string>(text);
+    }
+
+    std::vector<std::string> texts(const std::deque<Message> &messages)
+    {
+        std::vector<std::string> result;
+        for (const auto &message : messages)
+        {
+            result.push_back(message.text);
+        }
+        return result;
+    }
+
+    const QueueLimits UNLIMITED = {SIZE_MAX, SIZE_MAX};
+}
+
+TEST(OutboundQueueTest, DrainsOldestFirstWithinBudget)
+{
+    OutboundQueue queue;
+    for (int i = 0; i < 5; i++)
+    {
+        queue.push(payload("m" + std::to_string(i)));
+    }
+    EXPECT_EQ(queue.size(), 5);
+    EXPECT_EQ(queue.bytes(), 10);
+
+    std::deque<Message> outgoing;
+    EXPECT_EQ(queue.drainInto(Connection{1}, {2, SIZE_MAX}, outgoing), 2);
+    EXPECT_EQ(texts(outgoing), (std::vector<std::string>{"m0", "m1"}));
+    EXPECT_EQ(outgoing.front().connection.id, 1);
+
+    // A message larger than the byte budget still goes out on its own
+    queue.push(payload(std::string(100, 'x')));
+    outgoing.clear();
+    EXPECT_EQ(queue.drainInto(Connection{1}, {SIZE_MAX, 1}, outgoing), 1);
+    EXPECT_EQ(queue.drainInto(Connection{1}, UNLIMITED, outgoing), 3);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.bytes(), 0);
+}
+
+TEST(OutboundQueueTest, NewerStateSupersedesQueuedState)
+{
+    OutboundQueue queue;
+    EXPECT_FALSE(queue.push(payload("score 1"), 7));
+    EXPECT_FALSE(queue.push(payload("chat")));
+    EXPECT_TRUE(queue.push(payload("score 2"), 7));
+    EXPECT_FALSE(queue.push(payload("other game"), 8));
+    EXPECT_EQ(queue.size(), 3);
+
+    std::deque<Message> outgoing;
+    queue.drainInto(Connection{1}, UNLIMITED, outgoing);
+    EXPECT_EQ(texts(outgoing), (std::vector<std::string>{"chat", "score 2", "other game"}));
+
+    // Once sent, the key no longer replaces anything
+    EXPECT_FALSE(queue.push(payload("score 3"), 7));
+}
+
+TEST(OutboundQueueTest, SupersededMessagesDoNotPileUp)
+{
+    OutboundQueue queue;
+    queue.push(payload("first"));
+    for (int i = 0; i < 10000; i++)
+    {
+        queue.push(payload("score " + std::to_string(i)), 7);
+    }
+    queue.push(payload("last"));
+    EXPECT_EQ(queue.size(), 3);
+
+    std::deque<Message> outgoing;
+    queue.drainInto(Connection{1}, UNLIMITED, outgoing);
+    EXPECT_EQ(texts(outgoing), (std::vector<std::string>{"first", "score 9999", "last"}));
+}
+
+TEST(OutboundQueueTest, DropsOldestUntilWithinLimits)
+{
+    OutboundQueue queue;
+    for (int i = 0; i < 10; i++)
+    {
+        queue.push(payload("message " + std::to_string(i)), i % 2 == 0 ? 0 : 100 + i);
+    }
+
+    EXPECT_TRUE(queue.exceeds({8, SIZE_MAX}));
+    EXPECT_EQ(queue.dropOldest({8, SIZE_MAX}), 2);
+    EXPECT_FALSE(queue.exceeds({8, SIZE_MAX}));
+    EXPECT_EQ(queue.dropOldest({SIZE_MAX, 20}), 6);
+    EXPECT_EQ(queue.bytes(), 18);
+
+    std::deque<Message> outgoing;
+    queue.drainInto(Connection{1}, UNLIMITED, outgoing);
+    EXPECT_EQ(texts(outgoing), (std::vector<std::string>{"message 8", "message 9"}));
+}
+
+TEST(OutboundQueueTest, ParsesPolicies)
+{
+    EXPECT_EQ(parseBackpressurePolicy("drop-oldest"), BackpressurePolicy::DROP_OLDEST);
+    EXPECT_EQ(parseBackpressurePolicy("Disconnect"), BackpressurePolicy::DISCONNECT);
+    EXPECT_EQ(parseBackpressurePolicy("pause"), BackpressurePolicy::PAUSE_SESSION);
+    EXPECT_FALSE(parseBackpressurePolicy("block").has_value());
+}
+
+TEST(OutboundQueueTest, HandsOutTracesOfMessagesAsTheyLeave)
+{
+    auto traced = [](MessageType action)
+    {
+        LatencyTrace trace;
+        trace.action = action;
+        trace.receivedAt = LatencyTrace::Clock::now();
+        return trace;
+    };
+
+    OutboundQueue queue;
+    queue.push(payload("joined"), 0, traced(MessageType::JOIN));
+    queue.push(payload("score 1"), 7, traced(MessageType::NEW_GAME));
+    queue.push(payload("untraced"));
+    queue.push(payload("score 2"), 7, traced(MessageType::ECHO));
+
+    std::deque<Message> outgoing;
+    std::vector<LatencyTrace> sent;
+    queue.drainInto(Connection{1}, {1, SIZE_MAX}, outgoing, &sent);
+    ASSERT_EQ(sent.size(), 1u);
+    EXPECT_EQ(sent[0].action, MessageType::JOIN);
+
+    // The superseded message was never sent, so neither is its trace
+    queue.drainInto(Connection{1}, UNLIMITED, outgoing, &sent);
+    EXPECT_EQ(texts(outgoing), (std::vector<std::string>{"joined", "untraced", "score 2"}));
+    ASSERT_EQ(sent.size(), 2u);
+    EXPECT_EQ(sent[1].action, MessageType::ECHO);
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "external/RateLimiter.h"
+
+namespace
+{
+    using Clock = TokenBucket::Clock;
+    using std::chrono::milliseconds;
+}
+
+TEST(RateLimiterTest, BucketAllowsBurstThenRefills)
+{
+    auto start = Clock::now();
+    TokenBucket bucket({2, 3}, start);
+
+    for (int i = 0; i < 3; i++)
+    {
+        ASSERT_TRUE(bucket.refill(start));
+        bucket.take();
+    }
+    EXPECT_FALSE(bucket.refill(start));
+
+    // Two tokens a second, one is back after half a second
+    EXPECT_FALSE(bucket.refill(start + milliseconds(400)));
+    EXPECT_TRUE(bucket.refill(start + milliseconds(500)));
+
+    // Never more than the burst
+    bucket.take();
+    EXPECT_TRUE(bucket.refill(start + milliseconds(100000)));
+    for (int i = 0; i < 3; i++)
+    {
+        bucket.take();
+    }
+    EXPECT_FALSE(bucket.refill(start + milliseconds(100000)));
+}
+
+TEST(RateLimiterTest, ActionLimitsAreSeparateFromTheConnectionLimit)
+{
+    RateLimits limits{{10, 10}, {{MessageType::NEW_GAME, {1, 2}}}};
+    ConnectionRateLimiter limiter;
+    auto now = Clock::now();
+
+    EXPECT_TRUE(limiter.admit(limits, MessageType::NEW_GAME, now));
+    EXPECT_TRUE(limiter.admit(limits, MessageType::NEW_GAME, now));
+    EXPECT_FALSE(limiter.admit(limits, MessageType::NEW_GAME, now));
+
+    // Other actions only draw on the connection's bucket, 2 of 10 tokens are used
+    for (int i = 0; i < 8; i++)
+    {
+        EXPECT_TRUE(limiter.admit(limits, MessageType::ECHO, now));
+    }
+    EXPECT_FALSE(limiter.admit(limits, MessageType::ECHO, now));
+
+    // A rejected new game did not use up a connection token
+    auto later = now + milliseconds(1000);
+    EXPECT_TRUE(limiter.admit(limits, MessageType::NEW_GAME, later));
+    for (int i = 0; i < 9; i++)
+    {
+        EXPECT_TRUE(limiter.admit(limits, MessageType::ECHO, later));
+    }
+}
+
+TEST(RateLimiterTest, UnlimitedConnectionsAreAlwaysAdmitted)
+{
+    RateLimits limits{{0, 1}, {}};
+    ConnectionRateLimiter limiter;
+    auto now = Clock::now();
+
+    for (int i = 0; i < 1000; i++)
+    {
+        ASSERT_TRUE(limiter.admit(limits, MessageType::ECHO, now));
+    }
+}
+
+TEST(RateLimiterTest, ParsesLimits)
+{
+    auto limit = parseRateLimit("0.5:3");
+    ASSERT_TRUE(limit.has_value());
+    EXPECT_DOUBLE_EQ(limit->perSecond, 0.5);
+    EXPECT_DOUBLE_EQ(limit->burst, 3);
+
+    EXPECT_DOUBLE_EQ(parseRateLimit("20")->burst, 20);
+    EXPECT_TRUE(parseRateLimit("0")->isUnlimited());
+    EXPECT_FALSE(parseRateLimit("fast").has_value());
+    EXPECT_FALSE(parseRateLimit("5:0").has_value());
+
+    auto action = parseActionRateLimit("3:1:5");
+    ASSERT_TRUE(action.has_value());
+    EXPECT_EQ(action->first, MessageType::NEW_GAME);
+    EXPECT_DOUBLE_EQ(action->second.burst, 5);
+    EXPECT_FALSE(parseActionRateLimit("3").has_value());
+}
+
+TEST(RateLimiterTest, RefusedBatchTakesNoTokens)
+{
+    RateLimits limits{{10, 3}, {{MessageType::NEW_GAME, {1, 1}}}};
+    ConnectionRateLimiter limiter;
+    auto now = Clock::now();
+
+    // More requests than the connection's burst, then more new games than their own
+    std::vector<MessageType> tooMany(4, MessageType::ECHO);
+    EXPECT_FALSE(limiter.admit(limits, tooMany, now));
+    std::vector<MessageType> twoGames = {MessageType::ECHO, MessageType::NEW_GAME, MessageType::NEW_GAME};
+    EXPECT_FALSE(limiter.admit(limits, twoGames, now));
+
+    // Every token is still there
+    EXPECT_TRUE(limiter.admit(limits, MessageType::NEW_GAME, now));
+    std::vector<MessageType> rest(2, MessageType::ECHO);
+    EXPECT_TRUE(limiter.admit(limits, rest, now));
+    EXPECT_FALSE(limiter.admit(limits, MessageType::ECHO, now));
+}
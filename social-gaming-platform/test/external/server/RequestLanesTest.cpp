@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "external/RequestLanes.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<std::string> popAll(RequestLanes<std::string> &lanes)
+    {
+        std::vector<std::string> order;
+        while (auto item = lanes.pop())
+        {
+            order.push_back(item.value());
+        }
+        return order;
+    }
+}
+
+TEST(RequestLanesTest, InputsGoBeforeControlAndDiagnostics)
+{
+    RequestLanes<std::string> lanes({8, 4, 1});
+    auto now = Clock::now();
+
+    lanes.push(RequestLane::DIAGNOSTIC, 1, "echo", now);
+    lanes.push(RequestLane::CONTROL, 2, "join", now);
+    lanes.push(RequestLane::INPUT, 3, "move", now);
+
+    EXPECT_EQ(lanes.size(), 3);
+    EXPECT_EQ(popAll(lanes), (std::vector<std::string>{"move", "join", "echo"}));
+    EXPECT_TRUE(lanes.empty());
+    EXPECT_FALSE(lanes.pop().has_value());
+}
+
+TEST(RequestLanesTest, BusyInputLaneDoesNotStarveTheOthers)
+{
+    RequestLanes<std::string> lanes({2, 1, 1});
+    auto now = Clock::now();
+
+    for (uintptr_t client = 0; client < 4; client++)
+    {
+        lanes.push(RequestLane::INPUT, 10 + client, "input", now);
+        lanes.push(RequestLane::CONTROL, 20 + client, "control", now);
+        lanes.push(RequestLane::DIAGNOSTIC, 30 + client, "diagnostic", now);
+    }
+
+    auto order = popAll(lanes);
+    std::vector<std::string> firstRound(order.begin(), order.begin() + 4);
+    EXPECT_EQ(firstRound, (std::vector<std::string>{"input", "input", "control", "diagnostic"}));
+    EXPECT_EQ(order.size(), 12);
+}
+
+TEST(RequestLanesTest, IdleLanesGiveUpTheirTurns)
+{
+    RequestLanes<std::string> lanes({1, 1, 1});
+    auto now = Clock::now();
+
+    for (uintptr_t client = 0; client < 5; client++)
+    {
+        lanes.push(RequestLane::DIAGNOSTIC, client, std::to_string(client), now);
+    }
+
+    EXPECT_EQ(popAll(lanes), (std::vector<std::string>{"0", "1", "2", "3", "4"}));
+}
+
+TEST(RequestLanesTest, ClientRequestsStayInOrderAcrossLanes)
+{
+    RequestLanes<std::string> lanes({8, 4, 1});
+    auto now = Clock::now();
+
+    // The input waits behind the same client's join, another client's input does not
+    lanes.push(RequestLane::CONTROL, 1, "join", now);
+    lanes.push(RequestLane::INPUT, 1, "move", now);
+    lanes.push(RequestLane::INPUT, 2, "other", now);
+
+    EXPECT_EQ(lanes.size(RequestLane::CONTROL), 2);
+    EXPECT_EQ(popAll(lanes), (std::vector<std::string>{"other", "join", "move"}));
+
+    // Nothing queued anymore, so the client's input has its own lane again
+    lanes.push(RequestLane::INPUT, 1, "move", now);
+    EXPECT_EQ(lanes.size(RequestLane::INPUT), 1);
+}
+
+TEST(RequestLanesTest, ZeroWeightsStillServeTheLane)
+{
+    RequestLanes<std::string> lanes({0, 0, 0});
+    lanes.push(RequestLane::CONTROL, 1, "join", Clock::now());
+
+    EXPECT_EQ(lanes.pop(), "join");
+}
+
+TEST(RequestLanesTest, ActionsMapToLanes)
+{
+    EXPECT_EQ(laneOf(MessageType::INPUT_CHOICE), RequestLane::INPUT);
+    EXPECT_EQ(laneOf(MessageType::INPUT_VOTE), RequestLane::INPUT);
+    EXPECT_EQ(laneOf(MessageType::JOIN), RequestLane::CONTROL);
+    EXPECT_EQ(laneOf(MessageType::NEW_GAME), RequestLane::CONTROL);
+    EXPECT_EQ(laneOf(MessageType::DISCONNECT), RequestLane::CONTROL);
+    EXPECT_EQ(laneOf(MessageType::ECHO), RequestLane::DIAGNOSTIC);
+    EXPECT_EQ(laneOf(MessageType::UNDEFINED), RequestLane::DIAGNOSTIC);
+}
+
+TEST(RequestLanesTest, ParsesLaneWeights)
+{
+    auto weights = parseLaneWeights("8:4:1");
+    ASSERT_TRUE(weights.has_value());
+    EXPECT_EQ(weights.value(), (LaneWeights{8, 4, 1}));
+
+    EXPECT_FALSE(parseLaneWeights("8:4").has_value());
+    EXPECT_FALSE(parseLaneWeights("8:4:1:2").has_value());
+    EXPECT_FALSE(parseLaneWeights("8:0:1").has_value());
+    EXPECT_FALSE(parseLaneWeights("a:b:c").has_value());
+    EXPECT_FALSE(parseLaneWeights("").has_value());
+}
+
+TEST(RequestLanesTest, RecordsTheWaitPerLane)
+{
+    Histogram &wait = laneWaitHistogram(RequestLane::CONTROL);
+    uint64_t before = wait.snapshot().count;
+
+    RequestLanes<std::string> lanes({1, 1, 1});
+    lanes.push(RequestLane::CONTROL, 1, "join", Clock::now());
+    lanes.pop();
+
+    EXPECT_EQ(wait.snapshot().count, before + 1);
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+
+#include "external/Request.h"
+#include "external/RequestLatency.h"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    // The report line of one stage, empty when it has no requests
+    std::string reportLine(const std::string &report, const std::string &prefix)
+    {
+        size_t start = report.find("\n" + prefix + " ");
+        if (start == std::string::npos)
+        {
+            return "";
+        }
+        size_t end = report.find('\n', start + 1);
+        return report.substr(start + 1, end - start - 1);
+    }
+}
+
+TEST(RequestLatencyTest, RecordsEveryStage)
+{
+    RequestLatency &latency = RequestLatency::instance();
+    LatencyGroup &game = latency.forGame("latency_test_game");
+    EXPECT_EQ(&game, &latency.forGame("latency_test_game"));
+
+    auto received = std::chrono::steady_clock::now();
+    LatencyTrace trace;
+    trace.action = MessageType::INPUT_VOTE;
+    trace.game = &game;
+    trace.receivedAt = received;
+    trace.parsedAt = received + 2us;
+    trace.handleStartedAt = received + 102us;
+    trace.handledAt = received + 112us;
+    trace.serializedAt = received + 113us;
+    latency.record(trace, received + 1113us);
+
+    LatencyGroup &action = latency.forAction(MessageType::INPUT_VOTE);
+    EXPECT_EQ(action[LatencyStage::QUEUE].count(), 1);
+    EXPECT_NEAR(action[LatencyStage::QUEUE].quantileNanos(0.5), 100000, 3200);
+    EXPECT_NEAR(action[LatencyStage::SEND].quantileNanos(0.5), 1000000, 32000);
+    EXPECT_NEAR(game[LatencyStage::TOTAL].quantileNanos(0.99), 1113000, 36000);
+
+    std::string report = latency.report();
+    EXPECT_EQ(reportLine(report, "action input_vote handle").substr(0, 28), "action input_vote handle 1 1");
+    EXPECT_NE(reportLine(report, "game latency_test_game total"), "");
+    EXPECT_EQ(reportLine(report, "action input_range total"), "");
+}
+
+TEST(RequestLatencyTest, UnsetTracesAreNotRecorded)
+{
+    LatencyTrace trace;
+    trace.action = MessageType::INPUT_RANGE;
+    RequestLatency::instance().record(trace, std::chrono::steady_clock::now());
+
+    EXPECT_EQ(RequestLatency::instance().forAction(MessageType::INPUT_RANGE)[LatencyStage::TOTAL].count(), 0);
+}
+
+TEST(RequestLatencyTest, TracesFollowTheRequest)
+{
+    Request request(R"({"action":"2","body":"hello","request_id":"1"})", Connection{1});
+    request.latency.handleStartedAt = std::chrono::steady_clock::now();
+    request.latency.handledAt = request.latency.handleStartedAt;
+
+    LatencyTrace trace = traceOf(request);
+    EXPECT_EQ(trace.action, MessageType::ECHO);
+    EXPECT_EQ(trace.receivedAt, request.receivedAt);
+    EXPECT_LE(trace.receivedAt, trace.parsedAt);
+    EXPECT_LE(trace.parsedAt, trace.handleStartedAt);
+    EXPECT_LE(trace.handledAt, trace.serializedAt);
+}
+
+TEST(RequestLatencyTest, DumpRequestsAreTakenOnce)
+{
+    RequestLatency::takeDumpRequest();
+    EXPECT_FALSE(RequestLatency::takeDumpRequest());
+
+    RequestLatency::requestDump();
+    EXPECT_TRUE(RequestLatency::takeDumpRequest());
+    EXPECT_FALSE(RequestLatency::takeDumpRequest());
+}
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "external/RequestPipeline.h"
+
+namespace
+{
+    const std::string gameDirectory = "request_pipeline_test";
+
+    Request makeRequest(uintptr_t client, const std::string &action, const std::string &body)
+    {
+        return Request(R"({"action":")" + action + R"(","body":")" + body + R"(","request_id":"7"})", Connection{client});
+    }
+
+    class RequestPipelineTest : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            std::filesystem::create_directories(gameDirectory);
+            std::ofstream file(gameDirectory + "/simple.game", std::ios::trunc);
+            file << "configuration {\n"
+                    "name: \"Simple\"\n"
+                    "player range: (2, 4)\n"
+                    "audience: false\n"
+                    "setup: {}\n"
+                    "}\n"
+                    "constants {}\n"
+                    "variables {}\n"
+                    "per-player {}\n"
+                    "per-audience {}\n"
+                    "rules {\n"
+                    "x <- 1;\n"
+                    "}\n";
+        }
+
+        void TearDown() override
+        {
+            std::filesystem::remove_all(gameDirectory);
+        }
+
+        // Wait for the pool to finish the deferred requests
+        std::vector<Request> waitForPrepared(RequestPipeline &pipeline)
+        {
+            std::vector<Request> prepared;
+            auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (pipeline.inFlight() > 0 && std::chrono::steady_clock::now() < giveUp)
+            {
+                for (auto &request : pipeline.takePrepared())
+                {
+                    prepared.push_back(std::move(request));
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return prepared;
+        }
+    };
+}
+
+TEST_F(RequestPipelineTest, DefersNewGamesThatNeedLoading)
+{
+    GameManager gameManager(gameDirectory);
+    logic::GameDefinitionCache gameCache(gameManager);
+    PreparationPool pool(2);
+    RequestPipeline pipeline(pool, gameCache);
+
+    Request echo = makeRequest(1, "2", "hello");
+    EXPECT_FALSE(pipeline.defer(echo));
+
+    Request missing = makeRequest(1, "3", "missing");
+    EXPECT_FALSE(pipeline.defer(missing));
+
+    Request newGame = makeRequest(1, "3", "simple");
+    ASSERT_TRUE(pipeline.defer(newGame));
+    EXPECT_EQ(pipeline.inFlight(), 1u);
+
+    auto prepared = waitForPrepared(pipeline);
+    ASSERT_EQ(prepared.size(), 1u);
+    EXPECT_EQ(prepared[0].client.id, 1u);
+    EXPECT_EQ(prepared[0].requestId, "7");
+    EXPECT_EQ(prepared[0].body, "simple");
+
+    // Loaded now, handled right away
+    Request again = makeRequest(1, "3", "simple");
+    EXPECT_FALSE(pipeline.defer(again));
+}
+
+TEST_F(RequestPipelineTest, DropsRequestsOfClientsThatLeft)
+{
+    GameManager gameManager(gameDirectory);
+    logic::GameDefinitionCache gameCache(gameManager);
+    PreparationPool pool(1);
+    RequestPipeline pipeline(pool, gameCache);
+
+    Request gone = makeRequest(1, "3", "simple");
+    Request staying = makeRequest(2, "3", "simple");
+    ASSERT_TRUE(pipeline.defer(gone));
+    ASSERT_TRUE(pipeline.defer(staying));
+    pipeline.forgetClient(1);
+
+    auto prepared = waitForPrepared(pipeline);
+    ASSERT_EQ(prepared.size(), 1u);
+    EXPECT_EQ(prepared[0].client.id, 2u);
+}
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "external/Request.h"
+#include "external/RequestScanner.h"
+
+namespace
+{
+    using json = nlohmann::json;
+
+    // Whether a JSON parser accepts the message
+    bool isJson(const std::string &message)
+    {
+        return json::accept(message);
+    }
+}
+
+TEST(RequestScannerTest, ReadsTheRequestFields)
+{
+    Request request(R"({"action":"11","body":"rock","sessionID":"ABCD","request_id":"7","target_var":"choice"})",
+                    Connection{5});
+
+    ASSERT_TRUE(request.isValid);
+    EXPECT_EQ(request.action, MessageType::INPUT_CHOICE);
+    EXPECT_EQ(request.body, "rock");
+    EXPECT_EQ(request.sessionId, "ABCD");
+    EXPECT_EQ(request.requestId, "7");
+    EXPECT_EQ(request.targetVar, "choice");
+    EXPECT_EQ(request.client.id, 5);
+}
+
+TEST(RequestScannerTest, FieldsViewTheMessage)
+{
+    std::string message = R"({ "body" : "hello", "action": "2" })";
+    auto scanned = scanRequest(message);
+
+    ASSERT_TRUE(scanned.has_value());
+    ASSERT_TRUE(scanned->body.has_value());
+    EXPECT_EQ(scanned->body->raw, "hello");
+    EXPECT_FALSE(scanned->body->escaped);
+    EXPECT_EQ(scanned->body->raw.data(), message.data() + message.find("hello"));
+    EXPECT_FALSE(scanned->sessionId.has_value());
+}
+
+TEST(RequestScannerTest, DecodesEscapes)
+{
+    Request request(R"({"action":"2","body":"a\"b\\c\/d\né😀"})", Connection{1});
+
+    ASSERT_TRUE(request.isValid);
+    EXPECT_EQ(request.body, "a\"b\\c/d\n\xC3\xA9\xF0\x9F\x98\x80");
+}
+
+TEST(RequestScannerTest, SkipsOtherMembers)
+{
+    Request request(R"({"extra":{"nested":[1,-2.5e3,true,false,null,{"body":"inner"}]},"body":"outer","action":"2"})",
+                    Connection{1});
+
+    ASSERT_TRUE(request.isValid);
+    EXPECT_EQ(request.body, "outer");
+    EXPECT_EQ(request.action, MessageType::ECHO);
+}
+
+TEST(RequestScannerTest, LaterMemberReplacesEarlier)
+{
+    Request request(R"({"body":"first","body":"second"})", Connection{1});
+
+    EXPECT_EQ(request.body, "second");
+}
+
+TEST(RequestScannerTest, UnknownActionsAreUndefined)
+{
+    EXPECT_EQ(Request(R"({"action":"100"})", Connection{1}).action, MessageType::UNDEFINED);
+    EXPECT_EQ(Request(R"({"action":"move"})", Connection{1}).action, MessageType::UNDEFINED);
+    EXPECT_EQ(Request(R"({"action":""})", Connection{1}).action, MessageType::UNDEFINED);
+    EXPECT_EQ(Request(R"({"body":"no action"})", Connection{1}).action, MessageType::UNDEFINED);
+    EXPECT_TRUE(Request(R"({"action":"move"})", Connection{1}).isValid);
+}
+
+TEST(RequestScannerTest, FieldsMustBeStrings)
+{
+    EXPECT_FALSE(Request(R"({"action":3})", Connection{1}).isValid);
+    EXPECT_FALSE(Request(R"({"body":["a"]})", Connection{1}).isValid);
+    EXPECT_TRUE(Request(R"({"other":3})", Connection{1}).isValid);
+}
+
+TEST(RequestScannerTest, AcceptsWhatAJsonParserAccepts)
+{
+    std::vector<std::string> messages = {
+        R"({"action":"2"})",
+        " \t\r\n{}\n",
+        "[]",
+        "\"text\"",
+        "42",
+        "-0.5E-2",
+        "null",
+        R"({"a":{"b":{"c":[[],[{}]]}}})",
+        R"({"a":"Aß"})",
+        "{\"a\":\"\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\"}",
+        // Rejected by both
+        "",
+        "INVALID!!",
+        "{",
+        R"({"action":"2"} trailing)",
+        R"({"action":"2",})",
+        R"({"a":01})",
+        R"({"a":1.})",
+        R"({"a":.5})",
+        R"({"a":tru})",
+        R"({"a":"\x"})",
+        R"({"a":"\ud800"})",
+        R"({"a":"\udc00"})",
+        R"({"a":"\u12G4"})",
+        "{\"a\":\"line\nbreak\"}",
+        "{\"a\":\"\xC0\xAF\"}",
+        "{\"a\":\"\xED\xA0\x80\"}",
+        "{\"a\":\"\xF4\x90\x80\x80\"}",
+        "{\"a\":\"\xE2\x82\"}",
+        R"({'a':1})",
+        R"({a:1})",
+        R"([1,2)",
+        R"("unterminated)",
+    };
+
+    for (const auto &message : messages)
+    {
+        EXPECT_EQ(scanRequest(message).has_value(), isJson(message)) << message;
+    }
+}
+
+TEST(RequestScannerTest, RefusesDeepNesting)
+{
+    std::string deep = "{\"a\":" + std::string(1000, '[') + std::string(1000, ']') + "}";
+
+    EXPECT_FALSE(scanRequest(deep).has_value());
+}
+
+TEST(RequestScannerTest, ArraysAreBatches)
+{
+    Request batch(R"( [{"action":"0","body":"ABCD","request_id":"1"}, {"action":"11","body":"rock","request_id":"2"}] )",
+                  Connection{3});
+
+    ASSERT_TRUE(batch.isValid);
+    ASSERT_EQ(batch.batch.size(), 2);
+    EXPECT_EQ(batch.batch[0].action, MessageType::JOIN);
+    EXPECT_EQ(batch.batch[1].body, "rock");
+    EXPECT_EQ(batch.batch[1].requestId, "2");
+    EXPECT_EQ(batch.batch[1].client.id, 3);
+    EXPECT_TRUE(batch.batch[1].isValid);
+
+    // The join decides where the batch goes
+    EXPECT_EQ(&routingRequestOf(batch), &batch.batch[0]);
+    EXPECT_EQ(&routingRequestOf(batch.batch[1]), &batch.batch[1]);
+}
+
+TEST(RequestScannerTest, BatchesHoldOnlyRequests)
+{
+    EXPECT_FALSE(Request("[]", Connection{1}).isValid);
+    EXPECT_FALSE(Request(R"([{"action":"2"}, 3])", Connection{1}).isValid);
+    EXPECT_FALSE(Request(R"([{"action":"2"}] {})", Connection{1}).isValid);
+    EXPECT_FALSE(Request(R"([{"action":2}])", Connection{1}).isValid);
+
+    std::string tooMany = "[";
+    for (size_t i = 0; i <= MAX_BATCH_REQUESTS; i++)
+    {
+        tooMany += i > 0 ? R"(,{"action":"2"})" : R"({"action":"2"})";
+    }
+    tooMany += "]";
+    EXPECT_FALSE(Request(tooMany, Connection{1}).isValid);
+}
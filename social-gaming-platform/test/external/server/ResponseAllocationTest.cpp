@@ -0,0 +1,133 @@
+/**
+ * Replaces the global allocation functions to count allocations, so it is
+ * built as its own test executable rather than into external_tests.
+ */
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <new>
+
+#include "external/Request.h"
+#include "external/RequestHandler.h"
+#include "external/ResponseRouting.h"
+
+namespace
+{
+    // Allocations made by this thread while counting
+    thread_local bool countingAllocations = false;
+    thread_local size_t allocations = 0;
+
+    void *allocate(size_t size, size_t alignment) noexcept
+    {
+        if (countingAllocations)
+        {
+            allocations++;
+        }
+        size = size == 0 ? 1 : size;
+        if (alignment <= alignof(std::max_align_t))
+        {
+            return std::malloc(size);
+        }
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    }
+
+    void *allocateOrThrow(size_t size, size_t alignment)
+    {
+        if (void *memory = allocate(size, alignment))
+        {
+            return memory;
+        }
+        throw std::bad_alloc();
+    }
+}
+
+void *operator new(size_t size) { return allocateOrThrow(size, 0); }
+void *operator new[](size_t size) { return allocateOrThrow(size, 0); }
+void *operator new(size_t size, std::align_val_t alignment) { return allocateOrThrow(size, size_t(alignment)); }
+void *operator new[](size_t size, std::align_val_t alignment) { return allocateOrThrow(size, size_t(alignment)); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return allocate(size, 0); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return allocate(size, 0); }
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept { return allocate(size, size_t(alignment)); }
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept { return allocate(size, size_t(alignment)); }
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete[](void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, size_t) noexcept { std::free(memory); }
+void operator delete(void *memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void *memory, const std::nothrow_t &) noexcept { std::free(memory); }
+void operator delete[](void *memory, const std::nothrow_t &) noexcept { std::free(memory); }
+void operator delete(void *memory, std::align_val_t, const std::nothrow_t &) noexcept { std::free(memory); }
+void operator delete[](void *memory, std::align_val_t, const std::nothrow_t &) noexcept { std::free(memory); }
+
+TEST(ResponseAllocationTest, EchoFromMessageToRoutedBroadcastOnlyAllocatesItsRecipients)
+{
+    SessionManager sessionManager;
+    GameManager gameManager((std::filesystem::temp_directory_path() / "response_allocation_test").string());
+    logic::Scheduler<logic::GameProcess> scheduler;
+    logic::GameDefinitionCache gameCache(gameManager);
+    RequestHandler requestHandler(sessionManager, gameManager, scheduler, gameCache);
+
+    GameData gameData;
+    Session *session = sessionManager.createSession(1, gameData).value();
+    for (uintptr_t player = 1; player <= 4; player++)
+    {
+        ASSERT_TRUE(sessionManager.addPlayer(*session, Connection{player}).has_value());
+    }
+
+    const std::string message = R"({"action":"2","body":"hello","request_id":"17"})";
+    std::deque<Broadcast> outgoing;
+    std::vector<SharedPayload> sent;
+    sent.reserve(8);
+
+    // Parse, handle, serialize and route to the session the way the server does,
+    // the payload is held by the recipients' queues until the next round trip
+    auto roundTrip = [&]()
+    {
+        sent.clear();
+        Request request(message, Connection{1});
+        routeResult(sessionManager, messageResultOf(request.client.id, requestHandler.handleRequest(request)), outgoing);
+        sent.insert(sent.end(), outgoing.front().recipients.size(), outgoing.front().payload);
+        size_t bytes = outgoing.front().payload->size();
+        outgoing.clear();
+        return bytes;
+    };
+
+    // The first round trips size the buffers, fill the payload pool and register the metrics
+    for (int i = 0; i < 3; i++)
+    {
+        roundTrip();
+    }
+
+    // The count does see allocations, aligned ones included
+    struct alignas(64) CacheLine
+    {
+        char bytes[64];
+    };
+    allocations = 0;
+    countingAllocations = true;
+    auto counted = std::make_unique<int>(1);
+    auto aligned = std::make_unique<CacheLine>();
+    countingAllocations = false;
+    ASSERT_EQ(allocations, 2);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(aligned.get()) % alignof(CacheLine), 0u);
+
+    allocations = 0;
+    countingAllocations = true;
+    size_t serialized = 0;
+    for (int i = 0; i < 1000; i++)
+    {
+        serialized += roundTrip();
+    }
+    countingAllocations = false;
+
+    // The recipient list of each broadcast is its only allocation
+    EXPECT_GT(serialized, 0);
+    EXPECT_EQ(sent.size(), 4);
+    EXPECT_EQ(allocations, 1000);
+}
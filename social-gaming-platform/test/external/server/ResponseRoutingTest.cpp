@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+
+#include "external/RequestHandler.h"
+#include "external/ResponseRouting.h"
+
+namespace
+{
+    Session *makeSession(SessionManager &sessionManager, uintptr_t players)
+    {
+        GameData gameData;
+        Session *session = sessionManager.createSession(1, gameData).value();
+        for (uintptr_t player = 1; player <= players; player++)
+        {
+            sessionManager.addPlayer(*session, Connection{player});
+        }
+        return session;
+    }
+
+    std::vector<uintptr_t> recipientIDs(const Broadcast &broadcast)
+    {
+        std::vector<uintptr_t> ids;
+        for (const auto &recipient : broadcast.recipients)
+        {
+            ids.push_back(recipient.id);
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+}
+
+TEST(ResponseRoutingTest, BroadcastsToEveryPlayerOrOnlyTheNamedOnes)
+{
+    SessionManager sessionManager;
+    std::expected<Session *, std::string_view> session = makeSession(sessionManager, 5);
+    auto payload = std::make_shared<const std::string>("update");
+
+    Broadcast everyone = buildBroadcast(payload, session, {});
+    EXPECT_EQ(recipientIDs(everyone), (std::vector<uintptr_t>{1, 2, 3, 4, 5}));
+    EXPECT_EQ(everyone.payload, payload);
+
+    // Named clients outside the session are not sent to
+    Broadcast named = buildBroadcast(payload, session, {4, 2, 9});
+    EXPECT_EQ(recipientIDs(named), (std::vector<uintptr_t>{2, 4}));
+}
+
+TEST(ResponseRoutingTest, RoutedResultSharesOnePayloadWithTheAudience)
+{
+    SessionManager sessionManager;
+    Session *session = makeSession(sessionManager, 3);
+    sessionManager.addAudienceMemberToSession(session->getJoinCode(), Connection{10});
+
+    std::deque<Broadcast> outgoing;
+    routeResult(sessionManager, MessageResult{"state", false, {}, true, 1}, outgoing);
+
+    ASSERT_EQ(outgoing.size(), 1);
+    EXPECT_EQ(recipientIDs(outgoing.front()), (std::vector<uintptr_t>{1, 2, 3, 10}));
+
+    std::deque<Message> messages;
+    appendMessages(outgoing, messages);
+    ASSERT_EQ(messages.size(), 4);
+    for (const auto &message : messages)
+    {
+        EXPECT_EQ(message.text, "state");
+    }
+}
+
+TEST(ResponseRoutingTest, SpectatorsGetTheEchoPayloadOfThePlayers)
+{
+    SessionManager sessionManager;
+    GameManager gameManager((std::filesystem::temp_directory_path() / "response_routing_test").string());
+    logic::Scheduler<logic::GameProcess> scheduler;
+    logic::GameDefinitionCache gameCache(gameManager);
+    RequestHandler requestHandler(sessionManager, gameManager, scheduler, gameCache);
+
+    Session *session = makeSession(sessionManager, 3);
+    ASSERT_TRUE(sessionManager.addAudienceMemberToSession(session->getJoinCode(), Connection{10}).has_value());
+
+    Request echo(R"({"action":"2","body":"hello","request_id":"1"})", Connection{1});
+    std::deque<Broadcast> outgoing;
+    routeResult(sessionManager, messageResultOf(echo.client.id, requestHandler.handleRequest(echo)), outgoing);
+
+    ASSERT_EQ(outgoing.size(), 1);
+    EXPECT_EQ(recipientIDs(outgoing.front()), (std::vector<uintptr_t>{1, 2, 3, 10}));
+
+    // Queued per recipient as the server does, the spectator holds the very payload the players do
+    const SharedPayload &payload = outgoing.front().payload;
+    long holders = payload.use_count();
+    std::map<uintptr_t, OutboundQueue> outbound;
+    for (const auto &recipient : outgoing.front().recipients)
+    {
+        outbound[recipient.id].push(payload);
+    }
+    EXPECT_EQ(payload.use_count(), holders + outbound.size());
+    EXPECT_NE(payload->find("hello"), std::string::npos);
+
+    // Replies to one player stay away from the audience
+    Request join(R"({"action":"0","body":"NOCODE","request_id":"2"})", Connection{2});
+    outgoing.clear();
+    routeResult(sessionManager, messageResultOf(join.client.id, requestHandler.handleRequest(join)), outgoing);
+    ASSERT_EQ(outgoing.size(), 1);
+    EXPECT_EQ(recipientIDs(outgoing.front()), (std::vector<uintptr_t>{2}));
+}
+
+TEST(ResponseRoutingTest, ClientsOutsideSessionsOnlyReachNamedRecipients)
+{
+    SessionManager sessionManager;
+
+    std::deque<Broadcast> outgoing;
+    routeResult(sessionManager, MessageResult{"reply", false, {7}, false, 7}, outgoing);
+    routeResult(sessionManager, MessageResult{"lost", false, {}, false, 8}, outgoing);
+    routeResult(sessionManager, MessageResult{"", false, {7}, false, 7}, outgoing);
+
+    ASSERT_EQ(outgoing.size(), 1);
+    EXPECT_EQ(*outgoing.front().payload, "reply");
+    EXPECT_EQ(recipientIDs(outgoing.front()), (std::vector<uintptr_t>{7}));
+}
+
+TEST(ResponseRoutingTest, BatchIsAnsweredInOneFrameToItsSender)
+{
+    SessionManager sessionManager;
+    makeSession(sessionManager, 3);
+
+    MessageResult batch{"", false, {}, false, 1};
+    batch.batchItems.push_back(MessageResult{R"({"request_id":"1"})", false, {1}, false, 1});
+    batch.batchItems.push_back(MessageResult{R"({"request_id":"2"})", false, {}, false, 1});
+
+    std::deque<Broadcast> outgoing;
+    routeResult(sessionManager, std::move(batch), outgoing);
+
+    // The second reply also reaches the rest of the session, without repeating it to the sender
+    ASSERT_EQ(outgoing.size(), 2);
+    EXPECT_EQ(*outgoing[0].payload, R"([{"request_id":"1"},{"request_id":"2"}])");
+    EXPECT_EQ(recipientIDs(outgoing[0]), (std::vector<uintptr_t>{1}));
+    EXPECT_EQ(*outgoing[1].payload, R"({"request_id":"2"})");
+    EXPECT_EQ(recipientIDs(outgoing[1]), (std::vector<uintptr_t>{2, 3}));
+}
+
+TEST(ResponseRoutingTest, FailedBatchRequestIsAnsweredWithAnError)
+{
+    Request batch(R"([{"action":"2","request_id":"1"},{"action":"2","request_id":"2"}])", Connection{1});
+
+    MessageResult result = batchResultOf(batch, [](Request &request)
+                                         {
+                                             if (request.requestId == "1")
+                                             {
+                                                 throw std::runtime_error("failed");
+                                             }
+                                             return MessageResult{"ok", false, {1}, false, 1}; });
+
+    ASSERT_EQ(result.batchItems.size(), 2);
+    EXPECT_NE(result.batchItems[0].result.find(R"("request_id":"1","success":false)"), std::string::npos);
+    EXPECT_EQ(result.batchItems[1].result, "ok");
+}
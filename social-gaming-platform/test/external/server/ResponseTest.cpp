@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <type_traits>
+
+#include "external/Response.h"
+
+namespace
+{
+    using json = nlohmann::json;
+
+    // Serialized the way a JSON library would, keys sorted and compact
+    std::string reserialized(const std::string &text)
+    {
+        return json::parse(text).dump();
+    }
+}
+
+TEST(ResponseTest, ResponsesMoveWithoutCopying)
+{
+    static_assert(std::is_nothrow_move_constructible_v<CommonResponse>);
+    static_assert(std::is_nothrow_move_assignable_v<Response>);
+
+    Response response = MessageResponse(CommonResponse("1", "hello", MessageType::MESSAGE, {1, 2, 3}));
+    const uintptr_t *ids = std::get<MessageResponse>(response).common.clientIds.data();
+
+    Response moved = std::move(response);
+    EXPECT_EQ(std::get<MessageResponse>(moved).common.clientIds.data(), ids);
+}
+
+TEST(ResponseTest, SerializesLikeAJsonObject)
+{
+    Response echo = MessageResponse(CommonResponse("gameIdXXXX", "Text To Echo", MessageType::MESSAGE, {}, true, "3", true));
+    EXPECT_EQ(serializeResponse(echo),
+              "{\"game_session_id\":\"gameIdXXXX\",\"message\":\"Text To Echo\",\"request_id\":\"3\",\"success\":true,\"type\":20}");
+
+    Response input = InputResponse(CommonResponse("7", "Pick one", MessageType::INPUT_CHOICE, {4, 5}, false), "choice", 30);
+    std::string serialized = serializeResponse(input);
+    EXPECT_EQ(serialized, reserialized(serialized));
+    EXPECT_EQ(serialized,
+              "{\"client_ids\":[4,5],\"game_session_id\":\"7\",\"message\":\"Pick one\",\"success\":false,"
+              "\"target_var\":\"choice\",\"timeout\":30,\"type\":11}");
+}
+
+TEST(ResponseTest, EscapesStrings)
+{
+    std::string message = "quote \" backslash \\ controls \b\f\n\r\t\x01\x1f unicode \xC3\xA9\xF0\x9F\x98\x80";
+    std::string serialized = serializeResponse(MessageResponse(CommonResponse("1", message, MessageType::MESSAGE)));
+
+    EXPECT_EQ(serialized, reserialized(serialized));
+    EXPECT_EQ(json::parse(serialized)["message"], message);
+}
+
+TEST(ResponseTest, ReplacesInvalidUtf8)
+{
+    std::string serialized = serializeResponse(MessageResponse(CommonResponse("1", "a\xFF" "b\xC3", MessageType::MESSAGE)));
+
+    EXPECT_EQ(json::parse(serialized)["message"], "a\xEF\xBF\xBD" "b\xEF\xBF\xBD");
+}
+
+TEST(ResponseTest, SerializingIntoTheBufferReusesIt)
+{
+    Response first = MessageResponse(CommonResponse("1", "first", MessageType::MESSAGE));
+    Response second = MessageResponse(CommonResponse("2", "second", MessageType::MESSAGE));
+
+    std::string_view serialized = serializeResponseToBuffer(first);
+    const char *buffer = serialized.data();
+    EXPECT_EQ(serialized, serializeResponse(first));
+
+    serialized = serializeResponseToBuffer(second);
+    EXPECT_EQ(serialized.data(), buffer);
+    EXPECT_EQ(serialized, serializeResponse(second));
+}
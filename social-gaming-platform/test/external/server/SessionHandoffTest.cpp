@@ -0,0 +1,265 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "external/SessionHandoff.h"
+#include "external/ShardTransport.h"
+
+namespace
+{
+    std::string socketPath()
+    {
+        return "/tmp/session-handoff-test-" + std::to_string(getpid()) + ".sock";
+    }
+
+    // Let frames cross the socket both ways
+    void pump(ShardLink &router, ShardTransport &backend)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            router.flush();
+            backend.update();
+        }
+    }
+}
+
+TEST(SessionHandoffTest, SocketsAndStateCrossTheHandoff)
+{
+    int channel[2], carried[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, channel), 0);
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, carried), 0);
+
+    Handoff handoff;
+    handoff.transport.descriptors = {carried[0]};
+    handoff.transport.state = "transport";
+    handoff.clients = {{3, WireFormat::JSON}, {4, WireFormat::COMPACT}};
+    handoff.sessions = std::string(100000, 's');
+
+    std::thread sender([&]()
+                       { EXPECT_TRUE(sendHandoff(channel[0], handoff, std::chrono::seconds(5)).has_value()); });
+    auto received = receiveHandoff(channel[1], std::chrono::seconds(5));
+    sender.join();
+
+    ASSERT_TRUE(received.has_value()) << received.error();
+    EXPECT_EQ(received->transport.state, "transport");
+    EXPECT_EQ(received->sessions, handoff.sessions);
+    ASSERT_EQ(received->clients.size(), 2u);
+    EXPECT_EQ(received->clients[1].id, 4u);
+    EXPECT_EQ(received->clients[1].wireFormat, WireFormat::COMPACT);
+
+    // The descriptor that arrived is the same socket
+    ASSERT_EQ(received->transport.descriptors.size(), 1u);
+    int adopted = received->transport.descriptors[0];
+    EXPECT_NE(adopted, carried[0]);
+    ASSERT_EQ(write(adopted, "x", 1), 1);
+    char byte = 0;
+    ASSERT_EQ(read(carried[1], &byte, 1), 1);
+    EXPECT_EQ(byte, 'x');
+
+    for (int fd : {channel[0], channel[1], carried[0], carried[1], adopted})
+    {
+        close(fd);
+    }
+}
+
+TEST(SessionHandoffTest, RejectsWhatIsNotAHandoff)
+{
+    int channel[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, channel), 0);
+
+    std::string garbage(64, 'g');
+    ASSERT_EQ(write(channel[0], garbage.data(), garbage.size()), static_cast<ssize_t>(garbage.size()));
+    close(channel[0]);
+
+    EXPECT_FALSE(receiveHandoff(channel[1], std::chrono::seconds(5)).has_value());
+    close(channel[1]);
+}
+
+TEST(SessionHandoffTest, RejectsACorruptClientCount)
+{
+    int channel[2], carried[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, channel), 0);
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, carried), 0);
+
+    // A handoff whose client count claims far more clients than follow
+    std::string body(HANDOFF_MAGIC);
+    auto append = [&body](auto value)
+    { body.append(reinterpret_cast<const char *>(&value), sizeof(value)); };
+    append(HANDOFF_VERSION);
+    append(uint32_t(1));
+    append(uint64_t(0));
+    append(uint32_t(0xFFFFFFFF));
+
+    std::string message;
+    uint64_t length = body.size();
+    message.append(reinterpret_cast<const char *>(&length), sizeof(length));
+    message.append(body);
+
+    // The descriptor rides on the first byte, as sendHandoff sends it
+    iovec first{message.data(), 1};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr header{};
+    header.msg_iov = &first;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+    cmsghdr *rights = CMSG_FIRSTHDR(&header);
+    rights->cmsg_level = SOL_SOCKET;
+    rights->cmsg_type = SCM_RIGHTS;
+    rights->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(rights), &carried[0], sizeof(int));
+    ASSERT_EQ(sendmsg(channel[0], &header, 0), 1);
+    ASSERT_EQ(write(channel[0], message.data() + 1, message.size() - 1), static_cast<ssize_t>(message.size() - 1));
+
+    auto received = receiveHandoff(channel[1], std::chrono::seconds(5));
+    ASSERT_FALSE(received.has_value());
+    EXPECT_EQ(received.error(), "Handoff is truncated");
+
+    for (int fd : {channel[0], channel[1], carried[0], carried[1]})
+    {
+        close(fd);
+    }
+}
+
+TEST(SessionHandoffTest, SuccessorKeepsTheRouterLink)
+{
+    const std::string path = socketPath();
+    auto listened = ShardTransport::listen(path);
+    ASSERT_TRUE(listened.has_value()) << listened.error();
+    std::unique_ptr<ShardTransport> old = std::move(listened.value());
+    std::vector<uintptr_t> disconnected;
+    old->setHandlers([](Connection) {}, [](Connection) {});
+
+    auto link = ShardLink::connect(path);
+    ASSERT_TRUE(link.has_value()) << link.error();
+    ShardLink &router = link.value();
+    router.queue(LinkFrameKind::CONNECT, 7);
+    router.queue(LinkFrameKind::MESSAGE, 7, "before");
+    router.queue(LinkFrameKind::CONNECT, 8);
+    pump(router, *old);
+    ASSERT_EQ(old->receive().size(), 1u);
+
+    // A message the old server has not taken yet, and client 8 leaving before the old server heard of it
+    router.queue(LinkFrameKind::MESSAGE, 7, "pending");
+    pump(router, *old);
+    router.queue(LinkFrameKind::DISCONNECT, 8);
+    router.flush();
+    old->send({Message{Connection{7}, "reply to before"}});
+
+    TransportHandoff handoff;
+    ASSERT_TRUE(old->handOff(handoff));
+    ASSERT_EQ(handoff.descriptors.size(), 2u);
+
+    // As another process would, the successor gets its own copies of the sockets
+    TransportHandoff received{{dup(handoff.descriptors[0]), dup(handoff.descriptors[1])}, handoff.state};
+    for (int fd : handoff.descriptors)
+    {
+        close(fd);
+    }
+    old.reset();
+
+    auto successor = ShardTransport::awaitHandoff(path);
+    successor->setHandlers([](Connection) {}, [&](Connection c)
+                           { disconnected.push_back(c.id); });
+    ASSERT_TRUE(successor->takeOver(received));
+
+    router.queue(LinkFrameKind::MESSAGE, 7, "after");
+    pump(router, *successor);
+    EXPECT_EQ(disconnected, std::vector<uintptr_t>{8});
+
+    auto messages = successor->receive();
+    ASSERT_EQ(messages.size(), 2u);
+    EXPECT_EQ(messages[0].connection.id, 7u);
+    EXPECT_EQ(messages[0].text, "pending");
+    EXPECT_EQ(messages[1].text, "after");
+
+    successor->send({Message{Connection{7}, "reply to after"}});
+    std::deque<LinkFrame> frames;
+    for (int i = 0; i < 10 && frames.size() < 2; i++)
+    {
+        successor->update();
+        router.receive(frames);
+    }
+    ASSERT_EQ(frames.size(), 2u);
+    EXPECT_EQ(frames[0].text, "reply to before");
+    EXPECT_EQ(frames[1].text, "reply to after");
+
+    // The old transport left the socket in place for a reconnecting router
+    router.close();
+    auto reconnected = ShardLink::connect(path);
+    EXPECT_TRUE(reconnected.has_value());
+}
+
+TEST(SessionHandoffTest, SuccessorFindsTheServingProcess)
+{
+    const std::string path = socketPath();
+    auto listener = HandoffListener::listen(path);
+    ASSERT_TRUE(listener.has_value()) << listener.error();
+    EXPECT_EQ(listener.value()->accept(), -1);
+
+    int carried[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, carried), 0);
+
+    bool committed = false;
+    std::thread serving([&]()
+                        {
+        int successor = -1;
+        for (int i = 0; i < 500 && successor == -1; i++)
+        {
+            successor = listener.value()->accept();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ASSERT_NE(successor, -1);
+        Handoff handoff;
+        handoff.transport.descriptors = {carried[0]};
+        handoff.sessions = "sessions";
+        EXPECT_TRUE(sendHandoff(successor, handoff, std::chrono::seconds(5)).has_value());
+        committed = commitHandoff(successor, std::chrono::seconds(5)).has_value();
+        close(successor); });
+
+    auto predecessor = connectForHandoff(path);
+    ASSERT_TRUE(predecessor.has_value()) << predecessor.error();
+    auto handoff = receiveHandoff(predecessor.value(), std::chrono::seconds(5));
+    auto confirmed = confirmHandoff(predecessor.value(), std::chrono::seconds(5));
+    close(predecessor.value());
+    serving.join();
+
+    ASSERT_TRUE(handoff.has_value()) << handoff.error();
+    EXPECT_EQ(handoff->sessions, "sessions");
+    EXPECT_TRUE(confirmed.has_value());
+    EXPECT_TRUE(committed);
+    ASSERT_EQ(handoff->transport.descriptors.size(), 1u);
+    close(handoff->transport.descriptors[0]);
+    close(carried[0]);
+    close(carried[1]);
+
+    // Nobody serves once the listener is gone
+    listener.value().reset();
+    EXPECT_FALSE(connectForHandoff(path).has_value());
+}
+
+TEST(SessionHandoffTest, ServingProcessKeepsServingWithoutConfirmation)
+{
+    int channel[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, channel), 0);
+
+    // The successor gave up after the handoff arrived
+    close(channel[1]);
+    EXPECT_FALSE(commitHandoff(channel[0], std::chrono::seconds(5)).has_value());
+    close(channel[0]);
+
+    // The serving process timed out and closed the connection before the successor was ready
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, channel), 0);
+    close(channel[0]);
+    EXPECT_FALSE(confirmHandoff(channel[1], std::chrono::seconds(5)).has_value());
+    close(channel[1]);
+
+    // Or it is still waiting, but the successor does not hear back in time
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, channel), 0);
+    EXPECT_FALSE(confirmHandoff(channel[1], std::chrono::milliseconds(50)).has_value());
+    close(channel[0]);
+    close(channel[1]);
+}
@@ -0,0 +1,260 @@
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "external/LoopbackTransport.h"
+#include "external/ShardRouter.h"
+#include "external/ShardTransport.h"
+
+namespace
+{
+    std::string socketPath(unsigned backend)
+    {
+        return "/tmp/shard-router-test-" + std::to_string(getpid()) + "-" + std::to_string(backend) + ".sock";
+    }
+
+    std::string message(const std::string &action, const std::string &body)
+    {
+        return R"({"action":")" + action + R"(","body":")" + body + R"(","request_id":"1"})";
+    }
+
+    /**
+     * A router in front of two backends, all in this process
+     */
+    class ShardRouterTest : public ::testing::Test
+    {
+    protected:
+        ServerOptions options;
+        LoopbackTransport *clients = nullptr;
+        std::vector<std::unique_ptr<ShardTransport>> backends;
+        std::vector<std::vector<uintptr_t>> connected = {{}, {}};
+        std::vector<std::vector<uintptr_t>> disconnected = {{}, {}};
+        std::unique_ptr<ShardRouter> router;
+
+        void SetUp() override
+        {
+            for (unsigned i = 0; i < 2; i++)
+            {
+                auto backend = ShardTransport::listen(socketPath(i));
+                ASSERT_TRUE(backend.has_value()) << backend.error();
+                backend.value()->setHandlers([this, i](Connection c)
+                                             { connected[i].push_back(c.id); },
+                                             [this, i](Connection c)
+                                             { disconnected[i].push_back(c.id); });
+                backends.push_back(std::move(backend.value()));
+            }
+
+            auto transport = std::make_unique<LoopbackTransport>();
+            clients = transport.get();
+            router = std::make_unique<ShardRouter>(std::move(transport), std::vector<std::string>{socketPath(0), socketPath(1)},
+                                                   1, options);
+            pump();
+        }
+
+        // Let frames cross the sockets both ways
+        void pump()
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                router->update();
+                for (auto &backend : backends)
+                {
+                    if (backend)
+                    {
+                        backend->update();
+                    }
+                }
+            }
+        }
+    };
+}
+
+TEST(ShardLinkTest, FramesCrossTheSocket)
+{
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    ShardLink writer(fds[0]);
+    ShardLink reader(fds[1]);
+
+    writer.queue(LinkFrameKind::CONNECT, 7);
+    writer.queue(LinkFrameKind::MESSAGE, 7, "hello");
+    writer.queue(LinkFrameKind::MESSAGE, 8, std::string(100000, 'x'));
+    writer.queue(LinkFrameKind::DISCONNECT, 7);
+
+    std::deque<LinkFrame> frames;
+    while (writer.pendingBytes() > 0 || frames.size() < 4)
+    {
+        ASSERT_TRUE(writer.flush());
+        ASSERT_TRUE(reader.receive(frames));
+    }
+
+    ASSERT_EQ(frames.size(), 4u);
+    EXPECT_EQ(frames[0].kind, LinkFrameKind::CONNECT);
+    EXPECT_EQ(frames[0].connectionId, 7u);
+    EXPECT_EQ(frames[1].text, "hello");
+    EXPECT_EQ(frames[2].connectionId, 8u);
+    EXPECT_EQ(frames[2].text.size(), 100000u);
+    EXPECT_EQ(frames[3].kind, LinkFrameKind::DISCONNECT);
+
+    writer.close();
+    EXPECT_FALSE(reader.receive(frames));
+    EXPECT_FALSE(reader.isOpen());
+}
+
+TEST_F(ShardRouterTest, ForwardsMessagesAndReplies)
+{
+    ASSERT_TRUE(router->isBackendConnected(0));
+    ASSERT_TRUE(router->isBackendConnected(1));
+
+    Connection client = clients->connect();
+    clients->sendToServer(client, message("2", "hello"));
+    pump();
+
+    unsigned backend = router->backendOf(client.id).value();
+    EXPECT_EQ(connected[backend], std::vector<uintptr_t>{client.id});
+    EXPECT_TRUE(connected[1 - backend].empty());
+
+    auto received = backends[backend]->receive();
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(received[0].connection.id, client.id);
+    EXPECT_EQ(received[0].text, message("2", "hello"));
+
+    backends[backend]->send({Message{client, "reply"}});
+    pump();
+
+    auto replies = clients->takeSent();
+    ASSERT_EQ(replies.size(), 1u);
+    EXPECT_EQ(replies[0].connection.id, client.id);
+    EXPECT_EQ(replies[0].text, "reply");
+}
+
+TEST_F(ShardRouterTest, JoinCodeNamesTheBackend)
+{
+    for (unsigned shard = 0; shard < 2; shard++)
+    {
+        Connection client = clients->connect();
+        clients->sendToServer(client, message("0", std::to_string(shard) + "ABCDE"));
+        pump();
+
+        EXPECT_EQ(router->backendOf(client.id), shard);
+        EXPECT_EQ(backends[shard]->receive().size(), 1u);
+    }
+}
+
+TEST_F(ShardRouterTest, JoiningElsewhereKeepsTheOldBackendUntilDisconnect)
+{
+    Connection client = clients->connect();
+    clients->sendToServer(client, message("0", "0ABCDE"));
+    pump();
+    clients->sendToServer(client, message("0", "1ABCDE"));
+    pump();
+
+    EXPECT_EQ(router->backendOf(client.id), 1u);
+    EXPECT_TRUE(disconnected[0].empty());
+    EXPECT_EQ(connected[1], std::vector<uintptr_t>{client.id});
+
+    clients->close(client);
+    pump();
+    EXPECT_EQ(disconnected[0], std::vector<uintptr_t>{client.id});
+    EXPECT_EQ(disconnected[1], std::vector<uintptr_t>{client.id});
+}
+
+TEST_F(ShardRouterTest, ClientInASessionStaysWithItsBackend)
+{
+    Connection client = clients->connect();
+    clients->sendToServer(client, message("0", "0ABCDE"));
+    pump();
+    ASSERT_EQ(backends[0]->receive().size(), 1u);
+    backends[0]->reportSeat(client, true);
+    pump();
+
+    // Its backend answers joining another session, which it refuses
+    clients->sendToServer(client, message("0", "1ABCDE"));
+    pump();
+    EXPECT_EQ(router->backendOf(client.id), 0u);
+    EXPECT_EQ(backends[0]->receive().size(), 1u);
+    EXPECT_TRUE(connected[1].empty());
+    EXPECT_TRUE(disconnected[0].empty());
+
+    // Once it left its session it may join elsewhere
+    backends[0]->reportSeat(client, false);
+    pump();
+    clients->sendToServer(client, message("0", "1ABCDE"));
+    pump();
+    EXPECT_EQ(router->backendOf(client.id), 1u);
+    EXPECT_EQ(backends[1]->receive().size(), 1u);
+}
+
+TEST_F(ShardRouterTest, ClientSeatedOnTwoBackendsKeepsTheFirst)
+{
+    // Both joins cross the router before either backend reports the client seated
+    Connection client = clients->connect();
+    clients->sendToServer(client, message("0", "0ABCDE"));
+    clients->sendToServer(client, message("0", "1ABCDE"));
+    pump();
+    backends[0]->reportSeat(client, true);
+    pump();
+    backends[1]->reportSeat(client, true);
+    pump();
+    pump();
+
+    EXPECT_TRUE(disconnected[0].empty());
+    EXPECT_EQ(disconnected[1], std::vector<uintptr_t>{client.id});
+    EXPECT_TRUE(clients->isOpen(client));
+
+    clients->sendToServer(client, message("2", "hello"));
+    pump();
+    EXPECT_EQ(backends[0]->receive().size(), 2u);
+}
+
+TEST_F(ShardRouterTest, DisconnectsReachTheBackend)
+{
+    Connection client = clients->connect();
+    clients->sendToServer(client, message("2", "hello"));
+    pump();
+    unsigned backend = router->backendOf(client.id).value();
+
+    clients->close(client);
+    pump();
+
+    EXPECT_FALSE(router->backendOf(client.id).has_value());
+    EXPECT_EQ(disconnected[backend], std::vector<uintptr_t>{client.id});
+}
+
+TEST_F(ShardRouterTest, BackendClosingAClientClosesItsConnection)
+{
+    Connection client = clients->connect();
+    clients->sendToServer(client, message("2", "hello"));
+    pump();
+    unsigned backend = router->backendOf(client.id).value();
+
+    backends[backend]->disconnect(client);
+    pump();
+
+    EXPECT_FALSE(clients->isOpen(client));
+}
+
+TEST_F(ShardRouterTest, LostBackendOnlyTakesItsClients)
+{
+    Connection first = clients->connect();
+    clients->sendToServer(first, message("0", "0ABCDE"));
+    Connection second = clients->connect();
+    clients->sendToServer(second, message("0", "1ABCDE"));
+    pump();
+
+    backends[0].reset();
+    pump();
+
+    EXPECT_FALSE(router->isBackendConnected(0));
+    EXPECT_FALSE(clients->isOpen(first));
+    EXPECT_TRUE(clients->isOpen(second));
+
+    // Joining a session on the lost backend is answered by the router
+    Connection third = clients->connect();
+    clients->sendToServer(third, message("0", "0ABCDE"));
+    pump();
+    auto replies = clients->takeSent();
+    ASSERT_EQ(replies.size(), 1u);
+    EXPECT_NE(replies[0].text.find("UNAVAILABLE"), std::string::npos) << replies[0].text;
+}
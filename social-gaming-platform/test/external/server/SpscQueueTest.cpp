@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+
+#include "external/SpscQueue.h"
+
+TEST(SpscQueueTest, KeepsOrderAndRejectsWhenFull)
+{
+    SpscQueue<std::string> queue(3);
+    EXPECT_EQ(queue.capacity(), 4);
+
+    for (int i = 0; i < 4; i++)
+    {
+        std::string value = std::to_string(i);
+        EXPECT_TRUE(queue.tryPush(std::move(value)));
+    }
+
+    std::string rejected = "rejected";
+    EXPECT_FALSE(queue.tryPush(std::move(rejected)));
+    EXPECT_EQ(rejected, "rejected");
+
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_EQ(queue.tryPop(), std::to_string(i));
+    }
+    EXPECT_FALSE(queue.tryPop().has_value());
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(SpscQueueTest, PassesEveryValueBetweenThreads)
+{
+    const int count = 20000;
+    SpscQueue<int> queue(64);
+
+    std::jthread producer([&]
+                          {
+        for (int i = 0; i < count; i++)
+        {
+            int value = i;
+            while (!queue.tryPush(std::move(value)))
+            {
+                std::this_thread::yield();
+            }
+        } });
+
+    for (int expected = 0; expected < count;)
+    {
+        if (auto value = queue.tryPop())
+        {
+            ASSERT_EQ(value.value(), expected);
+            expected++;
+        }
+    }
+}
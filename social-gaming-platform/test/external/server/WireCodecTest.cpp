@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "external/Request.h"
+#include "external/Response.h"
+#include "external/Utf8.h"
+#include "external/WireCodec.h"
+
+namespace
+{
+    bool isUtf8(std::string_view text)
+    {
+        for (size_t i = 0; i < text.size();)
+        {
+            size_t length = utf8SequenceLength(text.substr(i));
+            if (length == 0)
+            {
+                return false;
+            }
+            i += length;
+        }
+        return true;
+    }
+
+    const CommonResponse &commonOf(const Response &response)
+    {
+        return std::visit([](const auto &res) -> const CommonResponse &
+                          { return res.common; }, response);
+    }
+}
+
+TEST(WireCodecTest, RequestsRoundTrip)
+{
+    std::string frame = encodeCompactRequest(MessageType::INPUT_CHOICE, "rock \xC3\xA9", "42", "ABCD", "choice");
+    Request request(frame, Connection{5});
+
+    ASSERT_TRUE(request.isValid);
+    EXPECT_EQ(request.action, MessageType::INPUT_CHOICE);
+    EXPECT_EQ(request.body, "rock \xC3\xA9");
+    EXPECT_EQ(request.requestId, "42");
+    EXPECT_EQ(request.sessionId, "ABCD");
+    EXPECT_EQ(request.targetVar, "choice");
+    EXPECT_EQ(request.client.id, 5);
+
+    Request echo(encodeCompactRequest(MessageType::ECHO, "hello", "7"), Connection{5});
+    ASSERT_TRUE(echo.isValid);
+    EXPECT_EQ(echo.sessionId, "");
+    EXPECT_FALSE(echo.targetVar.has_value());
+}
+
+TEST(WireCodecTest, RequestFieldsViewTheFrame)
+{
+    std::string frame = encodeCompactRequest(MessageType::ECHO, std::string(200, 'x'), "1");
+    auto decoded = decodeCompactRequest(frame);
+
+    ASSERT_TRUE(decoded.has_value());
+    ASSERT_TRUE(decoded->fields.body.has_value());
+    EXPECT_EQ(decoded->fields.body->raw.size(), 200);
+    EXPECT_EQ(decoded->fields.body->raw.data(), frame.data() + frame.find('x'));
+    EXPECT_FALSE(decoded->fields.body->escaped);
+}
+
+TEST(WireCodecTest, ServerActionsAreUndefined)
+{
+    EXPECT_EQ(Request(encodeCompactRequest(MessageType::DISCONNECT, "", "1"), Connection{1}).action, MessageType::UNDEFINED);
+    EXPECT_EQ(Request(encodeCompactRequest(MessageType::UNDEFINED, "", "1"), Connection{1}).action, MessageType::UNDEFINED);
+}
+
+TEST(WireCodecTest, RejectsMalformedFrames)
+{
+    std::string frame = encodeCompactRequest(MessageType::INPUT_TEXT, "answer", "3", "ABCD");
+
+    EXPECT_TRUE(decodeCompactRequest(frame).has_value());
+    EXPECT_FALSE(decodeCompactRequest("").has_value());
+    EXPECT_FALSE(decodeCompactRequest("{}").has_value());
+    EXPECT_FALSE(decodeCompactRequest(frame.substr(0, frame.size() - 1)).has_value());
+    EXPECT_FALSE(decodeCompactRequest(frame + "x").has_value());
+    EXPECT_FALSE(decodeCompactRequest(std::string("\x01\x0B\x10", 3)).has_value());
+
+    // A field that is not UTF-8
+    EXPECT_FALSE(decodeCompactRequest(std::string("\x01\x0B\x01\x02\xC3(", 6)).has_value());
+    EXPECT_FALSE(Request(std::string("\x01\x0B\x01\x02\xC3(", 6), Connection{1}).isValid);
+}
+
+TEST(WireCodecTest, ResponsesRoundTrip)
+{
+    Response input = InputResponse(CommonResponse("7", "Pick one", MessageType::INPUT_CHOICE, {4, 5, uintptr_t(1) << 40}, false, "9"),
+                                   "choice", -30);
+    std::string frame = encodeCompactResponse(input);
+    auto decoded = decodeCompactResponse(frame);
+
+    ASSERT_TRUE(decoded.has_value());
+    ASSERT_TRUE(std::holds_alternative<InputResponse>(decoded.value()));
+    const auto &response = std::get<InputResponse>(decoded.value());
+    EXPECT_EQ(response.common.gameSessionId, "7");
+    EXPECT_EQ(response.common.message, "Pick one");
+    EXPECT_EQ(response.common.type, MessageType::INPUT_CHOICE);
+    EXPECT_EQ(response.common.clientIds, (std::vector<uintptr_t>{4, 5, uintptr_t(1) << 40}));
+    EXPECT_EQ(response.common.success, false);
+    EXPECT_EQ(response.common.requestId, "9");
+    EXPECT_EQ(response.targetVar, "choice");
+    EXPECT_EQ(response.timeout, -30);
+
+    Response score = MessageResponse(CommonResponse("ABCD", "alice: 3", MessageType::SCORE));
+    auto decodedScore = decodeCompactResponse(encodeCompactResponse(score));
+    ASSERT_TRUE(decodedScore.has_value());
+    ASSERT_TRUE(std::holds_alternative<MessageResponse>(decodedScore.value()));
+    EXPECT_EQ(commonOf(decodedScore.value()).type, MessageType::SCORE);
+    EXPECT_FALSE(commonOf(decodedScore.value()).success.has_value());
+    EXPECT_FALSE(commonOf(decodedScore.value()).requestId.has_value());
+    EXPECT_TRUE(commonOf(decodedScore.value()).clientIds.empty());
+}
+
+TEST(WireCodecTest, FramesAreText)
+{
+    Response response = MessageResponse(CommonResponse("1", "a\xFF" "b " + std::string(300, 'x'), MessageType::MESSAGE,
+                                                       {1000000}, true, "12345"));
+    std::string frame = encodeCompactResponse(response);
+
+    EXPECT_TRUE(isCompactFrame(frame));
+    EXPECT_TRUE(isUtf8(frame));
+
+    auto decoded = decodeCompactResponse(frame);
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(commonOf(decoded.value()).message.substr(0, 5), "a\xEF\xBF\xBD" "b");
+
+    EXPECT_TRUE(isUtf8(encodeCompactRequest(MessageType::INPUT_TEXT, std::string(5000, 'y'), "1", "ABCD", "answer")));
+}
+
+TEST(WireCodecTest, CompactResponsesAreSmaller)
+{
+    Response input = InputResponse(CommonResponse("ABCD", "Choose rock, paper or scissors", MessageType::INPUT_CHOICE, {4}),
+                                   "choice", 30);
+
+    EXPECT_LT(encodeCompactResponse(input).size(), serializeResponse(input).size());
+}
+
+TEST(WireCodecTest, ParsesFormatNames)
+{
+    EXPECT_EQ(parseWireFormat("json"), WireFormat::JSON);
+    EXPECT_EQ(parseWireFormat(wireFormatName(WireFormat::COMPACT)), WireFormat::COMPACT);
+    EXPECT_FALSE(parseWireFormat("cbor").has_value());
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+
+#include "data/data.h"
+
+class GameDirectoryWatcherTest : public ::testing::TestWithParam<bool> {
+protected:
+    const std::string gameDirectory = "game_directory_watcher_test";
+
+    std::mutex changesMutex;
+    std::condition_variable changesChanged;
+    std::vector<GameChange> changes;
+
+    void SetUp() override {
+        std::filesystem::create_directories(gameDirectory);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(gameDirectory);
+    }
+
+    GameDirectoryWatcher::ChangeCallback recorder() {
+        return [this](const GameChange &change) {
+            std::lock_guard<std::mutex> lock(changesMutex);
+            changes.push_back(change);
+            changesChanged.notify_all();
+        };
+    }
+
+    bool waitForChange(const std::string &gameName, bool removed) {
+        std::unique_lock<std::mutex> lock(changesMutex);
+        return changesChanged.wait_for(lock, std::chrono::seconds(5), [&] {
+            return std::any_of(changes.begin(), changes.end(), [&](const GameChange &change) {
+                return change.gameName == gameName && change.removed == removed;
+            });
+        });
+    }
+
+    void writeGame(const std::string &name) {
+        std::ofstream file(gameDirectory + "/" + name + ".game", std::ios::trunc);
+        file << "rules {}\n";
+    }
+};
+
+TEST_P(GameDirectoryWatcherTest, ReportsAddedAndRemovedGames) {
+    GameDirectoryWatcher watcher(gameDirectory, recorder(), std::chrono::milliseconds(50));
+    watcher.start(GetParam());
+
+    writeGame("added");
+    EXPECT_TRUE(waitForChange("added", false));
+
+    std::filesystem::remove(gameDirectory + "/added.game");
+    EXPECT_TRUE(waitForChange("added", true));
+}
+
+TEST_P(GameDirectoryWatcherTest, IgnoresOtherFiles) {
+    GameDirectoryWatcher watcher(gameDirectory, recorder(), std::chrono::milliseconds(50));
+    watcher.start(GetParam());
+
+    std::ofstream(gameDirectory + "/notes.txt") << "not a game";
+    writeGame("real");
+    ASSERT_TRUE(waitForChange("real", false));
+
+    std::lock_guard<std::mutex> lock(changesMutex);
+    for (const auto &change : changes) {
+        EXPECT_NE(change.gameName, "notes");
+    }
+}
+
+TEST_P(GameDirectoryWatcherTest, KeepsWatchingWhenTheDirectoryIsReplaced) {
+    writeGame("before");
+    GameDirectoryWatcher watcher(gameDirectory, recorder(), std::chrono::milliseconds(50));
+    watcher.start(GetParam());
+
+    std::filesystem::remove_all(gameDirectory);
+    EXPECT_TRUE(waitForChange("before", true));
+
+    std::filesystem::create_directories(gameDirectory);
+    writeGame("after");
+    EXPECT_TRUE(waitForChange("after", false));
+    EXPECT_FALSE(watcher.isUsingInotify());
+}
+
+INSTANTIATE_TEST_SUITE_P(InotifyAndPolling, GameDirectoryWatcherTest, ::testing::Values(false, true));
+
+TEST(GameManagerTest, AppliesChangesIncrementally) {
+    const std::string gameDirectory = "game_manager_apply_test";
+    std::filesystem::create_directories(gameDirectory);
+    GameManager gameManager(gameDirectory);
+
+    gameManager.applyChange({"first", false});
+    gameManager.applyChange({"second", false});
+    gameManager.applyChange({"first", false});
+    EXPECT_EQ(gameManager.listGameNames(), (std::vector<std::string>{"first", "second"}));
+
+    gameManager.applyChange({"first", true});
+    EXPECT_EQ(gameManager.listGameNames(), (std::vector<std::string>{"second"}));
+
+    std::filesystem::remove_all(gameDirectory);
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "data/logger.h"
+
+namespace {
+    std::string readAll(FILE *file) {
+        std::fflush(file);
+        std::rewind(file);
+        std::string contents;
+        char buffer[4096];
+        while (size_t count = std::fread(buffer, 1, sizeof(buffer), file)) {
+            contents.append(buffer, count);
+        }
+        return contents;
+    }
+
+    size_t countLines(const std::string &text) {
+        return std::count(text.begin(), text.end(), '\n');
+    }
+}
+
+TEST(LoggerTest, WritesStructuredRecords) {
+    FILE *output = std::tmpfile();
+    {
+        Logger logger(64, output);
+        logger.log(LogLevel::INFO, "server", "client connected",
+                   {{"client", uintptr_t(12)}, {"name", "two words"}, {"ok", true}, {"delta", -3}});
+        logger.flush();
+
+        std::string contents = readAll(output);
+        EXPECT_NE(contents.find("INFO    [server] client connected client=12 name=\"two words\" ok=true delta=-3\n"),
+                  std::string::npos) << contents;
+    }
+    std::fclose(output);
+}
+
+TEST(LoggerTest, KeepsRecordsOnOneLine) {
+    FILE *output = std::tmpfile();
+    {
+        Logger logger(64, output);
+        logger.log(LogLevel::WARNING, "request", "bad\nmessage", {{"text", std::string(1000, 'x')}});
+        logger.flush();
+
+        std::string contents = readAll(output);
+        EXPECT_EQ(countLines(contents), 1);
+        EXPECT_NE(contents.find("bad\\nmessage"), std::string::npos);
+        EXPECT_NE(contents.find("...\n"), std::string::npos);
+    }
+    std::fclose(output);
+}
+
+TEST(LoggerTest, IdleWriterWakesForNewRecords) {
+    FILE *output = std::tmpfile();
+    {
+        Logger logger(64, output);
+        for (int i = 0; i < 3; i++) {
+            // Long enough for the writer to be waiting when the record arrives
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            logger.log(LogLevel::INFO, "server", "tick");
+            logger.flush();
+            EXPECT_EQ(countLines(readAll(output)), i + 1);
+        }
+    }
+    std::fclose(output);
+}
+
+TEST(LoggerTest, DropsInsteadOfBlockingWhenFull) {
+    FILE *output = std::tmpfile();
+    {
+        Logger logger(4, output);
+        for (int i = 0; i < 10000; i++) {
+            logger.log(LogLevel::INFO, "test", "record", {{"i", i}});
+        }
+        logger.flush();
+
+        std::string contents = readAll(output);
+        EXPECT_EQ(countLines(contents) + logger.getDroppedCount(), 10000);
+    }
+    std::fclose(output);
+}
+
+TEST(LoggerTest, AcceptsRecordsFromManyThreads) {
+    FILE *output = std::tmpfile();
+    {
+        Logger logger(1 << 16, output);
+        {
+            std::vector<std::jthread> threads;
+            for (int t = 0; t < 4; t++) {
+                threads.emplace_back([&logger, t] {
+                    for (int i = 0; i < 1000; i++) {
+                        logger.log(LogLevel::INFO, "test", "record", {{"thread", t}, {"i", i}});
+                    }
+                });
+            }
+        }
+        logger.flush();
+
+        EXPECT_EQ(countLines(readAll(output)), 4000);
+        EXPECT_EQ(logger.getDroppedCount(), 0);
+    }
+    std::fclose(output);
+}
+
+TEST(LoggerTest, FiltersByLevel) {
+    Logger &logger = Logger::instance();
+    LogLevel previous = logger.getLevel();
+    logger.setLevel(LogLevel::WARNING);
+
+    int evaluated = 0;
+    auto sideEffect = [&evaluated] { return ++evaluated; };
+
+    EXPECT_FALSE(logger.isEnabled(LogLevel::INFO));
+    EXPECT_TRUE(logger.isEnabled(LogLevel::ERROR));
+    if constexpr (LOG_COMPILED_LEVEL > static_cast<int>(LogLevel::DEBUG)) {
+        LOG_DEBUG("test", "compiled out", {{"value", sideEffect()}});
+        EXPECT_EQ(evaluated, 0);
+    }
+
+    EXPECT_EQ(parseLogLevel("warning"), LogLevel::WARNING);
+    EXPECT_FALSE(parseLogLevel("loud").has_value());
+
+    logger.setLevel(previous);
+}
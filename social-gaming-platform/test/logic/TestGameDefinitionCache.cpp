@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "logic/GameDefinitionCache.h"
+
+namespace TestGameDefinitionCache
+{
+    const std::string gameDirectory = "game_definition_cache_test";
+
+    std::string sourceCode(std::string_view rules)
+    {
+        return std::string(
+                   "configuration {\n"
+                   "name: \"Simple\"\n"
+                   "player range: (2, 4)\n"
+                   "audience: false\n"
+                   "setup: {}\n"
+                   "}\n"
+                   "constants {}\n"
+                   "variables {}\n"
+                   "per-player {}\n"
+                   "per-audience {}\n"
+                   "rules {\n") +
+               std::string(rules) + "}\n";
+    }
+
+    void writeGame(const std::string &name, const std::string &contents)
+    {
+        std::ofstream file(gameDirectory + "/" + name + ".game", std::ios::trunc);
+        file << contents;
+    }
+
+    void bumpWriteTime(const std::string &name)
+    {
+        auto path = gameDirectory + "/" + name + ".game";
+        std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::seconds(1));
+    }
+
+    class GameDefinitionCacheTest : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            std::filesystem::create_directories(gameDirectory);
+        }
+
+        void TearDown() override
+        {
+            std::filesystem::remove_all(gameDirectory);
+        }
+    };
+}
+
+using namespace TestGameDefinitionCache;
+
+TEST_F(GameDefinitionCacheTest, ReusesCompiledGame)
+{
+    writeGame("simple", sourceCode("x <- 1;\n"));
+    GameManager gameManager(gameDirectory);
+    logic::GameDefinitionCache cache(gameManager);
+
+    auto first = cache.getGame("simple");
+    auto second = cache.getGame("simple");
+
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(first.value(), second.value());
+    EXPECT_EQ(first.value()->ruleSpecs.size(), 1);
+}
+
+TEST_F(GameDefinitionCacheTest, RecompilesChangedGame)
+{
+    writeGame("simple", sourceCode("x <- 1;\n"));
+    GameManager gameManager(gameDirectory);
+    logic::GameDefinitionCache cache(gameManager);
+
+    auto first = cache.getGame("simple");
+
+    writeGame("simple", sourceCode("x <- 1;\ny <- 2;\n"));
+    bumpWriteTime("simple");
+    auto second = cache.getGame("simple");
+
+    ASSERT_TRUE(second.has_value());
+    EXPECT_NE(first.value(), second.value());
+    EXPECT_EQ(second.value()->ruleSpecs.size(), 2);
+
+    // The previous definition is still usable by sessions holding it
+    EXPECT_EQ(first.value()->ruleSpecs.size(), 1);
+}
+
+TEST_F(GameDefinitionCacheTest, KeepsGameWhenOnlyTimestampChanged)
+{
+    writeGame("simple", sourceCode("x <- 1;\n"));
+    GameManager gameManager(gameDirectory);
+    logic::GameDefinitionCache cache(gameManager);
+
+    auto first = cache.getGame("simple");
+    bumpWriteTime("simple");
+    auto second = cache.getGame("simple");
+
+    EXPECT_EQ(first.value(), second.value());
+}
+
+TEST_F(GameDefinitionCacheTest, ReportsMissingAndInvalidGames)
+{
+    writeGame("broken", sourceCode("x <- 1\n"));
+    GameManager gameManager(gameDirectory);
+    logic::GameDefinitionCache cache(gameManager);
+
+    EXPECT_FALSE(cache.getGame("missing").has_value());
+    EXPECT_FALSE(cache.getGame("broken").has_value());
+    EXPECT_EQ(cache.size(), 0);
+}
+
+TEST_F(GameDefinitionCacheTest, NeedsLoadingUntilCachedAsOnDisk)
+{
+    writeGame("simple", sourceCode("x <- 1;\n"));
+    GameManager gameManager(gameDirectory);
+    logic::GameDefinitionCache cache(gameManager);
+
+    EXPECT_TRUE(cache.needsLoading("simple"));
+    EXPECT_FALSE(cache.needsLoading("missing"));
+
+    ASSERT_TRUE(cache.getGame("simple").has_value());
+    EXPECT_FALSE(cache.needsLoading("simple"));
+
+    bumpWriteTime("simple");
+    EXPECT_TRUE(cache.needsLoading("simple"));
+}
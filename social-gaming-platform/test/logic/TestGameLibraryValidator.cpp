@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "logic/GameLibraryValidator.h"
+
+namespace TestGameLibraryValidator
+{
+    const std::string gameDirectory = "game_library_validator_test";
+
+    const std::string validGame =
+        "configuration {\n"
+        "name: \"Simple\"\n"
+        "player range: (2, 4)\n"
+        "audience: false\n"
+        "setup: {}\n"
+        "}\n"
+        "constants {}\n"
+        "variables {}\n"
+        "per-player {}\n"
+        "per-audience {}\n"
+        "rules {\n"
+        "x <- 1;\n"
+        "}\n";
+
+    void writeGame(const std::string &name, const std::string &contents)
+    {
+        std::ofstream file(gameDirectory + "/" + name + ".game", std::ios::trunc);
+        file << contents;
+    }
+
+    class GameLibraryValidatorTest : public ::testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            std::filesystem::create_directories(gameDirectory);
+        }
+
+        void TearDown() override
+        {
+            std::filesystem::remove_all(gameDirectory);
+        }
+    };
+}
+
+using namespace TestGameLibraryValidator;
+
+TEST_F(GameLibraryValidatorTest, ReportsEveryGameInOrder)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        writeGame("game" + std::to_string(i), validGame);
+    }
+    writeGame("broken", "rules {\nx <- 1\n}\n");
+
+    GameManager gameManager(gameDirectory);
+    logic::GameLibraryValidator validator(gameManager, 4);
+    auto report = validator.validateAll();
+
+    auto gameNames = gameManager.listGameNames();
+    ASSERT_EQ(report.results.size(), gameNames.size());
+    for (size_t i = 0; i < gameNames.size(); i++)
+    {
+        EXPECT_EQ(report.results[i].gameName, gameNames[i]);
+        EXPECT_EQ(report.results[i].error.has_value(), gameNames[i] == "broken");
+    }
+    EXPECT_EQ(report.failureCount(), 1);
+}
+
+TEST_F(GameLibraryValidatorTest, WarmsCacheWithValidGames)
+{
+    writeGame("valid", validGame);
+    writeGame("broken", "rules {\nx <- 1\n}\n");
+
+    GameManager gameManager(gameDirectory);
+    logic::GameDefinitionCache cache(gameManager);
+    logic::GameLibraryValidator validator(gameManager, 2);
+    auto report = validator.validateAll(&cache);
+
+    EXPECT_EQ(cache.size(), 1);
+    auto cached = cache.getGame("valid");
+    ASSERT_TRUE(cached.has_value());
+    EXPECT_EQ(cached.value()->ruleSpecs.size(), 1);
+}
+
+TEST_F(GameLibraryValidatorTest, HandlesEmptyDirectory)
+{
+    GameManager gameManager(gameDirectory);
+    logic::GameLibraryValidator validator(gameManager);
+    auto report = validator.validateAll();
+
+    EXPECT_TRUE(report.results.empty());
+    EXPECT_EQ(report.failureCount(), 0);
+}
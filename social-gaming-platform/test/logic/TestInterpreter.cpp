@@ -141,4 +141,45 @@ TEST(InterpreterTests, NestedRules) {
     EXPECT_EQ(interpreter.executeRules(), logic::RuleExecutionOutcome::SUCCESS_DELIVERING_OUTPUT);
     EXPECT_EQ(interpreter.executeRules(), logic::RuleExecutionOutcome::SUCCESS_WAITING_FOR_INPUT);
     EXPECT_EQ(interpreter.executeRules(), logic::RuleExecutionOutcome::NO_MORE_RULES_TO_EXECUTE);
+};
+
+
+TEST(InterpreterTests, RestoresOnlyBetweenTopLevelRules) {
+    auto gameRules = []() {
+        logic::RuleSpecs nestedRules;
+        nestedRules.emplace_back(std::make_shared<TestInterpreter::MockRuleSpecification>(
+            0, logic::RuleExecutionOutcome::SUCCESS_DELIVERING_OUTPUT));
+        nestedRules.emplace_back(std::make_shared<TestInterpreter::MockRuleSpecification>(
+            0, logic::RuleExecutionOutcome::SUCCESS_WAITING_FOR_INPUT));
+
+        logic::RuleSpecStack ruleSpecStack;
+        ruleSpecStack.push(std::make_shared<TestInterpreter::MockRuleSpecification>(
+            0, logic::RuleExecutionOutcome::SUCCESS_WITH_NO_NESTED_RULES_REMAINING));
+        ruleSpecStack.push(std::make_shared<TestInterpreter::MockRuleSpecification>(
+            1, logic::RuleExecutionOutcome::SUCCESS_WITH_NESTED_RULES_REMAINING, std::move(nestedRules)));
+        return ruleSpecStack;
+    };
+    Session session;
+
+    logic::Interpreter interpreter = interpreterSetup(gameRules(), session);
+    EXPECT_EQ(interpreter.getState().topLevelRulesRemaining(), 2);
+
+    // Inside the first rule, a nested rule is still waiting
+    EXPECT_EQ(interpreter.executeRules(), logic::RuleExecutionOutcome::SUCCESS_DELIVERING_OUTPUT);
+    EXPECT_FALSE(interpreter.getState().isBetweenTopLevelRules());
+    EXPECT_FALSE(interpreterSetup(gameRules(), session).restorePosition(-2));
+
+    // The first rule is done, the game can resume from the second
+    EXPECT_EQ(interpreter.executeRules(), logic::RuleExecutionOutcome::SUCCESS_WAITING_FOR_INPUT);
+    EXPECT_TRUE(interpreter.getState().isBetweenTopLevelRules());
+    EXPECT_EQ(interpreter.getState().topLevelRulesRemaining(), 1);
+
+    logic::Interpreter restored = interpreterSetup(gameRules(), session);
+    EXPECT_TRUE(restored.restorePosition(1));
+    EXPECT_EQ(restored.getState().ruleSpecsRemaining(), 1);
+    EXPECT_EQ(restored.executeRules(), logic::RuleExecutionOutcome::NO_MORE_RULES_TO_EXECUTE);
+
+    // Not started, or past what the game has
+    EXPECT_TRUE(interpreterSetup(gameRules(), session).restorePosition(-1));
+    EXPECT_FALSE(interpreterSetup(gameRules(), session).restorePosition(3));
 };
\ No newline at end of file
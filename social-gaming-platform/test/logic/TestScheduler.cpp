@@ -1,3 +1,6 @@
+#include <chrono>
+#include <optional>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -158,3 +161,94 @@ TEST(SchedulerTests, ExecutesMultipleProcessesInParallel)
 //   scheduler.executeInParallel();
 //   EXPECT_TRUE(process.isDone());
 // };
+
+class TimedFakeProcess
+{
+public:
+  logic::ProcessID id;
+  bool waitingForInput = true;
+  bool done = false;
+  std::optional<std::chrono::steady_clock::time_point> wakeDeadline;
+  int wakes = 0;
+  int ticks = 0;
+};
+
+template <>
+class logic::ProcessTraits<TimedFakeProcess>
+{
+private:
+  TimedFakeProcess *process;
+
+public:
+  ProcessTraits(TimedFakeProcess *process) : process(process) {};
+
+  void tick()
+  {
+    process->ticks++;
+  }
+
+  bool isWaitingForIO() const
+  {
+    return process->waitingForInput;
+  }
+
+  bool isDone() const
+  {
+    return process->done;
+  }
+
+  logic::ProcessID getId() const
+  {
+    return process->id;
+  }
+
+  std::optional<std::chrono::steady_clock::time_point> getWakeDeadline() const
+  {
+    return process->wakeDeadline;
+  }
+
+  void wake()
+  {
+    process->wakeDeadline.reset();
+    process->waitingForInput = false;
+    process->wakes++;
+  }
+};
+
+TEST(SchedulerTests, WakesAProcessWhenItsDeadlinePasses)
+{
+  auto now = std::chrono::steady_clock::now();
+  TimedFakeProcess waiting{0, false};
+  waiting.wakeDeadline = now + std::chrono::milliseconds(20);
+  TimedFakeProcess answered{1, false};
+  answered.wakeDeadline = now + std::chrono::milliseconds(20);
+
+  logic::Scheduler<TimedFakeProcess> scheduler;
+  scheduler.addProcess(logic::ProcessTraits<TimedFakeProcess>(&waiting));
+  scheduler.addProcess(logic::ProcessTraits<TimedFakeProcess>(&answered));
+
+  // Both run once, then wait for their input with a timeout
+  scheduler.executeInParallel();
+  EXPECT_EQ(scheduler.getTimerCount(), 2);
+  EXPECT_GE(scheduler.nextTimerDeadline(), now + std::chrono::milliseconds(20));
+  EXPECT_LE(scheduler.nextTimerDeadline(), now + std::chrono::milliseconds(21));
+  waiting.waitingForInput = true;
+  answered.waitingForInput = true;
+  scheduler.executeInParallel();
+  EXPECT_EQ(scheduler.getWaitingCount(), 2);
+
+  // One gets its input in time, running clears its deadline
+  answered.waitingForInput = false;
+  answered.wakeDeadline.reset();
+  scheduler.executeInParallel();
+  scheduler.executeInParallel();
+  EXPECT_EQ(scheduler.getTimerCount(), 1);
+
+  std::this_thread::sleep_until(scheduler.nextTimerDeadline() + std::chrono::milliseconds(1));
+  scheduler.executeInParallel();
+
+  EXPECT_EQ(waiting.wakes, 1);
+  EXPECT_EQ(answered.wakes, 0);
+  EXPECT_EQ(scheduler.getTimerCount(), 0);
+  EXPECT_EQ(scheduler.nextTimerDeadline(), std::chrono::steady_clock::time_point::max());
+}
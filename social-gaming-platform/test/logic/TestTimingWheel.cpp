@@ -0,0 +1,144 @@
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "logic/scheduler/TimingWheel.h"
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+TEST(TimingWheelTests, FiresTimersAtTheirDeadline)
+{
+  auto start = Clock::now();
+  logic::TimingWheel<int> wheel(1ms, start);
+  std::vector<int> expired;
+
+  wheel.schedule(start + 10ms, 1);
+  wheel.schedule(start + 5ms, 2);
+  EXPECT_EQ(wheel.size(), 2);
+  EXPECT_EQ(wheel.nextDeadline(), start + 5ms);
+
+  wheel.advance(start + 4ms, expired);
+  EXPECT_TRUE(expired.empty());
+
+  wheel.advance(start + 5ms, expired);
+  EXPECT_EQ(expired, std::vector<int>{2});
+
+  wheel.advance(start + 20ms, expired);
+  EXPECT_EQ(expired, (std::vector<int>{2, 1}));
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_EQ(wheel.nextDeadline(), Clock::time_point::max());
+}
+
+TEST(TimingWheelTests, NeverFiresEarly)
+{
+  auto start = Clock::now();
+  logic::TimingWheel<int> wheel(10ms, start);
+  std::vector<int> expired;
+
+  // Between ticks, the deadline rounds up
+  wheel.schedule(start + 15ms, 1);
+  wheel.advance(start + 14ms, expired);
+  EXPECT_TRUE(expired.empty());
+  wheel.advance(start + 20ms, expired);
+  EXPECT_EQ(expired, std::vector<int>{1});
+
+  // A deadline already past fires on the next advance
+  wheel.schedule(start, 2);
+  wheel.advance(start + 30ms, expired);
+  EXPECT_EQ(expired, (std::vector<int>{1, 2}));
+}
+
+TEST(TimingWheelTests, CancelledTimersDoNotFire)
+{
+  auto start = Clock::now();
+  logic::TimingWheel<int> wheel(1ms, start);
+  std::vector<int> expired;
+
+  auto first = wheel.schedule(start + 3ms, 1);
+  auto second = wheel.schedule(start + 3ms, 2);
+  EXPECT_TRUE(wheel.cancel(first));
+  EXPECT_FALSE(wheel.cancel(first));
+  EXPECT_FALSE(wheel.isPending(first));
+  EXPECT_TRUE(wheel.isPending(second));
+
+  // The freed entry is reused, the old handle stays invalid
+  auto third = wheel.schedule(start + 3ms, 3);
+  EXPECT_EQ(third.index, first.index);
+  EXPECT_FALSE(wheel.cancel(first));
+
+  wheel.advance(start + 3ms, expired);
+  EXPECT_EQ(expired, (std::vector<int>{2, 3}));
+  EXPECT_FALSE(wheel.isPending(second));
+}
+
+TEST(TimingWheelTests, TimersMoveDownTheLevels)
+{
+  auto start = Clock::now();
+  logic::TimingWheel<int> wheel(1ms, start);
+  std::vector<int> expired;
+
+  // One timer in each level, and one past all of them
+  std::vector<std::chrono::milliseconds> delays = {40ms, 1000ms, 100000ms, 10000000ms, 30000000ms};
+  for (size_t i = 0; i < delays.size(); i++)
+  {
+    wheel.schedule(start + delays[i], static_cast<int>(i));
+  }
+
+  for (size_t i = 0; i < delays.size(); i++)
+  {
+    wheel.advance(start + delays[i] - 1ms, expired);
+    EXPECT_EQ(expired.size(), i) << "delay " << delays[i].count();
+    EXPECT_LE(wheel.nextDeadline(), start + delays[i]);
+
+    wheel.advance(start + delays[i], expired);
+    ASSERT_EQ(expired.size(), i + 1) << "delay " << delays[i].count();
+    EXPECT_EQ(expired.back(), static_cast<int>(i));
+  }
+}
+
+TEST(TimingWheelTests, HandlesManyPendingTimers)
+{
+  const int count = 100000;
+  auto start = Clock::now();
+  logic::TimingWheel<int> wheel(1ms, start);
+  std::mt19937 random(7);
+  std::uniform_int_distribution<int> delay(1, 600000);
+
+  std::vector<logic::TimerHandle> handles;
+  std::vector<int> deadlines;
+  for (int i = 0; i < count; i++)
+  {
+    deadlines.push_back(delay(random));
+    handles.push_back(wheel.schedule(start + std::chrono::milliseconds(deadlines.back()), i));
+  }
+  EXPECT_EQ(wheel.size(), count);
+
+  // Inputs arrive for every other player
+  for (int i = 0; i < count; i += 2)
+  {
+    EXPECT_TRUE(wheel.cancel(handles[i]));
+  }
+  EXPECT_EQ(wheel.size(), count / 2);
+
+  // Fired in deadline order, each once, none early
+  std::vector<int> expired;
+  int last = 0;
+  for (int now = 0; now <= 600000; now += 997)
+  {
+    size_t before = expired.size();
+    wheel.advance(start + std::chrono::milliseconds(now), expired);
+    for (size_t i = before; i < expired.size(); i++)
+    {
+      EXPECT_EQ(expired[i] % 2, 1);
+      EXPECT_LE(deadlines[expired[i]], now);
+      EXPECT_GE(deadlines[expired[i]], last);
+      last = deadlines[expired[i]];
+    }
+  }
+  wheel.advance(start + 601000ms, expired);
+  EXPECT_EQ(expired.size(), count / 2);
+  EXPECT_TRUE(wheel.empty());
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "data/metrics.h"
+
+TEST(MetricsTest, CounterSumsEveryThread) {
+    Counter counter;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; i++) {
+        threads.emplace_back([&counter]() {
+            for (int j = 0; j < 10000; j++) {
+                counter.add();
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(counter.value(), 80000u);
+}
+
+TEST(MetricsTest, HistogramBucketsByPowerOfTwo) {
+    Histogram histogram;
+    histogram.recordNanos(0);
+    histogram.recordNanos(1024);
+    histogram.recordNanos(1025);
+    histogram.recordNanos(3000);
+    histogram.record(std::chrono::hours(1));
+
+    Histogram::Snapshot snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 5u);
+    EXPECT_EQ(snapshot.buckets[0], 2u);
+    EXPECT_EQ(snapshot.buckets[1], 1u);
+    EXPECT_EQ(snapshot.buckets[2], 1u);
+    EXPECT_EQ(snapshot.buckets[Histogram::BUCKETS - 1], 1u);
+
+    EXPECT_DOUBLE_EQ(Histogram::upperBoundSeconds(0), 1024e-9);
+    EXPECT_TRUE(std::isinf(Histogram::upperBoundSeconds(Histogram::BUCKETS - 1)));
+}
+
+TEST(MetricsTest, LatencyHistogramKeepsTheRelativeErrorSmall) {
+    // Exact below 64ns, within one bucket width above
+    for (uint64_t nanos : {0ull, 1ull, 63ull, 64ull, 65ull, 1000ull, 123456ull, 987654321ull, 60000000000ull}) {
+        uint64_t highest = LatencyHistogram::highestOf(LatencyHistogram::bucketOf(nanos));
+        EXPECT_GE(highest, nanos);
+        EXPECT_LE(highest - nanos, nanos / LatencyHistogram::SUB_BUCKETS) << nanos;
+    }
+
+    // Buckets are contiguous
+    for (size_t bucket = 1; bucket < LatencyHistogram::BUCKETS; bucket++) {
+        uint64_t lowest = LatencyHistogram::highestOf(bucket - 1) + 1;
+        EXPECT_EQ(LatencyHistogram::bucketOf(lowest), bucket);
+    }
+
+    // Values past the range saturate in the last bucket
+    EXPECT_EQ(LatencyHistogram::bucketOf(UINT64_MAX), LatencyHistogram::BUCKETS - 1);
+}
+
+TEST(MetricsTest, LatencyHistogramQuantiles) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.quantileNanos(0.5), 0u);
+
+    // 1us to 1ms
+    for (uint64_t micros = 1; micros <= 1000; micros++) {
+        histogram.recordNanos(micros * 1000);
+    }
+
+    EXPECT_EQ(histogram.count(), 1000u);
+    for (double quantile : {0.5, 0.9, 0.99, 0.999}) {
+        double expected = quantile * 1e6;
+        EXPECT_NEAR(static_cast<double>(histogram.quantileNanos(quantile)), expected, expected * 0.04) << quantile;
+    }
+    EXPECT_GE(histogram.quantileNanos(1.0), 1000000u);
+}
+
+TEST(MetricsTest, RegistryReturnsTheSameMetric) {
+    MetricsRegistry registry;
+    Counter &first = registry.counter("requests_total", "Requests", "action=\"join\"");
+    Counter &second = registry.counter("requests_total", "Requests", "action=\"join\"");
+    Counter &other = registry.counter("requests_total", "Requests", "action=\"end\"");
+
+    EXPECT_EQ(&first, &second);
+    EXPECT_NE(&first, &other);
+}
+
+TEST(MetricsTest, RendersPrometheusText) {
+    MetricsRegistry registry;
+    registry.counter("requests_total", "Requests handled", "action=\"join\"").add(3);
+    registry.counter("requests_total", "Requests handled", "action=\"end\"").add();
+    registry.gauge("game_sessions", "Sessions").set(7);
+    registry.histogram("parse_duration_seconds", "Parse time").recordNanos(2000);
+
+    std::string text = registry.render();
+    EXPECT_NE(text.find("# HELP requests_total Requests handled\n# TYPE requests_total counter\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("requests_total{action=\"join\"} 3\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("requests_total{action=\"end\"} 1\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("# TYPE game_sessions gauge\ngame_sessions 7\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("# TYPE parse_duration_seconds histogram\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("parse_duration_seconds_bucket{le=\"+Inf\"} 1\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("parse_duration_seconds_count 1\n"), std::string::npos) << text;
+
+    // One HELP line per name, however many label sets
+    EXPECT_EQ(text.find("# HELP requests_total"), text.rfind("# HELP requests_total"));
+}
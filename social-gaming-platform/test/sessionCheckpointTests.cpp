@@ -0,0 +1,237 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "data/data.h"
+
+class SessionCheckpointTest : public ::testing::Test {
+protected:
+    GameData gameData;
+    std::string path = "session_checkpoint_test.bin";
+
+    void SetUp() override {
+        DataNode configNode;
+        configNode.setMapValue("name", create_string_node("Rock, Paper, Scissors"));
+        configNode.setMapValue("players", create_range_node(std::make_pair(2, 4)));
+        configNode.setMapValue("audience", create_bool_node(false));
+
+        DataNode winnersNode;
+        winnersNode.addVectorValue(create_string_node("Player1"));
+        winnersNode.addVectorValue(create_int_node(3));
+
+        DataNode variablesNode;
+        variablesNode.setMapValue("winners", winnersNode);
+        variablesNode.setMapValue("nothing", create_monostate_node());
+
+        gameData.configuration = Configuration(configNode);
+        gameData.variables = GameStateObject(variablesNode);
+    }
+
+    void TearDown() override {
+        std::remove(path.c_str());
+    }
+};
+
+TEST_F(SessionCheckpointTest, EncodeDecodeRoundTrip) {
+    Session session(7, gameData, "ABC123");
+    session.setGameName("RPS");
+    session.setInterpreterPosition(4);
+
+    std::string record;
+    encodeSession(record, session);
+    auto decoded = decodeSession(record);
+
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(decoded->getId(), 7);
+    EXPECT_EQ(decoded->getJoinCode(), "ABC123");
+    EXPECT_EQ(decoded->getGameName(), "RPS");
+    EXPECT_EQ(decoded->getInterpreterPosition(), 4);
+    EXPECT_EQ(decoded->getGameData().configuration.getDataNode(), gameData.configuration.getDataNode());
+    EXPECT_EQ(decoded->getGameData().variables.getDataNode(), gameData.variables.getDataNode());
+}
+
+TEST_F(SessionCheckpointTest, DecodeTruncatedRecordFails) {
+    Session session(7, gameData, "ABC123");
+
+    std::string record;
+    encodeSession(record, session);
+    record.resize(record.size() / 2);
+
+    EXPECT_FALSE(decodeSession(record).has_value());
+}
+
+TEST_F(SessionCheckpointTest, ReaderIndexesEverySession) {
+    CheckpointBuilder builder;
+    builder.addSession(Session(1, gameData, "AAAAAA"));
+    builder.addSession(Session(5, gameData, "BBBBBB"));
+
+    auto reader = CheckpointReader::fromBuffer(builder.finish());
+
+    ASSERT_TRUE(reader.has_value());
+    ASSERT_EQ(reader->getEntries().size(), 2);
+    EXPECT_EQ(reader->getMaxSessionId(), 5);
+    EXPECT_EQ(reader->getEntries().at(1).joinCode, "BBBBBB");
+    EXPECT_EQ(decodeSession(reader->getRecord(reader->getEntries().at(1)))->getId(), 5);
+}
+
+TEST_F(SessionCheckpointTest, RejectsInvalidImage) {
+    EXPECT_FALSE(CheckpointReader::fromBuffer("not a checkpoint").has_value());
+    EXPECT_FALSE(CheckpointReader::open("missing_checkpoint.bin").has_value());
+}
+
+TEST_F(SessionCheckpointTest, RejectsCorruptSessionCount) {
+    CheckpointBuilder builder;
+    builder.addSession(Session(1, gameData, "AAAAAA"));
+    std::string image = builder.finish();
+
+    // The count follows the magic and the version
+    const uint32_t count = 0xFFFFFFFF;
+    std::memcpy(image.data() + CHECKPOINT_MAGIC.size() + sizeof(uint32_t), &count, sizeof(count));
+
+    auto reader = CheckpointReader::fromBuffer(image);
+    ASSERT_FALSE(reader.has_value());
+    EXPECT_EQ(reader.error(), "Checkpoint index is truncated");
+}
+
+TEST_F(SessionCheckpointTest, AcceptsAnIndexOfTheSmallestEntries) {
+    // Entries without a join code are as small as the index allows
+    CheckpointBuilder builder;
+    for (int id = 1; id <= 5; id++) {
+        builder.addSession(Session(id, gameData, ""));
+    }
+
+    auto reader = CheckpointReader::fromBuffer(builder.finish());
+    ASSERT_TRUE(reader.has_value()) << reader.error();
+    EXPECT_EQ(reader->getEntries().size(), 5);
+}
+
+TEST_F(SessionCheckpointTest, SessionManagerRestoresLazily) {
+    SessionManager before;
+    Session *first = before.createSession(1, gameData).value();
+    Session *second = before.createSession(2, gameData).value();
+    first->setGameName("RPS");
+    const std::string joinCode = second->getJoinCode();
+    const int secondId = second->getId();
+
+    ASSERT_TRUE(before.writeCheckpoint(path).has_value());
+
+    SessionManager after;
+    int restoredCount = 0;
+    after.setRestoreCallback([&restoredCount](Session &) { restoredCount++; return true; });
+
+    auto restored = after.restoreFromCheckpoint(path);
+    ASSERT_TRUE(restored.has_value());
+    EXPECT_EQ(restored.value(), 2);
+    EXPECT_EQ(after.pendingRestoreCount(), 2);
+    EXPECT_EQ(restoredCount, 0);
+
+    auto session = after.getSession(joinCode);
+    ASSERT_TRUE(session.has_value());
+    EXPECT_EQ(session.value()->getId(), secondId);
+    EXPECT_EQ(after.pendingRestoreCount(), 1);
+    EXPECT_EQ(restoredCount, 1);
+
+    // New sessions must not reuse a checkpointed id
+    Session *created = after.createSession(3, gameData).value();
+    EXPECT_GT(created->getId(), secondId);
+}
+
+TEST_F(SessionCheckpointTest, SessionThatCannotResumeIsDropped) {
+    SessionManager before;
+    Session *stuck = before.createSession(1, gameData).value();
+    stuck->setInterpreterPosition(-2);
+    const std::string stuckCode = stuck->getJoinCode();
+    const std::string fineCode = before.createSession(2, gameData).value()->getJoinCode();
+    ASSERT_TRUE(before.writeCheckpoint(path).has_value());
+
+    SessionManager after;
+    after.setRestoreCallback([](Session &session) { return session.getInterpreterPosition() != -2; });
+    ASSERT_TRUE(after.restoreFromCheckpoint(path).has_value());
+
+    EXPECT_FALSE(after.getSession(stuckCode).has_value());
+    EXPECT_FALSE(after.isSessionExists(stuckCode));
+    EXPECT_TRUE(after.getSession(fineCode).has_value());
+}
+
+TEST_F(SessionCheckpointTest, CheckpointKeepsUntouchedSessions) {
+    SessionManager before;
+    const std::string joinCode = before.createSession(1, gameData).value()->getJoinCode();
+    ASSERT_TRUE(before.writeCheckpoint(path).has_value());
+
+    SessionManager middle;
+    ASSERT_TRUE(middle.restoreFromCheckpoint(path).has_value());
+    ASSERT_TRUE(middle.writeCheckpoint(path).has_value());
+
+    SessionManager after;
+    ASSERT_TRUE(after.restoreFromCheckpoint(path).has_value());
+    EXPECT_TRUE(after.isSessionExists(joinCode));
+}
+
+TEST_F(SessionCheckpointTest, SnapshotKeepsSessionMembers) {
+    SessionManager before;
+    Session *played = before.createSession(1, gameData).value();
+    ASSERT_TRUE(before.addPlayer(*played, Connection{1}).has_value());
+    ASSERT_TRUE(before.addPlayerToSession(played->getJoinCode(), Connection{2}).has_value());
+    played->getAudience().add(Connection{9});
+    const int playedId = played->getId();
+    const std::string emptyCode = before.createSession(3, gameData).value()->getJoinCode();
+
+    SnapshotBuilder builder;
+    before.addToSnapshot(builder);
+    auto snapshot = SnapshotReader::fromBuffer(builder.finish());
+    ASSERT_TRUE(snapshot.has_value()) << snapshot.error();
+
+    SessionManager after;
+    int restoredCount = 0;
+    after.setRestoreCallback([&restoredCount](Session &) { restoredCount++; return true; });
+
+    auto restored = after.restoreSnapshot(snapshot.value());
+    ASSERT_TRUE(restored.has_value());
+    EXPECT_EQ(restored.value(), 2);
+    EXPECT_EQ(restoredCount, 2);
+    EXPECT_EQ(after.pendingRestoreCount(), 0);
+    EXPECT_TRUE(after.isSessionExists(emptyCode));
+
+    auto session = after.findSessionByPlayer(2);
+    ASSERT_TRUE(session.has_value());
+    EXPECT_EQ(session.value()->getId(), playedId);
+    EXPECT_EQ(session.value()->getPlayers().size(), 2);
+    EXPECT_TRUE(session.value()->getAudience().contains(9));
+
+    // Members leave restored sessions like any other
+    EXPECT_EQ(after.removeClient(1), playedId);
+    EXPECT_FALSE(after.findSessionByPlayer(1).has_value());
+    after.removeClient(9);
+    EXPECT_FALSE(session.value()->getAudience().contains(9));
+}
+
+TEST_F(SessionCheckpointTest, SnapshotGoesToTheOwningShard) {
+    SessionManager first(0, 2);
+    SessionManager second(1, 2);
+    const std::string firstCode = first.createSession(1, gameData).value()->getJoinCode();
+    const std::string secondCode = second.createSession(2, gameData).value()->getJoinCode();
+
+    SnapshotBuilder builder;
+    first.addToSnapshot(builder);
+    second.addToSnapshot(builder);
+    auto snapshot = SnapshotReader::fromBuffer(builder.finish());
+    ASSERT_TRUE(snapshot.has_value()) << snapshot.error();
+
+    SessionManager restored(1, 2);
+    EXPECT_EQ(restored.restoreSnapshot(snapshot.value()).value(), 1);
+    EXPECT_TRUE(restored.isSessionExists(secondCode));
+    EXPECT_FALSE(restored.isSessionExists(firstCode));
+}
+
+TEST_F(SessionCheckpointTest, RejectsTruncatedSnapshot) {
+    SessionManager before;
+    ASSERT_TRUE(before.addPlayer(*before.createSession(1, gameData).value(), Connection{1}).has_value());
+
+    SnapshotBuilder builder;
+    before.addToSnapshot(builder);
+    std::string image = builder.finish();
+
+    EXPECT_FALSE(SnapshotReader::fromBuffer(image.substr(0, image.size() - 4)).has_value());
+    EXPECT_FALSE(SnapshotReader::fromBuffer("short").has_value());
+}
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include "data/data.h"
+#include "data/session/manager.h"
+
+TEST(SessionMembershipTest, FindsSessionOfEachPlayer) {
+    SessionManager manager;
+    GameData gameData;
+
+    Session *first = manager.createSession(1, gameData).value();
+    Session *second = manager.createSession(2, gameData).value();
+    ASSERT_TRUE(manager.addPlayer(*first, {1}).has_value());
+    ASSERT_TRUE(manager.addPlayer(*second, {2}).has_value());
+    ASSERT_TRUE(manager.addPlayerToSession(first->getJoinCode(), {3}).has_value());
+
+    EXPECT_EQ(manager.findSessionByPlayer(1).value(), first);
+    EXPECT_EQ(manager.findSessionByPlayer(2).value(), second);
+    EXPECT_EQ(manager.findSessionByPlayer(3).value(), first);
+    EXPECT_FALSE(manager.findSessionByPlayer(4).has_value());
+
+    EXPECT_FALSE(manager.addPlayer(*second, {3}).has_value());
+    EXPECT_FALSE(manager.addPlayerToSession(second->getJoinCode(), {1}).has_value());
+}
+
+TEST(SessionMembershipTest, RemoveClientLeavesTheirSession) {
+    SessionManager manager;
+    GameData gameData;
+
+    Session *played = manager.createSession(1, gameData).value();
+    Session *watched = manager.createSession(2, gameData).value();
+    ASSERT_TRUE(manager.addPlayer(*played, {1}).has_value());
+    ASSERT_TRUE(manager.addPlayer(*watched, {2}).has_value());
+    ASSERT_TRUE(manager.addAudienceMemberToSession(watched->getJoinCode(), {3}).has_value());
+
+    EXPECT_EQ(manager.removeClient(1), played->getId());
+    EXPECT_TRUE(played->getPlayers().empty());
+    EXPECT_FALSE(manager.findSessionByPlayer(1).has_value());
+
+    EXPECT_FALSE(manager.removeClient(3).has_value());
+    EXPECT_FALSE(watched->getAudience().contains(3));
+
+    // Gone clients can start over
+    EXPECT_FALSE(manager.removeClient(1).has_value());
+    EXPECT_TRUE(manager.addPlayerToSession(watched->getJoinCode(), {1}).has_value());
+    EXPECT_TRUE(manager.addPlayerToSession(played->getJoinCode(), {3}).has_value());
+}
+
+TEST(SessionMembershipTest, ClientsAreInOneSessionAtATime) {
+    SessionManager manager;
+    GameData gameData;
+
+    Session *played = manager.createSession(1, gameData).value();
+    Session *watched = manager.createSession(2, gameData).value();
+    ASSERT_TRUE(manager.addPlayer(*played, {1}).has_value());
+    ASSERT_TRUE(manager.addPlayer(*watched, {2}).has_value());
+    ASSERT_TRUE(manager.addAudienceMemberToSession(watched->getJoinCode(), {3}).has_value());
+
+    EXPECT_EQ(manager.addAudienceMemberToSession(watched->getJoinCode(), {1}).error(), "Player is already in another session");
+    EXPECT_EQ(manager.addPlayerToSession(played->getJoinCode(), {3}).error(), "Player is already in another session");
+    EXPECT_EQ(manager.addPlayerToSession("NOCODE", {1}).error(), "Player is already in another session");
+    EXPECT_FALSE(manager.createSession(3, gameData).has_value());
+    EXPECT_EQ(manager.addAudienceMemberToSession(watched->getJoinCode(), {3}).error(), "Already in the audience of this session");
+    EXPECT_EQ(manager.addPlayerToSession(played->getJoinCode(), {1}).error(), "Player is already in this session");
+
+    EXPECT_EQ(played->getPlayers().size(), 1u);
+    EXPECT_EQ(watched->getPlayers().size(), 1u);
+    EXPECT_TRUE(watched->getAudience().contains(3));
+}
+
+TEST(SessionMembershipTest, ManagersSharingClientsKeepThemInOneSession) {
+    std::unordered_map<uintptr_t, SessionManager *> seats;
+    SessionManager first(0, 2);
+    SessionManager second(1, 2);
+    for (SessionManager *manager : {&first, &second})
+    {
+        manager->setMembershipCallbacks([&seats, manager](uintptr_t client)
+                                        { return seats.try_emplace(client, manager).first->second == manager; },
+                                        [&seats](uintptr_t client)
+                                        { seats.erase(client); });
+    }
+    GameData gameData;
+
+    Session *played = first.createSession(1, gameData).value();
+    ASSERT_TRUE(first.addPlayer(*played, {1}).has_value());
+    Session *other = second.createSession(2, gameData).value();
+    ASSERT_TRUE(second.addPlayer(*other, {2}).has_value());
+
+    EXPECT_EQ(second.addPlayerToSession(other->getJoinCode(), {1}).error(), "Player is already in another session");
+    EXPECT_EQ(second.addAudienceMemberToSession(other->getJoinCode(), {1}).error(), "Player is already in another session");
+    EXPECT_FALSE(second.addPlayer(*other, {1}).has_value());
+    EXPECT_EQ(other->getPlayers().size(), 1u);
+    EXPECT_FALSE(other->getAudience().contains(1));
+
+    // Leaving the session on one manager frees the client for the others
+    first.removeClient(1);
+    EXPECT_FALSE(seats.contains(1));
+    EXPECT_TRUE(second.addAudienceMemberToSession(other->getJoinCode(), {1}).has_value());
+    EXPECT_EQ(seats.at(1), &second);
+
+    ASSERT_TRUE(second.destroySession(other->getId()).has_value());
+    EXPECT_TRUE(seats.empty());
+}
+
+TEST(SessionMembershipTest, JoiningAsPlayerLeavesTheAudience) {
+    SessionManager manager;
+    GameData gameData;
+
+    Session *session = manager.createSession(1, gameData).value();
+    ASSERT_TRUE(manager.addAudienceMemberToSession(session->getJoinCode(), {2}).has_value());
+    ASSERT_TRUE(manager.addPlayerToSession(session->getJoinCode(), {2}).has_value());
+    EXPECT_FALSE(session->getAudience().contains(2));
+
+    EXPECT_EQ(manager.removeClient(2), session->getId());
+    EXPECT_TRUE(session->getPlayers().empty());
+}
+
+TEST(SessionMembershipTest, DestroyedSessionsReleaseTheirMembers) {
+    SessionManager manager;
+    GameData gameData;
+
+    Session *session = manager.createSession(1, gameData).value();
+    int sessionId = session->getId();
+    ASSERT_TRUE(manager.addPlayer(*session, {1}).has_value());
+    ASSERT_TRUE(manager.addAudienceMemberToSession(session->getJoinCode(), {2}).has_value());
+
+    ASSERT_TRUE(manager.destroySession(sessionId).has_value());
+    EXPECT_FALSE(manager.findSessionByPlayer(1).has_value());
+    EXPECT_FALSE(manager.removeClient(1).has_value());
+    EXPECT_FALSE(manager.removeClient(2).has_value());
+    EXPECT_TRUE(manager.createSession(1, gameData).has_value());
+}
+
+TEST(SessionMembershipTest, SlowClientsHoldTheirSessionPaused) {
+    SessionManager manager;
+    GameData gameData;
+
+    Session *session = manager.createSession(1, gameData).value();
+    ASSERT_TRUE(manager.addPlayer(*session, {1}).has_value());
+    ASSERT_TRUE(manager.addPlayerToSession(session->getJoinCode(), {2}).has_value());
+
+    EXPECT_FALSE(manager.pauseSessionFor(3));
+    EXPECT_TRUE(manager.pauseSessionFor(1));
+    EXPECT_TRUE(manager.pauseSessionFor(1));
+    EXPECT_TRUE(manager.pauseSessionFor(2));
+    EXPECT_TRUE(session->isPaused());
+
+    // Paused until every client holding it resumes or leaves
+    manager.resumeSessionFor(1);
+    EXPECT_TRUE(session->isPaused());
+    manager.removeClient(2);
+    EXPECT_FALSE(session->isPaused());
+    manager.resumeSessionFor(1);
+    EXPECT_FALSE(session->isPaused());
+}
@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+
+#include "data/data.h"
+#include "data/session/manager.h"
+
+TEST(SessionShardingTest, SingleShardKeepsSequentialIds) {
+    SessionManager manager;
+    GameData gameData;
+
+    auto first = manager.createSession(1, gameData);
+    auto second = manager.createSession(2, gameData);
+
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(first.value()->getId(), 1);
+    EXPECT_EQ(second.value()->getId(), 2);
+}
+
+TEST(SessionShardingTest, ShardsHandOutDisjointIdsAndNameThemselvesInJoinCodes) {
+    const unsigned shardCount = 4;
+    GameData gameData;
+
+    for (unsigned shard = 0; shard < shardCount; shard++) {
+        SessionManager manager(shard, shardCount);
+
+        for (uintptr_t player = 1; player <= 3; player++) {
+            auto session = manager.createSession(player, gameData);
+            ASSERT_TRUE(session.has_value());
+            EXPECT_EQ(session.value()->getId() % shardCount, shard);
+            EXPECT_EQ(SessionManager::shardOfJoinCode(session.value()->getJoinCode(), shardCount), shard);
+        }
+    }
+}
+
+TEST(SessionShardingTest, RejectsMalformedJoinCodes) {
+    EXPECT_FALSE(SessionManager::shardOfJoinCode("", 4).has_value());
+    EXPECT_FALSE(SessionManager::shardOfJoinCode("0ABC", 4).has_value());
+    EXPECT_FALSE(SessionManager::shardOfJoinCode("Z12345", 4).has_value());
+    EXPECT_FALSE(SessionManager::shardOfJoinCode("-12345", 4).has_value());
+    EXPECT_EQ(SessionManager::shardOfJoinCode("312345", 4), 3u);
+}